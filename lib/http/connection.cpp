@@ -64,8 +64,8 @@ connection::do_read()
             }
             else if (result == request_parser::good)
             {
-                request_handler_.handle_request(request_, reply_);
-                do_write();
+                request_handler_.handle_request(request_, reply_,
+                                                [this, self]() { do_write(); });
             }
             else
             {
@@ -53,6 +53,19 @@ void server::add404(routeHandler callback)
 
 void
 server::addRoute(const std::string& routeName, routeHandler callback)
+{
+    mRoutes[routeName] = [callback](const std::string& params,
+                                    responder respond)
+    {
+        std::string content;
+        callback(params, content);
+        respond(content);
+    };
+}
+
+void
+server::addAsyncRoute(const std::string& routeName,
+                      asyncRouteHandler callback)
 {
     mRoutes[routeName] = callback;
 }
@@ -86,13 +99,15 @@ server::~server()
 }
 
 void
-server::handle_request(const request& req, reply& rep)
+server::handle_request(const request& req, reply& rep,
+                       std::function<void()> done)
 {
     // Decode url to path.
     std::string request_path;
     if (!url_decode(req.uri, request_path))
     {
         rep = reply::stock_reply(reply::bad_request);
+        done();
         return;
     }
 
@@ -110,37 +125,34 @@ server::handle_request(const request& req, reply& rep)
         params = request_path.substr(pos);
     }
 
+    auto status = reply::ok;
+    std::string contentType = "application/json";
     auto it = mRoutes.find(command);
-    if (it != mRoutes.end())
-    {
-        it->second(params, rep.content);
-
-        rep.status = reply::ok;
-        rep.headers.resize(2);
-        rep.headers[0].name = "Content-Length";
-        rep.headers[0].value = std::to_string(rep.content.size());
-        rep.headers[1].name = "Content-Type";
-        rep.headers[1].value = "application/json";
-    }
-    else
+    if (it == mRoutes.end())
     {
         it = mRoutes.find("404");
-        if (it != mRoutes.end())
-        {
-            it->second(params, rep.content);
-
-            rep.status = reply::not_found;
-            rep.headers.resize(2);
-            rep.headers[0].name = "Content-Length";
-            rep.headers[0].value = std::to_string(rep.content.size());
-            rep.headers[1].name = "Content-Type";
-            rep.headers[1].value = "text/html";
-        } else
+        if (it == mRoutes.end())
         {
             rep = reply::stock_reply(reply::not_found);
+            done();
             return;
         }
+        status = reply::not_found;
+        contentType = "text/html";
     }
+
+    it->second(params, [&rep, status, contentType,
+                        done](const std::string& content)
+    {
+        rep.content = content;
+        rep.status = status;
+        rep.headers.resize(2);
+        rep.headers[0].name = "Content-Length";
+        rep.headers[0].value = std::to_string(rep.content.size());
+        rep.headers[1].name = "Content-Type";
+        rep.headers[1].value = contentType;
+        done();
+    });
 }
 
 bool
@@ -30,6 +30,11 @@ class server
 
 public:
     typedef std::function<void(const std::string&, std::string&)> routeHandler;
+    /// Sets the content of the reply and sends it.
+    typedef std::function<void(const std::string&)> responder;
+    /// A route that may call its responder after it returned.
+    typedef std::function<void(const std::string&, responder)>
+        asyncRouteHandler;
     server(const server&) = delete;
     server& operator=(const server&) = delete;
 
@@ -42,9 +47,14 @@ public:
     ~server();
 
     void addRoute(const std::string& routeName, routeHandler callback);
+    void addAsyncRoute(const std::string& routeName,
+                       asyncRouteHandler callback);
     void add404(routeHandler callback);
 
-    void handle_request(const request& req, reply& rep);
+    /// Fills `rep` then calls `done`, possibly after returning: `rep` has to
+    /// stay alive until then.
+    void handle_request(const request& req, reply& rep,
+                        std::function<void()> done);
 
     static void parseParams(const std::string& params, std::map<std::string, std::string>& retMap);
 
@@ -71,7 +81,7 @@ private:
     /// The next socket to be accepted.
     asio::ip::tcp::socket socket_;
 
-    std::map<std::string, routeHandler> mRoutes;
+    std::map<std::string, asyncRouteHandler> mRoutes;
 };
 
 } // namespace server
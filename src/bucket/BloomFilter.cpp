@@ -0,0 +1,126 @@
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BloomFilter.h"
+#include "crypto/Random.h"
+#include "crypto/XDRHasher.h"
+#include "util/GlobalChecks.h"
+#include "util/siphash.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace hcnet
+{
+
+namespace
+{
+struct SeededXDRHasher : XDRHasher<SeededXDRHasher>
+{
+    SipHash24 state;
+    explicit SeededXDRHasher(BloomFilter::Seed const& seed)
+        : state(seed.data())
+    {
+    }
+    void
+    hashBytes(unsigned char const* bytes, size_t len)
+    {
+        state.update(bytes, len);
+    }
+};
+
+// Calls f(bitIndex) for each of the k probe positions of keyHash, stopping
+// early (and returning false) as soon as f returns false.
+template <typename F>
+bool
+forEachProbe(uint64_t keyHash, uint32_t numHashFunctions, size_t numBits, F f)
+{
+    uint32_t h1 = static_cast<uint32_t>(keyHash);
+    // Force h2 odd so successive probes never collapse onto one bit when
+    // numBits is a power of two.
+    uint32_t h2 = static_cast<uint32_t>(keyHash >> 32) | 1;
+    for (uint32_t i = 0; i < numHashFunctions; ++i)
+    {
+        if (!f((h1 + static_cast<uint64_t>(i) * h2) % numBits))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+BloomFilter::BloomFilter(Seed const& seed,
+                         std::vector<uint64_t> const& keyHashes,
+                         size_t bitsPerKey)
+    : mSeed(seed)
+{
+    ZoneScoped;
+    releaseAssert(bitsPerKey > 0);
+
+    // k = bitsPerKey * ln(2) minimizes the false positive rate.
+    mNumHashFunctions = std::max<uint32_t>(
+        1, static_cast<uint32_t>(std::lround(bitsPerKey * 0.69)));
+
+    size_t numWords = std::max<size_t>(
+        1, (keyHashes.size() * bitsPerKey + 63) / 64);
+    mBits.resize(numWords, 0);
+
+    size_t numBits = numWords * 64;
+    for (auto h : keyHashes)
+    {
+        forEachProbe(h, mNumHashFunctions, numBits, [&](uint64_t bit) {
+            mBits[bit / 64] |= uint64_t(1) << (bit % 64);
+            return true;
+        });
+    }
+}
+
+BloomFilter::BloomFilter(BucketIndexBloomFilter const& persisted)
+    : mSeed(persisted.seed)
+    , mNumHashFunctions(persisted.numHashFunctions)
+    , mBits(persisted.bits.begin(), persisted.bits.end())
+{
+    releaseAssertOrThrow(mNumHashFunctions > 0);
+    releaseAssertOrThrow(!mBits.empty());
+}
+
+BloomFilter::Seed
+BloomFilter::randomSeed()
+{
+    auto bytes = randomBytes(sizeof(Seed));
+    Seed seed;
+    std::copy(bytes.begin(), bytes.end(), seed.begin());
+    return seed;
+}
+
+uint64_t
+BloomFilter::hashKey(Seed const& seed, LedgerKey const& k)
+{
+    SeededXDRHasher hasher(seed);
+    xdr::archive(hasher, k);
+    hasher.flush();
+    return hasher.state.digest();
+}
+
+bool
+BloomFilter::mayContain(LedgerKey const& k) const
+{
+    ZoneScoped;
+    return forEachProbe(hashKey(mSeed, k), mNumHashFunctions,
+                        mBits.size() * 64, [&](uint64_t bit) {
+                            return ((mBits[bit / 64] >> (bit % 64)) & 1) != 0;
+                        });
+}
+
+BucketIndexBloomFilter
+BloomFilter::toXDR() const
+{
+    BucketIndexBloomFilter res;
+    res.seed = mSeed;
+    res.numHashFunctions = mNumHashFunctions;
+    res.bits.assign(mBits.begin(), mBits.end());
+    return res;
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdr/Hcnet-internal.h"
+#include "xdr/Hcnet-ledger-entries.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace hcnet
+{
+
+/**
+ * Bloom filter over the LedgerKeys of a bucket. mayContain() never returns
+ * false for a key that was added; it returns true for an absent key with a
+ * probability that depends on the number of bits per key (about 1% at 10).
+ *
+ * Keys are hashed once with SipHash-2-4 under a per-filter random seed, and
+ * the k probe positions are derived from the two 32-bit halves of that hash
+ * (Kirsch-Mitzenmacher double hashing). The seed is stored with the filter
+ * so it stays valid when persisted, unlike shortHash's per-process key.
+ */
+class BloomFilter
+{
+  public:
+    using Seed = xdr::opaque_array<16>;
+
+  private:
+    Seed mSeed;
+    uint32_t mNumHashFunctions;
+    std::vector<uint64_t> mBits;
+
+  public:
+    // Builds a filter from the hashes of all keys, computed with hashKey()
+    // under `seed`.
+    BloomFilter(Seed const& seed, std::vector<uint64_t> const& keyHashes,
+                size_t bitsPerKey);
+
+    // Restores a filter saved with toXDR().
+    explicit BloomFilter(BucketIndexBloomFilter const& persisted);
+
+    static Seed randomSeed();
+    static uint64_t hashKey(Seed const& seed, LedgerKey const& k);
+
+    bool mayContain(LedgerKey const& k) const;
+
+    BucketIndexBloomFilter toXDR() const;
+
+    size_t
+    sizeInBytes() const
+    {
+        return mBits.size() * sizeof(uint64_t);
+    }
+};
+}
@@ -18,22 +18,32 @@
 #include "crypto/SHA.h"
 #include "database/Database.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "medida/timer.h"
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "util/TmpDir.h"
 #include "util/XDRStream.h"
+#include "util/types.h"
 #include "xdrpp/message.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
+#include <algorithm>
 #include <future>
+#include <optional>
 
 namespace hcnet
 {
 
 Bucket::Bucket(std::string const& filename, Hash const& hash)
-    : mFilename(filename), mHash(hash)
+    : Bucket(filename, hash, nullptr)
+{
+}
+
+Bucket::Bucket(std::string const& filename, Hash const& hash,
+               std::unique_ptr<BucketIndex const>&& index)
+    : mFilename(filename), mHash(hash), mIndex(std::move(index))
 {
     releaseAssert(filename.empty() || fs::exists(filename));
     if (!filename.empty())
@@ -66,6 +76,117 @@ Bucket::getSize() const
     return mSize;
 }
 
+bool
+Bucket::isEmpty() const
+{
+    if (mFilename.empty() || isZero(mHash))
+    {
+        releaseAssertOrThrow(mFilename.empty() && isZero(mHash));
+        return true;
+    }
+
+    return false;
+}
+
+bool
+Bucket::isIndexed() const
+{
+    return static_cast<bool>(mIndex);
+}
+
+BucketIndex const&
+Bucket::getIndex() const
+{
+    releaseAssertOrThrow(mIndex);
+    return *mIndex;
+}
+
+XDRInputFileStream&
+Bucket::getStream() const
+{
+    if (!mStream)
+    {
+        mStream = std::make_unique<XDRInputFileStream>();
+        mStream->open(mFilename);
+    }
+    return *mStream;
+}
+
+std::optional<BucketEntry>
+Bucket::getBucketEntry(LedgerKey const& k,
+                       BloomFilterCounters* counters) const
+{
+    ZoneScoped;
+    if (isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    if (counters)
+    {
+        ++counters->mLookups;
+    }
+    if (!getIndex().mayContain(k))
+    {
+        return std::nullopt;
+    }
+
+    auto be = readBucketEntry(k);
+    if (counters)
+    {
+        ++(be ? counters->mHits : counters->mFalsePositives);
+    }
+    return be;
+}
+
+std::optional<BucketEntry>
+Bucket::readBucketEntry(LedgerKey const& k) const
+{
+    ZoneScoped;
+    auto pos = getIndex().lookup(k);
+    if (!pos)
+    {
+        return std::nullopt;
+    }
+
+    auto& stream = getStream();
+    stream.seek(*pos);
+
+    BucketEntry be;
+    auto pageSize = getIndex().getPageSize();
+    if (pageSize == 0)
+    {
+        // Individual index: the offset points directly at the entry.
+        if (stream.readOne(be))
+        {
+            return std::make_optional(be);
+        }
+        return std::nullopt;
+    }
+
+    // Range index: scan the page, stopping early once we are past `k` since
+    // the file is sorted.
+    LedgerEntryIdCmp cmp;
+    while (stream.pos() < static_cast<size_t>(*pos + pageSize) &&
+           stream.readOne(be))
+    {
+        if (be.type() == METAENTRY)
+        {
+            continue;
+        }
+        auto key = getBucketLedgerKey(be);
+        if (cmp(k, key))
+        {
+            break;
+        }
+        if (!cmp(key, k))
+        {
+            return std::make_optional(be);
+        }
+    }
+    return std::nullopt;
+}
+
 bool
 Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
@@ -601,6 +722,238 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
     ++ni;
 }
 
+static void
+mergeEntries(BucketManager& bucketManager, MergeCounters& mc,
+             BucketInputIterator& oi, BucketInputIterator& ni,
+             BucketOutputIterator& out,
+             std::vector<BucketInputIterator>& shadowIterators,
+             uint32_t protocolVersion, bool keepShadowedLifecycleEntries)
+{
+    BucketEntryIdCmp cmp;
+    size_t iter = 0;
+
+    while (oi || ni)
+    {
+        // Check if the merge should be stopped every few entries
+        if (++iter >= 1000)
+        {
+            iter = 0;
+            if (bucketManager.isShutdown())
+            {
+                // Stop merging, as BucketManager is now shutdown
+                // This is safe as temp file has not been adopted yet,
+                // so it will be removed with the tmp dir
+                throw std::runtime_error(
+                    "Incomplete bucket merge due to BucketManager shutdown");
+            }
+        }
+
+        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
+                                             shadowIterators, protocolVersion,
+                                             keepShadowedLifecycleEntries))
+        {
+            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
+                                    protocolVersion,
+                                    keepShadowedLifecycleEntries);
+        }
+    }
+}
+
+// Large merges are split into key ranges that are merged concurrently, each
+// into its own part file, and the parts are then concatenated in key order.
+// Since no key spans two ranges, every merge decision is the same as in a
+// serial merge, and the output (and so its hash) is byte-identical.
+//
+// Ranges are chosen from a sample of keys taken from both inputs, roughly
+// every `stride` bytes. Sampling only decodes the sampled records and skips
+// over the others using their length prefix.
+struct MergeRange
+{
+    std::optional<BucketEntry> mLowerBound;
+    std::optional<BucketEntry> mUpperBound;
+    size_t mOldStartOffset{0};
+    size_t mNewStartOffset{0};
+};
+
+static constexpr size_t MERGE_SAMPLES_PER_RANGE = 64;
+
+using MergeSamples = std::vector<std::pair<BucketEntry, size_t>>;
+
+static MergeSamples
+sampleBucket(std::shared_ptr<Bucket> const& bucket, size_t stride)
+{
+    ZoneScoped;
+    MergeSamples samples;
+    if (bucket->getFilename().empty())
+    {
+        return samples;
+    }
+
+    XDRInputMappedFileStream in;
+    in.open(bucket->getFilename());
+    BucketEntry be;
+    size_t next = 0;
+    while (in)
+    {
+        auto pos = in.pos();
+        if (pos < next)
+        {
+            if (!in.skipOne())
+            {
+                break;
+            }
+            continue;
+        }
+        if (!in.readOne(be))
+        {
+            break;
+        }
+        if (be.type() != METAENTRY)
+        {
+            samples.emplace_back(be, pos);
+            next = pos + stride;
+        }
+    }
+    return samples;
+}
+
+// Offset of the last sampled entry below `bound`, from which an iterator can
+// skip forward to the first entry in the range starting at `bound`.
+static size_t
+startOffsetFor(MergeSamples const& samples, BucketEntry const& bound)
+{
+    BucketEntryIdCmp cmp;
+    auto it = std::lower_bound(
+        samples.begin(), samples.end(), bound,
+        [&](std::pair<BucketEntry, size_t> const& sample,
+            BucketEntry const& b) { return cmp(sample.first, b); });
+    return it == samples.begin() ? 0 : std::prev(it)->second;
+}
+
+static std::vector<MergeRange>
+chooseMergeRanges(Config const& cfg, std::shared_ptr<Bucket> const& oldBucket,
+                  std::shared_ptr<Bucket> const& newBucket)
+{
+    auto nRanges = static_cast<size_t>(cfg.BUCKET_MERGE_THREADS);
+    auto totalSize = oldBucket->getSize() + newBucket->getSize();
+    if (nRanges <= 1 ||
+        totalSize < cfg.BUCKET_MERGE_PARALLEL_CUTOFF * 1024 * 1024)
+    {
+        return {};
+    }
+
+    ZoneScoped;
+    auto stride =
+        std::max<size_t>(1, totalSize / (nRanges * MERGE_SAMPLES_PER_RANGE));
+    auto oldSamples = sampleBucket(oldBucket, stride);
+    auto newSamples = sampleBucket(newBucket, stride);
+
+    BucketEntryIdCmp cmp;
+    std::vector<BucketEntry const*> keys;
+    for (auto const* samples : {&oldSamples, &newSamples})
+    {
+        for (auto const& sample : *samples)
+        {
+            keys.emplace_back(&sample.first);
+        }
+    }
+    std::sort(keys.begin(), keys.end(),
+              [&](BucketEntry const* a, BucketEntry const* b) {
+                  return cmp(*a, *b);
+              });
+
+    std::vector<MergeRange> ranges(1);
+    for (size_t i = 1; i < nRanges; ++i)
+    {
+        auto idx = i * keys.size() / nRanges;
+        if (idx == 0)
+        {
+            continue;
+        }
+        auto const& split = *keys[idx];
+        auto const& lower = ranges.back().mLowerBound;
+        if (lower && !cmp(*lower, split))
+        {
+            // Same key as the previous split; the range would be empty.
+            continue;
+        }
+        ranges.back().mUpperBound = split;
+        auto& r = ranges.emplace_back();
+        r.mLowerBound = split;
+        r.mOldStartOffset = startOffsetFor(oldSamples, split);
+        r.mNewStartOffset = startOffsetFor(newSamples, split);
+    }
+    return ranges;
+}
+
+static void
+mergeRangesInParallel(BucketManager& bucketManager, MergeCounters& mc,
+                      std::shared_ptr<Bucket> const& oldBucket,
+                      std::shared_ptr<Bucket> const& newBucket,
+                      std::vector<MergeRange> const& ranges,
+                      BucketOutputIterator& out, BucketMetadata const& meta,
+                      bool keepDeadEntries, uint32_t protocolVersion,
+                      bool keepShadowedLifecycleEntries, asio::io_context& ctx)
+{
+    ZoneScoped;
+    auto const& tmpDir = bucketManager.getTmpDir();
+    std::vector<MergeCounters> counters(ranges.size());
+
+    // Dedicated threads rather than the worker pool: this merge is itself
+    // running on a worker thread, and blocking it on tasks queued behind
+    // other merges could deadlock the pool.
+    std::vector<std::future<BucketOutputIterator::Part>> futures;
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        futures.emplace_back(std::async(std::launch::async, [&, i]() {
+            auto const& r = ranges[i];
+            auto lower = r.mLowerBound ? &*r.mLowerBound : nullptr;
+            auto upper = r.mUpperBound ? &*r.mUpperBound : nullptr;
+            BucketInputIterator oi(oldBucket, r.mOldStartOffset, lower, upper);
+            BucketInputIterator ni(newBucket, r.mNewStartOffset, lower, upper);
+            std::vector<BucketInputIterator> noShadows;
+            auto part = BucketOutputIterator::makePart(
+                tmpDir, keepDeadEntries, meta, counters[i], ctx);
+            mergeEntries(bucketManager, counters[i], oi, ni, *part, noShadows,
+                         protocolVersion, keepShadowedLifecycleEntries);
+            return part->finishPart();
+        }));
+    }
+
+    // Wait for every range before reporting any failure, since the tasks
+    // refer to this frame.
+    std::vector<BucketOutputIterator::Part> parts;
+    std::exception_ptr error;
+    for (auto& f : futures)
+    {
+        try
+        {
+            parts.emplace_back(f.get());
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        for (auto const& part : parts)
+        {
+            std::remove(part.mFilename.c_str());
+        }
+        std::rethrow_exception(error);
+    }
+
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        mc += counters[i];
+        out.appendPart(parts[i]);
+    }
+}
+
 std::shared_ptr<Bucket>
 Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
               std::shared_ptr<Bucket> const& oldBucket,
@@ -635,33 +988,25 @@ Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
     BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries, meta,
                              mc, ctx, doFsync);
 
-    BucketEntryIdCmp cmp;
-    size_t iter = 0;
-
-    while (oi || ni)
+    // Shadows are only consulted by pre-protocol-12 merges, which are never
+    // split: every range would need its own shadow iterators.
+    auto ranges = shadows.empty()
+                      ? chooseMergeRanges(bucketManager.getConfig(), oldBucket,
+                                          newBucket)
+                      : std::vector<MergeRange>{};
+    if (ranges.size() > 1)
     {
-        // Check if the merge should be stopped every few entries
-        if (++iter >= 1000)
-        {
-            iter = 0;
-            if (bucketManager.isShutdown())
-            {
-                // Stop merging, as BucketManager is now shutdown
-                // This is safe as temp file has not been adopted yet,
-                // so it will be removed with the tmp dir
-                throw std::runtime_error(
-                    "Incomplete bucket merge due to BucketManager shutdown");
-            }
-        }
-
-        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
-                                             shadowIterators, protocolVersion,
-                                             keepShadowedLifecycleEntries))
-        {
-            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
-                                    protocolVersion,
-                                    keepShadowedLifecycleEntries);
-        }
+        CLOG_DEBUG(Bucket, "Merging buckets {} and {} in {} key ranges",
+                   hexAbbrev(oldBucket->getHash()),
+                   hexAbbrev(newBucket->getHash()), ranges.size());
+        mergeRangesInParallel(bucketManager, mc, oldBucket, newBucket, ranges,
+                              out, meta, keepDeadEntries, protocolVersion,
+                              keepShadowedLifecycleEntries, ctx);
+    }
+    else
+    {
+        mergeEntries(bucketManager, mc, oi, ni, out, shadowIterators,
+                     protocolVersion, keepShadowedLifecycleEntries);
     }
     if (countMergeEvents)
     {
@@ -4,12 +4,15 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketIndex.h"
 #include "bucket/LedgerCmp.h"
 #include "crypto/Hex.h"
 #include "overlay/HcnetXDR.h"
 #include "util/NonCopyable.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDRStream.h"
+#include <memory>
+#include <optional>
 #include <string>
 
 namespace hcnet
@@ -39,6 +42,20 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     Hash const mHash;
     size_t mSize{0};
 
+    // Index of the keys in mFilename, present only when BucketListDB is
+    // enabled. Null for the empty bucket.
+    std::unique_ptr<BucketIndex const> const mIndex{};
+
+    // Lazily opened stream used by getBucketEntry. Point lookups only ever
+    // happen on the main thread, so this is not synchronized.
+    mutable std::unique_ptr<XDRInputFileStream> mStream;
+
+    XDRInputFileStream& getStream() const;
+
+    // Index lookup and file read behind getBucketEntry, once the bloom filter
+    // has let the key through.
+    std::optional<BucketEntry> readBucketEntry(LedgerKey const& k) const;
+
   public:
     // Create an empty bucket. The empty bucket has hash '000000...' and its
     // filename is the empty string.
@@ -49,10 +66,29 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // needs to ensure that.
     Bucket(std::string const& filename, Hash const& hash);
 
+    // As above, but also takes ownership of an index of the bucket's keys.
+    Bucket(std::string const& filename, Hash const& hash,
+           std::unique_ptr<BucketIndex const>&& index);
+
     Hash const& getHash() const;
     std::string const& getFilename() const;
     size_t getSize() const;
 
+    bool isEmpty() const;
+
+    // Returns true if the bucket has an index, so getBucketEntry may be used.
+    bool isIndexed() const;
+
+    BucketIndex const& getIndex() const;
+
+    // Loads the BucketEntry (LIVE, INIT or DEAD) for the given key if one is
+    // present in this bucket. Requires isIndexed(). Main thread only. If
+    // `counters` is given, the outcome of the bloom filter probe is recorded
+    // in it.
+    std::optional<BucketEntry>
+    getBucketEntry(LedgerKey const& k,
+                   BloomFilterCounters* counters = nullptr) const;
+
     // Returns true if a BucketEntry that is key-wise identical to the given
     // BucketEntry exists in the bucket. For testing.
     bool containsBucketIdentity(BucketEntry const& id) const;
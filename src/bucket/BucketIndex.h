@@ -0,0 +1,99 @@
+#pragma once
+
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include "xdr/Hcnet-ledger-entries.h"
+#include "xdr/Hcnet-types.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace hcnet
+{
+
+class Config;
+
+// Tallies of bloom filter outcomes over a number of lookups. A lookup the
+// filter rejects costs no file access; a false positive costs a wasted one.
+struct BloomFilterCounters
+{
+    uint64_t mLookups{0};
+    uint64_t mHits{0};
+    uint64_t mFalsePositives{0};
+};
+
+/**
+ * BucketIndex maps the LedgerKeys of a bucket to offsets in the bucket's XDR
+ * file, so that an individual entry can be loaded with a single seek rather
+ * than by scanning the whole bucket.
+ *
+ * There are two flavours of index, chosen by bucket size. Small buckets get an
+ * "individual" index with one (key, offset) pair per entry. Large buckets get
+ * a "range" index, which splits the file into pages of a fixed byte size and
+ * records the (lowest key, highest key, offset) of each page; a lookup then
+ * seeks to the page and scans at most one page worth of entries.
+ *
+ * Both flavours also carry a bloom filter over all keys, so that lookups for
+ * keys absent from the bucket (the common case when searching the BucketList
+ * level by level) can usually be answered without reading the file.
+ *
+ * Like Bucket, a BucketIndex is immutable once constructed and can be shared
+ * between threads.
+ */
+class BucketIndex : public NonMovableOrCopyable
+{
+  public:
+    // Version of the on-disk format written by saveToDisk. Persisted indexes
+    // with a different version are ignored and rebuilt.
+    static constexpr uint32_t BUCKET_INDEX_VERSION = 1;
+
+    // Bloom filter size, giving a false positive rate of about 1%.
+    static constexpr size_t BLOOM_FILTER_BITS_PER_KEY = 10;
+
+    virtual ~BucketIndex() = default;
+
+    // Returns the file offset at which to start searching for `k`: the exact
+    // entry offset for individual indexes, or the start of the page that
+    // would contain `k` for range indexes. Returns nullopt if `k` is
+    // definitely not in the bucket.
+    virtual std::optional<std::streamoff> lookup(LedgerKey const& k) const = 0;
+
+    // Probes the bloom filter. Returns false only if `k` is definitely not in
+    // the bucket.
+    virtual bool mayContain(LedgerKey const& k) const = 0;
+
+    // Returns the page size in bytes, or 0 for individual indexes.
+    virtual std::streamoff getPageSize() const = 0;
+
+    // Returns the number of index entries (keys or pages).
+    virtual size_t size() const = 0;
+
+    // Writes the index to `filename`, tagged with the hash of the bucket it
+    // describes.
+    virtual void saveToDisk(std::filesystem::path const& filename,
+                            Hash const& bucketHash) const = 0;
+
+    // Returns the page size to use for a bucket file of `fileSize` bytes under
+    // the given config, 0 meaning an individual index.
+    static std::streamoff getPageSizeForBucket(Config const& cfg,
+                                               size_t fileSize);
+
+    // Scans the bucket file at `filename` and builds an index for it. The
+    // flavour of the index depends on the file size and config.
+    static std::unique_ptr<BucketIndex const>
+    createIndex(Config const& cfg, std::filesystem::path const& filename);
+
+    // Loads a previously persisted index for the bucket `bucketHash`.
+    // Returns nullptr if `indexFilename` does not exist, or was written for
+    // a different bucket, format version or page size, in which case the
+    // caller should rebuild the index with createIndex.
+    static std::unique_ptr<BucketIndex const>
+    load(Config const& cfg, std::filesystem::path const& indexFilename,
+         Hash const& bucketHash, size_t bucketFileSize);
+};
+}
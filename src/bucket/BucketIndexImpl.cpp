@@ -0,0 +1,252 @@
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+// ASIO is somewhat particular about when it gets included -- it wants to be the
+// first to include <windows.h> -- so we try to include it before everything
+// else.
+#include "util/asio.h"
+#include "bucket/BucketIndexImpl.h"
+#include "bucket/LedgerCmp.h"
+#include "crypto/Hex.h"
+#include "main/Config.h"
+#include "util/Fs.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "util/types.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace hcnet
+{
+
+namespace
+{
+void
+writePersistedIndex(std::filesystem::path const& filename,
+                    PersistedBucketIndex const& persisted)
+{
+    ZoneScoped;
+    // Write to a temporary name and rename, so a crash mid-write never leaves
+    // a truncated index that would be picked up on restart.
+    auto tmpName = filename.string() + ".tmp";
+    {
+        asio::io_context ctx;
+        XDROutputFileStream out(ctx, /*fsyncOnClose=*/true);
+        out.open(tmpName);
+        out.writeOne(persisted);
+    }
+    std::filesystem::rename(tmpName, filename);
+}
+}
+
+IndividualBucketIndex::IndividualBucketIndex(
+    std::vector<BucketIndexIndividualEntry>&& entries, BloomFilter&& filter)
+    : mEntries(std::move(entries)), mFilter(std::move(filter))
+{
+}
+
+std::optional<std::streamoff>
+IndividualBucketIndex::lookup(LedgerKey const& k) const
+{
+    ZoneScoped;
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), k,
+                               [](BucketIndexIndividualEntry const& e,
+                                  LedgerKey const& key) {
+                                   return LedgerEntryIdCmp{}(e.key, key);
+                               });
+    if (it == mEntries.end() || LedgerEntryIdCmp{}(k, it->key))
+    {
+        return std::nullopt;
+    }
+    return static_cast<std::streamoff>(it->offset);
+}
+
+void
+IndividualBucketIndex::saveToDisk(std::filesystem::path const& filename,
+                                  Hash const& bucketHash) const
+{
+    PersistedBucketIndex persisted;
+    persisted.formatVersion = BUCKET_INDEX_VERSION;
+    persisted.bucketHash = bucketHash;
+    persisted.pageSize = 0;
+    persisted.entries.v(0);
+    persisted.entries.individualEntries().assign(mEntries.begin(),
+                                                 mEntries.end());
+    persisted.filter = mFilter.toXDR();
+    writePersistedIndex(filename, persisted);
+}
+
+RangeBucketIndex::RangeBucketIndex(std::vector<BucketIndexRangeEntry>&& entries,
+                                   std::streamoff pageSize,
+                                   BloomFilter&& filter)
+    : mEntries(std::move(entries))
+    , mPageSize(pageSize)
+    , mFilter(std::move(filter))
+{
+    releaseAssert(mPageSize > 0);
+}
+
+std::optional<std::streamoff>
+RangeBucketIndex::lookup(LedgerKey const& k) const
+{
+    ZoneScoped;
+    // Find the first page whose upper bound is not below k; k can only be in
+    // that page, and only if it is not below the page's lower bound.
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), k,
+                               [](BucketIndexRangeEntry const& e,
+                                  LedgerKey const& key) {
+                                   return LedgerEntryIdCmp{}(e.upperBound, key);
+                               });
+    if (it == mEntries.end() || LedgerEntryIdCmp{}(k, it->lowerBound))
+    {
+        return std::nullopt;
+    }
+    return static_cast<std::streamoff>(it->offset);
+}
+
+void
+RangeBucketIndex::saveToDisk(std::filesystem::path const& filename,
+                             Hash const& bucketHash) const
+{
+    PersistedBucketIndex persisted;
+    persisted.formatVersion = BUCKET_INDEX_VERSION;
+    persisted.bucketHash = bucketHash;
+    persisted.pageSize = static_cast<uint64>(mPageSize);
+    persisted.entries.v(1);
+    persisted.entries.rangeEntries().assign(mEntries.begin(), mEntries.end());
+    persisted.filter = mFilter.toXDR();
+    writePersistedIndex(filename, persisted);
+}
+
+std::streamoff
+BucketIndex::getPageSizeForBucket(Config const& cfg, size_t fileSize)
+{
+    auto exponent = cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT;
+    auto cutoffBytes =
+        cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF * 1024 * 1024;
+    if (exponent == 0 || fileSize < cutoffBytes)
+    {
+        return 0;
+    }
+    return static_cast<std::streamoff>(1) << exponent;
+}
+
+std::unique_ptr<BucketIndex const>
+BucketIndex::createIndex(Config const& cfg,
+                         std::filesystem::path const& filename)
+{
+    ZoneScoped;
+    releaseAssertOrThrow(!filename.empty());
+
+    XDRInputFileStream in;
+    in.open(filename.string());
+    auto pageSize = getPageSizeForBucket(cfg, in.size());
+
+    CLOG_DEBUG(Bucket, "Indexing bucket file {} ({} bytes, page size {})",
+               filename.string(), in.size(), pageSize);
+
+    // Hash keys for the bloom filter during the same pass; the filter can
+    // only be sized once the number of keys is known.
+    auto seed = BloomFilter::randomSeed();
+    std::vector<uint64_t> keyHashes;
+    auto makeFilter = [&]() {
+        return BloomFilter(seed, keyHashes, BLOOM_FILTER_BITS_PER_KEY);
+    };
+
+    BucketEntry be;
+    size_t pos = 0;
+    if (pageSize == 0)
+    {
+        std::vector<BucketIndexIndividualEntry> entries;
+        while (in.readOne(be))
+        {
+            if (be.type() != METAENTRY)
+            {
+                auto& e = entries.emplace_back();
+                e.key = getBucketLedgerKey(be);
+                e.offset = pos;
+                keyHashes.emplace_back(BloomFilter::hashKey(seed, e.key));
+            }
+            pos = in.pos();
+        }
+        return std::make_unique<IndividualBucketIndex const>(
+            std::move(entries), makeFilter());
+    }
+
+    std::vector<BucketIndexRangeEntry> entries;
+    while (in.readOne(be))
+    {
+        if (be.type() != METAENTRY)
+        {
+            auto key = getBucketLedgerKey(be);
+            keyHashes.emplace_back(BloomFilter::hashKey(seed, key));
+            if (entries.empty() ||
+                pos >= entries.back().offset + static_cast<size_t>(pageSize))
+            {
+                auto& e = entries.emplace_back();
+                e.lowerBound = key;
+                e.offset = pos;
+            }
+            // Bucket files are sorted, so each key is the page's new maximum.
+            entries.back().upperBound = std::move(key);
+        }
+        pos = in.pos();
+    }
+    return std::make_unique<RangeBucketIndex const>(std::move(entries),
+                                                    pageSize, makeFilter());
+}
+
+std::unique_ptr<BucketIndex const>
+BucketIndex::load(Config const& cfg, std::filesystem::path const& indexFilename,
+                  Hash const& bucketHash, size_t bucketFileSize)
+{
+    ZoneScoped;
+    if (!fs::exists(indexFilename.string()))
+    {
+        return nullptr;
+    }
+
+    PersistedBucketIndex persisted;
+    std::optional<BloomFilter> filter;
+    try
+    {
+        XDRInputFileStream in;
+        in.open(indexFilename.string());
+        if (!in.readOne(persisted))
+        {
+            return nullptr;
+        }
+        filter.emplace(persisted.filter);
+    }
+    catch (std::exception const& e)
+    {
+        CLOG_WARNING(Bucket, "Ignoring unreadable bucket index {}: {}",
+                     indexFilename.string(), e.what());
+        return nullptr;
+    }
+
+    auto expectedPageSize = getPageSizeForBucket(cfg, bucketFileSize);
+    if (persisted.formatVersion != BUCKET_INDEX_VERSION ||
+        persisted.bucketHash != bucketHash ||
+        static_cast<std::streamoff>(persisted.pageSize) != expectedPageSize ||
+        persisted.entries.v() != (expectedPageSize == 0 ? 0 : 1))
+    {
+        CLOG_DEBUG(Bucket, "Ignoring stale bucket index {} for bucket {}",
+                   indexFilename.string(), hexAbbrev(bucketHash));
+        return nullptr;
+    }
+
+    if (expectedPageSize == 0)
+    {
+        return std::make_unique<IndividualBucketIndex const>(
+            std::move(persisted.entries.individualEntries()),
+            std::move(*filter));
+    }
+    return std::make_unique<RangeBucketIndex const>(
+        std::move(persisted.entries.rangeEntries()), expectedPageSize,
+        std::move(*filter));
+}
+}
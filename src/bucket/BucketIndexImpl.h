@@ -0,0 +1,99 @@
+#pragma once
+
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BloomFilter.h"
+#include "bucket/BucketIndex.h"
+#include "xdr/Hcnet-internal.h"
+
+#include <vector>
+
+namespace hcnet
+{
+
+// Index with one entry per key in the bucket, used for small buckets. Entries
+// are sorted by LedgerEntryIdCmp, in the same order as the bucket file.
+class IndividualBucketIndex : public BucketIndex
+{
+    std::vector<BucketIndexIndividualEntry> mEntries;
+    BloomFilter const mFilter;
+
+  public:
+    IndividualBucketIndex(std::vector<BucketIndexIndividualEntry>&& entries,
+                          BloomFilter&& filter);
+
+    std::optional<std::streamoff> lookup(LedgerKey const& k) const override;
+
+    bool
+    mayContain(LedgerKey const& k) const override
+    {
+        return mFilter.mayContain(k);
+    }
+
+    std::streamoff
+    getPageSize() const override
+    {
+        return 0;
+    }
+
+    size_t
+    size() const override
+    {
+        return mEntries.size();
+    }
+
+    void saveToDisk(std::filesystem::path const& filename,
+                    Hash const& bucketHash) const override;
+
+    std::vector<BucketIndexIndividualEntry> const&
+    getEntries() const
+    {
+        return mEntries;
+    }
+};
+
+// Index with one entry per fixed-size page of the bucket file, used for large
+// buckets. Each entry records the lowest and highest key whose record starts
+// in the page, so a lookup only needs to scan a single page.
+class RangeBucketIndex : public BucketIndex
+{
+    std::vector<BucketIndexRangeEntry> mEntries;
+    std::streamoff const mPageSize;
+    BloomFilter const mFilter;
+
+  public:
+    RangeBucketIndex(std::vector<BucketIndexRangeEntry>&& entries,
+                     std::streamoff pageSize, BloomFilter&& filter);
+
+    std::optional<std::streamoff> lookup(LedgerKey const& k) const override;
+
+    bool
+    mayContain(LedgerKey const& k) const override
+    {
+        return mFilter.mayContain(k);
+    }
+
+    std::streamoff
+    getPageSize() const override
+    {
+        return mPageSize;
+    }
+
+    size_t
+    size() const override
+    {
+        return mEntries.size();
+    }
+
+    void saveToDisk(std::filesystem::path const& filename,
+                    Hash const& bucketHash) const override;
+
+    std::vector<BucketIndexRangeEntry> const&
+    getEntries() const
+    {
+        return mEntries;
+    }
+};
+}
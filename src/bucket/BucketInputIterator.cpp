@@ -44,6 +44,10 @@ BucketInputIterator::loadEntry()
             {
                 Bucket::checkProtocolLegality(mEntry, mMetadata.ledgerVersion);
             }
+            if (mUpperBound && !mCmp(mEntry, *mUpperBound))
+            {
+                mEntryPtr = nullptr;
+            }
         }
     }
     else
@@ -88,8 +92,20 @@ BucketInputIterator::getMetadata() const
 }
 
 BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
+    : BucketInputIterator(bucket, 0, nullptr, nullptr)
+{
+}
+
+BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                                         size_t startOffset,
+                                         BucketEntry const* lowerBound,
+                                         BucketEntry const* upperBound)
     : mBucket(bucket), mEntryPtr(nullptr), mSeenMetadata(false)
 {
+    if (upperBound)
+    {
+        mUpperBound = *upperBound;
+    }
     // In absence of metadata, we treat every bucket as though it is from ledger
     // protocol 0, which is the protocol of the genesis ledger. At very least
     // some empty buckets and the bucket containing the initial genesis account
@@ -103,6 +119,18 @@ BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
                    mBucket->getFilename());
         mIn.open(mBucket->getFilename());
         loadEntry();
+
+        // The METAENTRY (if any) has now been read, so it is safe to jump
+        // past it.
+        if (startOffset > 0)
+        {
+            mIn.seek(startOffset);
+            loadEntry();
+        }
+        while (lowerBound && mEntryPtr && mCmp(*mEntryPtr, *lowerBound))
+        {
+            ++(*this);
+        }
     }
 }
 
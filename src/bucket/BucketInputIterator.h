@@ -9,6 +9,7 @@
 #include "xdr/Hcnet-ledger.h"
 
 #include <memory>
+#include <optional>
 
 namespace hcnet
 {
@@ -24,11 +25,15 @@ class BucketInputIterator
     // pointer. If
     // non-null, it points to mEntry.
     BucketEntry const* mEntryPtr{nullptr};
-    XDRInputFileStream mIn;
+    // Buckets are always read front to back, so read them through a
+    // read-ahead mapping rather than an ifstream.
+    XDRInputMappedFileStream mIn;
     BucketEntry mEntry;
     bool mSeenMetadata{false};
     bool mSeenOtherEntries{false};
     BucketMetadata mMetadata;
+    BucketEntryIdCmp mCmp;
+    std::optional<BucketEntry> mUpperBound;
     void loadEntry();
 
   public:
@@ -48,6 +53,15 @@ class BucketInputIterator
 
     BucketInputIterator(std::shared_ptr<Bucket const> bucket);
 
+    // Iterates over only the entries of `bucket` whose keys lie in
+    // [lowerBound, upperBound), where a null bound is unbounded. Reading
+    // starts at `startOffset`, which must be 0 or the offset of an entry that
+    // is not above lowerBound; entries before lowerBound are skipped. Used to
+    // split a merge into key ranges.
+    BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                        size_t startOffset, BucketEntry const* lowerBound,
+                        BucketEntry const* upperBound);
+
     ~BucketInputIterator();
 
     BucketInputIterator& operator++();
@@ -421,6 +421,70 @@ BucketList::getLevel(uint32_t i)
     return mLevels.at(i);
 }
 
+std::shared_ptr<LedgerEntry>
+BucketList::getLedgerEntry(LedgerKey const& k,
+                           BloomFilterCounters& counters) const
+{
+    ZoneScoped;
+    for (auto const& lev : mLevels)
+    {
+        for (auto const& b : {lev.getCurr(), lev.getSnap()})
+        {
+            auto be = b->getBucketEntry(k, &counters);
+            if (!be)
+            {
+                continue;
+            }
+            if (be->type() == DEADENTRY)
+            {
+                return nullptr;
+            }
+            return std::make_shared<LedgerEntry>(be->liveEntry());
+        }
+    }
+    return nullptr;
+}
+
+std::vector<LedgerEntry>
+BucketList::loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys,
+                     BloomFilterCounters& counters) const
+{
+    ZoneScoped;
+    std::vector<LedgerEntry> entries;
+    std::set<LedgerKey, LedgerEntryIdCmp> remaining(keys);
+    for (auto const& lev : mLevels)
+    {
+        for (auto const& b : {lev.getCurr(), lev.getSnap()})
+        {
+            if (b->isEmpty())
+            {
+                continue;
+            }
+            // Once a key has been found in a newer bucket, older versions are
+            // shadowed, so stop looking for it.
+            for (auto it = remaining.begin(); it != remaining.end();)
+            {
+                auto be = b->getBucketEntry(*it, &counters);
+                if (!be)
+                {
+                    ++it;
+                    continue;
+                }
+                if (be->type() != DEADENTRY)
+                {
+                    entries.emplace_back(be->liveEntry());
+                }
+                it = remaining.erase(it);
+            }
+            if (remaining.empty())
+            {
+                return entries;
+            }
+        }
+    }
+    return entries;
+}
+
 void
 BucketList::resolveAnyReadyFutures()
 {
@@ -5,12 +5,16 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/FutureBucket.h"
+#include "bucket/LedgerCmp.h"
 #include "overlay/HcnetXDR.h"
 #include "xdrpp/message.h"
 #include <future>
+#include <set>
 
 namespace hcnet
 {
+
+struct BloomFilterCounters;
 // This is the "bucket list", a set sets-of-hashed-objects, organized into
 // temporal "levels", with older levels being larger and changing less
 // frequently. The purpose of this data structure is twofold:
@@ -448,6 +452,20 @@ class BucketList
     // of the concatenation of the hashes of the `curr` and `snap` buckets.
     Hash getHash() const;
 
+    // Look up the newest version of `k`, searching buckets from the newest
+    // (level 0 curr) to the oldest. Returns nullptr if there is no entry for
+    // `k` or the newest one is a DEADENTRY. All non-empty buckets must be
+    // indexed. Bloom filter outcomes for every bucket probed are added to
+    // `counters`.
+    std::shared_ptr<LedgerEntry>
+    getLedgerEntry(LedgerKey const& k, BloomFilterCounters& counters) const;
+
+    // As getLedgerEntry, for a batch of keys. Keys without a live entry are
+    // omitted from the result.
+    std::vector<LedgerEntry>
+    loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys,
+             BloomFilterCounters& counters) const;
+
     // Restart any merges that might be running on background worker threads,
     // merging buckets between levels. This needs to be called after forcing a
     // BucketList to adopt a new state, either at application restart or when
@@ -20,6 +20,7 @@ namespace hcnet
 
 class Application;
 class BucketList;
+class Config;
 class TmpDirManager;
 struct LedgerHeader;
 struct MergeKey;
@@ -106,6 +107,7 @@ class BucketManager : NonMovableOrCopyable
     virtual TmpDirManager& getTmpDirManager() = 0;
     virtual std::string const& getBucketDir() const = 0;
     virtual BucketList& getBucketList() = 0;
+    virtual Config const& getConfig() const = 0;
 
     virtual medida::Timer& getMergeTimer() = 0;
 
@@ -125,10 +127,14 @@ class BucketManager : NonMovableOrCopyable
     // This method is mostly-threadsafe -- assuming you don't destruct the
     // BucketManager mid-call -- and is intended to be called from both main and
     // worker threads. Very carefully.
+    //
+    // When BucketListDB is enabled, `index` should index `filename`. If it is
+    // null, an index is loaded from disk or built here, under the bucket lock.
     virtual std::shared_ptr<Bucket>
     adoptFileAsBucket(std::string const& filename, uint256 const& hash,
                       size_t nObjects, size_t nBytes,
-                      MergeKey* mergeKey = nullptr) = 0;
+                      MergeKey* mergeKey = nullptr,
+                      std::unique_ptr<BucketIndex const> index = nullptr) = 0;
 
     // Companion method to `adoptFileAsBucket` also called from the
     // `BucketOutputIterator::getBucket` merge-completion path. This method
@@ -141,6 +147,9 @@ class BucketManager : NonMovableOrCopyable
     // Return a bucket by hash if we have it, else return nullptr.
     virtual std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) = 0;
 
+    // Return the path at which the index of bucket `hash` is persisted.
+    virtual std::string bucketIndexFilename(Hash const& hash) const = 0;
+
     // Get a reference to a merge-future that's either running (or finished
     // somewhat recently) from either a map of the std::shared_futures doing the
     // merges and/or a set of records mapping merge inputs to outputs and the
@@ -183,6 +192,17 @@ class BucketManager : NonMovableOrCopyable
     // state of the bucket list.
     virtual void snapshotLedger(LedgerHeader& currentHeader) = 0;
 
+    // Look up the newest version of a LedgerEntry in the indexed BucketList.
+    // Returns nullptr if the entry does not exist or was deleted. Requires
+    // BucketListDB to be enabled.
+    virtual std::shared_ptr<LedgerEntry>
+    getLedgerEntry(LedgerKey const& k) const = 0;
+
+    // As getLedgerEntry, for a batch of keys. Keys that are not found are
+    // omitted from the result.
+    virtual std::vector<LedgerEntry>
+    loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys) const = 0;
+
 #ifdef BUILD_TESTS
     // Install a fake/assumed ledger version and bucket list hash to use in next
     // call to addBatch and snapshotLedger. This interface exists only for
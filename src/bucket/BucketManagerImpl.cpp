@@ -114,6 +114,16 @@ BucketManagerImpl::BucketManagerImpl(Application& app)
     , mBucketSnapMerge(app.getMetrics().NewTimer({"bucket", "snap", "merge"}))
     , mSharedBucketsSize(
           app.getMetrics().NewCounter({"bucket", "memory", "shared"}))
+    , mBucketListDBPointTimer(
+          app.getMetrics().NewTimer({"bucketlistDB", "point", "load"}))
+    , mBucketListDBBulkTimer(
+          app.getMetrics().NewTimer({"bucketlistDB", "bulk", "load"}))
+    , mBucketListDBBloomLookups(app.getMetrics().NewMeter(
+          {"bucketlistDB", "bloom", "lookups"}, "lookup"))
+    , mBucketListDBBloomHits(app.getMetrics().NewMeter(
+          {"bucketlistDB", "bloom", "hits"}, "lookup"))
+    , mBucketListDBBloomFalsePositives(app.getMetrics().NewMeter(
+          {"bucketlistDB", "bloom", "false-positives"}, "lookup"))
     // Minimal DB is stored in the buckets dir, so delete it only when
     // mode does not use minimal DB
     , mDeleteEntireBucketDirInDtor(
@@ -131,10 +141,16 @@ bucketBasename(std::string const& bucketHexHash)
     return "bucket-" + bucketHexHash + ".xdr";
 }
 
+std::string
+bucketIndexBasename(std::string const& bucketHexHash)
+{
+    return "bucket-" + bucketHexHash + ".index";
+}
+
 bool
 isBucketFile(std::string const& name)
 {
-    static std::regex re("^bucket-[a-z0-9]{64}\\.xdr(\\.gz)?$");
+    static std::regex re("^bucket-[a-z0-9]{64}\\.(xdr(\\.gz)?|index)$");
     return std::regex_match(name, re);
 };
 
@@ -158,6 +174,12 @@ BucketManagerImpl::bucketFilename(Hash const& hash)
     return bucketFilename(binToHex(hash));
 }
 
+std::string
+BucketManagerImpl::bucketIndexFilename(Hash const& hash) const
+{
+    return getBucketDir() + "/" + bucketIndexBasename(binToHex(hash));
+}
+
 std::string const&
 BucketManagerImpl::getTmpDir()
 {
@@ -242,6 +264,12 @@ BucketManagerImpl::getBucketList()
     return *mBucketList;
 }
 
+Config const&
+BucketManagerImpl::getConfig() const
+{
+    return mApp.getConfig();
+}
+
 medida::Timer&
 BucketManagerImpl::getMergeTimer()
 {
@@ -362,7 +390,8 @@ BucketManagerImpl::renameBucket(std::string const& src, std::string const& dst)
 std::shared_ptr<Bucket>
 BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
                                      uint256 const& hash, size_t nObjects,
-                                     size_t nBytes, MergeKey* mergeKey)
+                                     size_t nBytes, MergeKey* mergeKey,
+                                     std::unique_ptr<BucketIndex const> index)
 {
     ZoneScoped;
     releaseAssertOrThrow(mApp.getConfig().MODE_ENABLES_BUCKETLIST);
@@ -416,7 +445,16 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             }
         }
 
-        b = std::make_shared<Bucket>(canonicalName, hash);
+        if (index)
+        {
+            maybePersistIndex(*index, hash);
+        }
+        else
+        {
+            index = loadOrCreateIndex(canonicalName, hash);
+        }
+
+        b = std::make_shared<Bucket>(canonicalName, hash, std::move(index));
         {
             mSharedBuckets.emplace(hash, b);
             mSharedBucketsSize.set_count(mSharedBuckets.size());
@@ -474,7 +512,8 @@ BucketManagerImpl::getBucketByHash(uint256 const& hash)
                    "BucketManager::getBucketByHash({}) found no bucket, making "
                    "new one",
                    binToHex(hash));
-        auto p = std::make_shared<Bucket>(canonicalName, hash);
+        auto p = std::make_shared<Bucket>(
+            canonicalName, hash, loadOrCreateIndex(canonicalName, hash));
         mSharedBuckets.emplace(hash, p);
         mSharedBucketsSize.set_count(mSharedBuckets.size());
         return p;
@@ -482,6 +521,44 @@ BucketManagerImpl::getBucketByHash(uint256 const& hash)
     return std::shared_ptr<Bucket>();
 }
 
+std::unique_ptr<BucketIndex const>
+BucketManagerImpl::loadOrCreateIndex(std::string const& filename,
+                                     Hash const& hash)
+{
+    ZoneScoped;
+    auto const& cfg = mApp.getConfig();
+    if (!cfg.isUsingBucketListDB())
+    {
+        return nullptr;
+    }
+
+    if (cfg.EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX)
+    {
+        auto index = BucketIndex::load(cfg, bucketIndexFilename(hash), hash,
+                                       fs::size(filename));
+        if (index)
+        {
+            CLOG_DEBUG(Bucket, "Loaded persisted index for bucket {}",
+                       hexAbbrev(hash));
+            return index;
+        }
+    }
+
+    auto index = BucketIndex::createIndex(cfg, filename);
+    maybePersistIndex(*index, hash);
+    return index;
+}
+
+void
+BucketManagerImpl::maybePersistIndex(BucketIndex const& index,
+                                     Hash const& hash)
+{
+    if (mApp.getConfig().EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX)
+    {
+        index.saveToDisk(bucketIndexFilename(hash), hash);
+    }
+}
+
 std::shared_future<std::shared_ptr<Bucket>>
 BucketManagerImpl::getMergeFuture(MergeKey const& key)
 {
@@ -688,6 +765,8 @@ BucketManagerImpl::forgetUnreferencedBuckets()
                 std::remove(filename.c_str());
                 auto gzfilename = filename + ".gz";
                 std::remove(gzfilename.c_str());
+                auto indexFilename = bucketIndexFilename(j->first);
+                std::remove(indexFilename.c_str());
             }
 
             // Dropping this bucket means we'll no longer be able to
@@ -767,6 +846,40 @@ BucketManagerImpl::getBucketHashesInBucketDirForTesting() const
 }
 #endif
 
+std::shared_ptr<LedgerEntry>
+BucketManagerImpl::getLedgerEntry(LedgerKey const& k) const
+{
+    ZoneScoped;
+    releaseAssertOrThrow(mApp.getConfig().isUsingBucketListDB());
+    auto timer = mBucketListDBPointTimer.TimeScope();
+    BloomFilterCounters counters;
+    auto res = mBucketList->getLedgerEntry(k, counters);
+    markBloomFilterMetrics(counters);
+    return res;
+}
+
+std::vector<LedgerEntry>
+BucketManagerImpl::loadKeys(
+    std::set<LedgerKey, LedgerEntryIdCmp> const& keys) const
+{
+    ZoneScoped;
+    releaseAssertOrThrow(mApp.getConfig().isUsingBucketListDB());
+    auto timer = mBucketListDBBulkTimer.TimeScope();
+    BloomFilterCounters counters;
+    auto res = mBucketList->loadKeys(keys, counters);
+    markBloomFilterMetrics(counters);
+    return res;
+}
+
+void
+BucketManagerImpl::markBloomFilterMetrics(
+    BloomFilterCounters const& counters) const
+{
+    mBucketListDBBloomLookups.Mark(counters.mLookups);
+    mBucketListDBBloomHits.Mark(counters.mHits);
+    mBucketListDBBloomFalsePositives.Mark(counters.mFalsePositives);
+}
+
 // updates the given LedgerHeader to reflect the current state of the bucket
 // list
 void
@@ -46,6 +46,11 @@ class BucketManagerImpl : public BucketManager
     medida::Timer& mBucketAddBatch;
     medida::Timer& mBucketSnapMerge;
     medida::Counter& mSharedBucketsSize;
+    medida::Timer& mBucketListDBPointTimer;
+    medida::Timer& mBucketListDBBulkTimer;
+    medida::Meter& mBucketListDBBloomLookups;
+    medida::Meter& mBucketListDBBloomHits;
+    medida::Meter& mBucketListDBBloomFalsePositives;
     MergeCounters mMergeCounters;
 
     bool const mDeleteEntireBucketDirInDtor;
@@ -72,6 +77,14 @@ class BucketManagerImpl : public BucketManager
     void deleteEntireBucketDir();
     bool renameBucket(std::string const& src, std::string const& dst);
 
+    // Returns the index for bucket file `filename` with hash `hash`, loading
+    // it from disk if persisted and building (and persisting) it otherwise.
+    // Returns null if BucketListDB is disabled.
+    std::unique_ptr<BucketIndex const>
+    loadOrCreateIndex(std::string const& filename, Hash const& hash);
+    void maybePersistIndex(BucketIndex const& index, Hash const& hash);
+    void markBloomFilterMetrics(BloomFilterCounters const& counters) const;
+
 #ifdef BUILD_TESTS
     bool mUseFakeTestValuesForNextClose{false};
     uint32_t mFakeTestProtocolVersion;
@@ -91,16 +104,19 @@ class BucketManagerImpl : public BucketManager
     std::string const& getTmpDir() override;
     std::string const& getBucketDir() const override;
     BucketList& getBucketList() override;
+    Config const& getConfig() const override;
     medida::Timer& getMergeTimer() override;
     MergeCounters readMergeCounters() override;
     void incrMergeCounters(MergeCounters const&) override;
     TmpDirManager& getTmpDirManager() override;
     std::shared_ptr<Bucket>
-    adoptFileAsBucket(std::string const& filename, uint256 const& hash,
-                      size_t nObjects, size_t nBytes,
-                      MergeKey* mergeKey = nullptr) override;
+    adoptFileAsBucket(
+        std::string const& filename, uint256 const& hash, size_t nObjects,
+        size_t nBytes, MergeKey* mergeKey = nullptr,
+        std::unique_ptr<BucketIndex const> index = nullptr) override;
     void noteEmptyMergeOutput(MergeKey const& mergeKey) override;
     std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) override;
+    std::string bucketIndexFilename(Hash const& hash) const override;
 
     std::shared_future<std::shared_ptr<Bucket>>
     getMergeFuture(MergeKey const& key) override;
@@ -118,6 +134,11 @@ class BucketManagerImpl : public BucketManager
                   std::vector<LedgerKey> const& deadEntries) override;
     void snapshotLedger(LedgerHeader& currentHeader) override;
 
+    std::shared_ptr<LedgerEntry>
+    getLedgerEntry(LedgerKey const& k) const override;
+    std::vector<LedgerEntry>
+    loadKeys(std::set<LedgerKey, LedgerEntryIdCmp> const& keys) const override;
+
 #ifdef BUILD_TESTS
     // Install a fake/assumed ledger version and bucket list hash to use in next
     // call to addBatch and snapshotLedger. This interface exists only for
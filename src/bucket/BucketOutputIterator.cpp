@@ -6,6 +6,7 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Random.h"
+#include "main/Config.h"
 #include "util/GlobalChecks.h"
 #include <Tracy.hpp>
 
@@ -40,8 +41,20 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
                                            BucketMetadata const& meta,
                                            MergeCounters& mc,
                                            asio::io_context& ctx, bool doFsync)
+    : BucketOutputIterator(tmpDir, keepDeadEntries, meta, mc, ctx, doFsync,
+                           /*writeMeta=*/true)
+{
+}
+
+BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
+                                           bool keepDeadEntries,
+                                           BucketMetadata const& meta,
+                                           MergeCounters& mc,
+                                           asio::io_context& ctx, bool doFsync,
+                                           bool writeMeta)
     : mFilename(randomBucketName(tmpDir))
-    , mOut(ctx, doFsync)
+    // Parts (written without a METAENTRY) are never hashed on their own.
+    , mOut(ctx, doFsync, /*computeHash=*/writeMeta)
     , mBuf(nullptr)
     , mKeepDeadEntries(keepDeadEntries)
     , mMeta(meta)
@@ -53,7 +66,8 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
     // Will throw if unable to open the file
     mOut.open(mFilename);
 
-    if (protocolVersionStartsFrom(
+    if (writeMeta &&
+        protocolVersionStartsFrom(
             meta.ledgerVersion,
             Bucket::FIRST_PROTOCOL_SUPPORTING_INITENTRY_AND_METAENTRY))
     {
@@ -97,7 +111,7 @@ BucketOutputIterator::put(BucketEntry const& e)
         if (mCmp(*mBuf, e))
         {
             ++mMergeCounters.mOutputIteratorActualWrites;
-            mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
+            mOut.writeOne(*mBuf, &mBytesPut);
             mObjectsPut++;
         }
     }
@@ -111,19 +125,83 @@ BucketOutputIterator::put(BucketEntry const& e)
     *mBuf = e;
 }
 
-std::shared_ptr<Bucket>
-BucketOutputIterator::getBucket(BucketManager& bucketManager,
-                                MergeKey* mergeKey)
+std::unique_ptr<BucketOutputIterator>
+BucketOutputIterator::makePart(std::string const& tmpDir, bool keepDeadEntries,
+                               BucketMetadata const& meta, MergeCounters& mc,
+                               asio::io_context& ctx)
+{
+    // Parts are deleted once appended, so there is no point syncing them.
+    return std::unique_ptr<BucketOutputIterator>(
+        new BucketOutputIterator(tmpDir, keepDeadEntries, meta, mc, ctx,
+                                 /*doFsync=*/false, /*writeMeta=*/false));
+}
+
+void
+BucketOutputIterator::flushBuffer()
 {
-    ZoneScoped;
     if (mBuf)
     {
-        mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
+        mOut.writeOne(*mBuf, &mBytesPut);
         mObjectsPut++;
         mBuf.reset();
     }
+}
 
+BucketOutputIterator::Part
+BucketOutputIterator::finishPart()
+{
+    ZoneScoped;
+    flushBuffer();
     mOut.close();
+    return Part{mFilename, mObjectsPut, mBytesPut};
+}
+
+void
+BucketOutputIterator::appendPart(Part const& part)
+{
+    ZoneScoped;
+    flushBuffer();
+    if (part.mBytesPut != 0)
+    {
+        // A serial merge would have written the entry before the part when
+        // the part's first entry arrived; the part counted its other writes.
+        if (mObjectsPut != 0)
+        {
+            ++mMergeCounters.mOutputIteratorActualWrites;
+        }
+
+        // The part is already framed XDR, so copy its bytes rather than
+        // decoding and re-encoding each entry; the hash covers the same
+        // bytes either way.
+        std::ifstream in(part.mFilename, std::ifstream::binary);
+        if (!in)
+        {
+            throw std::runtime_error("failed to open bucket part " +
+                                     part.mFilename);
+        }
+        std::vector<char> buf(fs::bufsz());
+        size_t copied = 0;
+        while (in)
+        {
+            in.read(buf.data(), buf.size());
+            auto n = static_cast<size_t>(in.gcount());
+            mOut.writeBytes(buf.data(), n, &mBytesPut);
+            copied += n;
+        }
+        releaseAssertOrThrow(copied == part.mBytesPut);
+        mObjectsPut += part.mObjectsPut;
+    }
+    std::remove(part.mFilename.c_str());
+}
+
+std::shared_ptr<Bucket>
+BucketOutputIterator::getBucket(BucketManager& bucketManager,
+                                MergeKey* mergeKey)
+{
+    ZoneScoped;
+    flushBuffer();
+
+    auto hash = mOut.close();
     if (mObjectsPut == 0 || mBytesPut == 0)
     {
         releaseAssert(mObjectsPut == 0);
@@ -136,7 +214,19 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager,
         }
         return std::make_shared<Bucket>();
     }
-    return bucketManager.adoptFileAsBucket(mFilename, mHasher.finish(),
-                                           mObjectsPut, mBytesPut, mergeKey);
+    std::unique_ptr<BucketIndex const> index{};
+
+    // Index the bucket here, on the thread that wrote it, rather than in
+    // adoptFileAsBucket under the bucket lock. Skip it if the bucket already
+    // exists, since this file will just be deleted.
+    if (bucketManager.getConfig().isUsingBucketListDB() &&
+        !bucketManager.getBucketByHash(hash))
+    {
+        index = BucketIndex::createIndex(bucketManager.getConfig(), mFilename);
+    }
+
+    return bucketManager.adoptFileAsBucket(mFilename, hash, mObjectsPut,
+                                           mBytesPut, mergeKey,
+                                           std::move(index));
 }
 }
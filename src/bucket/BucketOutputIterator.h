@@ -6,7 +6,7 @@
 
 #include "bucket/BucketManager.h"
 #include "bucket/LedgerCmp.h"
-#include "util/XDRStream.h"
+#include "util/XDRPipelinedOutputStream.h"
 #include "xdr/Hcnet-ledger.h"
 
 #include <memory>
@@ -24,10 +24,9 @@ class BucketOutputIterator
 {
   protected:
     std::string mFilename;
-    XDROutputFileStream mOut;
+    XDRPipelinedOutputFileStream mOut;
     BucketEntryIdCmp mCmp;
     std::unique_ptr<BucketEntry> mBuf;
-    SHA256 mHasher;
     size_t mBytesPut{0};
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
@@ -35,7 +34,22 @@ class BucketOutputIterator
     bool mPutMeta{false};
     MergeCounters& mMergeCounters;
 
+    BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries,
+                         BucketMetadata const& meta, MergeCounters& mc,
+                         asio::io_context& ctx, bool doFsync, bool writeMeta);
+
+    void flushBuffer();
+
   public:
+    // A run of entries written by a part iterator (see below), waiting to be
+    // appended to the output of a full one.
+    struct Part
+    {
+        std::string mFilename;
+        size_t mObjectsPut{0};
+        size_t mBytesPut{0};
+    };
+
     // BucketOutputIterators must _always_ be constructed with BucketMetadata,
     // regardless of the ledger version the bucket is being written from, even
     // if it's pre-METAENTRY support. The BucketOutputIterator constructor
@@ -47,8 +61,23 @@ class BucketOutputIterator
                          BucketMetadata const& meta, MergeCounters& mc,
                          asio::io_context& ctx, bool doFsync);
 
+    // Constructs an iterator for one key range of a bucket being written in
+    // parts. It never writes a METAENTRY, since the part will be appended
+    // after the METAENTRY of the full iterator, and is finished with
+    // finishPart rather than getBucket.
+    static std::unique_ptr<BucketOutputIterator>
+    makePart(std::string const& tmpDir, bool keepDeadEntries,
+             BucketMetadata const& meta, MergeCounters& mc,
+             asio::io_context& ctx);
+
     void put(BucketEntry const& e);
 
+    Part finishPart();
+
+    // Appends the entries of `part`, all of which must sort after every entry
+    // put so far, and deletes its file.
+    void appendPart(Part const& part);
+
     std::shared_ptr<Bucket> getBucket(BucketManager& bucketManager,
                                       MergeKey* mergeKey = nullptr);
 };
@@ -0,0 +1,338 @@
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+// This file contains tests for the BucketIndex and higher-level operations
+// concerning key-value lookup based on the BucketList.
+
+// ASIO is somewhat particular about when it gets included -- it wants to be the
+// first to include <windows.h> -- so we try to include it before everything
+// else.
+#include "util/asio.h"
+#include "bucket/BloomFilter.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
+#include "bucket/BucketList.h"
+#include "bucket/BucketManager.h"
+#include "bucket/BucketTests.h"
+#include "crypto/SHA.h"
+#include "database/Database.h"
+#include "ledger/LedgerTxn.h"
+#include "ledger/LedgerTxnEntry.h"
+#include "ledger/test/LedgerTestUtils.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionUtils.h"
+#include "util/Fs.h"
+#include "util/UnorderedMap.h"
+#include "util/UnorderedSet.h"
+
+using namespace hcnet;
+using namespace BucketTests;
+
+namespace BucketIndexTests
+{
+
+class BucketIndexTest
+{
+    VirtualClock mClock;
+    Application::pointer mApp;
+
+    // Newest live version of every generated key, and the keys that were
+    // deleted after having been live.
+    UnorderedMap<LedgerKey, LedgerEntry> mLive;
+    UnorderedSet<LedgerKey> mDead;
+
+  public:
+    explicit BucketIndexTest(Config const& cfg)
+        : mApp(createTestApplication(mClock, cfg))
+    {
+    }
+
+    BucketManager&
+    getBM() const
+    {
+        return mApp->getBucketManager();
+    }
+
+    Application&
+    getApp() const
+    {
+        return *mApp;
+    }
+
+    size_t
+    getLiveCount() const
+    {
+        return mLive.size();
+    }
+
+    void
+    buildBucketList(uint32_t nLedgers)
+    {
+        auto ledger = mApp->getLedgerManager().getLastClosedLedgerNum() + 1;
+        for (auto end = ledger + nLedgers; ledger < end; ++ledger)
+        {
+            auto live = LedgerTestUtils::generateValidLedgerEntries(10);
+            std::vector<LedgerKey> dead;
+
+            // Delete a couple of previously live entries every few ledgers.
+            if (ledger % 4 == 0)
+            {
+                for (auto it = mLive.begin();
+                     it != mLive.end() && dead.size() < 2;)
+                {
+                    dead.emplace_back(it->first);
+                    mDead.emplace(it->first);
+                    it = mLive.erase(it);
+                }
+            }
+
+            for (auto const& e : live)
+            {
+                auto k = LedgerEntryKey(e);
+                mLive[k] = e;
+                mDead.erase(k);
+            }
+
+            getBM().addBatch(*mApp, ledger, getAppLedgerVersion(mApp), {},
+                             live, dead);
+            mClock.crank(false);
+        }
+    }
+
+    void
+    checkPointLookups() const
+    {
+        for (auto const& kv : mLive)
+        {
+            auto e = getBM().getLedgerEntry(kv.first);
+            REQUIRE(e);
+            REQUIRE(*e == kv.second);
+        }
+        for (auto const& k : mDead)
+        {
+            REQUIRE(!getBM().getLedgerEntry(k));
+        }
+    }
+
+    void
+    checkBulkLookups() const
+    {
+        std::set<LedgerKey, LedgerEntryIdCmp> keys;
+        for (auto const& kv : mLive)
+        {
+            keys.emplace(kv.first);
+        }
+        for (auto const& k : mDead)
+        {
+            keys.emplace(k);
+        }
+
+        auto entries = getBM().loadKeys(keys);
+        REQUIRE(entries.size() == mLive.size());
+        for (auto const& e : entries)
+        {
+            auto it = mLive.find(LedgerEntryKey(e));
+            REQUIRE(it != mLive.end());
+            REQUIRE(it->second == e);
+        }
+    }
+
+    void
+    checkMissingKeys() const
+    {
+        for (auto const& k : LedgerTestUtils::generateLedgerKeys(20))
+        {
+            if (mLive.find(k) == mLive.end())
+            {
+                REQUIRE(!getBM().getLedgerEntry(k));
+            }
+        }
+    }
+};
+
+static Config
+getBucketListDBConfig()
+{
+    Config cfg(getTestConfig());
+    cfg.EXPERIMENTAL_BUCKETLIST_DB = true;
+    return cfg;
+}
+
+TEST_CASE("bucketlistDB point and bulk lookups", "[bucket][bucketindex]")
+{
+    auto cfg = getBucketListDBConfig();
+
+    auto test = [&](Config const& cfg) {
+        BucketIndexTest t(cfg);
+        t.buildBucketList(100);
+        t.checkPointLookups();
+        t.checkBulkLookups();
+        t.checkMissingKeys();
+    };
+
+    SECTION("individual index")
+    {
+        cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 0;
+        test(cfg);
+    }
+
+    SECTION("range index")
+    {
+        // Force small pages on every bucket so pages hold a handful of
+        // entries each.
+        cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF = 0;
+        cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 10;
+        test(cfg);
+    }
+}
+
+TEST_CASE("bucket index persistence", "[bucket][bucketindex]")
+{
+    auto cfg = getBucketListDBConfig();
+    cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF = 0;
+    cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 10;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    auto b = Bucket::fresh(bm, getAppLedgerVersion(app), {},
+                           LedgerTestUtils::generateValidLedgerEntries(100),
+                           {}, /*countMergeEvents=*/true, clock.getIOContext(),
+                           /*doFsync=*/true);
+    REQUIRE(b->isIndexed());
+
+    auto indexFilename = bm.bucketIndexFilename(b->getHash());
+    REQUIRE(fs::exists(indexFilename));
+
+    auto loaded = BucketIndex::load(cfg, indexFilename, b->getHash(),
+                                    b->getSize());
+    REQUIRE(loaded);
+    REQUIRE(loaded->getPageSize() == b->getIndex().getPageSize());
+    REQUIRE(loaded->size() == b->getIndex().size());
+
+    SECTION("stale index is ignored")
+    {
+        auto otherHash = sha256("not the bucket");
+        REQUIRE(!BucketIndex::load(cfg, indexFilename, otherHash,
+                                   b->getSize()));
+
+        // A different page size config invalidates the persisted index.
+        cfg.EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 0;
+        REQUIRE(!BucketIndex::load(cfg, indexFilename, b->getHash(),
+                                   b->getSize()));
+    }
+}
+
+TEST_CASE("bucket index bloom filter", "[bucket][bucketindex]")
+{
+    auto keys = LedgerTestUtils::generateLedgerKeys(1000);
+    UnorderedSet<LedgerKey> added(keys.begin(), keys.end());
+
+    auto seed = BloomFilter::randomSeed();
+    std::vector<uint64_t> keyHashes;
+    for (auto const& k : added)
+    {
+        keyHashes.emplace_back(BloomFilter::hashKey(seed, k));
+    }
+    BloomFilter filter(seed, keyHashes,
+                       BucketIndex::BLOOM_FILTER_BITS_PER_KEY);
+
+    auto check = [&](BloomFilter const& f) {
+        // No false negatives.
+        for (auto const& k : added)
+        {
+            REQUIRE(f.mayContain(k));
+        }
+
+        // About 1% false positives at 10 bits per key; allow some slack.
+        size_t absent = 0;
+        size_t falsePositives = 0;
+        for (auto const& k : LedgerTestUtils::generateLedgerKeys(5000))
+        {
+            if (added.find(k) == added.end())
+            {
+                ++absent;
+                falsePositives += f.mayContain(k) ? 1 : 0;
+            }
+        }
+        REQUIRE(absent > 0);
+        REQUIRE(falsePositives * 100 < absent * 3);
+    };
+
+    SECTION("membership")
+    {
+        check(filter);
+    }
+
+    SECTION("xdr round trip")
+    {
+        BloomFilter restored(filter.toXDR());
+        REQUIRE(restored.sizeInBytes() == filter.sizeInBytes());
+        check(restored);
+    }
+
+    SECTION("corrupt filter is rejected")
+    {
+        auto persisted = filter.toXDR();
+        persisted.numHashFunctions = 0;
+        REQUIRE_THROWS(BloomFilter(persisted));
+    }
+}
+
+TEST_CASE("bucketlistDB bloom filter metrics", "[bucket][bucketindex]")
+{
+    BucketIndexTest t(getBucketListDBConfig());
+    t.buildBucketList(20);
+
+    auto& metrics = t.getApp().getMetrics();
+    auto& lookups =
+        metrics.NewMeter({"bucketlistDB", "bloom", "lookups"}, "lookup");
+    auto& hits = metrics.NewMeter({"bucketlistDB", "bloom", "hits"}, "lookup");
+    auto& falsePositives = metrics.NewMeter(
+        {"bucketlistDB", "bloom", "false-positives"}, "lookup");
+    auto lookupsBefore = lookups.count();
+    auto hitsBefore = hits.count();
+
+    t.checkPointLookups();
+    t.checkMissingKeys();
+
+    // Every live key is found in exactly one bucket, and the filter must have
+    // rejected most probes of buckets that do not hold the key.
+    auto nLookups = lookups.count() - lookupsBefore;
+    auto nHits = hits.count() - hitsBefore;
+    REQUIRE(nHits >= t.getLiveCount());
+    REQUIRE(nLookups > nHits + falsePositives.count());
+}
+
+TEST_CASE("LedgerTxnRoot loads from BucketList", "[bucket][bucketindex]")
+{
+    VirtualClock clock;
+    Application::pointer app =
+        createTestApplication(clock, getBucketListDBConfig());
+
+    for (int i = 0; i < 5; ++i)
+    {
+        txtest::closeLedger(*app);
+    }
+
+    // The root account lives only in the BucketList.
+    int count = -1;
+    app->getDatabase().getSession() << "SELECT COUNT(*) FROM accounts;",
+        soci::into(count);
+    REQUIRE(count == 0);
+
+    LedgerTxn ltx(app->getLedgerTxnRoot());
+    auto rootKey = accountKey(
+        txtest::getRoot(app->getNetworkID()).getPublicKey());
+    REQUIRE(ltx.load(rootKey));
+}
+}
@@ -29,6 +29,8 @@
 #include "util/Timer.h"
 #include "xdrpp/autocheck.h"
 
+#include <chrono>
+
 using namespace hcnet;
 
 namespace BucketTests
@@ -979,6 +981,76 @@ TEST_CASE_VERSIONS("merging bucket entries with initentry with shadows",
     });
 }
 
+TEST_CASE("merges split into key ranges match serial merges", "[bucket]")
+{
+    auto mergeWith = [](int threads, std::vector<LedgerEntry> const& init,
+                        std::vector<LedgerEntry> const& oldLive,
+                        std::vector<LedgerEntry> const& newInit,
+                        std::vector<LedgerEntry> const& newLive,
+                        std::vector<LedgerKey> const& newDead,
+                        bool keepDeadEntries) {
+        VirtualClock clock;
+        Config cfg(getTestConfig());
+        cfg.BUCKET_MERGE_THREADS = threads;
+        cfg.BUCKET_MERGE_PARALLEL_CUTOFF = 0;
+        Application::pointer app = createTestApplication(clock, cfg);
+        auto& bm = app->getBucketManager();
+        auto vers = getAppLedgerVersion(app);
+
+        auto oldBucket =
+            Bucket::fresh(bm, vers, init, oldLive, {},
+                          /*countMergeEvents=*/true, clock.getIOContext(),
+                          /*doFsync=*/true);
+        auto newBucket =
+            Bucket::fresh(bm, vers, newInit, newLive, newDead,
+                          /*countMergeEvents=*/true, clock.getIOContext(),
+                          /*doFsync=*/true);
+        auto merged = Bucket::merge(
+            bm, cfg.LEDGER_PROTOCOL_VERSION, oldBucket, newBucket,
+            /*shadows=*/{}, keepDeadEntries,
+            /*countMergeEvents=*/true, clock.getIOContext(),
+            /*doFsync=*/true);
+        EntryCounts counts(merged);
+        return std::make_tuple(merged->getHash(), bm.readMergeCounters(),
+                               counts.sum());
+    };
+
+    // Old bucket: INIT and LIVE entries. New bucket: updates and deletions
+    // of some of them, plus INIT entries for new keys, so ranges see every
+    // kind of equal-key merge.
+    auto init = LedgerTestUtils::generateValidLedgerEntries(1000);
+    auto oldLive = LedgerTestUtils::generateValidLedgerEntries(1000);
+    auto newInit = LedgerTestUtils::generateValidLedgerEntries(1000);
+    std::vector<LedgerEntry> newLive;
+    std::vector<LedgerKey> newDead;
+    for (size_t i = 0; i + 1 < init.size(); i += 3)
+    {
+        newLive.emplace_back(init[i]);
+        newLive.back().lastModifiedLedgerSeq++;
+        newDead.emplace_back(LedgerEntryKey(init[i + 1]));
+    }
+    for (size_t i = 0; i + 1 < oldLive.size(); i += 3)
+    {
+        newLive.emplace_back(oldLive[i]);
+        newLive.back().lastModifiedLedgerSeq++;
+        newDead.emplace_back(LedgerEntryKey(oldLive[i + 1]));
+    }
+
+    for (bool keepDeadEntries : {true, false})
+    {
+        auto serial = mergeWith(1, init, oldLive, newInit, newLive, newDead,
+                                keepDeadEntries);
+        for (int threads : {2, 4, 7})
+        {
+            auto split = mergeWith(threads, init, oldLive, newInit, newLive,
+                                   newDead, keepDeadEntries);
+            REQUIRE(std::get<0>(split) == std::get<0>(serial));
+            REQUIRE(std::get<1>(split) == std::get<1>(serial));
+            REQUIRE(std::get<2>(split) == std::get<2>(serial));
+        }
+    }
+}
+
 TEST_CASE_VERSIONS("bucket apply", "[bucket]")
 {
     VirtualClock clock;
@@ -1024,6 +1096,42 @@ TEST_CASE_VERSIONS("bucket apply", "[bucket]")
     });
 }
 
+TEST_CASE("bucket input read bench", "[bucketbench][!hide]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0));
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    auto live = LedgerTestUtils::generateValidLedgerEntries(500000);
+    auto b = Bucket::fresh(app->getBucketManager(), getAppLedgerVersion(app),
+                           {}, live, {}, /*countMergeEvents=*/true,
+                           clock.getIOContext(), /*doFsync=*/false);
+    auto mb = static_cast<double>(b->getSize()) / (1024 * 1024);
+    CLOG_INFO(Bucket, "Reading bucket of {:.1f}MB", mb);
+
+    auto timeRead = [&](auto&& in, std::string const& name) {
+        BucketEntry be;
+        size_t n = 0;
+        auto start = std::chrono::steady_clock::now();
+        in.open(b->getFilename());
+        while (in.readOne(be))
+        {
+            ++n;
+        }
+        in.close();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        CLOG_INFO(Bucket, "{}: {} entries in {:.3f}s, {:.1f}MB/s", name, n,
+                  elapsed.count(), mb / elapsed.count());
+    };
+
+    for (int i = 0; i < 5; ++i)
+    {
+        timeRead(XDRInputFileStream(), "ifstream");
+        timeRead(XDRInputMappedFileStream(), "mmap");
+    }
+}
+
 TEST_CASE("bucket apply bench", "[bucketbench][!hide]")
 {
     auto runtest = [](Config::TestDbMode mode) {
@@ -15,6 +15,7 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
 #include <Tracy.hpp>
@@ -71,7 +72,9 @@ ApplyBucketsWork::ApplyBucketsWork(
     std::map<std::string, std::shared_ptr<Bucket>> const& buckets,
     HistoryArchiveState const& applyState, uint32_t maxProtocolVersion)
     : ApplyBucketsWork(app, buckets, applyState, maxProtocolVersion,
-                       [](LedgerEntryType) { return true; })
+                       [&app](LedgerEntryType let) {
+                           return app.getConfig().modeStoresEntryTypeInSQL(let);
+                       })
 {
 }
 
@@ -28,6 +28,31 @@ blake2(ByteSlice const& bin)
     return out;
 }
 
+HmacSha256Mac
+blake2Mac(HmacSha256Key const& key, ByteSlice const& bin)
+{
+    static_assert(sizeof(HmacSha256Key::key) >= crypto_generichash_KEYBYTES_MIN,
+                  "unexpected crypto_generichash_KEYBYTES_MIN");
+    ZoneScoped;
+    HmacSha256Mac out;
+    if (crypto_generichash(out.mac.data(), out.mac.size(), bin.data(),
+                           bin.size(), key.key.data(), key.key.size()) != 0)
+    {
+        throw CryptoError("error from crypto_generichash");
+    }
+    return out;
+}
+
+bool
+blake2MacVerify(HmacSha256Mac const& mac, HmacSha256Key const& key,
+                ByteSlice const& bin)
+{
+    ZoneScoped;
+    auto expected = blake2Mac(key, bin);
+    return 0 == sodium_memcmp(expected.mac.data(), mac.mac.data(),
+                              mac.mac.size());
+}
+
 BLAKE2::BLAKE2()
 {
     reset();
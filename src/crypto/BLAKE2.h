@@ -16,6 +16,14 @@ namespace hcnet
 // Plain BLAKE2 (a.k.a. BLAKE2b)
 uint256 blake2(ByteSlice const& bin);
 
+// Keyed BLAKE2b, used as a MAC. Key and output have the sizes of
+// HMAC-SHA256, so it can stand in for it on overlay connections that
+// negotiate it; it needs a single compression pass per block where HMAC
+// needs two SHA256 passes.
+HmacSha256Mac blake2Mac(HmacSha256Key const& key, ByteSlice const& bin);
+bool blake2MacVerify(HmacSha256Mac const& mac, HmacSha256Key const& key,
+                     ByteSlice const& bin);
+
 // BLAKE2 in incremental mode, for large inputs.
 class BLAKE2
 {
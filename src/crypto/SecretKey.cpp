@@ -17,6 +17,7 @@
 #include "util/Math.h"
 #include "util/RandomEvictionCache.h"
 #include <Tracy.hpp>
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <mutex>
@@ -40,11 +41,33 @@ namespace hcnet
 // to the state of the process; caching its results centrally
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
+//
+// The cache is split into shards, each behind its own mutex, so threads
+// verifying at the same time rarely contend. Cache keys are BLAKE2 hashes, so
+// their first byte picks a shard uniformly.
+
+static size_t const VERIFY_SIG_CACHE_SHARDS = 16;
+
+struct alignas(64) VerifySigCacheShard
+{
+    std::mutex mMutex;
+    std::unique_ptr<RandomEvictionCache<Hash, bool>> mCache{
+        std::make_unique<RandomEvictionCache<Hash, bool>>(
+            PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE /
+            VERIFY_SIG_CACHE_SHARDS)};
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+    uint64_t mReportedEvicts{0};
+};
+
+static std::array<VerifySigCacheShard, VERIFY_SIG_CACHE_SHARDS>
+    gVerifySigCache;
 
-static std::mutex gVerifySigCacheMutex;
-static RandomEvictionCache<Hash, bool> gVerifySigCache(0xffff);
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
+static VerifySigCacheShard&
+verifySigCacheShard(Hash const& cacheKey)
+{
+    return gVerifySigCache[cacheKey[0] % VERIFY_SIG_CACHE_SHARDS];
+}
 
 static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
@@ -232,6 +255,54 @@ SecretKey::benchmarkOpsPerSecond(size_t& sign, size_t& verify,
         1000000 / std::max(size_t(1), size_t(verifyUsec.count() / iterations));
 }
 
+void
+SecretKey::benchmarkBatchVerifyOpsPerSecond(size_t& verify, size_t iterations,
+                                            size_t batchSize,
+                                            size_t cachedVerifyPasses)
+{
+    namespace ch = std::chrono;
+    using clock = ch::high_resolution_clock;
+    using usec = ch::microseconds;
+
+    releaseAssert(batchSize > 0);
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        auto c = SignVerifyTestcase::create();
+        c.sign();
+        auto& check = checks.emplace_back();
+        check.key = c.key.getPublicKey();
+        check.signature = c.sig;
+        check.message = c.msg;
+    }
+
+    auto verifyStart = clock::now();
+    for (auto pass = 0; pass < cachedVerifyPasses; ++pass)
+    {
+        if (pass == 1)
+        {
+            // As in benchmarkOpsPerSecond, only measure cache-hits if there
+            // is more than 1 pass.
+            verifyStart = clock::now();
+        }
+        for (size_t i = 0; i < checks.size(); i += batchSize)
+        {
+            auto n = std::min(batchSize, checks.size() - i);
+            auto results = PubKeyUtils::verifySigBatch(checks.data() + i, n);
+            if (std::find(results.begin(), results.end(), false) !=
+                results.end())
+            {
+                throw std::runtime_error("verify failed");
+            }
+        }
+    }
+    auto verifyEnd = clock::now();
+
+    auto verifyUsec = ch::duration_cast<usec>(verifyEnd - verifyStart);
+    verify =
+        1000000 / std::max(size_t(1), size_t(verifyUsec.count() / iterations));
+}
+
 #ifdef BUILD_TESTS
 template <typename Rng>
 static std::vector<uint8_t>
@@ -313,21 +384,50 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
     return sk;
 }
 
+void
+PubKeyUtils::setVerifySigCacheSize(size_t size)
+{
+    auto shardSize = std::max<size_t>(1, size / VERIFY_SIG_CACHE_SHARDS);
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->maxSize() != shardSize)
+        {
+            shard.mCache =
+                std::make_unique<RandomEvictionCache<Hash, bool>>(shardSize);
+            shard.mReportedEvicts = 0;
+        }
+    }
+}
+
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.clear();
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache->clear();
+    }
 }
 
 void
-PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses)
+PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses,
+                                       uint64_t& evicts)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
+    hits = 0;
+    misses = 0;
+    evicts = 0;
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        auto shardEvicts = shard.mCache->getCounters().mEvicts;
+        hits += shard.mHits;
+        misses += shard.mMisses;
+        evicts += shardEvicts - shard.mReportedEvicts;
+        shard.mHits = 0;
+        shard.mMisses = 0;
+        shard.mReportedEvicts = shardEvicts;
+    }
 }
 
 std::string
@@ -436,15 +536,16 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     }
 
     auto cacheKey = verifySigCacheKey(key, signature, bin);
+    auto& shard = verifySigCacheShard(cacheKey);
 
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->exists(cacheKey, false))
         {
-            ++gVerifyCacheHit;
+            ++shard.mHits;
             std::string hitStr("hit");
             ZoneText(hitStr.c_str(), hitStr.size());
-            return gVerifySigCache.get(cacheKey);
+            return shard.mCache->get(cacheKey);
         }
     }
 
@@ -453,12 +554,88 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    ++gVerifyCacheMiss;
-    gVerifySigCache.put(cacheKey, ok);
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    ++shard.mMisses;
+    shard.mCache->put(cacheKey, ok);
     return ok;
 }
 
+std::vector<bool>
+PubKeyUtils::verifySigBatch(SignatureCheck const* checks, size_t count)
+{
+    ZoneScoped;
+    std::vector<bool> results(count, false);
+    std::vector<Hash> cacheKeys(count);
+    std::array<std::vector<size_t>, VERIFY_SIG_CACHE_SHARDS> byShard;
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const& check = checks[i];
+        releaseAssert(check.key.type() == PUBLIC_KEY_TYPE_ED25519);
+        if (check.signature.size() != 64)
+        {
+            continue;
+        }
+        cacheKeys[i] =
+            verifySigCacheKey(check.key, check.signature, check.message);
+        byShard[cacheKeys[i][0] % VERIFY_SIG_CACHE_SHARDS].emplace_back(i);
+    }
+
+    // Look up every shard's part of the batch, keeping only the misses.
+    for (size_t s = 0; s < VERIFY_SIG_CACHE_SHARDS; ++s)
+    {
+        auto& pending = byShard[s];
+        if (pending.empty())
+        {
+            continue;
+        }
+        auto& shard = gVerifySigCache[s];
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        size_t misses = 0;
+        for (auto i : pending)
+        {
+            if (shard.mCache->exists(cacheKeys[i], false))
+            {
+                results[i] = shard.mCache->get(cacheKeys[i]);
+            }
+            else
+            {
+                pending[misses++] = i;
+            }
+        }
+        shard.mHits += pending.size() - misses;
+        pending.resize(misses);
+    }
+
+    for (auto const& pending : byShard)
+    {
+        for (auto i : pending)
+        {
+            auto const& check = checks[i];
+            results[i] = crypto_sign_verify_detached(
+                             check.signature.data(), check.message.data(),
+                             check.message.size(),
+                             check.key.ed25519().data()) == 0;
+        }
+    }
+
+    for (size_t s = 0; s < VERIFY_SIG_CACHE_SHARDS; ++s)
+    {
+        auto const& pending = byShard[s];
+        if (pending.empty())
+        {
+            continue;
+        }
+        auto& shard = gVerifySigCache[s];
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mMisses += pending.size();
+        for (auto i : pending)
+        {
+            shard.mCache->put(cacheKeys[i], results[i]);
+        }
+    }
+    return results;
+}
+
 PublicKey
 PubKeyUtils::random()
 {
@@ -13,9 +13,11 @@
 #include "crypto/StrKey.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
+#include "lib/util/finally.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include <autocheck/autocheck.hpp>
+#include <chrono>
 #include <map>
 #include <regex>
 #include <sodium.h>
@@ -255,6 +257,57 @@ TEST_CASE("HMAC test vector", "[crypto]")
     REQUIRE(hmacSha256Verify(v, k, s));
 }
 
+TEST_CASE("BLAKE2 MAC", "[crypto]")
+{
+    HmacSha256Key k;
+    k.key[0] = 'k';
+    k.key[1] = 'e';
+    k.key[2] = 'y';
+    std::string s = "The quick brown fox jumps over the lazy dog";
+    auto v = blake2Mac(k, s);
+
+    uint256 expected;
+    REQUIRE(crypto_generichash(expected.data(), expected.size(),
+                               reinterpret_cast<unsigned char const*>(s.data()),
+                               s.size(), k.key.data(), k.key.size()) == 0);
+    REQUIRE(v.mac == expected);
+    REQUIRE(v.mac != hmacSha256(k, s).mac);
+    REQUIRE(blake2MacVerify(v, k, s));
+
+    REQUIRE(!blake2MacVerify(v, k, s + "."));
+    k.key[0] = 'K';
+    REQUIRE(!blake2MacVerify(v, k, s));
+}
+
+TEST_CASE("overlay MAC bench", "[!hide][mac-bench]")
+{
+    namespace ch = std::chrono;
+    HmacSha256Key k;
+    randombytes_buf(k.key.data(), k.key.size());
+
+    // Sizes of a typical transaction, SCP envelope and transaction set
+    for (size_t size : {200, 1000, 100000})
+    {
+        auto bytes = randomBytes(size);
+        size_t const iterations = 20000000 / size;
+        auto run = [&](auto mac) {
+            auto start = ch::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                mac(k, bytes);
+            }
+            auto elapsed = ch::steady_clock::now() - start;
+            return ch::duration<double, std::nano>(elapsed).count() /
+                   iterations;
+        };
+        auto hmacNs = run(hmacSha256);
+        auto blake2Ns = run(blake2Mac);
+        LOG_INFO(DEFAULT_LOG,
+                 "MAC of {} bytes: HMAC-SHA256 {:.0f}ns, BLAKE2b {:.0f}ns",
+                 size, hmacNs, blake2Ns);
+    }
+}
+
 TEST_CASE("HKDF test vector", "[crypto]")
 {
     auto ikm = hexToBin("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
@@ -295,6 +348,131 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("verify batch", "[crypto]")
+{
+    // Every third signature is corrupted and every seventh truncated.
+    std::vector<PubKeyUtils::SignatureCheck> checks(100);
+    std::vector<bool> expected;
+    size_t cacheable = 0;
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        auto& check = checks[i];
+        auto sk = SecretKey::pseudoRandomForTesting();
+        check.key = sk.getPublicKey();
+        check.message = randomBytes(32);
+        check.signature = sk.sign(check.message);
+        if (i % 3 == 0)
+        {
+            check.signature[4] ^= 1;
+        }
+        if (i % 7 == 0)
+        {
+            check.signature.resize(32);
+        }
+        else
+        {
+            ++cacheable;
+        }
+        expected.emplace_back(i % 3 != 0 && i % 7 != 0);
+    }
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evicts = 0;
+    PubKeyUtils::clearVerifySigCache();
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+
+    REQUIRE(PubKeyUtils::verifySigBatch(checks.data(), checks.size()) ==
+            expected);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+    REQUIRE(hits == 0);
+    REQUIRE(misses == cacheable);
+
+    SECTION("cached results are reused")
+    {
+        REQUIRE(PubKeyUtils::verifySigBatch(checks.data(), checks.size()) ==
+                expected);
+        for (size_t i = 0; i < checks.size(); ++i)
+        {
+            REQUIRE(PubKeyUtils::verifySig(checks[i].key, checks[i].signature,
+                                           checks[i].message) == expected[i]);
+        }
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+        REQUIRE(hits == 2 * cacheable);
+        REQUIRE(misses == 0);
+    }
+
+    SECTION("small cache evicts")
+    {
+        // The cache is process-wide: restore it even if a check fails
+        auto restoreSize = gsl::finally([]() {
+            PubKeyUtils::setVerifySigCacheSize(
+                PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE);
+        });
+        PubKeyUtils::setVerifySigCacheSize(32);
+        REQUIRE(PubKeyUtils::verifySigBatch(checks.data(), checks.size()) ==
+                expected);
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+        REQUIRE(misses == cacheable);
+        REQUIRE(evicts > 0);
+    }
+}
+
+TEST_CASE("verify batch agrees with libsodium on malformed signatures",
+          "[crypto]")
+{
+    auto sk = SecretKey::pseudoRandomForTesting();
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    auto addCheck = [&](PublicKey const& key, Signature const& sig) {
+        auto& check = checks.emplace_back();
+        check.key = key;
+        check.signature = sig;
+        check.message = {'h', 'e', 'l', 'l', 'o'};
+    };
+    auto validSig = sk.sign(std::string("hello"));
+    addCheck(sk.getPublicKey(), validSig);
+
+    // S + L, where L is the order of the base point: the same point
+    // equation holds, but the encoding of S is not canonical.
+    uint8_t const order[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+                               0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                               0,    0,    0,    0,    0,    0,    0,    0,
+                               0,    0,    0,    0,    0,    0,    0,    0x10};
+    auto bigS = validSig;
+    unsigned carry = 0;
+    for (size_t i = 0; i < 32; ++i)
+    {
+        carry += bigS[32 + i] + order[i];
+        bigS[32 + i] = static_cast<uint8_t>(carry);
+        carry >>= 8;
+    }
+    addCheck(sk.getPublicKey(), bigS);
+
+    // Identity key with R = identity and S = 0, which satisfies the
+    // verification equation for any message.
+    PublicKey identity;
+    identity.ed25519()[0] = 1;
+    Signature trivial(64, 0);
+    trivial[0] = 1;
+    addCheck(identity, trivial);
+
+    PubKeyUtils::clearVerifySigCache();
+    auto results = PubKeyUtils::verifySigBatch(checks.data(), checks.size());
+    PubKeyUtils::clearVerifySigCache();
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        auto const& c = checks[i];
+        bool sodiumOk =
+            crypto_sign_verify_detached(c.signature.data(), c.message.data(),
+                                        c.message.size(),
+                                        c.key.ed25519().data()) == 0;
+        REQUIRE(results[i] == sodiumOk);
+        REQUIRE(PubKeyUtils::verifySig(c.key, c.signature, c.message) ==
+                sodiumOk);
+    }
+    REQUIRE(results == std::vector<bool>{true, false, false});
+}
+
 TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][!hide]")
 {
     size_t signPerSec = 0, verifyPerSec = 0;
@@ -314,6 +492,25 @@ TEST_CASE("verify-hit benchmarking", "[crypto-bench][bench][!hide]")
              verifyPerSec);
 }
 
+TEST_CASE("verify batch benchmarking", "[crypto-bench][bench][!hide]")
+{
+    for (size_t batchSize : {1, 64, 1000})
+    {
+        size_t verifyPerSec = 0;
+        SecretKey::benchmarkBatchVerifyOpsPerSecond(verifyPerSec, 10000,
+                                                    batchSize);
+        LOG_INFO(DEFAULT_LOG,
+                 "Benchmarked {} verifications / sec in batches of {}",
+                 verifyPerSec, batchSize);
+        SecretKey::benchmarkBatchVerifyOpsPerSecond(verifyPerSec, 10000,
+                                                    batchSize, 10);
+        LOG_INFO(DEFAULT_LOG,
+                 "Benchmarked {} verification cache-hits / sec in batches of "
+                 "{}",
+                 verifyPerSec, batchSize);
+    }
+}
+
 TEST_CASE("StrKey tests", "[crypto]")
 {
     std::regex b32("^([A-Z2-7])+$");
@@ -11,6 +11,7 @@
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include <functional>
+#include <mutex>
 #include <set>
 #include <soci.h>
 #include <string>
@@ -94,12 +95,15 @@ class Database : NonMovableOrCopyable
     std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
     medida::Counter& mStatementsSize;
 
+    // Timers can be requested by worker threads reading through the pool.
+    std::mutex mEntityTypesMutex;
     std::set<std::string> mEntityTypes;
 
     static bool gDriversRegistered;
     static void registerDrivers();
     void applySchemaUpgrade(unsigned long vers);
     void open();
+    void addEntityType(std::string const& entityName);
 
   public:
     // Instantiate object and connect to app.getConfig().DATABASE;
@@ -121,6 +125,12 @@ class Database : NonMovableOrCopyable
     // when the statement context is destroyed.
     StatementContext getPreparedStatement(std::string const& query);
 
+    // As above, but the statement runs on `session`, which may be a session
+    // from the connection pool. Only statements on the main session are
+    // cached.
+    StatementContext getPreparedStatement(std::string const& query,
+                                          soci::session& session);
+
     // Purge all cached prepared statements, closing their handles with the
     // database.
     void clearPreparedStatementCache();
@@ -20,6 +20,7 @@
 namespace hcnet
 {
 class Application;
+class TxValidityCache;
 class XDROutputFileStream;
 
 /*
@@ -120,8 +121,19 @@ class Herder
     // We are learning about a new transaction.
     virtual TransactionQueue::AddResult
     recvTransaction(TransactionFrameBasePtr tx, bool submittedFromSelf) = 0;
+    // Same as recvTransaction, except that with TX_ADMISSION_QUEUE_SIZE set
+    // the stateless checks and the signatures are verified on a worker thread
+    // first. `onResult` is called on the main thread, possibly before this
+    // returns. Transactions are added to the queue in the order they were
+    // received.
+    virtual void recvTransactionAsync(
+        TransactionFrameBasePtr tx, bool submittedFromSelf,
+        std::function<void(TransactionQueue::AddResult)> onResult) = 0;
     virtual void peerDoesntHave(hcnet::MessageType type,
                                 uint256 const& itemID, Peer::pointer peer) = 0;
+    // `peer` sent the item, which is about to be received.
+    virtual void peerReplied(hcnet::MessageType type, uint256 const& itemID,
+                             Peer::pointer peer) = 0;
     virtual TxSetFrameConstPtr getTxSet(Hash const& hash) = 0;
     virtual SCPQuorumSetPtr getQSet(Hash const& qSetHash) = 0;
 
@@ -194,5 +206,9 @@ class Herder
     virtual size_t getMaxQueueSizeOps() const = 0;
     virtual bool isBannedTx(Hash const& hash) const = 0;
     virtual TransactionFrameBaseConstPtr getTx(Hash const& hash) const = 0;
+
+    // Transactions found valid against the current ledger state, shared by
+    // the transaction queue and tx set validation.
+    virtual TxValidityCache& getTxValidityCache() = 0;
 };
 }
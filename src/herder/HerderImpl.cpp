@@ -33,6 +33,7 @@
 #include "medida/counter.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/Decoder.h"
 #include "util/XDRStream.h"
 #include "xdr/Hcnet-internal.h"
@@ -75,9 +76,16 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
 }
 
 HerderImpl::HerderImpl(Application& app)
-    : mTransactionQueue(app, TRANSACTION_QUEUE_TIMEOUT_LEDGERS,
+    : mTxValidityCache(app)
+    , mTransactionQueue(app, TRANSACTION_QUEUE_TIMEOUT_LEDGERS,
                         TRANSACTION_QUEUE_BAN_LEDGERS,
                         TRANSACTION_QUEUE_SIZE_MULTIPLIER)
+    , mAdmissionQueueSize(
+          app.getMetrics().NewCounter({"herder", "admission", "queue"}))
+    , mAdmissionRejected(app.getMetrics().NewMeter(
+          {"herder", "admission", "rejected"}, "transaction"))
+    , mAdmissionDelay(
+          app.getMetrics().NewTimer({"herder", "admission", "delay"}))
     , mPendingEnvelopes(app, *this)
     , mHerderSCPDriver(app, *this, mUpgrades, mPendingEnvelopes)
     , mLastSlotSaved(0)
@@ -89,6 +97,11 @@ HerderImpl::HerderImpl(Application& app)
     , mApp(app)
     , mLedgerManager(app.getLedgerManager())
     , mSCPMetrics(app)
+    , mTxSetBuildTimer(app.getMetrics().NewTimer({"herder", "txset", "build"}))
+    , mCandidateTxSetHit(app.getMetrics().NewMeter(
+          {"herder", "candidate-txset", "hit"}, "txset"))
+    , mCandidateTxSetMiss(app.getMetrics().NewMeter(
+          {"herder", "candidate-txset", "miss"}, "txset"))
     , mState(Herder::HERDER_BOOTING_STATE)
 {
     auto ln = getSCP().getLocalNode();
@@ -458,6 +471,138 @@ HerderImpl::recvTransaction(TransactionFrameBasePtr tx, bool submittedFromSelf)
     return result;
 }
 
+void
+HerderImpl::recvTransactionAsync(
+    TransactionFrameBasePtr tx, bool submittedFromSelf,
+    std::function<void(TransactionQueue::AddResult)> onResult)
+{
+    ZoneScoped;
+    auto const& hash = tx->getFullHash();
+    auto maxPending = mApp.getConfig().TX_ADMISSION_QUEUE_SIZE;
+    if (maxPending == 0 || mTransactionQueue.isBanned(hash) ||
+        mTransactionQueue.getTx(hash))
+    {
+        onResult(recvTransaction(tx, submittedFromSelf));
+        return;
+    }
+    if (mPendingAdmissionHashes.find(hash) != mPendingAdmissionHashes.end())
+    {
+        onResult(TransactionQueue::AddResult::ADD_STATUS_DUPLICATE);
+        return;
+    }
+
+    auto admission = std::make_shared<PendingAdmission>();
+    admission->mTx = tx;
+    admission->mSubmittedFromSelf = submittedFromSelf;
+    admission->mOnResult = std::move(onResult);
+    admission->mReceivedTime = mApp.getClock().now();
+
+    if (mPendingAdmissions.size() >= maxPending)
+    {
+        // Transactions from peers wait for their turn: the peer's reading
+        // capacity stays held until `onResult` is called, so flow control
+        // bounds how many of them can wait and throttles the peers sending
+        // them. Transactions submitted to this node are not bounded by
+        // anything, so they have to be submitted again later.
+        if (submittedFromSelf)
+        {
+            mAdmissionRejected.Mark();
+            admission->mOnResult(
+                TransactionQueue::AddResult::ADD_STATUS_TRY_AGAIN_LATER);
+            return;
+        }
+        mWaitingAdmissions.emplace_back(admission);
+    }
+    else
+    {
+        mPendingAdmissions.emplace_back(admission);
+        verifyAdmission(admission);
+    }
+    mPendingAdmissionHashes.emplace(hash);
+    mAdmissionQueueSize.inc();
+}
+
+void
+HerderImpl::verifyAdmission(std::shared_ptr<PendingAdmission> admission)
+{
+    ZoneScoped;
+    // Signers have to be loaded from the ledger here, but the signatures can
+    // be verified anywhere: the transaction queue then finds the results in
+    // the signature verification cache.
+    auto checks = std::make_shared<std::vector<PubKeyUtils::SignatureCheck>>();
+    {
+        LedgerTxn ltx(mApp.getLedgerTxnRoot(),
+                      /* shouldUpdateLastModified */ true,
+                      TransactionMode::READ_ONLY_WITHOUT_SQL_TXN);
+        admission->mTx->insertSignatureChecks(ltx, *checks);
+    }
+
+    // `admission` is moved along so that its last reference, which may hold
+    // a peer's reading capacity, is always released on the main thread.
+    auto header = mLedgerManager.getLastClosedLedgerHeader().header;
+    auto& app = mApp;
+    mApp.postOnBackgroundThread(
+        [this, &app, checks, header,
+         admission = std::move(admission)]() mutable {
+            bool valid = admission->mTx->checkValidStateless(header);
+            if (valid)
+            {
+                PubKeyUtils::verifySigBatch(checks->data(), checks->size());
+            }
+            app.postOnMainThread(
+                [this, valid, ledgerSeq = header.ledgerSeq,
+                 admission = std::move(admission)]() {
+                    admission->mStatelessValid = valid;
+                    admission->mCheckedLedgerSeq = ledgerSeq;
+                    admission->mVerified = true;
+                    if (!mApp.isStopping())
+                    {
+                        admitVerifiedTransactions();
+                    }
+                },
+                "admitVerifiedTransactions");
+        },
+        "verifyTransactionSignatures");
+}
+
+void
+HerderImpl::admitVerifiedTransactions()
+{
+    ZoneScoped;
+    while (!mPendingAdmissions.empty() && mPendingAdmissions.front()->mVerified)
+    {
+        auto admission = mPendingAdmissions.front();
+        mPendingAdmissions.pop_front();
+        mPendingAdmissionHashes.erase(admission->mTx->getFullHash());
+        mAdmissionQueueSize.dec();
+        mAdmissionDelay.Update(mApp.getClock().now() -
+                               admission->mReceivedTime);
+        // The stateless checks only have to run again if a ledger closed in
+        // between, which may have changed their outcome
+        if (!admission->mStatelessValid &&
+            admission->mCheckedLedgerSeq ==
+                mLedgerManager.getLastClosedLedgerNum())
+        {
+            admission->mOnResult(TransactionQueue::AddResult::ADD_STATUS_ERROR);
+        }
+        else
+        {
+            admission->mOnResult(recvTransaction(
+                admission->mTx, admission->mSubmittedFromSelf));
+        }
+    }
+
+    auto maxPending = mApp.getConfig().TX_ADMISSION_QUEUE_SIZE;
+    while (!mWaitingAdmissions.empty() &&
+           mPendingAdmissions.size() < maxPending)
+    {
+        auto admission = mWaitingAdmissions.front();
+        mWaitingAdmissions.pop_front();
+        mPendingAdmissions.emplace_back(admission);
+        verifyAdmission(admission);
+    }
+}
+
 bool
 HerderImpl::checkCloseTime(SCPEnvelope const& envelope, bool enforceRecent)
 {
@@ -873,6 +1018,92 @@ HerderImpl::lastClosedLedgerIncreased()
     releaseAssert(mLedgerManager.isSynced());
 
     setupTriggerNextLedger();
+
+    if (mApp.getConfig().PREPARE_CANDIDATE_TX_SET)
+    {
+        auto lclHash = mLedgerManager.getLastClosedLedgerHeader().hash;
+        mApp.postOnMainThread(
+            [this, lclHash]() {
+                if (mApp.isStopping())
+                {
+                    return;
+                }
+                prepareCandidateTxSet(lclHash);
+            },
+            "prepareCandidateTxSet");
+    }
+}
+
+void
+HerderImpl::prepareCandidateTxSet(Hash const& lclHash)
+{
+    ZoneScoped;
+    mCandidateTxSet.reset();
+
+    auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
+    auto now = mApp.getClock().now();
+    auto triggerTime = mTriggerTimer.expiry_time();
+    if (!isTracking() || !mLedgerManager.isSynced() || lcl.hash != lclHash ||
+        triggerTime <= now)
+    {
+        return;
+    }
+
+    // The trigger nominates the current time as close time, so the set has to
+    // be valid from the time the trigger timer expires, and for a while after
+    // in case the trigger runs late. Transactions that are invalid anywhere in
+    // that range are left to the trigger to ban.
+    auto untilTrigger = std::chrono::duration_cast<std::chrono::milliseconds>(
+        triggerTime - now);
+    uint64_t closeTime =
+        VirtualClock::to_time_t(mApp.getClock().system_now() + untilTrigger);
+    auto lastCloseTime = lcl.header.scpValue.closeTime;
+    if (closeTime <= lastCloseTime)
+    {
+        closeTime = lastCloseTime + 1;
+    }
+    uint64_t lowerBoundCloseTimeOffset = closeTime - lastCloseTime;
+    uint64_t upperBoundCloseTimeOffset =
+        lowerBoundCloseTimeOffset +
+        mApp.getConfig().getExpectedLedgerCloseTime().count();
+
+    TxSetFrame::Transactions queueTxs;
+    auto txSet = makeTxSetFromQueue(lcl, lowerBoundCloseTimeOffset,
+                                    upperBoundCloseTimeOffset, false, queueTxs);
+    if (txSet)
+    {
+        mCandidateTxSet = CandidateTxSet{lcl.hash, lowerBoundCloseTimeOffset,
+                                         upperBoundCloseTimeOffset,
+                                         std::move(queueTxs), txSet};
+    }
+}
+
+TxSetFrameConstPtr
+HerderImpl::makeTxSetFromQueue(LedgerHeaderHistoryEntry const& lcl,
+                               uint64_t lowerBoundCloseTimeOffset,
+                               uint64_t upperBoundCloseTimeOffset,
+                               bool banInvalid,
+                               TxSetFrame::Transactions& queueTxs)
+{
+    ZoneScoped;
+    auto maxOps = mLedgerManager.getLastMaxTxSetSizeOps();
+    while (true)
+    {
+        queueTxs = mTransactionQueue.getTopTransactions(lcl.header, maxOps);
+        TxSetFrame::Transactions invalidTxs;
+        auto txSet = TxSetFrame::makeFromTransactions(
+            queueTxs, mApp, lowerBoundCloseTimeOffset,
+            upperBoundCloseTimeOffset, &invalidTxs);
+        if (invalidTxs.empty())
+        {
+            return txSet;
+        }
+        if (!banInvalid)
+        {
+            return nullptr;
+        }
+        mTransactionQueue.ban(invalidTxs);
+    }
 }
 
 void
@@ -976,6 +1207,14 @@ HerderImpl::peerDoesntHave(MessageType type, uint256 const& itemID,
     mPendingEnvelopes.peerDoesntHave(type, itemID, peer);
 }
 
+void
+HerderImpl::peerReplied(MessageType type, uint256 const& itemID,
+                        Peer::pointer peer)
+{
+    ZoneScoped;
+    mPendingEnvelopes.peerReplied(type, itemID, peer);
+}
+
 TxSetFrameConstPtr
 HerderImpl::getTxSet(Hash const& hash)
 {
@@ -1064,10 +1303,7 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
         return;
     }
 
-    // our first choice for this round's set is all the tx we have collected
-    // during last few ledger closes
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
-    auto queueTxs = mTransactionQueue.getTransactions(lcl.header);
 
     // We pick as next close time the current time unless it's before the last
     // close time. We don't know how much time it will take to reach consensus
@@ -1100,11 +1336,45 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
     upperBoundCloseTimeOffset = nextCloseTime - lcl.header.scpValue.closeTime;
     lowerBoundCloseTimeOffset = upperBoundCloseTimeOffset;
 
-    TxSetFrame::Transactions invalidTxs;
-    auto proposedSet = TxSetFrame::makeFromTransactions(
-        queueTxs, mApp, lowerBoundCloseTimeOffset, upperBoundCloseTimeOffset,
-        &invalidTxs);
-    mTransactionQueue.ban(invalidTxs);
+    // our first choice for this round's set is the best of the tx we have
+    // collected during last few ledger closes. The queue was checked for
+    // invalid transactions when the last ledger closed, so the top ones are
+    // only validated here; should any of them be invalid, they get banned and
+    // the next best ones are picked instead. If that set was already built
+    // while waiting for the trigger, and nothing it depends on has changed
+    // since, it is used as is.
+    TxSetFrameConstPtr proposedSet;
+    {
+        auto timer = mTxSetBuildTimer.TimeScope();
+        if (mCandidateTxSet)
+        {
+            auto const& candidate = *mCandidateTxSet;
+            if (candidate.mLclHash == lcl.hash &&
+                candidate.mLowerBoundCloseTimeOffset <=
+                    lowerBoundCloseTimeOffset &&
+                upperBoundCloseTimeOffset <=
+                    candidate.mUpperBoundCloseTimeOffset &&
+                mTransactionQueue.getTopTransactions(
+                    lcl.header, mLedgerManager.getLastMaxTxSetSizeOps()) ==
+                    candidate.mQueueTxs)
+            {
+                proposedSet = candidate.mTxSet;
+                mCandidateTxSetHit.Mark();
+            }
+            else
+            {
+                mCandidateTxSetMiss.Mark();
+            }
+            mCandidateTxSet.reset();
+        }
+        if (!proposedSet)
+        {
+            TxSetFrame::Transactions queueTxs;
+            proposedSet = makeTxSetFromQueue(lcl, lowerBoundCloseTimeOffset,
+                                             upperBoundCloseTimeOffset, true,
+                                             queueTxs);
+        }
+    }
 
     auto txSetHash = proposedSet->getContentsHash();
 
@@ -2000,4 +2270,10 @@ HerderImpl::getTx(Hash const& hash) const
     return mTransactionQueue.getTx(hash);
 }
 
+TxValidityCache&
+HerderImpl::getTxValidityCache()
+{
+    return mTxValidityCache;
+}
+
 }
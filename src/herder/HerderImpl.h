@@ -8,12 +8,15 @@
 #include "herder/HerderSCPDriver.h"
 #include "herder/PendingEnvelopes.h"
 #include "herder/TransactionQueue.h"
+#include "herder/TxValidityCache.h"
 #include "herder/Upgrades.h"
 #include "util/Timer.h"
 #include "util/UnorderedMap.h"
+#include "util/UnorderedSet.h"
 #include "util/XDROperators.h"
 #include <deque>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace medida
@@ -96,6 +99,9 @@ class HerderImpl : public Herder
     TransactionQueue::AddResult
     recvTransaction(TransactionFrameBasePtr tx,
                     bool submittedFromSelf) override;
+    void recvTransactionAsync(
+        TransactionFrameBasePtr tx, bool submittedFromSelf,
+        std::function<void(TransactionQueue::AddResult)> onResult) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
 #ifdef BUILD_TESTS
@@ -122,6 +128,8 @@ class HerderImpl : public Herder
     bool recvTxSet(Hash const& hash, TxSetFrameConstPtr txset) override;
     void peerDoesntHave(MessageType type, uint256 const& itemID,
                         Peer::pointer peer) override;
+    void peerReplied(MessageType type, uint256 const& itemID,
+                     Peer::pointer peer) override;
     TxSetFrameConstPtr getTxSet(Hash const& hash) override;
     SCPQuorumSetPtr getQSet(Hash const& qSetHash) override;
 
@@ -182,6 +190,7 @@ class HerderImpl : public Herder
     size_t getMaxQueueSizeOps() const override;
     bool isBannedTx(Hash const& hash) const override;
     TransactionFrameBaseConstPtr getTx(Hash const& hash) const override;
+    TxValidityCache& getTxValidityCache() override;
 
   private:
     // return true if values referenced by envelope have a valid close time:
@@ -197,6 +206,20 @@ class HerderImpl : public Herder
 
     void setupTriggerNextLedger();
 
+    // Builds the tx set to nominate on top of `lcl` out of the best
+    // transactions in the queue, valid for close times within the given
+    // offsets from the last close time. `queueTxs` receives the transactions
+    // the set was built from. Invalid transactions are banned and replaced
+    // unless `banInvalid` is false, in which case nullptr is returned instead.
+    TxSetFrameConstPtr makeTxSetFromQueue(LedgerHeaderHistoryEntry const& lcl,
+                                          uint64_t lowerBoundCloseTimeOffset,
+                                          uint64_t upperBoundCloseTimeOffset,
+                                          bool banInvalid,
+                                          TxSetFrame::Transactions& queueTxs);
+
+    // Builds the candidate tx set for the next trigger while waiting for it.
+    void prepareCandidateTxSet(Hash const& lclHash);
+
     void startOutOfSyncTimer();
     void outOfSyncRecovery();
     void broadcast(SCPEnvelope const& e);
@@ -206,11 +229,41 @@ class HerderImpl : public Herder
     void newSlotExternalized(bool synchronous, HcnetValue const& value);
     void purgeOldPersistedTxSets();
 
+    TxValidityCache mTxValidityCache;
     TransactionQueue mTransactionQueue;
 
     void
     updateTransactionQueue(std::vector<TransactionFrameBasePtr> const& applied);
 
+    // Transactions received through recvTransactionAsync, in the order they
+    // were received. At most TX_ADMISSION_QUEUE_SIZE of them have their
+    // signatures verified at a time, the others wait for their turn in
+    // mWaitingAdmissions.
+    struct PendingAdmission
+    {
+        TransactionFrameBasePtr mTx;
+        bool mSubmittedFromSelf;
+        std::function<void(TransactionQueue::AddResult)> mOnResult;
+        VirtualClock::time_point mReceivedTime;
+        bool mVerified{false};
+        // Result of checkValidStateless against ledger mCheckedLedgerSeq
+        bool mStatelessValid{true};
+        uint32_t mCheckedLedgerSeq{0};
+    };
+    std::deque<std::shared_ptr<PendingAdmission>> mPendingAdmissions;
+    std::deque<std::shared_ptr<PendingAdmission>> mWaitingAdmissions;
+    UnorderedSet<Hash> mPendingAdmissionHashes;
+    medida::Counter& mAdmissionQueueSize;
+    medida::Meter& mAdmissionRejected;
+    medida::Timer& mAdmissionDelay;
+
+    // Starts the stateless checks and the signature verification of
+    // `admission` on a worker thread.
+    void verifyAdmission(std::shared_ptr<PendingAdmission> admission);
+    // Adds the verified transactions at the front of mPendingAdmissions to the
+    // transaction queue, then starts verifying the waiting ones.
+    void admitVerifiedTransactions();
+
     PendingEnvelopes mPendingEnvelopes;
     Upgrades mUpgrades;
     HerderSCPDriver mHerderSCPDriver;
@@ -273,6 +326,24 @@ class HerderImpl : public Herder
 
     SCPMetrics mSCPMetrics;
 
+    // time to build the tx set to nominate out of the transaction queue
+    medida::Timer& mTxSetBuildTimer;
+
+    // Tx set built ahead of the trigger, see PREPARE_CANDIDATE_TX_SET. It is
+    // nominated only if the ledger and the queue selection it was built from
+    // are still current and the close time falls within its validity range.
+    struct CandidateTxSet
+    {
+        Hash mLclHash;
+        uint64_t mLowerBoundCloseTimeOffset;
+        uint64_t mUpperBoundCloseTimeOffset;
+        TxSetFrame::Transactions mQueueTxs;
+        TxSetFrameConstPtr mTxSet;
+    };
+    std::optional<CandidateTxSet> mCandidateTxSet;
+    medida::Meter& mCandidateTxSetHit;
+    medida::Meter& mCandidateTxSetMiss;
+
     // Check that the quorum map intersection state is up to date, and if not
     // run a background job that re-analyzes the current quorum map.
     void checkAndMaybeReanalyzeQuorumMap();
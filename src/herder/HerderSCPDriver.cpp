@@ -684,6 +684,10 @@ HerderSCPDriver::combineCandidates(uint64_t slotIndex,
                 "No highest candidate transaction set found");
         }
         comp = *highest;
+
+        // This is very likely the set that gets externalized; start loading
+        // what it needs while the ballot protocol runs.
+        mLedgerManager.prefetchTxSetInBackground(highestTxSet);
     }
     comp.upgrades.clear();
     for (auto const& upgrade : upgrades)
@@ -73,6 +73,25 @@ PendingEnvelopes::peerDoesntHave(MessageType type, Hash const& itemID,
     }
 }
 
+void
+PendingEnvelopes::peerReplied(MessageType type, Hash const& itemID,
+                              Peer::pointer peer)
+{
+    switch (type)
+    {
+    case TX_SET:
+    case GENERALIZED_TX_SET:
+        mTxSetFetcher.replied(itemID, peer);
+        break;
+    case SCP_QUORUMSET:
+        mQuorumSetFetcher.replied(itemID, peer);
+        break;
+    default:
+        CLOG_INFO(Herder, "Unknown Type in peerReplied: {}", type);
+        break;
+    }
+}
+
 SCPQuorumSetPtr
 PendingEnvelopes::getKnownQSet(Hash const& hash, bool touch)
 {
@@ -176,6 +176,8 @@ class PendingEnvelopes
     void peerDoesntHave(MessageType type, Hash const& itemID,
                         Peer::pointer peer);
 
+    void peerReplied(MessageType type, Hash const& itemID, Peer::pointer peer);
+
     SCPEnvelopeWrapperPtr pop(uint64 slotIndex);
 
     // erases data for all slots strictly below `slotIndex`
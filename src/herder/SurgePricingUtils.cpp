@@ -341,6 +341,60 @@ SurgePricingPriorityQueue::canFitWithEviction(
     releaseAssert(false);
 }
 
+std::vector<TransactionFrameBasePtr>
+SurgePricingPriorityQueue::peekMostTopTxsWithinLimit(
+    uint32_t opsLimit,
+    std::function<TxStackPtr(TxStack const&)> const& copyStack) const
+{
+    // This only makes sense when the lowest fee rate tx is on top.
+    releaseAssert(!mComparator.isGreater());
+
+    // Stacks are ordered by their top transaction only, so the stacks visited
+    // so far are copied and popped in `visited`, and the stacks of this queue
+    // are brought in whenever they rank higher than all the visited ones.
+    std::vector<TransactionFrameBasePtr> txs;
+    TxStackSet visited(mComparator);
+    auto next = mTxStackSet.rbegin();
+    uint32_t opsLeftUntilLimit = opsLimit;
+    while (opsLeftUntilLimit > 0)
+    {
+        while (next != mTxStackSet.rend() &&
+               (visited.empty() || mComparator(*visited.rbegin(), *next)))
+        {
+            auto txStack = copyStack(**next);
+            ++next;
+            if (!txStack->empty())
+            {
+                visited.insert(txStack);
+            }
+        }
+        if (visited.empty())
+        {
+            break;
+        }
+
+        auto topIt = std::prev(visited.end());
+        auto txStack = *topIt;
+        visited.erase(topIt);
+        auto tx = txStack->getTopTx();
+        auto ops = tx->getNumOperations();
+        // Like `getMostTopTxsWithinLimit`, skip the rest of a stack once its
+        // top transaction does not fit.
+        if (ops > opsLeftUntilLimit)
+        {
+            continue;
+        }
+        txs.emplace_back(tx);
+        opsLeftUntilLimit -= ops;
+        txStack->popTopTx();
+        if (!txStack->empty())
+        {
+            visited.insert(txStack);
+        }
+    }
+    return txs;
+}
+
 SurgePricingPriorityQueue::TxStackSet::iterator
 SurgePricingPriorityQueue::getTop() const
 {
@@ -121,6 +121,17 @@ class SurgePricingPriorityQueue
     canFitWithEviction(TransactionFrameBase const& tx, uint32_t txOpsDiscount,
                        std::vector<TxStackPtr>& txStacksToEvict) const;
 
+    // Selects the same transactions as `getMostTopTxsWithinLimit` would from
+    // the stacks in this queue, without modifying the queue or its stacks.
+    // This only makes sense for the lowest priority queue; its stacks are
+    // visited from the highest fee rate down, and `copyStack` is called to get
+    // a stack that can be popped for every stack that is reached. Visiting
+    // stops as soon as `opsLimit` is reached, so this takes O(k log n) for k
+    // visited stacks out of n rather than ordering all the stacks.
+    std::vector<TransactionFrameBasePtr> peekMostTopTxsWithinLimit(
+        uint32_t opsLimit,
+        std::function<TxStackPtr(TxStack const&)> const& copyStack) const;
+
     // Returns total number of operations in all the stacks in this queue.
     uint32_t sizeOps() const;
 
@@ -4,8 +4,10 @@
 
 #include "herder/TransactionQueue.h"
 #include "crypto/SecretKey.h"
+#include "herder/Herder.h"
 #include "herder/SurgePricingUtils.h"
 #include "herder/TxQueueLimiter.h"
+#include "herder/TxValidityCache.h"
 #include "ledger/LedgerHashUtils.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
@@ -24,6 +26,7 @@
 #include "util/TarjanSCCCalculator.h"
 #include "util/XDROperators.h"
 #include "util/numeric128.h"
+#include "xdrpp/marshal.h"
 
 #include <Tracy.hpp>
 #include <algorithm>
@@ -51,6 +54,9 @@ TransactionQueue::TransactionQueue(Application& app, uint32 pendingDepth,
     : mApp(app)
     , mPendingDepth(pendingDepth)
     , mBannedTransactions(banDepth)
+    , mTxsByFeeRate(/* isHighestPriority */ false,
+                    std::numeric_limits<uint32_t>::max(),
+                    rand_uniform<size_t>(0, std::numeric_limits<size_t>::max()))
     , mLedgerVersion(app.getLedgerManager()
                          .getLastClosedLedgerHeader()
                          .header.ledgerVersion)
@@ -60,6 +66,8 @@ TransactionQueue::TransactionQueue(Application& app, uint32 pendingDepth,
           app.getMetrics().NewCounter({"herder", "arb-tx", "seen"}))
     , mArbTxDroppedCounter(
           app.getMetrics().NewCounter({"herder", "arb-tx", "dropped"}))
+    , mPendingTxsBytes(
+          app.getMetrics().NewCounter({"herder", "pending-txs", "bytes"}))
     , mTransactionsDelay(
           app.getMetrics().NewTimer({"herder", "pending-txs", "delay"}))
     , mTransactionsSelfDelay(
@@ -86,6 +94,73 @@ TransactionQueue::~TransactionQueue()
     // empty destructor needed here due to the dependency on TxQueueLimiter
 }
 
+// The transactions of an account from mNext up to (but excluding) mEnd, or to
+// the end of the queue if mEnd is not set.
+class AccountTxStack : public TxStack
+{
+  public:
+    AccountTxStack(TransactionQueue::AccountState const& accountState)
+        : mTransactions(accountState.mTransactions)
+    {
+    }
+
+    TransactionFrameBasePtr
+    getTopTx() const override
+    {
+        releaseAssert(!empty());
+        return mTransactions[mNext].mTx;
+    }
+
+    void
+    popTopTx() override
+    {
+        releaseAssert(!empty());
+        ++mNext;
+    }
+
+    uint32_t
+    getNumOperations() const override
+    {
+        uint32_t ops = 0;
+        for (size_t i = mNext; i < end(); ++i)
+        {
+            ops += mTransactions[i].mTx->getNumOperations();
+        }
+        return ops;
+    }
+
+    bool
+    empty() const override
+    {
+        return mNext >= end();
+    }
+
+    // Returns a copy of this stack that ends before the transaction with
+    // sequence number `seqNum`, if any.
+    TxStackPtr
+    copyUntilSeqNum(int64_t seqNum) const
+    {
+        auto it = std::find_if(
+            mTransactions.begin() + mNext, mTransactions.begin() + end(),
+            [&](auto const& tx) { return tx.mTx->getSeqNum() == seqNum; });
+        auto res = std::make_shared<AccountTxStack>(*this);
+        res->mEnd = it - mTransactions.begin();
+        return res;
+    }
+
+  private:
+    size_t
+    end() const
+    {
+        return std::min(mEnd.value_or(mTransactions.size()),
+                        mTransactions.size());
+    }
+
+    TransactionQueue::TimestampedTransactions const& mTransactions;
+    size_t mNext{0};
+    std::optional<size_t> mEnd;
+};
+
 // returns true, if a transaction can be replaced by another
 // `minFee` is set when returning false, and is the smallest fee
 // that would allow replace by fee to succeed in this situation
@@ -323,8 +398,8 @@ TransactionQueue::canAdd(TransactionFrameBasePtr tx,
         ltx.loadHeader().current().ledgerSeq =
             mApp.getLedgerManager().getLastClosedLedgerNum() + 1;
     }
-    if (!tx->checkValid(ltx, seqNum, 0,
-                        getUpperBoundCloseTimeOffset(mApp, closeTime)))
+    if (!mApp.getHerder().getTxValidityCache().checkValid(
+            tx, ltx, seqNum, 0, getUpperBoundCloseTimeOffset(mApp, closeTime)))
     {
         return TransactionQueue::AddResult::ADD_STATUS_ERROR;
     }
@@ -369,6 +444,7 @@ TransactionQueue::prepareDropTransaction(AccountState& as, TimestampedTx& tstx)
     as.mQueueSizeOps -= ops;
     mTxQueueLimiter->removeTransaction(tstx.mTx);
     mKnownTxHashes.erase(tstx.mTx->getFullHash());
+    mPendingTxsBytes.dec(tstx.mMemorySize);
     if (!tstx.mBroadcasted)
     {
         as.mBroadcastQueueOps -= ops;
@@ -485,6 +561,45 @@ TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
     return ret;
 }
 
+// Estimates the memory a queued transaction holds, erring on the high side.
+// The XDR size of the envelope bounds its variable-length parts (signature
+// bytes, memo, paths...); the rest are the fixed-size structures the frames
+// allocate for it and the queue entries pointing to it. Signature checkers
+// are not kept past validation, so they are not counted.
+static uint32_t
+estimateTxMemory(TransactionFrameBase const& tx)
+{
+    // vtable pointer and both reference counts of a make_shared allocation
+    size_t const controlBlockSize = sizeof(void*) + 2 * sizeof(uint32_t);
+    // next pointer and cached hash of a node, and its bucket
+    size_t const mapNodeSize = 2 * sizeof(void*) + sizeof(size_t);
+
+    auto const& env = tx.getEnvelope();
+    size_t res =
+        xdr::xdr_size(env) + sizeof(TransactionFrame) + controlBlockSize +
+        sizeof(TransactionQueue::TimestampedTx) + mapNodeSize +
+        sizeof(std::pair<Hash const, TransactionQueue::AccountState const*>) +
+        txbridge::getSignatures(env).size() * sizeof(DecoratedSignature);
+    if (env.type() == ENVELOPE_TYPE_TX_FEE_BUMP)
+    {
+        // The inner transaction has a frame of its own, with a copy of its
+        // envelope
+        auto const& inner = env.feeBump().tx.innerTx.v1();
+        res += sizeof(FeeBumpTransactionFrame) + controlBlockSize +
+               xdr::xdr_size(inner) +
+               inner.signatures.size() * sizeof(DecoratedSignature);
+    }
+
+    // Each operation has its XDR in the envelope, a frame, and a result in
+    // the transaction result
+    size_t const perOp = sizeof(Operation) + sizeof(OperationFrame) +
+                         controlBlockSize +
+                         sizeof(std::shared_ptr<OperationFrame>) +
+                         sizeof(OperationResult);
+    res += tx.getRawOperations().size() * perOp;
+    return static_cast<uint32_t>(res);
+}
+
 TransactionQueue::AddResult
 TransactionQueue::tryAdd(TransactionFrameBasePtr tx, bool submittedFromSelf)
 {
@@ -504,22 +619,26 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx, bool submittedFromSelf)
             mAccountStates.emplace(tx->getSourceID(), AccountState{}).first;
         oldTxIter = stateIter->second.mTransactions.end();
     }
+    removeFromFeeRateIndex(stateIter->second);
 
+    auto memorySize = estimateTxMemory(*tx);
+    TimestampedTx tstx{tx, mApp.getClock().now(), memorySize, false,
+                       submittedFromSelf};
     if (oldTxIter != stateIter->second.mTransactions.end())
     {
         prepareDropTransaction(stateIter->second, *oldTxIter);
-        *oldTxIter = {tx, false, mApp.getClock().now(), submittedFromSelf};
+        *oldTxIter = std::move(tstx);
     }
     else
     {
-        stateIter->second.mTransactions.push_back(
-            {tx, false, mApp.getClock().now(), submittedFromSelf});
+        stateIter->second.mTransactions.emplace_back(std::move(tstx));
         oldTxIter = --stateIter->second.mTransactions.end();
         mSizeByAge[stateIter->second.mAge]->inc();
     }
     auto ops = tx->getNumOperations();
     stateIter->second.mQueueSizeOps += ops;
     stateIter->second.mBroadcastQueueOps += ops;
+    addToFeeRateIndex(stateIter->second);
     auto& thisAccountState = mAccountStates[tx->getFeeSourceID()];
     thisAccountState.mTotalFees += tx->getFeeBid();
 
@@ -529,7 +648,8 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx, bool submittedFromSelf)
         txsToEvict, ops,
         [&](TransactionFrameBasePtr const& txToEvict) { ban({txToEvict}); });
     mTxQueueLimiter->addTransaction(tx);
-    mKnownTxHashes[tx->getFullHash()] = tx;
+    mKnownTxHashes[tx->getFullHash()] = &stateIter->second;
+    mPendingTxsBytes.inc(memorySize);
 
     broadcast(false);
 
@@ -546,6 +666,7 @@ TransactionQueue::dropTransactions(AccountStates::iterator stateIter,
     // Note prepareDropTransaction may erase other iterators from
     // mAccountStates, but it will not erase stateIter because it has at least
     // one transaction (otherwise we couldn't reach that line).
+    removeFromFeeRateIndex(stateIter->second);
     for (auto iter = begin; iter != end; ++iter)
     {
         prepareDropTransaction(stateIter->second, *iter);
@@ -553,6 +674,7 @@ TransactionQueue::dropTransactions(AccountStates::iterator stateIter,
 
     // Actually erase the transactions to be dropped.
     stateIter->second.mTransactions.erase(begin, end);
+    addToFeeRateIndex(stateIter->second);
 
     // If the queue for stateIter is now empty, then (1) erase it if it is not
     // the fee-source for some other transaction or (2) reset the age otherwise.
@@ -793,6 +915,7 @@ TransactionQueue::shift()
 
         if (mPendingDepth == it->second.mAge)
         {
+            removeFromFeeRateIndex(it->second);
             for (auto& toBan : it->second.mTransactions)
             {
                 // This never invalidates it because
@@ -877,24 +1000,69 @@ TransactionQueue::getTransactions(LedgerHeader const& lcl) const
     return txs;
 }
 
+TxSetFrame::Transactions
+TransactionQueue::getTopTransactions(LedgerHeader const& lcl,
+                                     uint32_t opsLimit) const
+{
+    ZoneScoped;
+    // Transactions from seqNum == startingSeq on are left out, as in
+    // getTransactions.
+    int64_t const startingSeq = getStartingSequenceNumber(lcl.ledgerSeq + 1);
+    return mTxsByFeeRate.peekMostTopTxsWithinLimit(
+        opsLimit, [startingSeq](TxStack const& txStack) {
+            return static_cast<AccountTxStack const&>(txStack).copyUntilSeqNum(
+                startingSeq);
+        });
+}
+
+void
+TransactionQueue::addToFeeRateIndex(AccountState const& as)
+{
+    if (!as.mTransactions.empty())
+    {
+        mTxsByFeeRate.add(std::make_shared<AccountTxStack>(as));
+    }
+}
+
+void
+TransactionQueue::removeFromFeeRateIndex(AccountState const& as)
+{
+    // Stacks are found by their top transaction, so an equivalent stack
+    // finds the indexed one.
+    if (!as.mTransactions.empty())
+    {
+        mTxsByFeeRate.erase(std::make_shared<AccountTxStack>(as));
+    }
+}
+
 TransactionFrameBaseConstPtr
 TransactionQueue::getTx(Hash const& hash) const
 {
     ZoneScoped;
     auto it = mKnownTxHashes.find(hash);
-    if (it != mKnownTxHashes.end())
+    if (it == mKnownTxHashes.end())
     {
-        return it->second;
+        return nullptr;
     }
-    else
+    // Accounts only have a few transactions queued
+    for (auto const& tstx : it->second->mTransactions)
     {
-        return nullptr;
+        if (tstx.mTx->getFullHash() == hash)
+        {
+            return tstx.mTx;
+        }
     }
+    releaseAssert(false);
+    return nullptr;
 }
 
 void
 TransactionQueue::clearAll()
 {
+    for (auto const& [_, accountState] : mAccountStates)
+    {
+        removeFromFeeRateIndex(accountState);
+    }
     mAccountStates.clear();
     for (auto& b : mBannedTransactions)
     {
@@ -902,6 +1070,7 @@ TransactionQueue::clearAll()
     }
     mTxQueueLimiter->reset();
     mKnownTxHashes.clear();
+    mPendingTxsBytes.clear();
 }
 
 void
@@ -101,11 +101,16 @@ class TransactionQueue
      *   sequence-number-source, ordered by sequence number
      */
 
+    // Kept small, as there is one per transaction in the queue: the flags
+    // share the padding after mMemorySize.
     struct TimestampedTx
     {
         TransactionFrameBasePtr mTx;
-        bool mBroadcasted;
         VirtualClock::time_point mInsertionTime;
+        // Estimated memory held by mTx, accounted in
+        // herder.pending-txs.bytes
+        uint32_t mMemorySize;
+        bool mBroadcasted;
         bool mSubmittedFromSelf;
     };
     using TimestampedTransactions = std::vector<TimestampedTx>;
@@ -146,6 +151,13 @@ class TransactionQueue
 
     TxSetFrame::Transactions getTransactions(LedgerHeader const& lcl) const;
 
+    // Returns the transactions that surge pricing would pick for a tx set of
+    // at most `opsLimit` operations out of `getTransactions(lcl)`, assuming
+    // they are all valid. This only goes through the selected transactions
+    // rather than the whole queue.
+    TxSetFrame::Transactions getTopTransactions(LedgerHeader const& lcl,
+                                                uint32_t opsLimit) const;
+
     struct ReplacedTransaction
     {
         TransactionFrameBasePtr mOld;
@@ -180,6 +192,12 @@ class TransactionQueue
 
     AccountStates mAccountStates;
     BannedTransactions mBannedTransactions;
+
+    // The transactions of every account in mAccountStates that has some, as
+    // a stack ordered by the fee rate of its first transaction. An account is
+    // removed before its transactions change and added back after, so that
+    // tx sets can be built without sorting the whole queue.
+    SurgePricingPriorityQueue mTxsByFeeRate;
     uint32_t mLedgerVersion;
 
     // counters
@@ -187,6 +205,7 @@ class TransactionQueue
     medida::Counter& mBannedTransactionsCounter;
     medida::Counter& mArbTxSeenCounter;
     medida::Counter& mArbTxDroppedCounter;
+    medida::Counter& mPendingTxsBytes;
     medida::Timer& mTransactionsDelay;
     medida::Timer& mTransactionsSelfDelay;
 
@@ -216,6 +235,9 @@ class TransactionQueue
 
     void releaseFeeMaybeEraseAccountState(TransactionFrameBasePtr tx);
 
+    void addToFeeRateIndex(AccountState const& as);
+    void removeFromFeeRateIndex(AccountState const& as);
+
     void prepareDropTransaction(AccountState& as, TimestampedTx& tstx);
     void dropTransactions(AccountStates::iterator stateIter,
                           TimestampedTransactions::iterator begin,
@@ -228,7 +250,11 @@ class TransactionQueue
     std::unique_ptr<TxQueueLimiter> mTxQueueLimiter;
     UnorderedMap<AssetPair, uint32_t, AssetPairHash> mArbitrageFloodDamping;
 
-    UnorderedMap<Hash, TransactionFrameBasePtr> mKnownTxHashes;
+    // The AccountState of the sequence-number-source of every queued
+    // transaction, by full hash. Values of mAccountStates never move, and an
+    // AccountState outlives its transactions, so the queue entries remain the
+    // only owners of the frames.
+    UnorderedMap<Hash, AccountState const*> mKnownTxHashes;
 
     size_t mBroadcastSeed;
 
@@ -7,7 +7,10 @@
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "herder/Herder.h"
+#include "herder/TxValidityCache.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -25,13 +28,19 @@
 
 #include <Tracy.hpp>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <numeric>
 
 namespace hcnet
 {
 namespace
 {
+// Number of signatures a thread verifies per claim on the shared work list.
+size_t const SIGNATURE_VERIFY_BATCH_SIZE = 64;
+
 // Target use case is to remove a subset of invalid transactions from a TxSet.
 // I.e. txSet.size() >= txsToRemove.size()
 TxSetFrame::Transactions
@@ -141,6 +150,68 @@ TxSetUtils::buildAccountTxQueues(TxSetFrame::Transactions const& txs)
     return queues;
 }
 
+void
+TxSetUtils::verifySignatures(TxSetFrame::Transactions const& txs,
+                             Application& app, AbstractLedgerTxn& ltx)
+{
+    ZoneScoped;
+    struct Work
+    {
+        std::vector<PubKeyUtils::SignatureCheck> mChecks;
+        std::atomic<size_t> mNext{0};
+        size_t mDone{0};
+        std::mutex mMutex;
+        std::condition_variable mCond;
+    };
+    auto work = std::make_shared<Work>();
+    for (auto const& tx : txs)
+    {
+        tx->insertSignatureChecks(ltx, work->mChecks);
+    }
+    auto total = work->mChecks.size();
+    if (total <= SIGNATURE_VERIFY_BATCH_SIZE)
+    {
+        // Not worth handing off; checkValid verifies these inline.
+        return;
+    }
+
+    // Every participant claims batches until none are left. Worker tasks
+    // that only start after the caller has finished find nothing to do, so
+    // the caller never waits on a worker that is busy with something else.
+    auto verifyBatches = [work, total]() {
+        while (true)
+        {
+            auto begin = work->mNext.fetch_add(SIGNATURE_VERIFY_BATCH_SIZE);
+            if (begin >= total)
+            {
+                return;
+            }
+            auto end = std::min(total, begin + SIGNATURE_VERIFY_BATCH_SIZE);
+            PubKeyUtils::verifySigBatch(work->mChecks.data() + begin,
+                                        end - begin);
+            std::lock_guard<std::mutex> guard(work->mMutex);
+            work->mDone += end - begin;
+            if (work->mDone == total)
+            {
+                work->mCond.notify_all();
+            }
+        }
+    };
+
+    auto batches = (total + SIGNATURE_VERIFY_BATCH_SIZE - 1) /
+                   SIGNATURE_VERIFY_BATCH_SIZE;
+    auto helpers =
+        std::min<size_t>(app.getConfig().WORKER_THREADS, batches - 1);
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        app.postOnBackgroundThread(verifyBatches, "verifySignatures");
+    }
+    verifyBatches();
+
+    std::unique_lock<std::mutex> lock(work->mMutex);
+    work->mCond.wait(lock, [&]() { return work->mDone == total; });
+}
+
 TxSetFrame::Transactions
 TxSetUtils::getInvalidTxList(TxSetFrame::Transactions const& txs,
                              Application& app,
@@ -160,6 +231,16 @@ TxSetUtils::getInvalidTxList(TxSetFrame::Transactions const& txs,
             app.getLedgerManager().getLastClosedLedgerNum() + 1;
     }
 
+    // Transactions found valid before mostly still are, and then need no
+    // signature checks
+    auto& validityCache = app.getHerder().getTxValidityCache();
+    TxSetFrame::Transactions uncheckedTxs;
+    std::copy_if(txs.begin(), txs.end(), std::back_inserter(uncheckedTxs),
+                 [&](TransactionFrameBasePtr const& tx) {
+                     return !validityCache.contains(*tx);
+                 });
+    verifySignatures(uncheckedTxs, app, ltx);
+
     UnorderedMap<AccountID, int64_t> accountFeeMap;
     TxSetFrame::Transactions invalidTxs;
 
@@ -178,8 +259,9 @@ TxSetUtils::getInvalidTxList(TxSetFrame::Transactions const& txs,
                 iter != accountQueue->mTxs.begin() &&
                 (tx->getMinSeqAge() != 0 || tx->getMinSeqLedgerGap() != 0);
             if (minSeqCheckIsInvalid ||
-                !tx->checkValid(ltx, lastSeq, lowerBoundCloseTimeOffset,
-                                upperBoundCloseTimeOffset))
+                !validityCache.checkValid(tx, ltx, lastSeq,
+                                          lowerBoundCloseTimeOffset,
+                                          upperBoundCloseTimeOffset))
             {
                 invalidTxs.emplace_back(tx);
                 iter = accountQueue->mTxs.erase(iter);
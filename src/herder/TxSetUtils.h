@@ -52,6 +52,14 @@ class TxSetUtils
                      uint64_t upperBoundCloseTimeOffset,
                      bool returnEarlyOnFirstInvalidTx);
 
+    // Verifies the ed25519 signatures that checking `txs` against `ltx` is
+    // expected to need, spread over the worker threads and the calling
+    // thread. Results land in the signature verification cache, so the
+    // following checkValid calls only hit the cache. Returns once all
+    // signatures have been verified.
+    static void verifySignatures(TxSetFrame::Transactions const& txs,
+                                 Application& app, AbstractLedgerTxn& ltx);
+
     static TxSetFrame::Transactions
     trimInvalid(TxSetFrame::Transactions const& txs, Application& app,
                 uint64_t lowerBoundCloseTimeOffset,
@@ -0,0 +1,227 @@
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TxValidityCache.h"
+#include "ledger/LedgerTxn.h"
+#include "ledger/LedgerTxnEntry.h"
+#include "ledger/LedgerTxnHeader.h"
+#include "main/Application.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "transactions/TransactionUtils.h"
+#include "util/UnorderedSet.h"
+#include "util/XDROperators.h"
+#include "util/types.h"
+#include <Tracy.hpp>
+
+namespace hcnet
+{
+
+namespace
+{
+// Enough for the transaction queue and the tx sets nominated by peers
+size_t const TX_VALIDITY_CACHE_SIZE = 20000;
+
+Preconditions const*
+getPreconditions(TransactionEnvelope const& env)
+{
+    switch (env.type())
+    {
+    case ENVELOPE_TYPE_TX:
+        return &env.v1().tx.cond;
+    case ENVELOPE_TYPE_TX_FEE_BUMP:
+        return &env.feeBump().tx.innerTx.v1().tx.cond;
+    default:
+        return nullptr;
+    }
+}
+
+std::optional<TimeBounds>
+getTimeBounds(TransactionEnvelope const& env)
+{
+    if (env.type() == ENVELOPE_TYPE_TX_V0)
+    {
+        return env.v0().tx.timeBounds ? std::make_optional(
+                                            *env.v0().tx.timeBounds)
+                                      : std::nullopt;
+    }
+    auto cond = getPreconditions(env);
+    switch (cond->type())
+    {
+    case PRECOND_TIME:
+        return cond->timeBounds();
+    case PRECOND_V2:
+        return cond->v2().timeBounds ? std::make_optional(
+                                           *cond->v2().timeBounds)
+                                     : std::nullopt;
+    default:
+        return std::nullopt;
+    }
+}
+
+// Highest ledger the transaction may be included in, plus one, or 0 if there
+// is no limit.
+uint32_t
+getMaxLedger(TransactionEnvelope const& env)
+{
+    auto cond = getPreconditions(env);
+    if (cond && cond->type() == PRECOND_V2 && cond->v2().ledgerBounds)
+    {
+        return cond->v2().ledgerBounds->maxLedger;
+    }
+    return 0;
+}
+
+std::vector<LedgerKey>
+getAccountKeys(TransactionFrameBase const& tx)
+{
+    UnorderedSet<AccountID> accounts{tx.getSourceID(), tx.getFeeSourceID()};
+    for (auto const& op : tx.getRawOperations())
+    {
+        if (op.sourceAccount)
+        {
+            accounts.emplace(toAccountID(*op.sourceAccount));
+        }
+    }
+
+    std::vector<LedgerKey> keys;
+    keys.reserve(accounts.size());
+    for (auto const& acc : accounts)
+    {
+        keys.emplace_back(accountKey(acc));
+    }
+    return keys;
+}
+}
+
+TxValidityCache::TxValidityCache(Application& app)
+    : mValidTxs(TX_VALIDITY_CACHE_SIZE)
+    , mHitMeter(app.getMetrics().NewMeter({"herder", "tx-validity", "hit"},
+                                          "transaction"))
+    , mMissMeter(app.getMetrics().NewMeter({"herder", "tx-validity", "miss"},
+                                           "transaction"))
+{
+}
+
+bool
+TxValidityCache::checkValid(TransactionFrameBasePtr const& tx,
+                            AbstractLedgerTxn& ltx, SequenceNumber current,
+                            uint64_t lowerBoundCloseTimeOffset,
+                            uint64_t upperBoundCloseTimeOffset)
+{
+    ZoneScoped;
+    if (isValid(*tx, ltx, current, lowerBoundCloseTimeOffset,
+                upperBoundCloseTimeOffset))
+    {
+        mHitMeter.Mark();
+        return true;
+    }
+
+    mMissMeter.Mark();
+    if (!tx->checkValid(ltx, current, lowerBoundCloseTimeOffset,
+                        upperBoundCloseTimeOffset))
+    {
+        return false;
+    }
+    addValid(*tx, ltx, current, lowerBoundCloseTimeOffset);
+    return true;
+}
+
+bool
+TxValidityCache::isValid(TransactionFrameBase const& tx,
+                         AbstractLedgerTxn& ltx, SequenceNumber current,
+                         uint64_t lowerBoundCloseTimeOffset,
+                         uint64_t upperBoundCloseTimeOffset)
+{
+    auto validTx = mValidTxs.maybeGet(tx.getFullHash());
+    if (!validTx || validTx->mCurrent != current)
+    {
+        return false;
+    }
+
+    {
+        auto header = ltx.loadHeader();
+        auto const& lh = header.current();
+        if (lh.ledgerVersion != validTx->mLedgerVersion ||
+            lh.baseFee != validTx->mBaseFee ||
+            lh.baseReserve != validTx->mBaseReserve ||
+            !(lh.ext == validTx->mHeaderExt))
+        {
+            return false;
+        }
+
+        // Ledger number and close time conditions hold for later ledgers and
+        // close times, up to the transaction's upper bounds.
+        auto const& env = tx.getEnvelope();
+        auto maxLedger = getMaxLedger(env);
+        if (lh.ledgerSeq < validTx->mLedgerSeq ||
+            (maxLedger != 0 && lh.ledgerSeq >= maxLedger))
+        {
+            return false;
+        }
+        auto tb = getTimeBounds(env);
+        auto closeTime = lh.scpValue.closeTime;
+        bool minCloseTimeHolds =
+            closeTime + lowerBoundCloseTimeOffset >= validTx->mMinCloseTime ||
+            ((!tb || tb->minTime == 0) && tx.getMinSeqAge() == 0);
+        bool maxCloseTimeHolds = !tb || tb->maxTime == 0 ||
+                                 closeTime + upperBoundCloseTimeOffset <=
+                                     tb->maxTime;
+        if (!minCloseTimeHolds || !maxCloseTimeHolds)
+        {
+            return false;
+        }
+    }
+
+    for (auto const& acc : validTx->mAccounts)
+    {
+        auto entry = ltx.loadWithoutRecord(LedgerEntryKey(acc));
+        if (!entry || !(entry.current() == acc))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+TxValidityCache::addValid(TransactionFrameBase const& tx,
+                          AbstractLedgerTxn& ltx, SequenceNumber current,
+                          uint64_t lowerBoundCloseTimeOffset)
+{
+    ValidTx validTx;
+    validTx.mCurrent = current;
+    for (auto const& key : getAccountKeys(tx))
+    {
+        auto entry = ltx.loadWithoutRecord(key);
+        if (!entry)
+        {
+            return;
+        }
+        validTx.mAccounts.emplace_back(entry.current());
+    }
+
+    auto header = ltx.loadHeader();
+    auto const& lh = header.current();
+    validTx.mLedgerVersion = lh.ledgerVersion;
+    validTx.mBaseFee = lh.baseFee;
+    validTx.mBaseReserve = lh.baseReserve;
+    validTx.mHeaderExt = lh.ext;
+    validTx.mLedgerSeq = lh.ledgerSeq;
+    validTx.mMinCloseTime = lh.scpValue.closeTime + lowerBoundCloseTimeOffset;
+    mValidTxs.put(tx.getFullHash(), validTx);
+}
+
+bool
+TxValidityCache::contains(TransactionFrameBase const& tx)
+{
+    return mValidTxs.exists(tx.getFullHash(), false);
+}
+
+void
+TxValidityCache::clear()
+{
+    mValidTxs.clear();
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/TransactionFrameBase.h"
+#include "util/NonCopyable.h"
+#include "util/RandomEvictionCache.h"
+#include "xdr/Hcnet-ledger.h"
+#include <vector>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace hcnet
+{
+
+class AbstractLedgerTxn;
+class Application;
+
+// Remembers the transactions that passed `checkValid`, along with everything
+// the result depended on: the ledger header fields, the close time range and
+// the accounts the transaction reads (source, fee source and operation
+// sources). A transaction checked again is only found valid without running
+// the checks if none of these changed since, so results survive ledger closes
+// for transactions whose accounts were left untouched.
+//
+// Failed checks are not remembered, as callers report the result code that
+// `checkValid` leaves in the transaction.
+class TxValidityCache : private NonMovableOrCopyable
+{
+    struct ValidTx
+    {
+        SequenceNumber mCurrent;
+        uint32_t mLedgerVersion;
+        uint32_t mBaseFee;
+        uint32_t mBaseReserve;
+        // Holds the flags disabling operations
+        LedgerHeader::_ext_t mHeaderExt;
+        // Ledger number and earliest close time the transaction was checked
+        // for. Later ones only need checking against its upper bounds.
+        uint32_t mLedgerSeq;
+        TimePoint mMinCloseTime;
+        std::vector<LedgerEntry> mAccounts;
+    };
+
+    RandomEvictionCache<Hash, ValidTx> mValidTxs;
+    medida::Meter& mHitMeter;
+    medida::Meter& mMissMeter;
+
+    bool isValid(TransactionFrameBase const& tx, AbstractLedgerTxn& ltx,
+                 SequenceNumber current, uint64_t lowerBoundCloseTimeOffset,
+                 uint64_t upperBoundCloseTimeOffset);
+    void addValid(TransactionFrameBase const& tx, AbstractLedgerTxn& ltx,
+                  SequenceNumber current, uint64_t lowerBoundCloseTimeOffset);
+
+  public:
+    explicit TxValidityCache(Application& app);
+
+    // Same as tx->checkValid(ltx, current, lowerBoundCloseTimeOffset,
+    // upperBoundCloseTimeOffset), skipping the checks if `tx` is known to be
+    // valid under the same conditions.
+    bool checkValid(TransactionFrameBasePtr const& tx, AbstractLedgerTxn& ltx,
+                    SequenceNumber current, uint64_t lowerBoundCloseTimeOffset,
+                    uint64_t upperBoundCloseTimeOffset);
+
+    // Returns true if `tx` was found valid before, whether or not that still
+    // holds.
+    bool contains(TransactionFrameBase const& tx);
+
+    void clear();
+};
+}
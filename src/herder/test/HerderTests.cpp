@@ -3359,6 +3359,63 @@ TEST_CASE("do not flood too many transactions", "[herder][transactionqueue]")
     }
 }
 
+TEST_CASE("prepared candidate tx set", "[herder][txset]")
+{
+    SIMULATION_CREATE_NODE(0);
+
+    Config cfg(getTestConfig());
+    cfg.MANUAL_CLOSE = false;
+    cfg.NODE_SEED = v0SecretKey;
+    cfg.QUORUM_SET.threshold = 1;
+    cfg.QUORUM_SET.validators.clear();
+    cfg.QUORUM_SET.validators.push_back(v0NodeID);
+    cfg.PREPARE_CANDIDATE_TX_SET = true;
+
+    VirtualClock clock;
+    auto app = createTestApplication(clock, cfg);
+    auto& lm = app->getLedgerManager();
+    auto& hit = app->getMetrics().NewMeter(
+        {"herder", "candidate-txset", "hit"}, "txset");
+    auto& miss = app->getMetrics().NewMeter(
+        {"herder", "candidate-txset", "miss"}, "txset");
+
+    auto closeNextLedger = [&]() {
+        auto next = lm.getLastClosedLedgerNum() + 1;
+        auto deadline = clock.now() + 2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS;
+        while (lm.getLastClosedLedgerNum() < next)
+        {
+            REQUIRE(clock.now() < deadline);
+            clock.crank(true);
+        }
+    };
+
+    // The first ledger is triggered at startup, without a candidate
+    closeNextLedger();
+    REQUIRE(hit.count() == 0);
+    REQUIRE(miss.count() == 0);
+
+    SECTION("queue unchanged")
+    {
+        closeNextLedger();
+        REQUIRE(hit.count() == 1);
+        REQUIRE(miss.count() == 0);
+    }
+    SECTION("transaction received after the candidate was built")
+    {
+        testutil::crankFor(clock, std::chrono::seconds(1));
+        auto root = TestAccount::createRoot(*app);
+        auto seqNum = root.getLastSequenceNumber();
+        auto tx = root.tx({payment(root, 1)});
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+
+        closeNextLedger();
+        REQUIRE(hit.count() == 0);
+        REQUIRE(miss.count() == 1);
+        REQUIRE(root.loadSequenceNumber() == seqNum + 1);
+    }
+}
+
 TEST_CASE("slot herder policy", "[herder]")
 {
     SIMULATION_CREATE_NODE(0);
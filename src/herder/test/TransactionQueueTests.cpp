@@ -11,6 +11,9 @@
 #include "herder/TxSetFrame.h"
 #include "herder/TxSetUtils.h"
 #include "ledger/LedgerHashUtils.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include "test/TestAccount.h"
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
@@ -20,6 +23,7 @@
 #include "util/Timer.h"
 #include "util/numeric128.h"
 #include "xdr/Hcnet-transaction.h"
+#include "xdrpp/marshal.h"
 
 #include <chrono>
 #include <fmt/chrono.h>
@@ -1566,6 +1570,129 @@ TEST_CASE("transaction queue starting sequence boundary",
     }
 }
 
+TEST_CASE("transaction queue top transactions", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+
+    auto root = TestAccount::createRoot(*app);
+    std::vector<TestAccount> accounts;
+    for (int i = 0; i < 10; ++i)
+    {
+        accounts.emplace_back(root.create(fmt::format("a{}", i), minBalance2));
+    }
+
+    // Every transaction bids a distinct fee rate, so that the selection does
+    // not depend on how ties are broken.
+    std::vector<uint32_t> feeRates(40);
+    std::iota(feeRates.begin(), feeRates.end(), 100);
+    std::shuffle(feeRates.begin(), feeRates.end(), gRandomEngine);
+
+    TransactionQueue tq(*app, 4, 10, 4);
+    std::vector<std::vector<TransactionFrameBasePtr>> txsByAccount;
+    uint32_t totalOps = 0;
+    for (auto& account : accounts)
+    {
+        auto& txs = txsByAccount.emplace_back();
+        auto nbTxs = rand_uniform(1, 4);
+        for (int i = 1; i <= nbTxs; ++i)
+        {
+            auto nbOps = rand_uniform(1, 3);
+            auto feeRate = feeRates.back();
+            feeRates.pop_back();
+            txs.emplace_back(
+                transaction(*app, account, i, 1, nbOps * feeRate, nbOps));
+            REQUIRE(tq.tryAdd(txs.back(), false) ==
+                    TransactionQueue::AddResult::ADD_STATUS_PENDING);
+            totalOps += nbOps;
+        }
+    }
+
+    // Same as surge pricing the whole queue
+    auto check = [&]() {
+        auto lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+        auto queues =
+            TxSetUtils::buildAccountTxQueues(tq.getTransactions(lcl.header));
+        for (uint32_t opsLimit = 0; opsLimit <= totalOps + 1; ++opsLimit)
+        {
+            auto expected =
+                SurgePricingPriorityQueue::getMostTopTxsWithinLimit(
+                    std::vector<TxStackPtr>(queues.begin(), queues.end()),
+                    opsLimit);
+            REQUIRE(tq.getTopTransactions(lcl.header, opsLimit) == expected);
+            queues = TxSetUtils::buildAccountTxQueues(
+                tq.getTransactions(lcl.header));
+        }
+    };
+
+    SECTION("added")
+    {
+        check();
+    }
+    SECTION("banned")
+    {
+        tq.ban({txsByAccount[0].front(), txsByAccount[1].back()});
+        check();
+    }
+    SECTION("applied")
+    {
+        tq.removeApplied({txsByAccount[2].front(), txsByAccount[3].back()});
+        check();
+    }
+    SECTION("replaced by fee")
+    {
+        // Only fee bumps can replace a transaction in the queue
+        auto oldTx = txsByAccount[4].front();
+        auto newFee = oldTx->getFeeBid() * TransactionQueue::FEE_MULTIPLIER *
+                      (oldTx->getNumOperations() + 1);
+        auto newTx = feeBump(*app, accounts[4], oldTx, newFee);
+        REQUIRE(tq.tryAdd(newTx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        check();
+    }
+    SECTION("aged out")
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            tq.shift();
+        }
+        auto lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+        REQUIRE(tq.getTopTransactions(lcl.header, totalOps).empty());
+    }
+    SECTION("starting sequence boundary")
+    {
+        // Like getTransactions, leaves out transactions that the next ledger
+        // would not accept at its starting sequence number
+        auto acc = root.create("b", minBalance2);
+        closeLedger(*app);
+        closeLedger(*app);
+        auto nextLedgerSeq =
+            app->getLedgerManager().getLastClosedLedgerNum();
+        int64_t startingSeq = static_cast<int64_t>(nextLedgerSeq) << 32;
+        acc.bumpSequence(startingSeq - 3);
+
+        TransactionQueue boundaryTq(*app, 4, 10, 4);
+        for (size_t i = 1; i <= 4; ++i)
+        {
+            REQUIRE(boundaryTq.tryAdd(transaction(*app, acc, i, 1, 100),
+                                      false) ==
+                    TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        }
+
+        auto checkTop = [&](uint32_t ledgerSeq, size_t size) {
+            auto lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+            lcl.header.ledgerSeq = ledgerSeq;
+            auto top = boundaryTq.getTopTransactions(lcl.header, 100);
+            REQUIRE(top.size() == size);
+            REQUIRE(top == boundaryTq.getTransactions(lcl.header));
+        };
+        checkTop(2, 4);
+        checkTop(3, 2);
+        checkTop(4, 4);
+    }
+}
+
 TEST_CASE("transaction queue with fee-bump", "[herder][transactionqueue]")
 {
     VirtualClock clock;
@@ -2066,6 +2193,224 @@ TEST_CASE("remove applied", "[herder][transactionqueue]")
     REQUIRE(tq.getTransactions({}).size() == 2);
 }
 
+TEST_CASE("transaction queue bytes", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& tq = herder.getTransactionQueue();
+    auto& bytes =
+        app->getMetrics().NewCounter({"herder", "pending-txs", "bytes"});
+
+    auto root = TestAccount::createRoot(*app);
+    auto tx1 = root.tx({payment(root, 1)});
+    auto tx2 = root.tx({payment(root, 2), payment(root, 3)});
+    REQUIRE(bytes.count() == 0);
+
+    REQUIRE(herder.recvTransaction(tx1, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    auto size1 = bytes.count();
+    // The frames take more memory than the envelope takes on the wire
+    REQUIRE(size1 > static_cast<int64_t>(xdr::xdr_size(tx1->getEnvelope())));
+    REQUIRE(herder.recvTransaction(tx2, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    auto size2 = bytes.count() - size1;
+    REQUIRE(size2 > size1);
+
+    SECTION("removed")
+    {
+        tq.removeApplied({tx1});
+        REQUIRE(bytes.count() == size2);
+    }
+    SECTION("banned")
+    {
+        tq.ban({tx1});
+        REQUIRE(bytes.count() == 0);
+    }
+}
+
+TEST_CASE("transaction queue get transaction", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+
+    auto root = TestAccount::createRoot(*app);
+    auto account1 = root.create("a1", minBalance2);
+    auto account2 = root.create("a2", minBalance2);
+
+    TransactionQueue tq(*app, 4, 10, 4);
+    auto tx1a = transaction(*app, account1, 1, 1, 100);
+    auto tx1b = transaction(*app, account1, 2, 1, 100);
+    auto tx2 = transaction(*app, account2, 1, 1, 100);
+    for (auto const& tx : {tx1a, tx1b, tx2})
+    {
+        REQUIRE(tq.tryAdd(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    }
+
+    auto queued = [&](TransactionFrameBasePtr const& tx) {
+        return tq.getTx(tx->getFullHash()) == tx;
+    };
+    REQUIRE(queued(tx1a));
+    REQUIRE(queued(tx1b));
+    REQUIRE(queued(tx2));
+    REQUIRE(!tq.getTx(HashUtils::random()));
+
+    SECTION("applied")
+    {
+        tq.removeApplied({tx1a});
+        REQUIRE(!tq.getTx(tx1a->getFullHash()));
+        REQUIRE(queued(tx1b));
+        REQUIRE(queued(tx2));
+    }
+    SECTION("replaced by fee")
+    {
+        // The fee bump is found through its sequence-number-source
+        auto newFee = tx1b->getFeeBid() * TransactionQueue::FEE_MULTIPLIER *
+                      (tx1b->getNumOperations() + 1);
+        auto newTx = feeBump(*app, account2, tx1b, newFee);
+        REQUIRE(tq.tryAdd(newTx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        REQUIRE(!tq.getTx(tx1b->getFullHash()));
+        REQUIRE(queued(newTx));
+        REQUIRE(queued(tx1a));
+    }
+    SECTION("banned")
+    {
+        tq.ban({tx2});
+        REQUIRE(!tq.getTx(tx2->getFullHash()));
+        REQUIRE(queued(tx1a));
+        REQUIRE(queued(tx1b));
+    }
+    SECTION("aged out")
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            tq.shift();
+        }
+        REQUIRE(!tq.getTx(tx1a->getFullHash()));
+        REQUIRE(!tq.getTx(tx1b->getFullHash()));
+        REQUIRE(!tq.getTx(tx2->getFullHash()));
+    }
+}
+
+TEST_CASE("transaction admission queue", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.TX_ADMISSION_QUEUE_SIZE = 2;
+    auto app = createTestApplication(clock, cfg);
+
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& tq = herder.getTransactionQueue();
+    auto& queued =
+        app->getMetrics().NewCounter({"herder", "admission", "queue"});
+    auto& rejected = app->getMetrics().NewMeter(
+        {"herder", "admission", "rejected"}, "transaction");
+
+    auto root = TestAccount::createRoot(*app);
+    auto tx1 = root.tx({payment(root, 1)});
+    auto tx2 = root.tx({payment(root, 2)});
+    auto tx3 = root.tx({payment(root, 3)});
+    auto tx4 = root.tx({payment(root, 4)});
+    auto tx5 = root.tx({payment(root, 5)});
+    auto tx6 = root.tx({payment(root, 6)});
+
+    std::vector<std::pair<Hash, TransactionQueue::AddResult>> results;
+    auto recv = [&](TransactionFrameBasePtr const& tx, bool submittedFromSelf) {
+        herder.recvTransactionAsync(
+            tx, submittedFromSelf,
+            [&results, hash = tx->getFullHash()](
+                TransactionQueue::AddResult res) {
+                results.emplace_back(hash, res);
+            });
+    };
+
+    recv(tx1, false);
+    recv(tx2, false);
+    REQUIRE(results.empty());
+    REQUIRE(queued.count() == 2);
+
+    // Transactions from peers wait once full, duplicates of waiting
+    // transactions don't
+    recv(tx3, false);
+    recv(tx3, false);
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].first == tx3->getFullHash());
+    REQUIRE(results[0].second ==
+            TransactionQueue::AddResult::ADD_STATUS_DUPLICATE);
+    REQUIRE(queued.count() == 3);
+    REQUIRE(rejected.count() == 0);
+    REQUIRE(tq.getTransactions({}).empty());
+
+    // Transactions are added in the order they were received
+    results.clear();
+    while (results.size() < 3)
+    {
+        clock.crank(false);
+    }
+    REQUIRE(results[0].first == tx1->getFullHash());
+    REQUIRE(results[1].first == tx2->getFullHash());
+    REQUIRE(results[2].first == tx3->getFullHash());
+    for (auto const& res : results)
+    {
+        REQUIRE(res.second == TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    }
+    REQUIRE(queued.count() == 0);
+    REQUIRE(tq.getTransactions({}).size() == 3);
+
+    // Transactions already in the queue do not wait
+    results.clear();
+    recv(tx2, false);
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].second ==
+            TransactionQueue::AddResult::ADD_STATUS_DUPLICATE);
+
+    // Transactions submitted to this node are rejected once full
+    results.clear();
+    recv(tx4, false);
+    recv(tx5, true);
+    recv(tx6, true);
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].first == tx6->getFullHash());
+    REQUIRE(results[0].second ==
+            TransactionQueue::AddResult::ADD_STATUS_TRY_AGAIN_LATER);
+    REQUIRE(rejected.count() == 1);
+
+    results.clear();
+    while (results.size() < 2)
+    {
+        clock.crank(false);
+    }
+    REQUIRE(results[0].first == tx4->getFullHash());
+    REQUIRE(results[1].first == tx5->getFullHash());
+    REQUIRE(queued.count() == 0);
+    REQUIRE(tq.getTransactions({}).size() == 5);
+
+    // Stateless checks are made on the worker thread too
+    auto baseFee = app->getLedgerManager().getLastTxFee();
+    auto noOps = root.tx({});
+    auto inner =
+        transaction(*app, root, 1, 1, static_cast<uint32_t>(10 * baseFee));
+    auto lowFeeRate = feeBump(*app, root, inner, 2 * baseFee);
+
+    results.clear();
+    recv(noOps, false);
+    recv(lowFeeRate, false);
+    while (results.size() < 2)
+    {
+        clock.crank(false);
+    }
+    REQUIRE(results[0].second == TransactionQueue::AddResult::ADD_STATUS_ERROR);
+    REQUIRE(noOps->getResultCode() == txMISSING_OPERATION);
+    REQUIRE(results[1].second == TransactionQueue::AddResult::ADD_STATUS_ERROR);
+    REQUIRE(lowFeeRate->getResultCode() == txINSUFFICIENT_FEE);
+    REQUIRE(lowFeeRate->getResult().feeCharged == 20 * baseFee);
+    REQUIRE(tq.getTransactions({}).size() == 5);
+}
+
 static UnorderedSet<AssetPair, AssetPairHash>
 apVecToSet(std::vector<AssetPair> const& v)
 {
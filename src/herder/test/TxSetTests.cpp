@@ -2,9 +2,14 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/SecretKey.h"
+#include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
+#include "herder/TxSetUtils.h"
+#include "herder/TxValidityCache.h"
 #include "herder/test/TestTxSetUtils.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/LedgerTxn.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -12,7 +17,11 @@
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionBridge.h"
+#include "util/Logging.h"
 #include "util/ProtocolVersion.h"
+#include <chrono>
+#include <fmt/format.h>
 
 namespace hcnet
 {
@@ -605,5 +614,115 @@ TEST_CASE("generalized tx set fees", "[txset]")
     }
 }
 
+// Creates `n` accounts, 100 per ledger, and returns a payment from each of
+// them back to the root account. The ledger must allow tx sets of at least
+// 100 operations.
+TxSetFrame::Transactions
+makePaymentsFromNewAccounts(Application& app, size_t n)
+{
+    auto root = TestAccount::createRoot(app);
+    auto balance = app.getLedgerManager().getLastMinBalance(0) * 2;
+    std::vector<TestAccount> accounts;
+    for (size_t i = 0; i < n; i += MAX_OPS_PER_TX)
+    {
+        std::vector<Operation> ops;
+        for (size_t j = i; j < std::min<size_t>(n, i + MAX_OPS_PER_TX); ++j)
+        {
+            auto sk = getAccount(fmt::format("sigcheck{}", j));
+            ops.emplace_back(createAccount(sk.getPublicKey(), balance));
+            accounts.emplace_back(app, sk);
+        }
+        closeLedger(app, {root.tx(ops)});
+    }
+
+    TxSetFrame::Transactions txs;
+    for (auto& account : accounts)
+    {
+        txs.emplace_back(account.tx({payment(root, 1)}));
+    }
+    return txs;
+}
+
+TEST_CASE("tx set signatures are verified ahead of checkValid", "[txset]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 1000;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto txs = makePaymentsFromNewAccounts(*app, 200);
+    auto txSet = TxSetFrame::makeFromTransactions(txs, *app, 0, 0);
+    REQUIRE(txSet->sizeTx() == txs.size());
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evicts = 0;
+    PubKeyUtils::clearVerifySigCache();
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+    {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        TxSetUtils::verifySignatures(txSet->getTxs(), *app, ltx);
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+    REQUIRE(hits == 0);
+    REQUIRE(misses == txs.size());
+
+    // Both the verification stage inside checkValid and the checks proper
+    // (once for the transaction, once for its operation) are now served from
+    // the cache. Results from building the tx set would skip all of them.
+    app->getHerder().getTxValidityCache().clear();
+    REQUIRE(txSet->checkValid(*app, 0, 0));
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+    REQUIRE(hits == 3 * txs.size());
+    REQUIRE(misses == 0);
+
+    SECTION("invalid signatures are cached as invalid")
+    {
+        auto badTx = std::static_pointer_cast<TransactionFrame>(txs.back());
+        txbridge::getSignatures(badTx).back().signature.back() ^= 1;
+        badTx->clearCached();
+        txs.back() = badTx;
+
+        PubKeyUtils::clearVerifySigCache();
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            TxSetUtils::verifySignatures(txs, *app, ltx);
+        }
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+        REQUIRE(TxSetUtils::getInvalidTxList(txs, *app, 0, 0, false) ==
+                TxSetFrame::Transactions{badTx});
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, evicts);
+        REQUIRE(misses == 0);
+    }
+}
+
+TEST_CASE("tx set signature verification bench", "[txset][bench][!hide]")
+{
+    for (int threads : {1, 2, 4, 8})
+    {
+        VirtualClock clock;
+        auto cfg = getTestConfig();
+        cfg.WORKER_THREADS = threads;
+        cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 1000;
+        Application::pointer app = createTestApplication(clock, cfg);
+        auto txs = makePaymentsFromNewAccounts(*app, 1000);
+        auto txSet = TxSetFrame::makeFromTransactions(txs, *app, 0, 0);
+        REQUIRE(txSet->sizeTx() == txs.size());
+
+        std::chrono::duration<double> total{0};
+        int const runs = 10;
+        for (int i = 0; i < runs; ++i)
+        {
+            PubKeyUtils::clearVerifySigCache();
+            app->getHerder().getTxValidityCache().clear();
+            auto start = std::chrono::steady_clock::now();
+            REQUIRE(txSet->checkValid(*app, 0, 0));
+            total += std::chrono::steady_clock::now() - start;
+        }
+        CLOG_INFO(Herder,
+                  "checkValid of {} txs with {} worker threads: {:.2f}ms",
+                  txs.size(), threads, total.count() * 1000 / runs);
+    }
+}
+
 } // namespace
 } // namespace hcnet
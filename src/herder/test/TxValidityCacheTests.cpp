@@ -0,0 +1,114 @@
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/Herder.h"
+#include "herder/TxValidityCache.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTxn.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionBridge.h"
+
+namespace hcnet
+{
+using namespace txtest;
+
+TEST_CASE("tx validity cache", "[herder][txvaliditycache]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& cache = app->getHerder().getTxValidityCache();
+    auto& hits = app->getMetrics().NewMeter(
+        {"herder", "tx-validity", "hit"}, "transaction");
+
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = app->getLedgerManager().getLastMinBalance(0);
+    auto a1 = root.create("a1", minBalance * 10);
+    auto b1 = root.create("b1", minBalance * 10);
+
+    auto checkValid = [&](TransactionFrameBasePtr const& tx,
+                          uint64_t lowerBoundCloseTimeOffset = 0,
+                          uint64_t upperBoundCloseTimeOffset = 0) {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        return cache.checkValid(tx, ltx, 0, lowerBoundCloseTimeOffset,
+                                upperBoundCloseTimeOffset);
+    };
+
+    SECTION("account changes")
+    {
+        auto tx = a1.tx({payment(root, 1)});
+        REQUIRE(checkValid(tx));
+        REQUIRE(cache.contains(*tx));
+        REQUIRE(hits.count() == 0);
+
+        SECTION("unchanged")
+        {
+            REQUIRE(checkValid(tx));
+            REQUIRE(hits.count() == 1);
+
+            // Changes to accounts the transaction does not read do not matter
+            b1.pay(root, 1);
+            REQUIRE(checkValid(tx));
+            REQUIRE(hits.count() == 2);
+        }
+        SECTION("source account changed")
+        {
+            root.pay(a1, 1);
+            REQUIRE(checkValid(tx));
+            REQUIRE(hits.count() == 0);
+        }
+        SECTION("transaction applied")
+        {
+            // Building the tx set for the ledger goes through the cache too
+            closeLedger(*app, {tx});
+            auto hitsBefore = hits.count();
+            REQUIRE(!checkValid(tx));
+            REQUIRE(hits.count() == hitsBefore);
+        }
+    }
+    SECTION("time bounds")
+    {
+        auto closeTime = app->getLedgerManager()
+                             .getLastClosedLedgerHeader()
+                             .header.scpValue.closeTime;
+        auto tx = b1.tx({payment(root, 1)});
+        txbridge::setMaxTime(tx, closeTime + 10);
+        tx->clearCached();
+        auto& sigs = tx->getEnvelope().type() == ENVELOPE_TYPE_TX_V0
+                         ? tx->getEnvelope().v0().signatures
+                         : tx->getEnvelope().v1().signatures;
+        sigs.clear();
+        tx->addSignature(b1.getSecretKey());
+
+        REQUIRE(checkValid(tx, 0, 5));
+        REQUIRE(hits.count() == 0);
+        REQUIRE(checkValid(tx, 5, 10));
+        REQUIRE(hits.count() == 1);
+        REQUIRE(!checkValid(tx, 5, 11));
+        REQUIRE(hits.count() == 1);
+    }
+    SECTION("header flags upgrade")
+    {
+        auto tx = a1.tx({liquidityPoolDeposit(sha256("pool"), 1, 1,
+                                              Price{1, 1}, Price{1, 1})});
+        REQUIRE(checkValid(tx));
+        REQUIRE(checkValid(tx));
+        REQUIRE(hits.count() == 1);
+
+        // Only the header flags tell that the operation is disabled
+        LedgerUpgrade upgrade{LEDGER_UPGRADE_FLAGS};
+        upgrade.newFlags() = DISABLE_LIQUIDITY_POOL_DEPOSIT_FLAG;
+        REQUIRE(executeUpgrade(*app, upgrade).ext.v1().flags ==
+                DISABLE_LIQUIDITY_POOL_DEPOSIT_FLAG);
+        REQUIRE(!checkValid(tx));
+        REQUIRE(hits.count() == 1);
+    }
+}
+}
@@ -146,12 +146,10 @@ BucketOutputIteratorForTesting::writeTmpTestBucket()
 
     // Finish writing and close the bucket file
     REQUIRE(mBuf);
-    mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
-    mObjectsPut++;
-    mBuf.reset();
-    mOut.close();
+    flushBuffer();
+    auto hash = mOut.close();
 
-    return std::pair<std::string, uint256>(mFilename, mHasher.finish());
+    return std::pair<std::string, uint256>(mFilename, hash);
 };
 
 TestBucketGenerator::TestBucketGenerator(
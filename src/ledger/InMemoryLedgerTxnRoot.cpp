@@ -168,6 +168,12 @@ InMemoryLedgerTxnRoot::prefetch(UnorderedSet<LedgerKey> const& keys)
     return 0;
 }
 
+void
+InMemoryLedgerTxnRoot::prefetchInBackground(
+    UnorderedSet<LedgerKey> const& keys)
+{
+}
+
 void InMemoryLedgerTxnRoot::prepareNewObjects(size_t)
 {
 }
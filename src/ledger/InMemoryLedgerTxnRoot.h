@@ -82,6 +82,7 @@ class InMemoryLedgerTxnRoot : public AbstractLedgerTxnParent
 #endif
     double getPrefetchHitRate() const override;
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    void prefetchInBackground(UnorderedSet<LedgerKey> const& keys) override;
     void prepareNewObjects(size_t s) override;
 
 #ifdef BUILD_TESTS
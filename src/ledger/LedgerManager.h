@@ -13,6 +13,7 @@ namespace hcnet
 
 class LedgerCloseData;
 class Database;
+class TxSetFrame;
 
 /**
  * LedgerManager maintains, in memory, a logical pair of ledgers:
@@ -90,6 +91,13 @@ class LedgerManager
     // `ledgerData`.
     virtual void valueExternalized(LedgerCloseData const& ledgerData) = 0;
 
+    // Called by Herder once nomination has settled on a candidate transaction
+    // set for the next ledger. Starts loading the ledger entries that applying
+    // `txSet` is expected to touch in the background, so that closing the
+    // ledger finds them cached. Purely advisory.
+    virtual void
+    prefetchTxSetInBackground(std::shared_ptr<TxSetFrame const> txSet) = 0;
+
     // Return the LCL header and (complete, immutable) hash.
     virtual LedgerHeaderHistoryEntry const&
     getLastClosedLedgerHeader() const = 0;
@@ -1153,6 +1153,27 @@ LedgerManagerImpl::processFeesSeqNums(
     }
 }
 
+void
+LedgerManagerImpl::prefetchTxSetInBackground(
+    std::shared_ptr<TxSetFrame const> txSet)
+{
+    ZoneScoped;
+    if (mApp.getConfig().PREFETCH_BATCH_SIZE == 0 ||
+        txSet->getContentsHash() == mLastPrefetchedTxSetHash)
+    {
+        return;
+    }
+    mLastPrefetchedTxSetHash = txSet->getContentsHash();
+
+    UnorderedSet<LedgerKey> keys;
+    for (auto const& tx : txSet->getTxs())
+    {
+        tx->insertKeysForFeeProcessing(keys);
+        tx->insertKeysForTxApply(keys);
+    }
+    mApp.getLedgerTxnRoot().prefetchInBackground(keys);
+}
+
 void
 LedgerManagerImpl::prefetchTxSourceIds(
     std::vector<TransactionFrameBasePtr> const& txs)
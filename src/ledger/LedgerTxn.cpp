@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerTxn.h"
+#include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "crypto/SecretKey.h"
@@ -12,13 +13,18 @@
 #include "ledger/LedgerTxnHeader.h"
 #include "ledger/LedgerTxnImpl.h"
 #include "ledger/NonSociRelatedException.h"
+#include "main/Application.h"
+#include "main/Config.h"
 #include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
+#include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
 #include "xdr/Hcnet-ledger-entries.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <medida/meter.h>
+#include <medida/metrics_registry.h>
 #include <soci.h>
 
 namespace hcnet
@@ -2016,6 +2022,18 @@ LedgerTxn::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     return mParent.prefetch(keys);
 }
 
+void
+LedgerTxn::prefetchInBackground(UnorderedSet<LedgerKey> const& keys)
+{
+    getImpl()->prefetchInBackground(keys);
+}
+
+void
+LedgerTxn::Impl::prefetchInBackground(UnorderedSet<LedgerKey> const& keys)
+{
+    mParent.prefetchInBackground(keys);
+}
+
 void
 LedgerTxn::Impl::maybeUpdateLastModified() noexcept
 {
@@ -2379,14 +2397,14 @@ LedgerTxn::Impl::EntryIteratorImpl::clone() const
 // Implementation of LedgerTxnRoot ------------------------------------------
 size_t const LedgerTxnRoot::Impl::MIN_BEST_OFFERS_BATCH_SIZE = 5;
 
-LedgerTxnRoot::LedgerTxnRoot(Database& db, size_t entryCacheSize,
+LedgerTxnRoot::LedgerTxnRoot(Application& app, size_t entryCacheSize,
                              size_t prefetchBatchSize
 #ifdef BEST_OFFER_DEBUGGING
                              ,
                              bool bestOfferDebuggingEnabled
 #endif
                              )
-    : mImpl(std::make_unique<Impl>(db, entryCacheSize, prefetchBatchSize
+    : mImpl(std::make_unique<Impl>(app, entryCacheSize, prefetchBatchSize
 #ifdef BEST_OFFER_DEBUGGING
                                    ,
                                    bestOfferDebuggingEnabled
@@ -2395,7 +2413,7 @@ LedgerTxnRoot::LedgerTxnRoot(Database& db, size_t entryCacheSize,
 {
 }
 
-LedgerTxnRoot::Impl::Impl(Database& db, size_t entryCacheSize,
+LedgerTxnRoot::Impl::Impl(Application& app, size_t entryCacheSize,
                           size_t prefetchBatchSize
 #ifdef BEST_OFFER_DEBUGGING
                           ,
@@ -2405,9 +2423,20 @@ LedgerTxnRoot::Impl::Impl(Database& db, size_t entryCacheSize,
     : mMaxBestOffersBatchSize(
           std::min(std::max(prefetchBatchSize, MIN_BEST_OFFERS_BATCH_SIZE),
                    getMaxOffersToCross()))
-    , mDatabase(db)
+    , mApp(app)
+    , mDatabase(app.getDatabase())
     , mHeader(std::make_unique<LedgerHeader>())
-    , mEntryCache(entryCacheSize)
+    , mEntryCache(entryCacheSize,
+                  parseCacheEvictionPolicy(app.getConfig().ENTRY_CACHE_POLICY))
+    , mEntryCacheHitMeter(app.getMetrics().NewMeter(
+          {"ledger", "entry-cache", "hit"}, "entry"))
+    , mEntryCacheMissMeter(app.getMetrics().NewMeter(
+          {"ledger", "entry-cache", "miss"}, "entry"))
+    , mEntryCacheEvictMeter(app.getMetrics().NewMeter(
+          {"ledger", "entry-cache", "evict"}, "entry"))
+    , mLifetime(std::make_shared<bool>(true))
+    , mBackgroundPrefetchMeter(app.getMetrics().NewMeter(
+          {"ledger", "prefetch", "background"}, "entry"))
     , mBulkLoadBatchSize(prefetchBatchSize)
     , mChild(nullptr)
 #ifdef BEST_OFFER_DEBUGGING
@@ -2434,6 +2463,7 @@ LedgerTxnRoot::Impl::resetForFuzzer()
 {
     mBestOffers.clear();
     mEntryCache.clear();
+    ++mStateGeneration;
 }
 
 void
@@ -2646,6 +2676,45 @@ LedgerTxnRoot::Impl::bulkApply(BulkLedgerEntryChangeAccumulator& bleca,
 #endif
 }
 
+void
+LedgerTxnRoot::Impl::updateEntryCache(EntryIterator const& iter)
+{
+    if (iter.key().type() != InternalLedgerEntryType::LEDGER_ENTRY)
+    {
+        return;
+    }
+    // Only refresh keys that are already cached; caching everything a ledger
+    // wrote would push out entries that are actually being loaded.
+    auto cached = mEntryCache.peek(iter.key().ledgerKey());
+    if (!cached)
+    {
+        return;
+    }
+    if (iter.entryExists())
+    {
+        cached->entry =
+            std::make_shared<LedgerEntry const>(iter.entry().ledgerEntry());
+    }
+    else
+    {
+        cached->entry.reset();
+    }
+    cached->type = LoadType::IMMEDIATE;
+}
+
+void
+LedgerTxnRoot::Impl::reportEntryCacheMetrics()
+{
+    auto const& counters = mEntryCache.getCounters();
+    mEntryCacheHitMeter.Mark(counters.mHits -
+                             mReportedEntryCacheCounters.mHits);
+    mEntryCacheMissMeter.Mark(counters.mMisses -
+                              mReportedEntryCacheCounters.mMisses);
+    mEntryCacheEvictMeter.Mark(counters.mEvicts -
+                               mReportedEntryCacheCounters.mEvicts);
+    mReportedEntryCacheCounters = counters;
+}
+
 void
 LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
                                  LedgerTxnConsistency cons) noexcept
@@ -2665,13 +2734,35 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
     // guarantee, so use std::unique_ptr<...>::swap to achieve it
     auto childHeader = std::make_unique<LedgerHeader>(mChild->getHeader());
 
+    auto const& cfg = mApp.getConfig();
     auto bleca = BulkLedgerEntryChangeAccumulator();
+
+    // The cache can be kept up to date across ordinary ledger-by-ledger
+    // commits. Any other jump in the header (e.g. after catchup replaced the
+    // BucketList) may have changed state without going through here, so
+    // the cache is dropped instead.
+    bool keepEntryCache = childHeader->ledgerSeq == mHeader->ledgerSeq ||
+                          childHeader->ledgerSeq == mHeader->ledgerSeq + 1;
+    if (!keepEntryCache)
+    {
+        mEntryCache.clear();
+    }
     int64_t counter{0};
     try
     {
         while ((bool)iter)
         {
-            bleca.accumulate(iter);
+            // Entry types that live only in the BucketList were already
+            // persisted there by addBatch, so skip them here.
+            if (iter.key().type() != InternalLedgerEntryType::LEDGER_ENTRY ||
+                cfg.modeStoresEntryTypeInSQL(iter.key().ledgerKey().type()))
+            {
+                bleca.accumulate(iter);
+            }
+            if (keepEntryCache)
+            {
+                updateEntryCache(iter);
+            }
             ++iter;
             ++counter;
             size_t bufferThreshold =
@@ -2703,7 +2794,8 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
 
     // Clearing the cache does not throw
     mBestOffers.clear();
-    mEntryCache.clear();
+    reportEntryCacheMetrics();
+    ++mStateGeneration;
 
     // std::unique_ptr<...>::reset does not throw
     mTransaction.reset();
@@ -2800,6 +2892,7 @@ LedgerTxnRoot::Impl::deleteObjectsModifiedOnOrAfterLedger(uint32_t ledger) const
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
     {
@@ -2882,6 +2975,9 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     UnorderedSet<LedgerKey> contractdata;
     UnorderedSet<LedgerKey> configSettings;
 #endif
+    UnorderedSet<LedgerKey> bucketListKeys;
+    auto const& cfg = mApp.getConfig();
+    auto& session = mDatabase.getSession();
 
     auto cacheResult =
         [&](UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> const&
@@ -2903,13 +2999,24 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
 
     for (auto const& key : keys)
     {
+        if (!cfg.modeStoresEntryTypeInSQL(key.type()))
+        {
+            insertIfNotLoaded(bucketListKeys, key);
+            if (bucketListKeys.size() == mBulkLoadBatchSize)
+            {
+                cacheResult(bulkLoadFromBucketList(bucketListKeys));
+                bucketListKeys.clear();
+            }
+            continue;
+        }
+
         switch (key.type())
         {
         case ACCOUNT:
             insertIfNotLoaded(accounts, key);
             if (accounts.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadAccounts(accounts));
+                cacheResult(bulkLoadAccounts(accounts, session));
                 accounts.clear();
             }
             break;
@@ -2917,7 +3024,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(offers, key);
             if (offers.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadOffers(offers));
+                cacheResult(bulkLoadOffers(offers, session));
                 offers.clear();
             }
             break;
@@ -2925,7 +3032,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(trustlines, key);
             if (trustlines.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadTrustLines(trustlines));
+                cacheResult(bulkLoadTrustLines(trustlines, session));
                 trustlines.clear();
             }
             break;
@@ -2933,7 +3040,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(data, key);
             if (data.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadData(data));
+                cacheResult(bulkLoadData(data, session));
                 data.clear();
             }
             break;
@@ -2941,7 +3048,8 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(claimablebalance, key);
             if (claimablebalance.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadClaimableBalance(claimablebalance));
+                cacheResult(
+                    bulkLoadClaimableBalance(claimablebalance, session));
                 claimablebalance.clear();
             }
             break;
@@ -2949,7 +3057,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(liquiditypool, key);
             if (liquiditypool.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadLiquidityPool(liquiditypool));
+                cacheResult(bulkLoadLiquidityPool(liquiditypool, session));
                 liquiditypool.clear();
             }
             break;
@@ -2958,7 +3066,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(contractdata, key);
             if (contractdata.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadContractData(contractdata));
+                cacheResult(bulkLoadContractData(contractdata, session));
                 contractdata.clear();
             }
             break;
@@ -2966,7 +3074,7 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
             insertIfNotLoaded(configSettings, key);
             if (configSettings.size() == mBulkLoadBatchSize)
             {
-                cacheResult(bulkLoadConfigSettings(configSettings));
+                cacheResult(bulkLoadConfigSettings(configSettings, session));
                 configSettings.clear();
             }
             break;
@@ -2975,20 +3083,175 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     }
 
     //  Prefetch whatever is remaining
-    cacheResult(bulkLoadAccounts(accounts));
-    cacheResult(bulkLoadOffers(offers));
-    cacheResult(bulkLoadTrustLines(trustlines));
-    cacheResult(bulkLoadData(data));
-    cacheResult(bulkLoadClaimableBalance(claimablebalance));
-    cacheResult(bulkLoadLiquidityPool(liquiditypool));
+    cacheResult(bulkLoadAccounts(accounts, session));
+    cacheResult(bulkLoadOffers(offers, session));
+    cacheResult(bulkLoadTrustLines(trustlines, session));
+    cacheResult(bulkLoadData(data, session));
+    cacheResult(bulkLoadClaimableBalance(claimablebalance, session));
+    cacheResult(bulkLoadLiquidityPool(liquiditypool, session));
 #ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
-    cacheResult(bulkLoadConfigSettings(configSettings));
-    cacheResult(bulkLoadContractData(contractdata));
+    cacheResult(bulkLoadConfigSettings(configSettings, session));
+    cacheResult(bulkLoadContractData(contractdata, session));
 #endif
+    cacheResult(bulkLoadFromBucketList(bucketListKeys));
 
     return total;
 }
 
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadFromBucketList(
+    UnorderedSet<LedgerKey> const& keys) const
+{
+    ZoneScoped;
+    if (keys.empty())
+    {
+        return {};
+    }
+
+    std::set<LedgerKey, LedgerEntryIdCmp> sortedKeys(keys.begin(), keys.end());
+    return populateLoadedEntries(
+        keys, mApp.getBucketManager().loadKeys(sortedKeys));
+}
+
+UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+LedgerTxnRoot::Impl::bulkLoadSQLEntries(LedgerEntryType type,
+                                        UnorderedSet<LedgerKey> const& keys,
+                                        soci::session& session) const
+{
+    switch (type)
+    {
+    case ACCOUNT:
+        return bulkLoadAccounts(keys, session);
+    case TRUSTLINE:
+        return bulkLoadTrustLines(keys, session);
+    case OFFER:
+        return bulkLoadOffers(keys, session);
+    case DATA:
+        return bulkLoadData(keys, session);
+    case CLAIMABLE_BALANCE:
+        return bulkLoadClaimableBalance(keys, session);
+    case LIQUIDITY_POOL:
+        return bulkLoadLiquidityPool(keys, session);
+#ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
+    case CONTRACT_DATA:
+        return bulkLoadContractData(keys, session);
+    case CONFIG_SETTING:
+        return bulkLoadConfigSettings(keys, session);
+#endif
+    default:
+        throw std::runtime_error("Unknown key type");
+    }
+}
+
+void
+LedgerTxnRoot::prefetchInBackground(UnorderedSet<LedgerKey> const& keys)
+{
+    mImpl->prefetchInBackground(keys);
+}
+
+void
+LedgerTxnRoot::Impl::prefetchInBackground(UnorderedSet<LedgerKey> const& keys)
+{
+    ZoneScoped;
+    // Loading off the main thread needs a second database connection, which
+    // an in-memory SQLite database cannot provide. Entries that live in the
+    // BucketList are skipped, as it may only be read from the main thread.
+    if (mBackgroundPrefetchRunning || mBulkLoadBatchSize == 0 ||
+        !mDatabase.canUsePool())
+    {
+        return;
+    }
+
+    auto const& cfg = mApp.getConfig();
+    std::map<LedgerEntryType, std::vector<UnorderedSet<LedgerKey>>> batches;
+    for (auto const& key : keys)
+    {
+        if (!cfg.modeStoresEntryTypeInSQL(key.type()) ||
+            mEntryCache.exists(key, false))
+        {
+            continue;
+        }
+        auto& typeBatches = batches[key.type()];
+        if (typeBatches.empty() ||
+            typeBatches.back().size() == mBulkLoadBatchSize)
+        {
+            typeBatches.emplace_back();
+        }
+        typeBatches.back().insert(key);
+    }
+    if (batches.empty())
+    {
+        return;
+    }
+
+    // Create the pool here, as it is not safe to do so concurrently.
+    auto& pool = mDatabase.getPool();
+    mBackgroundPrefetchRunning = true;
+    std::weak_ptr<bool> lifetime = mLifetime;
+    auto generation = mStateGeneration;
+    mApp.postOnBackgroundThread(
+        [this, &pool, lifetime, generation, batches = std::move(batches)]() {
+            ZoneNamedN(bgZone, "background prefetch", true);
+            auto entries = std::make_shared<UnorderedMap<
+                LedgerKey, std::shared_ptr<LedgerEntry const>>>();
+            try
+            {
+                // A single transaction gives all batches the same snapshot.
+                soci::session session(pool);
+                soci::transaction tx(session);
+                for (auto const& [type, typeBatches] : batches)
+                {
+                    for (auto const& batch : typeBatches)
+                    {
+                        auto loaded = bulkLoadSQLEntries(type, batch, session);
+                        entries->insert(loaded.begin(), loaded.end());
+                    }
+                }
+            }
+            catch (std::exception const& e)
+            {
+                CLOG_WARNING(Ledger, "Background prefetch failed: {}",
+                             e.what());
+                entries->clear();
+            }
+            mApp.postOnMainThread(
+                [this, lifetime, generation, entries]() {
+                    if (lifetime.lock())
+                    {
+                        finishBackgroundPrefetch(generation, *entries);
+                    }
+                },
+                "LedgerTxnRoot: finish background prefetch");
+        },
+        "LedgerTxnRoot: background prefetch");
+}
+
+void
+LedgerTxnRoot::Impl::finishBackgroundPrefetch(
+    uint64_t stateGeneration,
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> const& entries)
+{
+    ZoneScoped;
+    mBackgroundPrefetchRunning = false;
+    // Entries read before a commit may be stale, and the commit did not
+    // update them as they were not cached yet.
+    if (stateGeneration != mStateGeneration)
+    {
+        return;
+    }
+
+    int64_t cached = 0;
+    for (auto const& [key, entry] : entries)
+    {
+        if (!mEntryCache.exists(key, false))
+        {
+            putInEntryCache(key, entry, LoadType::PREFETCH);
+            ++cached;
+        }
+    }
+    mBackgroundPrefetchMeter.Mark(cached);
+}
+
 double
 LedgerTxnRoot::getPrefetchHitRate() const
 {
@@ -3487,36 +3750,43 @@ LedgerTxnRoot::Impl::getNewestVersion(InternalLedgerKey const& gkey) const
     std::shared_ptr<LedgerEntry const> entry;
     try
     {
-        switch (key.type())
+        if (!mApp.getConfig().modeStoresEntryTypeInSQL(key.type()))
         {
-        case ACCOUNT:
-            entry = loadAccount(key);
-            break;
-        case DATA:
-            entry = loadData(key);
-            break;
-        case OFFER:
-            entry = loadOffer(key);
-            break;
-        case TRUSTLINE:
-            entry = loadTrustLine(key);
-            break;
-        case CLAIMABLE_BALANCE:
-            entry = loadClaimableBalance(key);
-            break;
-        case LIQUIDITY_POOL:
-            entry = loadLiquidityPool(key);
-            break;
+            entry = mApp.getBucketManager().getLedgerEntry(key);
+        }
+        else
+        {
+            switch (key.type())
+            {
+            case ACCOUNT:
+                entry = loadAccount(key);
+                break;
+            case DATA:
+                entry = loadData(key);
+                break;
+            case OFFER:
+                entry = loadOffer(key);
+                break;
+            case TRUSTLINE:
+                entry = loadTrustLine(key);
+                break;
+            case CLAIMABLE_BALANCE:
+                entry = loadClaimableBalance(key);
+                break;
+            case LIQUIDITY_POOL:
+                entry = loadLiquidityPool(key);
+                break;
 #ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
-        case CONTRACT_DATA:
-            entry = loadContractData(key);
-            break;
-        case CONFIG_SETTING:
-            entry = loadConfigSetting(key);
-            break;
+            case CONTRACT_DATA:
+                entry = loadContractData(key);
+                break;
+            case CONFIG_SETTING:
+                entry = loadConfigSetting(key);
+                break;
 #endif
-        default:
-            throw std::runtime_error("Unknown key type");
+            default:
+                throw std::runtime_error("Unknown key type");
+            }
         }
     }
     catch (NonSociRelatedException&)
@@ -267,6 +267,7 @@ enum class TransactionMode
     READ_WRITE_WITH_SQL_TXN
 };
 
+class Application;
 class Database;
 struct InflationVotes;
 struct LedgerEntry;
@@ -492,6 +493,12 @@ class AbstractLedgerTxnParent
     // than a (real or stub) root LedgerTxn.
     virtual uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) = 0;
 
+    // Like prefetch, but loads the entries on a worker thread and caches them
+    // once loaded, without blocking the caller. Meant for keys needed by a
+    // later ledger, e.g. one still being agreed on. Will throw when called on
+    // anything other than a (real or stub) root LedgerTxn.
+    virtual void prefetchInBackground(UnorderedSet<LedgerKey> const& keys) = 0;
+
     // prepares to increase the capacity of pending changes by up to "s" changes
     virtual void prepareNewObjects(size_t s) = 0;
 
@@ -784,6 +791,7 @@ class LedgerTxn : public AbstractLedgerTxn
 #endif
     double getPrefetchHitRate() const override;
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    void prefetchInBackground(UnorderedSet<LedgerKey> const& keys) override;
     void prepareNewObjects(size_t s) override;
 
     bool hasSponsorshipEntry() const override;
@@ -813,7 +821,7 @@ class LedgerTxnRoot : public AbstractLedgerTxnParent
     std::unique_ptr<Impl> const mImpl;
 
   public:
-    explicit LedgerTxnRoot(Database& db, size_t entryCacheSize,
+    explicit LedgerTxnRoot(Application& app, size_t entryCacheSize,
                            size_t prefetchBatchSize
 #ifdef BEST_OFFER_DEBUGGING
                            ,
@@ -876,6 +884,7 @@ class LedgerTxnRoot : public AbstractLedgerTxnParent
     void rollbackChild() noexcept override;
 
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    void prefetchInBackground(UnorderedSet<LedgerKey> const& keys) override;
     double getPrefetchHitRate() const override;
 
     void prepareNewObjects(size_t s) override;
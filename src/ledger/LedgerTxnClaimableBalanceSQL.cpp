@@ -41,6 +41,7 @@ class BulkLoadClaimableBalanceOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mBalanceIDs;
 
     std::vector<LedgerEntry>
@@ -71,9 +72,9 @@ class BulkLoadClaimableBalanceOperation
     }
 
   public:
-    BulkLoadClaimableBalanceOperation(Database& db,
+    BulkLoadClaimableBalanceOperation(Database& db, soci::session& session,
                                       UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mBalanceIDs.reserve(keys.size());
         for (auto const& k : keys)
@@ -99,7 +100,7 @@ class BulkLoadClaimableBalanceOperation
                           "FROM claimablebalance "
                           "WHERE balanceid IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -127,7 +128,7 @@ class BulkLoadClaimableBalanceOperation
                           "FROM claimablebalance "
                           "WHERE balanceid IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strBalanceIDs));
         return executeAndFetch(st);
@@ -137,13 +138,13 @@ class BulkLoadClaimableBalanceOperation
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
 LedgerTxnRoot::Impl::bulkLoadClaimableBalance(
-    UnorderedSet<LedgerKey> const& keys) const
+    UnorderedSet<LedgerKey> const& keys, soci::session& session) const
 {
     if (!keys.empty())
     {
-        BulkLoadClaimableBalanceOperation op(mDatabase, keys);
+        BulkLoadClaimableBalanceOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -355,6 +356,7 @@ LedgerTxnRoot::Impl::dropClaimableBalances()
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
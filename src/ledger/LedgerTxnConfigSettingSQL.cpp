@@ -54,6 +54,7 @@ class bulkLoadConfigSettingsOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<int32_t> mConfigSettingIDs;
 
     std::vector<LedgerEntry>
@@ -83,9 +84,9 @@ class bulkLoadConfigSettingsOperation
     }
 
   public:
-    bulkLoadConfigSettingsOperation(Database& db,
+    bulkLoadConfigSettingsOperation(Database& db, soci::session& session,
                                     UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mConfigSettingIDs.reserve(keys.size());
         for (auto const& k : keys)
@@ -103,7 +104,7 @@ class bulkLoadConfigSettingsOperation
                           "FROM configsettings "
                           "WHERE configsettingid IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -132,7 +133,7 @@ class bulkLoadConfigSettingsOperation
                           "FROM configsettings "
                           "WHERE configsettingid IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strConfigSettingIDs));
         return executeAndFetch(st);
@@ -141,14 +142,14 @@ class bulkLoadConfigSettingsOperation
 };
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-LedgerTxnRoot::Impl::bulkLoadConfigSettings(
-    UnorderedSet<LedgerKey> const& keys) const
+LedgerTxnRoot::Impl::bulkLoadConfigSettings(UnorderedSet<LedgerKey> const& keys,
+                                            soci::session& session) const
 {
     if (!keys.empty())
     {
-        bulkLoadConfigSettingsOperation op(mDatabase, keys);
+        bulkLoadConfigSettingsOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -363,6 +364,7 @@ LedgerTxnRoot::Impl::dropConfigSettings()
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -56,6 +56,7 @@ class BulkLoadContractDataOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mContractIDs;
     std::vector<std::string> mKeys;
 
@@ -86,9 +87,9 @@ class BulkLoadContractDataOperation
     }
 
   public:
-    BulkLoadContractDataOperation(Database& db,
+    BulkLoadContractDataOperation(Database& db, soci::session& session,
                                   UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mContractIDs.reserve(keys.size());
         mKeys.reserve(keys.size());
@@ -130,7 +131,7 @@ class BulkLoadContractDataOperation
                           "FROM contractdata "
                           "WHERE (contractid, key) IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -162,7 +163,7 @@ class BulkLoadContractDataOperation
             "FROM contractdata "
             "WHERE (contractid, key) IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strContractIDs));
         st.exchange(soci::use(strKeys));
@@ -172,14 +173,14 @@ class BulkLoadContractDataOperation
 };
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-LedgerTxnRoot::Impl::bulkLoadContractData(
-    UnorderedSet<LedgerKey> const& keys) const
+LedgerTxnRoot::Impl::bulkLoadContractData(UnorderedSet<LedgerKey> const& keys,
+                                          soci::session& session) const
 {
     if (!keys.empty())
     {
-        BulkLoadContractDataOperation op(mDatabase, keys);
+        BulkLoadContractDataOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -404,6 +405,7 @@ LedgerTxnRoot::Impl::dropContractData()
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -6,7 +6,7 @@
 
 #include "database/Database.h"
 #include "ledger/LedgerTxn.h"
-#include "util/RandomEvictionCache.h"
+#include "util/EvictionCache.h"
 #include <list>
 #ifdef USE_POSTGRES
 #include <iomanip>
@@ -15,6 +15,11 @@
 #include <sstream>
 #endif
 
+namespace medida
+{
+class Meter;
+}
+
 namespace hcnet
 {
 
@@ -616,6 +621,7 @@ class LedgerTxn::Impl
     void unsealHeader(LedgerTxn& self, std::function<void(LedgerHeader&)> f);
 
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys);
+    void prefetchInBackground(UnorderedSet<LedgerKey> const& keys);
 
     double getPrefetchHitRate() const;
 
@@ -694,7 +700,9 @@ class LedgerTxnRoot::Impl
         LoadType type;
     };
 
-    typedef RandomEvictionCache<LedgerKey, CacheEntry> EntryCache;
+    // Cached entries survive commits: commitChild refreshes every cached key
+    // that the child changed, so the cache always matches the database.
+    typedef EvictionCache<LedgerKey, CacheEntry> EntryCache;
 
     typedef AssetPair BestOffersKey;
 
@@ -711,13 +719,27 @@ class LedgerTxnRoot::Impl
     static size_t const MIN_BEST_OFFERS_BATCH_SIZE;
     size_t const mMaxBestOffersBatchSize;
 
+    Application& mApp;
     Database& mDatabase;
     std::unique_ptr<LedgerHeader> mHeader;
     mutable EntryCache mEntryCache;
+    EntryCache::Counters mReportedEntryCacheCounters;
+    medida::Meter& mEntryCacheHitMeter;
+    medida::Meter& mEntryCacheMissMeter;
+    medida::Meter& mEntryCacheEvictMeter;
     mutable BestOffers mBestOffers;
     mutable uint64_t mPrefetchHits{0};
     mutable uint64_t mPrefetchMisses{0};
 
+    // Background prefetch state. mStateGeneration changes whenever the
+    // database contents may change, so that entries loaded before then are
+    // dropped instead of cached. Jobs hold a weak reference to mLifetime to
+    // tell whether the root still exists when they finish.
+    mutable uint64_t mStateGeneration{0};
+    bool mBackgroundPrefetchRunning{false};
+    std::shared_ptr<bool> const mLifetime;
+    medida::Meter& mBackgroundPrefetchMeter;
+
     size_t mBulkLoadBatchSize;
     std::unique_ptr<soci::transaction> mTransaction;
     AbstractLedgerTxn* mChild;
@@ -728,6 +750,9 @@ class LedgerTxnRoot::Impl
 
     void throwIfChild() const;
 
+    void updateEntryCache(EntryIterator const& iter);
+    void reportEntryCacheMetrics();
+
     std::shared_ptr<LedgerEntry const> loadAccount(LedgerKey const& key) const;
     std::shared_ptr<LedgerEntry const> loadData(LedgerKey const& key) const;
     std::shared_ptr<LedgerEntry const> loadOffer(LedgerKey const& key) const;
@@ -796,13 +821,15 @@ class LedgerTxnRoot::Impl
 
     // The entry cache maintains relatively strong invariants:
     //
-    //  - It is only ever populated during a database operation, at root.
+    //  - It is only ever populated during a database operation, at root,
+    //    or by a background prefetch that read the same database state.
     //
     //  - Until the (bulk) LedgerTxnRoot::commitChild operation, the only
     //    database operations are SELECTs, which only populate the cache
     //    with fresh data from the DB.
     //
-    //  - On LedgerTxnRoot::commitChild, the cache is cleared.
+    //  - On LedgerTxnRoot::commitChild, every cached key that the child
+    //    changed is updated to its committed value.
     //
     //  - It is therefore always kept in exact correspondence with the
     //    database for the keyset that it has entries for. It's a precise
@@ -817,22 +844,37 @@ class LedgerTxnRoot::Impl
                                          Asset const& selling) const;
 
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys,
+                     soci::session& session) const;
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadTrustLines(UnorderedSet<LedgerKey> const& keys,
+                       soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadTrustLines(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadOffers(UnorderedSet<LedgerKey> const& keys,
+                   soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadOffers(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadData(UnorderedSet<LedgerKey> const& keys,
+                 soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadData(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadClaimableBalance(UnorderedSet<LedgerKey> const& keys,
+                             soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadClaimableBalance(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys,
+                          soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadFromBucketList(UnorderedSet<LedgerKey> const& keys) const;
+    // Loads `keys`, which must all be of the SQL-stored entry type `type`.
+    UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
+    bulkLoadSQLEntries(LedgerEntryType type,
+                       UnorderedSet<LedgerKey> const& keys,
+                       soci::session& session) const;
 #ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadContractData(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadContractData(UnorderedSet<LedgerKey> const& keys,
+                         soci::session& session) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-    bulkLoadConfigSettings(UnorderedSet<LedgerKey> const& keys) const;
+    bulkLoadConfigSettings(UnorderedSet<LedgerKey> const& keys,
+                           soci::session& session) const;
 #endif
 
     std::deque<LedgerEntry>::const_iterator
@@ -846,7 +888,7 @@ class LedgerTxnRoot::Impl
 
   public:
     // Constructor has the strong exception safety guarantee
-    Impl(Database& db, size_t entryCacheSize, size_t prefetchBatchSize
+    Impl(Application& app, size_t entryCacheSize, size_t prefetchBatchSize
 #ifdef BEST_OFFER_DEBUGGING
          ,
          bool bestOfferDebuggingEnabled
@@ -943,6 +985,15 @@ class LedgerTxnRoot::Impl
     // prefetched.
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys);
 
+    // Start loading keys that are not cached yet on a worker thread, through
+    // a pooled database connection. The results are cached on the main thread
+    // unless the database has changed since this call.
+    void prefetchInBackground(UnorderedSet<LedgerKey> const& keys);
+    void finishBackgroundPrefetch(
+        uint64_t stateGeneration,
+        UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>> const&
+            entries);
+
     double getPrefetchHitRate() const;
 
     void prepareNewObjects(size_t s);
@@ -62,6 +62,7 @@ class BulkLoadLiquidityPoolOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mPoolAssets;
 
     std::vector<LedgerEntry>
@@ -91,9 +92,9 @@ class BulkLoadLiquidityPoolOperation
     }
 
   public:
-    BulkLoadLiquidityPoolOperation(Database& db,
+    BulkLoadLiquidityPoolOperation(Database& db, soci::session& session,
                                    UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mPoolAssets.reserve(keys.size());
         for (auto const& k : keys)
@@ -119,7 +120,7 @@ class BulkLoadLiquidityPoolOperation
                           "FROM liquiditypool "
                           "WHERE poolasset IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -147,7 +148,7 @@ class BulkLoadLiquidityPoolOperation
                           "FROM liquiditypool "
                           "WHERE poolasset IN (SELECT * from r)";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strPoolAssets));
         return executeAndFetch(st);
@@ -156,14 +157,14 @@ class BulkLoadLiquidityPoolOperation
 };
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-LedgerTxnRoot::Impl::bulkLoadLiquidityPool(
-    UnorderedSet<LedgerKey> const& keys) const
+LedgerTxnRoot::Impl::bulkLoadLiquidityPool(UnorderedSet<LedgerKey> const& keys,
+                                           soci::session& session) const
 {
     if (!keys.empty())
     {
-        BulkLoadLiquidityPoolOperation op(mDatabase, keys);
+        BulkLoadLiquidityPoolOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -391,6 +392,7 @@ LedgerTxnRoot::Impl::dropLiquidityPools()
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -352,6 +352,7 @@ LedgerTxnRoot::Impl::dropTrustLines()
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    ++mStateGeneration;
 
     std::string coll = mDatabase.getSimpleCollationClause();
 
@@ -370,6 +371,7 @@ class BulkLoadTrustLinesOperation
     : public DatabaseTypeSpecificOperation<std::vector<LedgerEntry>>
 {
     Database& mDb;
+    soci::session& mSession;
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mAssets;
 
@@ -404,9 +406,9 @@ class BulkLoadTrustLinesOperation
     }
 
   public:
-    BulkLoadTrustLinesOperation(Database& db,
+    BulkLoadTrustLinesOperation(Database& db, soci::session& session,
                                 UnorderedSet<LedgerKey> const& keys)
-        : mDb(db)
+        : mDb(db), mSession(session)
     {
         mAccountIDs.reserve(keys.size());
         mAssets.reserve(keys.size());
@@ -452,7 +454,7 @@ class BulkLoadTrustLinesOperation
                           ") SELECT accountid, asset, ledgerentry "
                           "FROM trustlines WHERE (accountid, asset) IN r";
 
-        auto prep = mDb.getPreparedStatement(sql);
+        auto prep = mDb.getPreparedStatement(sql, mSession);
         auto be = prep.statement().get_backend();
         if (be == nullptr)
         {
@@ -487,7 +489,8 @@ class BulkLoadTrustLinesOperation
             "ledgerentry "
             " FROM trustlines "
             "WHERE (accountid, asset) IN (SELECT * "
-            "FROM r)");
+            "FROM r)",
+            mSession);
         auto& st = prep.statement();
         st.exchange(soci::use(strAccountIDs));
         st.exchange(soci::use(strAssets));
@@ -497,16 +500,16 @@ class BulkLoadTrustLinesOperation
 };
 
 UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
-LedgerTxnRoot::Impl::bulkLoadTrustLines(
-    UnorderedSet<LedgerKey> const& keys) const
+LedgerTxnRoot::Impl::bulkLoadTrustLines(UnorderedSet<LedgerKey> const& keys,
+                                        soci::session& session) const
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(keys.size()));
     if (!keys.empty())
     {
-        BulkLoadTrustLinesOperation op(mDatabase, keys);
+        BulkLoadTrustLinesOperation op(mDatabase, session, keys);
         return populateLoadedEntries(
-            keys, mDatabase.doDatabaseTypeSpecificOperation(op));
+            keys, doDatabaseTypeSpecificOperation(session, op));
     }
     else
     {
@@ -24,6 +24,7 @@
 #include <memory>
 #include <queue>
 #include <set>
+#include <thread>
 #include <xdrpp/autocheck.h>
 
 using namespace hcnet;
@@ -2595,6 +2596,138 @@ TEST_CASE("LedgerTxnRoot prefetch", "[ledgertxn]")
 #endif
 }
 
+TEST_CASE("LedgerTxnRoot entry cache survives commits", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    auto app = createTestApplication(clock, cfg);
+    auto& root = app->getLedgerTxnRoot();
+    auto& hits = app->getMetrics().NewMeter(
+        {"ledger", "entry-cache", "hit"}, "entry");
+    auto& misses = app->getMetrics().NewMeter(
+        {"ledger", "entry-cache", "miss"}, "entry");
+
+    LedgerEntry le;
+    le.data.type(ACCOUNT);
+    le.data.account() = LedgerTestUtils::generateValidAccountEntry();
+    le.data.account().balance = 100;
+    auto key = LedgerEntryKey(le);
+    {
+        LedgerTxn ltx(root);
+        ltx.create(le);
+        ltx.commit();
+    }
+
+    // Load the entry once so it is cached, then modify it.
+    {
+        LedgerTxn ltx(root);
+        ltx.load(key).current().data.account().balance = 200;
+        ltx.commit();
+    }
+    auto hitsBefore = hits.count();
+    auto missesBefore = misses.count();
+    {
+        LedgerTxn ltx(root);
+        auto entry = ltx.load(key);
+        REQUIRE(entry.current().data.account().balance == 200);
+        entry.erase();
+        ltx.commit();
+    }
+    REQUIRE(hits.count() == hitsBefore + 1);
+    REQUIRE(misses.count() == missesBefore);
+
+    // The erase is cached as well.
+    {
+        LedgerTxn ltx(root);
+        REQUIRE(!ltx.load(key));
+        ltx.commit();
+    }
+    REQUIRE(hits.count() == hitsBefore + 2);
+    REQUIRE(misses.count() == missesBefore);
+}
+
+TEST_CASE("LedgerTxnRoot background prefetch", "[ledgertxn]")
+{
+    // Background prefetch needs a connection pool, which an in-memory
+    // database does not support.
+    VirtualClock clock;
+    auto cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+    auto app = createTestApplication(clock, cfg);
+    auto& root = app->getLedgerTxnRoot();
+    auto& background = app->getMetrics().NewMeter(
+        {"ledger", "prefetch", "background"}, "entry");
+    auto& hits = app->getMetrics().NewMeter(
+        {"ledger", "entry-cache", "hit"}, "entry");
+
+    std::vector<LedgerEntry> entries(20);
+    UnorderedSet<LedgerKey> keys;
+    {
+        LedgerTxn ltx(root);
+        for (auto& le : entries)
+        {
+            le.data.type(ACCOUNT);
+            le.data.account() = LedgerTestUtils::generateValidAccountEntry();
+            le.data.account().balance = 100;
+            ltx.createWithoutLoading(le);
+            keys.emplace(LedgerEntryKey(le));
+        }
+        ltx.commit();
+    }
+
+    // Background work completes asynchronously, so crank in real time.
+    auto crankUntil = [&](std::function<bool()> const& done) {
+        for (int i = 0; i < 2000 && !done(); ++i)
+        {
+            clock.crank(false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(done());
+    };
+
+    SECTION("entries are cached")
+    {
+        root.prefetchInBackground(keys);
+        crankUntil([&]() { return background.count() == keys.size(); });
+
+        // Cache metrics are reported when committing to the root
+        auto hitsBefore = hits.count();
+        {
+            LedgerTxn ltx(root);
+            for (auto const& k : keys)
+            {
+                REQUIRE(ltx.load(k).current().data.account().balance == 100);
+            }
+            ltx.commit();
+        }
+        REQUIRE(hits.count() == hitsBefore + keys.size());
+    }
+
+    SECTION("entries loaded before a commit are dropped")
+    {
+        root.prefetchInBackground(keys);
+        auto updated = entries[0];
+        updated.data.account().balance = 200;
+        {
+            LedgerTxn ltx(root);
+            ltx.updateWithoutLoading(updated);
+            ltx.commit();
+        }
+
+        // A new prefetch is only accepted once the first one has finished.
+        crankUntil([&]() {
+            root.prefetchInBackground(keys);
+            return background.count() != 0;
+        });
+        crankUntil([&]() { return background.count() == keys.size(); });
+
+        LedgerTxn ltx(root);
+        REQUIRE(ltx.load(LedgerEntryKey(updated))
+                    .current()
+                    .data.account()
+                    .balance == 200);
+    }
+}
+
 TEST_CASE("Create performance benchmark", "[!hide][createbench]")
 {
     auto runTest = [&](Config::TestDbMode mode, bool loading) {
@@ -126,6 +126,10 @@ void validateNetworkPassphrase(std::shared_ptr<Application> app);
  * to the Application through std::futures or similar standard
  * thread-synchronization primitives.
  *
+ * With EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING, the Application also owns
+ * a single "overlay" thread that decodes and authenticates incoming peer
+ * messages before they are handed to the main thread.
+ *
  */
 
 class Application
@@ -231,6 +235,11 @@ class Application
         Scheduler::ActionType type = Scheduler::ActionType::NORMAL_ACTION) = 0;
     virtual void postOnBackgroundThread(std::function<void()>&& f,
                                         std::string jobName) = 0;
+    // Runs `f` on the overlay thread, which only exists when
+    // EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING is set. Work runs one item at
+    // a time, in the order it was posted.
+    virtual void postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName) = 0;
 
     // Perform actions necessary to transition from BOOTING_STATE to other
     // states. In particular: either reload or reinitialize the database, and
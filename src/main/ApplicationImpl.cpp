@@ -82,6 +82,11 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     , mConfig(cfg)
     , mWorkerIOContext(mConfig.WORKER_THREADS)
     , mWork(std::make_unique<asio::io_context::work>(mWorkerIOContext))
+    , mOverlayIOContext(1)
+    , mOverlayWork(mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING
+                       ? std::make_unique<asio::io_context::work>(
+                             mOverlayIOContext)
+                       : nullptr)
     , mWorkerThreads()
     , mStopSignals(clock.getIOContext(), SIGINT)
     , mStarted(false)
@@ -94,6 +99,8 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
           mMetrics->NewTimer({"app", "post-on-main-thread", "delay"}))
     , mPostOnBackgroundThreadDelay(
           mMetrics->NewTimer({"app", "post-on-background-thread", "delay"}))
+    , mPostOnOverlayThreadDelay(
+          mMetrics->NewTimer({"app", "post-on-overlay-thread", "delay"}))
     , mStartedOn(clock.system_now())
 {
 #ifdef SIGQUIT
@@ -106,6 +113,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     std::srand(static_cast<uint32>(clock.now().time_since_epoch().count()));
 
     mNetworkID = sha256(mConfig.NETWORK_PASSPHRASE);
+    PubKeyUtils::setVerifySigCacheSize(mConfig.SIGNATURE_CACHE_SIZE);
 
     TracyAppInfo(HCNET_CORE_VERSION.c_str(), HCNET_CORE_VERSION.size());
     TracyAppInfo(mConfig.NETWORK_PASSPHRASE.c_str(),
@@ -142,6 +150,12 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
         }};
         mWorkerThreads.emplace_back(std::move(thread));
     }
+
+    if (mOverlayWork)
+    {
+        // Not lowered in priority: the main thread waits on its output.
+        mOverlayThread = std::thread{[this]() { mOverlayIOContext.run(); }};
+    }
 }
 
 static void
@@ -220,8 +234,9 @@ maybeRebuildLedger(Application& app, bool applyBuckets)
         {
             LOG_INFO(DEFAULT_LOG,
                      "Rebuilding ledger tables by applying buckets");
-            auto filter = [&toRebuild](LedgerEntryType t) {
-                return toRebuild.find(t) != toRebuild.end();
+            auto filter = [&toRebuild, &app](LedgerEntryType t) {
+                return toRebuild.find(t) != toRebuild.end() &&
+                       app.getConfig().modeStoresEntryTypeInSQL(t);
             };
             if (!applyBucketsForLCL(app, filter))
             {
@@ -281,7 +296,7 @@ ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
                         mConfig.ENTRY_CACHE_SIZE);
         }
         mLedgerTxnRoot = std::make_unique<LedgerTxnRoot>(
-            *mDatabase, mConfig.ENTRY_CACHE_SIZE, mConfig.PREFETCH_BATCH_SIZE
+            *this, mConfig.ENTRY_CACHE_SIZE, mConfig.PREFETCH_BATCH_SIZE
 #ifdef BEST_OFFER_DEBUGGING
             ,
             mConfig.BEST_OFFER_DEBUGGING_ENABLED
@@ -352,14 +367,32 @@ void
 ApplicationImpl::upgradeToCurrentSchemaAndMaybeRebuildLedger(bool applyBuckets,
                                                              bool forceRebuild)
 {
+    auto& ps = getPersistentState();
+
+    // Switching BucketListDB on or off changes which entry types are stored in
+    // SQL, so the ledger tables have to be rebuilt from the buckets.
+    std::string backend =
+        mConfig.isUsingBucketListDB() ? "bucketlistdb" : "sql";
+    std::string prevBackend = ps.getState(PersistentState::kDBBackend);
+    if (prevBackend.empty())
+    {
+        prevBackend = "sql";
+    }
+    if (prevBackend != backend)
+    {
+        LOG_INFO(DEFAULT_LOG, "Ledger backend changed from {} to {}",
+                 prevBackend, backend);
+        forceRebuild = true;
+    }
+
     if (forceRebuild)
     {
-        auto& ps = getPersistentState();
         for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
         {
             ps.setRebuildForType(static_cast<LedgerEntryType>(let));
         }
     }
+    ps.setState(PersistentState::kDBBackend, backend);
 
     mDatabase->upgradeToCurrentSchema();
     maybeRebuildLedger(*this, applyBuckets);
@@ -803,6 +836,12 @@ ApplicationImpl::joinAllThreads()
         w.join();
     }
     LOG_DEBUG(DEFAULT_LOG, "Joined all {} threads", mWorkerThreads.size());
+
+    mOverlayWork.reset();
+    if (mOverlayThread.joinable())
+    {
+        mOverlayThread.join();
+    }
 }
 
 std::string
@@ -1111,10 +1150,11 @@ ApplicationImpl::syncOwnMetrics()
     // Flush crypto pure-global-cache stats. They don't belong
     // to a single app instance but first one to flush will claim
     // them.
-    uint64_t vhit = 0, vmiss = 0;
-    PubKeyUtils::flushVerifySigCacheCounts(vhit, vmiss);
+    uint64_t vhit = 0, vmiss = 0, vevict = 0;
+    PubKeyUtils::flushVerifySigCacheCounts(vhit, vmiss, vevict);
     mMetrics->NewMeter({"crypto", "verify", "hit"}, "signature").Mark(vhit);
     mMetrics->NewMeter({"crypto", "verify", "miss"}, "signature").Mark(vmiss);
+    mMetrics->NewMeter({"crypto", "verify", "evict"}, "signature").Mark(vevict);
     mMetrics->NewMeter({"crypto", "verify", "total"}, "signature")
         .Mark(vhit + vmiss);
 
@@ -1299,6 +1339,19 @@ ApplicationImpl::postOnBackgroundThread(std::function<void()>&& f,
     });
 }
 
+void
+ApplicationImpl::postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName)
+{
+    releaseAssert(mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING);
+    LogSlowExecution isSlow{std::move(jobName), LogSlowExecution::Mode::MANUAL,
+                            "executed after"};
+    asio::post(mOverlayIOContext, [this, f = std::move(f), isSlow]() {
+        mPostOnOverlayThreadDelay.Update(isSlow.checkElapsedTime());
+        f();
+    });
+}
+
 void
 ApplicationImpl::enableInvariantsFromConfig()
 {
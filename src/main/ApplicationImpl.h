@@ -82,6 +82,8 @@ class ApplicationImpl : public Application
                                   Scheduler::ActionType type) override;
     virtual void postOnBackgroundThread(std::function<void()>&& f,
                                         std::string jobName) override;
+    virtual void postOnOverlayThread(std::function<void()>&& f,
+                                     std::string jobName) override;
 
     virtual void start() override;
 
@@ -152,6 +154,11 @@ class ApplicationImpl : public Application
     asio::io_context mWorkerIOContext;
     std::unique_ptr<asio::io_context::work> mWork;
 
+    // Only served by a thread, and only kept alive by mOverlayWork, when
+    // EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING is set.
+    asio::io_context mOverlayIOContext;
+    std::unique_ptr<asio::io_context::work> mOverlayWork;
+
     std::unique_ptr<BucketManager> mBucketManager;
     std::unique_ptr<Database> mDatabase;
     std::unique_ptr<OverlayManager> mOverlayManager;
@@ -189,6 +196,7 @@ class ApplicationImpl : public Application
 #endif
 
     std::vector<std::thread> mWorkerThreads;
+    std::thread mOverlayThread;
 
     asio::signal_set mStopSignals;
 
@@ -201,6 +209,7 @@ class ApplicationImpl : public Application
     std::unique_ptr<medida::MetricsRegistry> mMetrics;
     medida::Timer& mPostOnMainThreadDelay;
     medida::Timer& mPostOnBackgroundThreadDelay;
+    medida::Timer& mPostOnOverlayThreadDelay;
     VirtualClock::system_time_point mStartedOn;
 
     Hash mNetworkID;
@@ -114,7 +114,7 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
     addRoute("logrotate", &CommandHandler::logRotate);
     addRoute("manualclose", &CommandHandler::manualClose);
     addRoute("metrics", &CommandHandler::metrics);
-    addRoute("tx", &CommandHandler::tx);
+    addAsyncRoute("tx", &CommandHandler::tx);
 #ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
     addRoute("preflight", &CommandHandler::preflight);
     addRoute("getledgerentry", &CommandHandler::getLedgerEntry);
@@ -157,15 +157,45 @@ CommandHandler::safeRouter(CommandHandler::HandlerRoute route,
     }
 }
 
+void
+CommandHandler::addAsyncRoute(std::string const& name, AsyncHandlerRoute route)
+{
+    mServer->addAsyncRoute(
+        name,
+        std::bind(&CommandHandler::safeAsyncRouter, this, route, _1, _2));
+}
+
+void
+CommandHandler::safeAsyncRouter(CommandHandler::AsyncHandlerRoute route,
+                                std::string const& params,
+                                http::server::server::responder respond)
+{
+    // `route` must not throw once it called `respond`
+    try
+    {
+        ZoneNamedN(httpZone, "HTTP command handler", true);
+        route(this, params, respond);
+    }
+    catch (std::exception const& e)
+    {
+        respond(fmt::format(FMT_STRING(R"({{"exception": "{}"}})"), e.what()));
+    }
+    catch (...)
+    {
+        respond(R"({"exception": "generic"})");
+    }
+}
+
 std::string
 CommandHandler::manualCmd(std::string const& cmd)
 {
-    http::server::reply reply;
+    auto reply = std::make_shared<http::server::reply>();
     http::server::request request;
     request.uri = cmd;
-    mServer->handle_request(request, reply);
-    LOG_INFO(DEFAULT_LOG, "{} -> {}", cmd, reply.content);
-    return reply.content;
+    mServer->handle_request(request, *reply, [cmd, reply]() {
+        LOG_INFO(DEFAULT_LOG, "{} -> {}", cmd, reply->content);
+    });
+    return reply->content;
 }
 
 void
@@ -727,40 +757,108 @@ CommandHandler::getLedgerEntry(std::string const& params, std::string& retStr)
 
 #endif
 
-void
-CommandHandler::tx(std::string const& params, std::string& retStr)
+static TransactionFrameBasePtr
+decodeTransaction(Hash const& networkID, uint32_t ledgerVersion,
+                  std::string const& blob)
 {
     ZoneScoped;
-    Json::Value root;
+    TransactionEnvelope envelope;
+    std::vector<uint8_t> binBlob;
+    decoder::decode_b64(blob, binBlob);
+    xdr::xdr_from_opaque(binBlob, envelope);
+
+    if (protocolVersionStartsFrom(ledgerVersion, ProtocolVersion::V_13))
+    {
+        envelope = txbridge::convertForV13(envelope);
+    }
 
+    auto transaction =
+        TransactionFrameBase::makeTransactionFromWire(networkID, envelope);
+    if (transaction)
+    {
+        // Hash it here rather than on the main thread
+        transaction->getFullHash();
+    }
+    return transaction;
+}
+
+void
+CommandHandler::tx(std::string const& params,
+                   http::server::server::responder respond)
+{
+    ZoneScoped;
     std::map<std::string, std::string> paramMap;
     http::server::server::parseParams(params, paramMap);
     std::string blob = paramMap["blob"];
 
-    if (!blob.empty())
+    if (blob.empty())
     {
-        TransactionEnvelope envelope;
-        std::vector<uint8_t> binBlob;
-        decoder::decode_b64(blob, binBlob);
-        xdr::xdr_from_opaque(binBlob, envelope);
+        throw std::invalid_argument("Must specify a tx blob: tx?blob=<tx in "
+                                    "xdr format>");
+    }
 
-        {
-            auto lhhe = mApp.getLedgerManager().getLastClosedLedgerHeader();
-            if (protocolVersionStartsFrom(lhhe.header.ledgerVersion,
-                                          ProtocolVersion::V_13))
+    auto ledgerVersion = mApp.getLedgerManager()
+                             .getLastClosedLedgerHeader()
+                             .header.ledgerVersion;
+    if (mApp.getConfig().TX_ADMISSION_QUEUE_SIZE == 0)
+    {
+        submitTransaction(
+            decodeTransaction(mApp.getNetworkID(), ledgerVersion, blob),
+            respond);
+        return;
+    }
+
+    // The transaction goes through the admission queue, so it can be decoded
+    // on a worker thread as well. `respond` is moved along so that the
+    // connection it holds is always released on the main thread.
+    auto& app = mApp;
+    mApp.postOnBackgroundThread(
+        [this, &app, ledgerVersion, blob,
+         respond = std::move(respond)]() mutable {
+            TransactionFrameBasePtr transaction;
+            std::string error;
+            try
             {
-                envelope = txbridge::convertForV13(envelope);
+                transaction =
+                    decodeTransaction(app.getNetworkID(), ledgerVersion, blob);
             }
-        }
+            catch (std::exception const& e)
+            {
+                error = fmt::format(FMT_STRING(R"({{"exception": "{}"}})"),
+                                    e.what());
+            }
+            app.postOnMainThread(
+                [this, transaction, error, respond = std::move(respond)]() {
+                    if (!error.empty())
+                    {
+                        respond(error);
+                    }
+                    else
+                    {
+                        submitTransaction(transaction, respond);
+                    }
+                },
+                "submitTransaction");
+        },
+        "decodeTransaction");
+}
 
-        auto transaction = TransactionFrameBase::makeTransactionFromWire(
-            mApp.getNetworkID(), envelope);
-        if (transaction)
-        {
-            // Add it to our current set and make sure it is valid.
-            TransactionQueue::AddResult status =
-                mApp.getHerder().recvTransaction(transaction, true);
+void
+CommandHandler::submitTransaction(TransactionFrameBasePtr transaction,
+                                  http::server::server::responder respond)
+{
+    ZoneScoped;
+    if (!transaction)
+    {
+        respond(Json::FastWriter().write(Json::Value()));
+        return;
+    }
 
+    // Add it to our current set and make sure it is valid.
+    mApp.getHerder().recvTransactionAsync(
+        transaction, true,
+        [transaction, respond](TransactionQueue::AddResult status) {
+            Json::Value root;
             root["status"] = TX_STATUS_STRING[static_cast<int>(status)];
             if (status == TransactionQueue::AddResult::ADD_STATUS_ERROR)
             {
@@ -771,15 +869,8 @@ CommandHandler::tx(std::string const& params, std::string& retStr)
                 resultBase64 = decoder::encode_b64(resultBin);
                 root["error"] = resultBase64;
             }
-        }
-    }
-    else
-    {
-        throw std::invalid_argument("Must specify a tx blob: tx?blob=<tx in "
-                                    "xdr format>");
-    }
-
-    retStr = Json::FastWriter().write(root);
+            respond(Json::FastWriter().write(root));
+        });
 }
 
 void
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "lib/http/server.hpp"
+#include "transactions/TransactionFrameBase.h"
 #include <string>
 
 /*
@@ -20,6 +21,9 @@ class CommandHandler
     typedef std::function<void(CommandHandler*, std::string const&,
                                std::string&)>
         HandlerRoute;
+    typedef std::function<void(CommandHandler*, std::string const&,
+                               http::server::server::responder)>
+        AsyncHandlerRoute;
 
     Application& mApp;
     std::unique_ptr<http::server::server> mServer;
@@ -27,10 +31,18 @@ class CommandHandler
     void addRoute(std::string const& name, HandlerRoute route);
     void safeRouter(HandlerRoute route, std::string const& params,
                     std::string& retStr);
+    void addAsyncRoute(std::string const& name, AsyncHandlerRoute route);
+    void safeAsyncRouter(AsyncHandlerRoute route, std::string const& params,
+                         http::server::server::responder respond);
+
+    void submitTransaction(TransactionFrameBasePtr tx,
+                           http::server::server::responder respond);
 
   public:
     CommandHandler(Application& app);
 
+    // Returns an empty string for commands answered after they return, such
+    // as tx with TX_ADMISSION_QUEUE_SIZE set: their result is only logged.
     std::string manualCmd(std::string const& cmd);
 
     void fileNotFound(std::string const& params, std::string& retStr);
@@ -53,7 +65,8 @@ class CommandHandler
     void setcursor(std::string const& params, std::string& retStr);
     void getcursor(std::string const& params, std::string& retStr);
     void scpInfo(std::string const& params, std::string& retStr);
-    void tx(std::string const& params, std::string& retStr);
+    void tx(std::string const& params,
+            http::server::server::responder respond);
 #ifdef ENABLE_NEXT_PROTOCOL_VERSION_UNSAFE_FOR_PRODUCTION
     void preflight(std::string const& params, std::string& retStr);
     void getLedgerEntry(std::string const& params, std::string& retStr);
@@ -13,6 +13,7 @@
 #include "main/HcnetCoreVersion.h"
 #include "scp/LocalNode.h"
 #include "scp/QuorumSetUtils.h"
+#include "util/EvictionCache.h"
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
@@ -128,7 +129,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MAXIMUM_LEDGER_CLOSETIME_DRIFT = 50;
 
     OVERLAY_PROTOCOL_MIN_VERSION = 21;
-    OVERLAY_PROTOCOL_VERSION = 24;
+    OVERLAY_PROTOCOL_VERSION = 27;
 
     VERSION_STR = HCNET_CORE_VERSION;
 
@@ -165,6 +166,8 @@ Config::Config() : NODE_SEED(SecretKey::random())
     DISABLE_BUCKET_GC = false;
     DISABLE_XDR_FSYNC = false;
     MAX_SLOTS_TO_REMEMBER = 12;
+    PREPARE_CANDIDATE_TX_SET = false;
+    TX_ADMISSION_QUEUE_SIZE = 0;
     METADATA_OUTPUT_STREAM = "";
     METADATA_DEBUG_LEDGERS = 0;
 
@@ -201,14 +204,22 @@ Config::Config() : NODE_SEED(SecretKey::random())
     FLOOD_ADVERT_PERIOD_MS = std::chrono::milliseconds(100);
     FLOOD_DEMAND_BACKOFF_DELAY_MS = std::chrono::milliseconds(500);
     ENABLE_PULL_MODE = false;
+    ENABLE_COMPACT_ADVERTS = false;
+    ENABLE_OVERLAY_COMPRESSION = false;
+    OVERLAY_COMPRESSION_MIN_BYTES = 4096;
+    ENABLE_OVERLAY_BLAKE2_MAC = false;
+    ITEM_FETCH_HEDGE_PEERS = 0;
 
     MAX_BATCH_WRITE_COUNT = 1024;
     MAX_BATCH_WRITE_BYTES = 1 * 1024 * 1024;
+    MAX_BATCH_WRITE_DELAY_MS = 0;
     PREFERRED_PEERS_ONLY = false;
 
     PEER_READING_CAPACITY = 200;
     PEER_FLOOD_READING_CAPACITY = 200;
     FLOW_CONTROL_SEND_MORE_BATCH_SIZE = 40;
+    FLOW_CONTROL_AUTOTUNE = false;
+    EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = false;
 
     // WORKER_THREADS: setting this too low risks a form of priority inversion
     // where a long-running background task occupies all worker threads and
@@ -221,13 +232,21 @@ Config::Config() : NODE_SEED(SecretKey::random())
     //
     // Worst case = 10 concurrent merges + 1 quorum intersection calculation.
     WORKER_THREADS = 11;
+    BUCKET_MERGE_THREADS = 4;
+    BUCKET_MERGE_PARALLEL_CUTOFF = 256; // 256 MB
     MAX_CONCURRENT_SUBPROCESSES = 16;
     NODE_IS_VALIDATOR = false;
     QUORUM_INTERSECTION_CHECKER = true;
     DATABASE = SecretValue{"sqlite3://:memory:"};
 
     ENTRY_CACHE_SIZE = 100000;
+    ENTRY_CACHE_POLICY = "S3FIFO";
     PREFETCH_BATCH_SIZE = 1000;
+    SIGNATURE_CACHE_SIZE = PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE;
+    EXPERIMENTAL_BUCKETLIST_DB = false;
+    EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 14; // 16 KB pages
+    EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF = 20;             // 20 MB
+    EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX = true;
 
     HISTOGRAM_WINDOW_SIZE = std::chrono::seconds(30);
 
@@ -1017,6 +1036,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 MAX_SLOTS_TO_REMEMBER = readInt<uint32>(item);
             }
+            else if (item.first == "PREPARE_CANDIDATE_TX_SET")
+            {
+                PREPARE_CANDIDATE_TX_SET = readBool(item);
+            }
+            else if (item.first == "TX_ADMISSION_QUEUE_SIZE")
+            {
+                TX_ADMISSION_QUEUE_SIZE = readInt<uint32>(item);
+            }
             else if (item.first ==
                      "ARTIFICIALLY_REPLAY_WITH_NEWEST_BUCKET_LOGIC_FOR_TESTING")
             {
@@ -1122,6 +1149,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 MAX_BATCH_WRITE_BYTES = readInt<int>(item, 1);
             }
+            else if (item.first == "MAX_BATCH_WRITE_DELAY_MS")
+            {
+                MAX_BATCH_WRITE_DELAY_MS = readInt<int>(item, 0);
+            }
             else if (item.first == "FLOOD_OP_RATE_PER_LEDGER")
             {
                 FLOOD_OP_RATE_PER_LEDGER = readDouble(item);
@@ -1154,6 +1185,34 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 ENABLE_PULL_MODE = readBool(item);
             }
+            else if (item.first == "ENABLE_COMPACT_ADVERTS")
+            {
+                ENABLE_COMPACT_ADVERTS = readBool(item);
+            }
+            else if (item.first == "ENABLE_OVERLAY_COMPRESSION")
+            {
+                ENABLE_OVERLAY_COMPRESSION = readBool(item);
+#ifndef USE_ZLIB
+                if (ENABLE_OVERLAY_COMPRESSION)
+                {
+                    throw std::invalid_argument(
+                        "ENABLE_OVERLAY_COMPRESSION requires a build with "
+                        "zlib");
+                }
+#endif
+            }
+            else if (item.first == "OVERLAY_COMPRESSION_MIN_BYTES")
+            {
+                OVERLAY_COMPRESSION_MIN_BYTES = readInt<uint32_t>(item);
+            }
+            else if (item.first == "ENABLE_OVERLAY_BLAKE2_MAC")
+            {
+                ENABLE_OVERLAY_BLAKE2_MAC = readBool(item);
+            }
+            else if (item.first == "ITEM_FETCH_HEDGE_PEERS")
+            {
+                ITEM_FETCH_HEDGE_PEERS = readInt<uint32_t>(item);
+            }
             else if (item.first == "FLOOD_ARB_TX_BASE_ALLOWANCE")
             {
                 FLOOD_ARB_TX_BASE_ALLOWANCE = readInt<int32_t>(item, -1);
@@ -1198,6 +1257,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 WORKER_THREADS = readInt<int>(item, 1, 1000);
             }
+            else if (item.first == "BUCKET_MERGE_THREADS")
+            {
+                BUCKET_MERGE_THREADS = readInt<int>(item, 1, 64);
+            }
+            else if (item.first == "BUCKET_MERGE_PARALLEL_CUTOFF")
+            {
+                BUCKET_MERGE_PARALLEL_CUTOFF = readInt<uint32_t>(item);
+            }
             else if (item.first == "MAX_CONCURRENT_SUBPROCESSES")
             {
                 MAX_CONCURRENT_SUBPROCESSES = readInt<size_t>(item, 1);
@@ -1270,10 +1337,47 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 ENTRY_CACHE_SIZE = readInt<uint32_t>(item);
             }
+            else if (item.first == "ENTRY_CACHE_POLICY")
+            {
+                ENTRY_CACHE_POLICY = readString(item);
+                try
+                {
+                    parseCacheEvictionPolicy(ENTRY_CACHE_POLICY);
+                }
+                catch (std::invalid_argument const&)
+                {
+                    throw std::invalid_argument(
+                        fmt::format(FMT_STRING("invalid {}: {}"), item.first,
+                                    ENTRY_CACHE_POLICY));
+                }
+            }
             else if (item.first == "PREFETCH_BATCH_SIZE")
             {
                 PREFETCH_BATCH_SIZE = readInt<uint32_t>(item);
             }
+            else if (item.first == "SIGNATURE_CACHE_SIZE")
+            {
+                SIGNATURE_CACHE_SIZE = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "EXPERIMENTAL_BUCKETLIST_DB")
+            {
+                EXPERIMENTAL_BUCKETLIST_DB = readBool(item);
+            }
+            else if (item.first ==
+                     "EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT")
+            {
+                EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT =
+                    readInt<uint32_t>(item, 0, 32);
+            }
+            else if (item.first == "EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF")
+            {
+                EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF =
+                    readInt<uint32_t>(item);
+            }
+            else if (item.first == "EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX")
+            {
+                EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX = readBool(item);
+            }
             else if (item.first == "MAXIMUM_LEDGER_CLOSETIME_DRIFT")
             {
                 MAXIMUM_LEDGER_CLOSETIME_DRIFT = readInt<int64_t>(item, 0);
@@ -1354,6 +1458,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 FLOW_CONTROL_SEND_MORE_BATCH_SIZE = readInt<uint32_t>(item, 1);
             }
+            else if (item.first == "FLOW_CONTROL_AUTOTUNE")
+            {
+                FLOW_CONTROL_AUTOTUNE = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING")
+            {
+                EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = readBool(item);
+            }
             else
             {
                 std::string err("Unknown configuration entry: '");
@@ -1886,6 +1998,26 @@ Config::modeStoresAnyHistory() const
     return MODE_STORES_HISTORY_LEDGERHEADERS || MODE_STORES_HISTORY_MISC;
 }
 
+bool
+Config::isUsingBucketListDB() const
+{
+    return EXPERIMENTAL_BUCKETLIST_DB && !MODE_USES_IN_MEMORY_LEDGER &&
+           MODE_ENABLES_BUCKETLIST;
+}
+
+bool
+Config::modeStoresEntryTypeInSQL(LedgerEntryType let) const
+{
+    if (!isUsingBucketListDB())
+    {
+        return true;
+    }
+
+    // These types are queried by secondary attributes (order books, pool
+    // share trustlines by asset) which the bucket index cannot answer.
+    return let == OFFER || let == TRUSTLINE || let == LIQUIDITY_POOL;
+}
+
 void
 Config::setNoListen()
 {
@@ -244,9 +244,39 @@ class Config : public std::enable_shared_from_this<Config>
     // processes `FLOW_CONTROL_SEND_MORE_BATCH_SIZE` messages
     uint32_t FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
 
+    // If set to true, the flood reading capacity granted to each peer and the
+    // SEND_MORE batch size are adapted to the measured round-trip time and
+    // processing latency of that peer, starting from
+    // PEER_FLOOD_READING_CAPACITY and FLOW_CONTROL_SEND_MORE_BATCH_SIZE.
+    bool FLOW_CONTROL_AUTOTUNE;
+
+    // If set to true, messages from authenticated TCP peers are decoded and
+    // their MACs verified on a dedicated overlay thread, and only the decoded
+    // messages are handed to the main thread. Experimental.
+    bool EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING;
+
     // Used to flood transactions lazily by first flooding their hashes.
     bool ENABLE_PULL_MODE;
 
+    // In pull mode, advertise transactions by 8-byte per-connection short ids
+    // instead of full hashes, to peers that enable it as well. Requires
+    // ENABLE_PULL_MODE.
+    bool ENABLE_COMPACT_ADVERTS;
+
+    // Send tx sets and quorum sets of at least OVERLAY_COMPRESSION_MIN_BYTES
+    // compressed to peers that enable compression as well.
+    bool ENABLE_OVERLAY_COMPRESSION;
+    uint32_t OVERLAY_COMPRESSION_MIN_BYTES;
+
+    // Authenticate overlay messages with keyed BLAKE2b instead of
+    // HMAC-SHA256 on connections to peers that enable it as well.
+    bool ENABLE_OVERLAY_BLAKE2_MAC;
+
+    // Number of peers asked for a missing tx set or quorum set in addition
+    // to the one normally picked, chosen by lowest round-trip time. The
+    // first reply ends the fetch.
+    uint32_t ITEM_FETCH_HEDGE_PEERS;
+
     // A config parameter that allows a node to generate buckets. This should
     // be set to `false` only for testing purposes.
     bool MODE_ENABLES_BUCKETLIST;
@@ -318,6 +348,18 @@ class Config : public std::enable_shared_from_this<Config>
     // approximately ~1 min of network activity.
     uint32 MAX_SLOTS_TO_REMEMBER;
 
+    // Build the tx set to nominate while waiting for the next ledger trigger,
+    // right after the last ledger closed, rather than when the trigger fires.
+    // The prepared set is only nominated if the transactions it was built
+    // from are still the best ones in the queue at trigger time.
+    bool PREPARE_CANDIDATE_TX_SET;
+
+    // Maximum number of transactions received from peers that may be waiting
+    // for their signatures to be verified on a worker thread before being
+    // added to the transaction queue. Transactions arriving while it is full
+    // are dropped. 0 verifies and adds transactions as they arrive.
+    uint32 TX_ADMISSION_QUEUE_SIZE;
+
     // A string specifying a stream to write fine-grained metadata to for each
     // ledger close while running. This will be opened at startup and
     // synchronously streamed-to during both catchup and live ledger-closing.
@@ -392,6 +434,10 @@ class Config : public std::enable_shared_from_this<Config>
     unsigned short PEER_STRAGGLER_TIMEOUT;
     int MAX_BATCH_WRITE_COUNT;
     int MAX_BATCH_WRITE_BYTES;
+    // How long a small flood message (transaction, advert or demand) can wait
+    // in an idle peer's write queue for more messages to write with it. 0
+    // writes every message as soon as the socket is idle.
+    int MAX_BATCH_WRITE_DELAY_MS;
     double FLOOD_OP_RATE_PER_LEDGER;
     int FLOOD_TX_PERIOD_MS;
     int32_t FLOOD_ARB_TX_BASE_ALLOWANCE;
@@ -419,6 +465,12 @@ class Config : public std::enable_shared_from_this<Config>
     // thread-management config
     int WORKER_THREADS;
 
+    // A single bucket merge whose inputs total at least
+    // BUCKET_MERGE_PARALLEL_CUTOFF MB is split into key ranges that are
+    // merged on up to BUCKET_MERGE_THREADS threads. 1 disables splitting.
+    int BUCKET_MERGE_THREADS;
+    size_t BUCKET_MERGE_PARALLEL_CUTOFF;
+
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
@@ -449,7 +501,10 @@ class Config : public std::enable_shared_from_this<Config>
     // Data layer cache configuration
     // - ENTRY_CACHE_SIZE controls the maximum number of LedgerEntry objects
     //   that will be stored in the cache
+    // - ENTRY_CACHE_POLICY selects how the cache picks entries to evict: one
+    //   of "RANDOM", "CLOCK" or "S3FIFO"
     size_t ENTRY_CACHE_SIZE;
+    std::string ENTRY_CACHE_POLICY;
 
     // Data layer prefetcher configuration
     // - PREFETCH_BATCH_SIZE determines how many records we'll prefetch per
@@ -457,6 +512,28 @@ class Config : public std::enable_shared_from_this<Config>
     // the entry cache
     size_t PREFETCH_BATCH_SIZE;
 
+    // Number of signature verification results kept in the process-wide
+    // verification cache. If several applications share a process, the last
+    // one started sets the size.
+    size_t SIGNATURE_CACHE_SIZE;
+
+    // If set to true, LedgerTxnRoot serves point loads of non-offer ledger
+    // entries directly from indexed bucket files instead of SQL, and only the
+    // entry types that back SQL-only queries (offers, trustlines and liquidity
+    // pools) continue to be written to the database. Experimental.
+    bool EXPERIMENTAL_BUCKETLIST_DB;
+
+    // Buckets with a file size (in MB) below this cutoff get an individual
+    // index (one entry per key). Larger buckets get a range index, with one
+    // entry per page of 2^EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT
+    // bytes. An exponent of 0 means every bucket is individually indexed.
+    size_t EXPERIMENTAL_BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT;
+    size_t EXPERIMENTAL_BUCKETLIST_DB_INDEX_CUTOFF;
+
+    // If set to true, bucket indexes are saved next to their bucket files and
+    // reloaded on startup instead of being rebuilt.
+    bool EXPERIMENTAL_BUCKETLIST_DB_PERSIST_INDEX;
+
     // If set to true, the application will halt when an internal error is
     // encountered during applying a transaction. Otherwise, the
     // txINTERNAL_ERROR transaction is created but not applied.
@@ -503,6 +580,8 @@ class Config : public std::enable_shared_from_this<Config>
     bool isInMemoryModeWithoutMinimalDB() const;
     bool modeStoresAllHistory() const;
     bool modeStoresAnyHistory() const;
+    bool isUsingBucketListDB() const;
+    bool modeStoresEntryTypeInSQL(LedgerEntryType let) const;
 
     void logBasicInfo();
     void setNoListen();
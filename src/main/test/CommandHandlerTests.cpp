@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "herder/Herder.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
@@ -53,7 +54,7 @@ TEST_CASE_VERSIONS("transaction envelope bridge", "[commandhandler]")
     auto submit = [&](auto... input) {
         std::string ret;
         auto opaque = decoder::encode_b64(xdr::xdr_to_opaque(input...));
-        ch.tx("?blob=" + opaque, ret);
+        ch.tx("?blob=" + opaque, [&ret](std::string const& res) { ret = res; });
         return ret;
     };
 
@@ -187,6 +188,60 @@ TEST_CASE_VERSIONS("transaction envelope bridge", "[commandhandler]")
     }
 }
 
+TEST_CASE("transaction submission through the admission queue",
+          "[commandhandler][herder]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.TX_ADMISSION_QUEUE_SIZE = 1;
+    auto app = createTestApplication(clock, cfg);
+    auto& ch = app->getCommandHandler();
+    auto baseFee = app->getLedgerManager().getLastTxFee();
+    auto root = TestAccount::createRoot(*app);
+
+    auto submit = [&](TransactionFrameBasePtr const& tx) {
+        std::optional<std::string> ret;
+        auto opaque =
+            decoder::encode_b64(xdr::xdr_to_opaque(tx->getEnvelope()));
+        ch.tx("?blob=" + opaque, [&ret](std::string const& res) { ret = res; });
+        // Answered once decoded and verified on worker threads
+        REQUIRE(!ret);
+        while (!ret)
+        {
+            clock.crank(false);
+        }
+        return *ret;
+    };
+
+    SECTION("valid transaction")
+    {
+        auto tx = root.tx({payment(root, 1)});
+        REQUIRE(submit(tx) == "{\"status\":\"PENDING\"}\n");
+        REQUIRE(app->getHerder().getTx(tx->getFullHash()));
+    }
+
+    SECTION("malformed transaction")
+    {
+        TransactionResult txRes;
+        txRes.feeCharged = baseFee;
+        txRes.result.code(txMISSING_OPERATION);
+        auto error = decoder::encode_b64(xdr::xdr_to_opaque(txRes));
+        REQUIRE(submit(root.tx({})) ==
+                "{\"error\":\"" + error + "\",\"status\":\"ERROR\"}\n");
+    }
+
+    SECTION("invalid blob")
+    {
+        std::optional<std::string> ret;
+        ch.tx("?blob=AAAA", [&ret](std::string const& res) { ret = res; });
+        while (!ret)
+        {
+            clock.crank(false);
+        }
+        REQUIRE(ret->find("exception") != std::string::npos);
+    }
+}
+
 TEST_CASE("manualclose", "[commandhandler]")
 {
     auto testManualCloseConfig = [](auto configure, auto issue) {
@@ -15,16 +15,48 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <bitset>
 #include <fmt/format.h>
+#include <set>
 
 namespace hcnet
 {
-Floodgate::FloodRecord::FloodRecord(HcnetMessage const& msg, uint32_t ledger,
-                                    Peer::pointer peer)
-    : mLedgerSeq(ledger), mMessage(msg)
+Floodgate::FloodRecord::FloodRecord(uint32_t ledger) : mLedgerSeq(ledger)
 {
-    if (peer)
-        mPeersTold.insert(peer->toString());
+}
+
+bool
+Floodgate::FloodRecord::insert(PeerIndex peer)
+{
+    size_t word = peer / 64;
+    uint64_t bit = uint64_t(1) << (peer % 64);
+    if (word >= mPeersTold.size())
+    {
+        mPeersTold.resize(word + 1);
+    }
+    bool inserted = (mPeersTold[word] & bit) == 0;
+    mPeersTold[word] |= bit;
+    return inserted;
+}
+
+bool
+Floodgate::FloodRecord::contains(PeerIndex peer) const
+{
+    size_t word = peer / 64;
+    return word < mPeersTold.size() &&
+           (mPeersTold[word] & (uint64_t(1) << (peer % 64))) != 0;
+}
+
+size_t
+Floodgate::FloodRecord::count() const
+{
+    size_t res = 0;
+    for (auto w : mPeersTold)
+    {
+        res += std::bitset<64>(w).count();
+    }
+    return res;
 }
 
 Floodgate::Floodgate(Application& app)
@@ -39,23 +71,99 @@ Floodgate::Floodgate(Application& app)
 {
 }
 
-// remove old flood records
+Floodgate::PeerIndex
+Floodgate::getPeerIndex(Peer::pointer const& peer)
+{
+    auto it = mPeerIndices.find(peer->toString());
+    if (it != mPeerIndices.end())
+    {
+        return it->second;
+    }
+    PeerIndex index;
+    if (mFreePeerIndices.empty())
+    {
+        index = mNextPeerIndex++;
+    }
+    else
+    {
+        index = mFreePeerIndices.back();
+        mFreePeerIndices.pop_back();
+    }
+    mPeerIndices.emplace(peer->toString(), index);
+    return index;
+}
+
+Floodgate::FloodRecord&
+Floodgate::newRecord(Hash const& index, uint32_t ledger)
+{
+    mGenerations[ledger].emplace_back(index);
+    auto& fr = mFloodMap.insert_or_assign(index, FloodRecord(ledger))
+                   .first->second;
+    mFloodMapSize.set_count(mFloodMap.size());
+    return fr;
+}
+
 void
-Floodgate::clearBelow(uint32_t maxLedger)
+Floodgate::retireDisconnectedPeers()
 {
-    ZoneScoped;
-    for (auto it = mFloodMap.cbegin(); it != mFloodMap.cend();)
+    // Records are created for the tracked ledger, so none created so far is
+    // newer than this.
+    uint32_t lastLedger = mApp.getHerder().trackingConsensusLedgerIndex();
+    if (!mGenerations.empty())
+    {
+        lastLedger = std::max(lastLedger, mGenerations.rbegin()->first);
+    }
+    auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
+    std::set<std::string> connected;
+    for (auto const& p : peers)
     {
-        if (it->second->mLedgerSeq < maxLedger)
+        connected.insert(p.second->toString());
+    }
+    for (auto it = mPeerIndices.begin(); it != mPeerIndices.end();)
+    {
+        if (connected.find(it->first) == connected.end())
         {
-            it = mFloodMap.erase(it);
+            mRetiredPeerIndices.emplace_back(it->second, lastLedger);
+            it = mPeerIndices.erase(it);
         }
         else
         {
             ++it;
         }
     }
+}
+
+// remove old flood records
+void
+Floodgate::clearBelow(uint32_t maxLedger)
+{
+    ZoneScoped;
+    while (!mGenerations.empty() && mGenerations.begin()->first < maxLedger)
+    {
+        auto ledger = mGenerations.begin()->first;
+        for (auto const& h : mGenerations.begin()->second)
+        {
+            auto it = mFloodMap.find(h);
+            if (it != mFloodMap.end() && it->second.mLedgerSeq == ledger)
+            {
+                mFloodMap.erase(it);
+            }
+        }
+        mGenerations.erase(mGenerations.begin());
+    }
     mFloodMapSize.set_count(mFloodMap.size());
+
+    // No remaining record mentions peers retired before maxLedger, so their
+    // indices can be handed out again.
+    auto freed = std::partition(
+        mRetiredPeerIndices.begin(), mRetiredPeerIndices.end(),
+        [&](auto const& retired) { return retired.second >= maxLedger; });
+    for (auto it = freed; it != mRetiredPeerIndices.end(); ++it)
+    {
+        mFreePeerIndices.emplace_back(it->first);
+    }
+    mRetiredPeerIndices.erase(freed, mRetiredPeerIndices.end());
+    retireDisconnectedPeers();
 }
 
 bool
@@ -70,16 +178,19 @@ Floodgate::addRecord(HcnetMessage const& msg, Peer::pointer peer, Hash& index)
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end())
     { // we have never seen this message
-        mFloodMap[index] = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().trackingConsensusLedgerIndex(), peer);
-        mFloodMapSize.set_count(mFloodMap.size());
+        auto& fr =
+            newRecord(index, mApp.getHerder().trackingConsensusLedgerIndex());
+        if (peer)
+        {
+            fr.insert(getPeerIndex(peer));
+        }
         TracyPlot("overlay.memory.flood-known",
                   static_cast<int64_t>(mFloodMap.size()));
         return true;
     }
     else
     {
-        result->second->mPeersTold.insert(peer->toString());
+        result->second.insert(getPeerIndex(peer));
         return false;
     }
 }
@@ -98,35 +209,34 @@ Floodgate::broadcast(HcnetMessage const& msg, bool force,
     {
         // Must pass a hash when broadcasting transactions.
         releaseAssert(hash.has_value());
+        // Lets compact adverts of it from any peer resolve to the hash.
+        mApp.getOverlayManager().rememberTxHash(hash.value());
     }
     Hash index = xdrBlake2(msg);
 
-    FloodRecord::pointer fr;
+    FloodRecord* fr;
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end() || force)
     { // no one has sent us this message / start from scratch
-        fr = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().trackingConsensusLedgerIndex(),
-            Peer::pointer());
-        mFloodMap[index] = fr;
-        mFloodMapSize.set_count(mFloodMap.size());
+        fr = &newRecord(index, mApp.getHerder().trackingConsensusLedgerIndex());
     }
     else
     {
-        fr = result->second;
+        fr = &result->second;
     }
-    // send it to people that haven't sent it to us
-    auto& peersTold = fr->mPeersTold;
 
     // make a copy, in case peers gets modified
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
 
     bool broadcasted = false;
     auto smsg = std::make_shared<HcnetMessage const>(msg);
+    // Serialized on first use and shared by every peer the message is sent to
+    Peer::EncodedMessage encoded;
     for (auto peer : peers)
     {
         releaseAssert(peer.second->isAuthenticated());
-        if (peersTold.insert(peer.second->toString()).second)
+        // send it to people that haven't sent it to us
+        if (fr->insert(getPeerIndex(peer.second)))
         {
             if (msg.type() == TRANSACTION && peer.second->isPullModeEnabled())
             {
@@ -136,14 +246,19 @@ Floodgate::broadcast(HcnetMessage const& msg, bool force,
             else
             {
                 mSendFromBroadcast.Mark();
+                if (!encoded)
+                {
+                    encoded = std::make_shared<xdr::opaque_vec<> const>(
+                        xdr::xdr_to_opaque(msg));
+                }
                 std::weak_ptr<Peer> weak(
                     std::static_pointer_cast<Peer>(peer.second));
                 mApp.postOnMainThread(
-                    [smsg, weak, log = !broadcasted]() {
+                    [smsg, encoded, weak, log = !broadcasted]() {
                         auto strong = weak.lock();
                         if (strong)
                         {
-                            strong->sendMessage(smsg, log);
+                            strong->sendMessage(smsg, encoded, log);
                         }
                     },
                     fmt::format(FMT_STRING("broadcast to {}"),
@@ -153,7 +268,7 @@ Floodgate::broadcast(HcnetMessage const& msg, bool force,
         }
     }
     CLOG_TRACE(Overlay, "broadcast {} told {}", hexAbbrev(index),
-               peersTold.size());
+               fr->count());
     return broadcasted;
 }
 
@@ -164,11 +279,12 @@ Floodgate::getPeersKnows(Hash const& h)
     auto record = mFloodMap.find(h);
     if (record != mFloodMap.end())
     {
-        auto& ids = record->second->mPeersTold;
         auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
         for (auto& p : peers)
         {
-            if (ids.find(p.second->toString()) != ids.end())
+            auto index = mPeerIndices.find(p.second->toString());
+            if (index != mPeerIndices.end() &&
+                record->second.contains(index->second))
             {
                 res.insert(p.second);
             }
@@ -182,6 +298,7 @@ Floodgate::shutdown()
 {
     mShuttingDown = true;
     mFloodMap.clear();
+    mGenerations.clear();
 }
 
 void
@@ -201,11 +318,10 @@ Floodgate::updateRecord(HcnetMessage const& oldMsg,
     auto oldIter = mFloodMap.find(oldHash);
     if (oldIter != mFloodMap.end())
     {
-        auto record = oldIter->second;
-        record->mMessage = newMsg;
-
+        auto record = std::move(oldIter->second);
         mFloodMap.erase(oldIter);
-        mFloodMap.emplace(newHash, record);
+        mGenerations[record.mLedgerSeq].emplace_back(newHash);
+        mFloodMap.emplace(newHash, std::move(record));
     }
 }
 
@@ -6,7 +6,10 @@
 
 #include "overlay/Peer.h"
 #include "overlay/HcnetXDR.h"
+#include "util/HashOfHash.h"
+#include "util/UnorderedMap.h"
 #include <map>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -19,6 +22,12 @@
  * All messages are marked with the ledger sequence number to which they
  * relate, and all flood-management information for a given ledger number
  * is purged from the FloodGate when the ledger closes.
+ *
+ * Records only hold a ledger number and a bitset of the peers told, with
+ * peers interned to small integers. The hashes of the records created for
+ * each ledger are kept together, so purging a ledger touches only its own
+ * records. A peer's number is recycled once it has disconnected and every
+ * record that could have its bit set has been purged.
  */
 
 namespace medida
@@ -31,26 +40,45 @@ namespace hcnet
 
 class Floodgate
 {
+    typedef uint32_t PeerIndex;
+
     class FloodRecord
     {
-      public:
-        typedef std::shared_ptr<FloodRecord> pointer;
+        std::vector<uint64_t> mPeersTold;
 
+      public:
         uint32_t mLedgerSeq;
-        HcnetMessage mMessage;
-        std::set<std::string> mPeersTold;
 
-        FloodRecord(HcnetMessage const& msg, uint32_t ledger,
-                    Peer::pointer peer);
+        explicit FloodRecord(uint32_t ledger);
+
+        // returns true if `peer` was not told yet
+        bool insert(PeerIndex peer);
+        bool contains(PeerIndex peer) const;
+        size_t count() const;
     };
 
-    std::map<Hash, FloodRecord::pointer> mFloodMap;
+    UnorderedMap<Hash, FloodRecord> mFloodMap;
+    // hashes of the records created for each ledger; may name records that
+    // were forgotten or recreated for a later ledger since
+    std::map<uint32_t, std::vector<Hash>> mGenerations;
+
+    UnorderedMap<std::string, PeerIndex> mPeerIndices;
+    PeerIndex mNextPeerIndex{0};
+    std::vector<PeerIndex> mFreePeerIndices;
+    // indices of disconnected peers and the last ledger whose records may
+    // still mention them
+    std::vector<std::pair<PeerIndex, uint32_t>> mRetiredPeerIndices;
+
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
     medida::Meter& mMessagesAdvertised;
     bool mShuttingDown;
 
+    PeerIndex getPeerIndex(Peer::pointer const& peer);
+    FloodRecord& newRecord(Hash const& index, uint32_t ledger);
+    void retireDisconnectedPeers();
+
   public:
     Floodgate(Application& app);
     // forget data strictly older than `maxLedger`
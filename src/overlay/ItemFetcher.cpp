@@ -33,7 +33,7 @@ ItemFetcher::fetch(Hash const& itemHash, const SCPEnvelope& envelope)
     if (entryIt == mTrackers.end())
     { // not being tracked
         TrackerPtr tracker =
-            std::make_shared<Tracker>(mApp, itemHash, mAskPeer);
+            std::make_shared<Tracker>(mApp, itemHash, mAskPeer, mReplyTimes);
         mTrackers[itemHash] = tracker;
 
         tracker->listen(envelope);
@@ -137,6 +137,17 @@ ItemFetcher::doesntHave(Hash const& itemHash, Peer::pointer peer)
     }
 }
 
+void
+ItemFetcher::replied(Hash const& itemHash, Peer::pointer peer)
+{
+    ZoneScoped;
+    const auto& iter = mTrackers.find(itemHash);
+    if (iter != mTrackers.end())
+    {
+        iter->second->replied(peer);
+    }
+}
+
 void
 ItemFetcher::recv(Hash itemHash, medida::Timer& timer)
 {
@@ -153,6 +164,7 @@ ItemFetcher::recv(Hash itemHash, medida::Timer& timer)
                    tracker->size());
 
         timer.Update(tracker->getDuration());
+        tracker->received();
         while (!tracker->empty())
         {
             mApp.getHerder().recvSCPEnvelope(tracker->pop());
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/Peer.h"
+#include "overlay/Tracker.h"
 #include "util/HashOfHash.h"
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
@@ -22,12 +23,9 @@ class Timer;
 namespace hcnet
 {
 
-class Tracker;
 class TxSetFrame;
 struct SCPQuorumSet;
 using SCPQuorumSetPtr = std::shared_ptr<SCPQuorumSet>;
-using AskPeer = std::function<void(Peer::pointer, Hash)>;
-
 /**
  * @class ItemFetcher
  *
@@ -84,6 +82,12 @@ class ItemFetcher : private NonMovableOrCopyable
      */
     void doesntHave(Hash const& itemHash, Peer::pointer peer);
 
+    /**
+     * Called when given @p peer sent data identified by @p itemHash, before
+     * it is processed.
+     */
+    void replied(Hash const& itemHash, Peer::pointer peer);
+
     /**
      * Called when data with given @p itemHash was received. All envelopes
      * added before with @see fetch and the same @p itemHash will be resent
@@ -103,5 +107,6 @@ class ItemFetcher : private NonMovableOrCopyable
 
   private:
     AskPeer mAskPeer;
+    FetchReplyTimes mReplyTimes;
 };
 }
@@ -0,0 +1,214 @@
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/OverlayCompression.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+#include <stdexcept>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace hcnet
+{
+
+namespace
+{
+#ifdef USE_ZLIB
+// Favor latency: tx sets are compressed on the main thread right before
+// being sent, and most of their bytes are keys and signatures that no level
+// compresses much further.
+int const COMPRESSION_LEVEL = Z_BEST_SPEED;
+#endif
+
+// deflate cannot encode more than about 1032 bytes per input byte, so a
+// larger claimed size is a lie that must not size the output buffer.
+size_t const MAX_COMPRESSION_RATIO = 1032;
+
+// The XDR encodings of five v1 transaction envelopes with zero-filled fields
+// except for a fee of 100, time bounds preconditions, one operation and one
+// signature. Their operations are, in order: CHANGE_TRUST to an alphanum4
+// asset, MANAGE_SELL_OFFER selling an alphanum4 asset, PAYMENT of an
+// alphanum4 asset, PAYMENT of the native asset and CREATE_ACCOUNT. zlib
+// favors matches near the end of the dictionary, so the most common operation
+// goes last. These bytes are part of the overlay protocol: they must not
+// change with the XDR definitions.
+unsigned char const DICTIONARY[] = {
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+}
+
+ByteSlice
+overlayCompressionDictionary()
+{
+    return ByteSlice(DICTIONARY, sizeof(DICTIONARY));
+}
+
+bool
+isCompressibleMessage(MessageType type)
+{
+    return type == TX_SET || type == GENERALIZED_TX_SET ||
+           type == SCP_QUORUMSET;
+}
+
+std::optional<CompressedMessage>
+compressMessage(ByteSlice const& raw)
+{
+    ZoneScoped;
+#ifndef USE_ZLIB
+    return std::nullopt;
+#else
+    auto dict = overlayCompressionDictionary();
+    z_stream zs{};
+    if (deflateInit(&zs, COMPRESSION_LEVEL) != Z_OK)
+    {
+        return std::nullopt;
+    }
+
+    CompressedMessage res;
+    res.uncompressedSize = static_cast<uint32>(raw.size());
+    res.data.resize(deflateBound(&zs, static_cast<uLong>(raw.size())));
+    zs.next_in = const_cast<Bytef*>(raw.data());
+    zs.avail_in = static_cast<uInt>(raw.size());
+    zs.next_out = res.data.data();
+    zs.avail_out = static_cast<uInt>(res.data.size());
+    int ret = deflateSetDictionary(&zs, dict.data(),
+                                   static_cast<uInt>(dict.size()));
+    if (ret == Z_OK)
+    {
+        ret = deflate(&zs, Z_FINISH);
+    }
+    auto written = zs.total_out;
+    deflateEnd(&zs);
+
+    if (ret != Z_STREAM_END || written >= raw.size())
+    {
+        return std::nullopt;
+    }
+    res.data.resize(written);
+    return res;
+#endif
+}
+
+xdr::opaque_vec<>
+decompressMessage(CompressedMessage const& msg)
+{
+    ZoneScoped;
+    if (msg.uncompressedSize > MAX_UNCOMPRESSED_MESSAGE_SIZE)
+    {
+        throw std::runtime_error(fmt::format(
+            "compressed message too large: {} bytes", msg.uncompressedSize));
+    }
+    if (msg.uncompressedSize > msg.data.size() * MAX_COMPRESSION_RATIO)
+    {
+        throw std::runtime_error(fmt::format(
+            "compressed message claims {} bytes from {} bytes of data",
+            msg.uncompressedSize, msg.data.size()));
+    }
+
+#ifndef USE_ZLIB
+    throw std::runtime_error("built without overlay compression support");
+#else
+    z_stream zs{};
+    if (inflateInit(&zs) != Z_OK)
+    {
+        throw std::runtime_error("could not initialize zlib");
+    }
+
+    xdr::opaque_vec<> res(msg.uncompressedSize);
+    zs.next_in = const_cast<Bytef*>(msg.data.data());
+    zs.avail_in = static_cast<uInt>(msg.data.size());
+    zs.next_out = res.data();
+    zs.avail_out = static_cast<uInt>(res.size());
+    int ret = inflate(&zs, Z_FINISH);
+    if (ret == Z_NEED_DICT)
+    {
+        auto dict = overlayCompressionDictionary();
+        ret = inflateSetDictionary(&zs, dict.data(),
+                                   static_cast<uInt>(dict.size()));
+        if (ret == Z_OK)
+        {
+            ret = inflate(&zs, Z_FINISH);
+        }
+    }
+    bool complete = ret == Z_STREAM_END && zs.avail_in == 0 &&
+                    zs.total_out == msg.uncompressedSize;
+    inflateEnd(&zs);
+
+    if (!complete)
+    {
+        throw std::runtime_error("corrupt compressed message");
+    }
+    return res;
+#endif
+}
+}
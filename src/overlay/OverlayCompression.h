@@ -0,0 +1,48 @@
+#pragma once
+
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/ByteSlice.h"
+#include "overlay/HcnetXDR.h"
+#include <optional>
+
+namespace hcnet
+{
+
+// Large overlay messages can be sent as COMPRESSED_MESSAGE to peers that
+// negotiated compression. Payloads are zlib streams primed with a fixed
+// dictionary of transaction XDR, so the framing that every transaction shares
+// (envelope and operation discriminants, account key types, zero padding)
+// compresses well even in small messages. Both ends must use the same
+// dictionary: changing it requires a new overlay version.
+//
+// Compression needs zlib. Builds without USE_ZLIB (such as the Visual Studio
+// one) never negotiate it, and reject ENABLE_OVERLAY_COMPRESSION.
+
+#ifdef USE_ZLIB
+static constexpr bool OVERLAY_COMPRESSION_AVAILABLE = true;
+#else
+static constexpr bool OVERLAY_COMPRESSION_AVAILABLE = false;
+#endif
+
+// Upper bound on the decoded size of a compressed message, matching the
+// largest message TCPPeer accepts.
+static constexpr size_t MAX_UNCOMPRESSED_MESSAGE_SIZE = 0x1000000;
+
+// Message types worth compressing: large, and sent to a single peer in
+// reply to a fetch rather than flooded with a shared encoding.
+bool isCompressibleMessage(MessageType type);
+
+// Returns the compressed form of the XDR-encoded message `raw`, or nullopt if
+// it would not be smaller.
+std::optional<CompressedMessage> compressMessage(ByteSlice const& raw);
+
+// Returns the XDR encoding held by `msg`. Throws std::runtime_error if `msg`
+// is corrupt or does not decode to exactly msg.uncompressedSize bytes.
+xdr::opaque_vec<> decompressMessage(CompressedMessage const& msg);
+
+// The preset dictionary; exposed for tests.
+ByteSlice overlayCompressionDictionary();
+}
@@ -194,6 +194,10 @@ class OverlayManager
 
     virtual void recordTxPullLatency(Hash const& hash) = 0;
 
+    // Makes the transaction hash known to every compact-advert peer, so that
+    // short ids referring to it can be resolved without a round trip.
+    virtual void rememberTxHash(Hash const& txHash) = 0;
+
     virtual size_t getMaxAdvertSize() const = 0;
 
     virtual ~OverlayManager()
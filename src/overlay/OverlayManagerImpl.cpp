@@ -906,7 +906,9 @@ bool
 OverlayManagerImpl::isFloodMessage(HcnetMessage const& msg)
 {
     return msg.type() == SCP_MESSAGE || msg.type() == TRANSACTION ||
-           msg.type() == FLOOD_DEMAND || msg.type() == FLOOD_ADVERT;
+           msg.type() == FLOOD_DEMAND || msg.type() == FLOOD_ADVERT ||
+           msg.type() == FLOOD_ADVERT_SHORT || msg.type() == FLOOD_EXPAND ||
+           msg.type() == FLOOD_DEMAND_SHORT;
 }
 std::vector<Peer::pointer>
 OverlayManagerImpl::getRandomAuthenticatedPeers()
@@ -1190,6 +1192,22 @@ OverlayManagerImpl::recordTxPullLatency(Hash const& hash)
     }
 }
 
+void
+OverlayManagerImpl::rememberTxHash(Hash const& txHash)
+{
+    for (auto const& peers :
+         {&mInboundPeers.mAuthenticated, &mOutboundPeers.mAuthenticated})
+    {
+        for (auto const& peer : *peers)
+        {
+            if (peer.second->isCompactAdvertsEnabled())
+            {
+                peer.second->rememberTxHash(txHash);
+            }
+        }
+    }
+}
+
 std::chrono::milliseconds
 OverlayManagerImpl::retryDelayDemand(int numAttemptsMade) const
 {
@@ -1282,6 +1300,22 @@ OverlayManagerImpl::demand()
 
     auto const& cfg = mApp.getConfig();
 
+    // Short ids matching no known transaction can't be told apart across
+    // peers. Only the first peer is asked for them right away; the others
+    // are asked once their ids have waited a backoff delay, by which time a
+    // transaction received meanwhile resolves them to a full hash instead.
+    bool demandedShortIds = false;
+    for (auto const& peer : pullModePeers)
+    {
+        if (peer->isCompactAdvertsEnabled())
+        {
+            demandedShortIds |= peer->demandTxShortIds(
+                demandedShortIds ? now - cfg.FLOOD_DEMAND_BACKOFF_DELAY_MS
+                                 : now,
+                getMaxDemandSize());
+        }
+    }
+
     UnorderedMap<Peer::pointer, std::pair<TxDemandVector, std::list<Hash>>>
         demandMap;
     bool anyNewDemand = false;
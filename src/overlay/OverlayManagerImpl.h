@@ -186,6 +186,7 @@ class OverlayManagerImpl : public OverlayManager
                            HcnetMessage const& newMsg) override;
 
     void recordTxPullLatency(Hash const& hash) override;
+    void rememberTxHash(Hash const& txHash) override;
     size_t getMaxAdvertSize() const override;
 
   private:
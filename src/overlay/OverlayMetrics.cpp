@@ -35,6 +35,10 @@ OverlayMetrics::OverlayMetrics(Application& app)
 
     , mItemFetcherNextPeer(app.getMetrics().NewMeter(
           {"overlay", "item-fetcher", "next-peer"}, "item-fetcher"))
+    , mItemFetcherHedge(app.getMetrics().NewMeter(
+          {"overlay", "item-fetcher", "hedge"}, "item-fetcher"))
+    , mItemFetcherReplyTimer(
+          app.getMetrics().NewTimer({"overlay", "item-fetcher", "reply"}))
 
     , mRecvErrorTimer(app.getMetrics().NewTimer({"overlay", "recv", "error"}))
     , mRecvHelloTimer(app.getMetrics().NewTimer({"overlay", "recv", "hello"}))
@@ -78,6 +82,12 @@ OverlayMetrics::OverlayMetrics(Application& app)
           app.getMetrics().NewTimer({"overlay", "recv", "flood-advert"}))
     , mRecvFloodDemandTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "flood-demand"}))
+    , mRecvFloodAdvertShortTimer(app.getMetrics().NewTimer(
+          {"overlay", "recv", "flood-advert-short"}))
+    , mRecvFloodExpandTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-expand"}))
+    , mRecvFloodDemandShortTimer(app.getMetrics().NewTimer(
+          {"overlay", "recv", "flood-demand-short"}))
 
     , mMessageDelayInWriteQueueTimer(
           app.getMetrics().NewTimer({"overlay", "delay", "write-queue"}))
@@ -100,6 +110,11 @@ OverlayMetrics::OverlayMetrics(Application& app)
           {"overlay", "outbound-queue", "drop-advert"}, "message"))
     , mOutboundQueueDropDemand(app.getMetrics().NewMeter(
           {"overlay", "outbound-queue", "drop-demand"}, "message"))
+    , mWriteQueueDepth{
+          &app.getMetrics().NewCounter({"overlay", "write-queue", "scp"}),
+          &app.getMetrics().NewCounter({"overlay", "write-queue", "fetch"}),
+          &app.getMetrics().NewCounter({"overlay", "write-queue", "demand"}),
+          &app.getMetrics().NewCounter({"overlay", "write-queue", "flood"})}
     , mSendErrorMeter(
           app.getMetrics().NewMeter({"overlay", "send", "error"}, "message"))
     , mSendHelloMeter(
@@ -136,6 +151,24 @@ OverlayMetrics::OverlayMetrics(Application& app)
           {"overlay", "send", "flood-advert"}, "message"))
     , mSendFloodDemandMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "flood-demand"}, "message"))
+    , mSendFloodAdvertShortMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-advert-short"}, "message"))
+    , mSendFloodExpandMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-expand"}, "message"))
+    , mSendFloodDemandShortMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-demand-short"}, "message"))
+    , mTxShortIdsExpanded(app.getMetrics().NewMeter(
+          {"overlay", "flood", "expanded"}, "transaction"))
+    , mCompressionSendRawBytes(app.getMetrics().NewMeter(
+          {"overlay", "compression", "send-raw"}, "byte"))
+    , mCompressionSendWireBytes(app.getMetrics().NewMeter(
+          {"overlay", "compression", "send-wire"}, "byte"))
+    , mCompressionRecvRawBytes(app.getMetrics().NewMeter(
+          {"overlay", "compression", "recv-raw"}, "byte"))
+    , mCompressionRecvWireBytes(app.getMetrics().NewMeter(
+          {"overlay", "compression", "recv-wire"}, "byte"))
+    , mMacSignTimer(app.getMetrics().NewTimer({"overlay", "mac", "sign"}))
+    , mMacVerifyTimer(app.getMetrics().NewTimer({"overlay", "mac", "verify"}))
     , mMessagesDemanded(app.getMetrics().NewMeter(
           {"overlay", "flood", "demanded"}, "message"))
     , mMessagesFulfilledMeter(app.getMetrics().NewMeter(
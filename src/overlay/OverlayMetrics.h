@@ -7,6 +7,8 @@
 // This structure just exists to cache frequently-accessed, overlay-wide
 // (non-peer-specific) metrics.
 
+#include <array>
+
 namespace medida
 {
 class Timer;
@@ -36,6 +38,8 @@ struct OverlayMetrics
     medida::Timer& mConnectionLatencyTimer;
 
     medida::Meter& mItemFetcherNextPeer;
+    medida::Meter& mItemFetcherHedge;
+    medida::Timer& mItemFetcherReplyTimer;
 
     medida::Timer& mRecvErrorTimer;
     medida::Timer& mRecvHelloTimer;
@@ -62,6 +66,9 @@ struct OverlayMetrics
 
     medida::Timer& mRecvFloodAdvertTimer;
     medida::Timer& mRecvFloodDemandTimer;
+    medida::Timer& mRecvFloodAdvertShortTimer;
+    medida::Timer& mRecvFloodExpandTimer;
+    medida::Timer& mRecvFloodDemandShortTimer;
 
     medida::Timer& mMessageDelayInWriteQueueTimer;
     medida::Timer& mMessageDelayInAsyncWriteTimer;
@@ -75,6 +82,9 @@ struct OverlayMetrics
     medida::Meter& mOutboundQueueDropAdvert;
     medida::Meter& mOutboundQueueDropDemand;
 
+    // Messages waiting in peer write queues, by WriteQueueClass
+    std::array<medida::Counter*, 4> mWriteQueueDepth;
+
     medida::Meter& mSendErrorMeter;
     medida::Meter& mSendHelloMeter;
     medida::Meter& mSendAuthMeter;
@@ -95,6 +105,17 @@ struct OverlayMetrics
 
     medida::Meter& mSendFloodAdvertMeter;
     medida::Meter& mSendFloodDemandMeter;
+    medida::Meter& mSendFloodAdvertShortMeter;
+    medida::Meter& mSendFloodExpandMeter;
+    medida::Meter& mSendFloodDemandShortMeter;
+    medida::Meter& mTxShortIdsExpanded;
+
+    medida::Meter& mCompressionSendRawBytes;
+    medida::Meter& mCompressionSendWireBytes;
+    medida::Meter& mCompressionRecvRawBytes;
+    medida::Meter& mCompressionRecvWireBytes;
+    medida::Timer& mMacSignTimer;
+    medida::Timer& mMacVerifyTimer;
     medida::Meter& mMessagesDemanded;
     medida::Meter& mMessagesFulfilledMeter;
     medida::Meter& mBannedMessageUnfulfilledMeter;
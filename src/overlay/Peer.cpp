@@ -5,6 +5,7 @@
 #include "overlay/Peer.h"
 
 #include "BanManager.h"
+#include "crypto/BLAKE2.h"
 #include "crypto/CryptoError.h"
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
@@ -15,6 +16,7 @@
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "overlay/OverlayCompression.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayMetrics.h"
 #include "overlay/PeerAuth.h"
@@ -26,6 +28,7 @@
 #include "util/Logging.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDROperators.h"
+#include "util/siphash.h"
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
@@ -49,10 +52,37 @@ using namespace soci;
 static constexpr VirtualClock::time_point PING_NOT_SENT =
     VirtualClock::time_point::min();
 
+// Number of tx hashes (or short ids) carried by a queued advert or demand.
+static size_t
+advertTxHashCount(HcnetMessage const& msg)
+{
+    if (msg.type() == FLOOD_ADVERT)
+    {
+        return msg.floodAdvert().txHashes.size();
+    }
+    return msg.floodAdvertShort().txShortIds.size();
+}
+
+static size_t
+demandTxHashCount(HcnetMessage const& msg)
+{
+    if (msg.type() == FLOOD_DEMAND)
+    {
+        return msg.floodDemand().txHashes.size();
+    }
+    if (msg.type() == FLOOD_DEMAND_SHORT)
+    {
+        return msg.floodDemandShort().txShortIds.size();
+    }
+    return msg.floodExpand().txShortIds.size();
+}
+
 Peer::Peer(Application& app, PeerRole role)
     : mApp(app)
     , mRole(role)
     , mState(role == WE_CALLED_REMOTE ? CONNECTING : CONNECTED)
+    , mAutotune{app.getConfig().PEER_FLOOD_READING_CAPACITY,
+                app.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE}
     , mRemoteOverlayMinVersion(0)
     , mRemoteOverlayVersion(0)
     , mCreationTime(app.getClock().now())
@@ -67,6 +97,7 @@ Peer::Peer(Application& app, PeerRole role)
     , mCapacity{app.getConfig().PEER_FLOOD_READING_CAPACITY,
                 app.getConfig().PEER_READING_CAPACITY}
     , mTxAdvertQueue(app)
+    , mShortIds(COMPACT_ADVERT_SHORT_ID_CACHE_SIZE)
     , mAdvertTimer(app)
 {
     mPingSentTime = PING_NOT_SENT;
@@ -113,6 +144,7 @@ Peer::MsgCapacityTracker::MsgCapacityTracker(std::weak_ptr<Peer> peer,
     {
         throw std::runtime_error("Invalid peer");
     }
+    mReceivedTime = self->mApp.getClock().now();
     self->beginMesssageProcessing(mMsg);
 }
 
@@ -121,7 +153,7 @@ Peer::MsgCapacityTracker::~MsgCapacityTracker()
     auto self = mWeakPeer.lock();
     if (self)
     {
-        self->endMessageProcessing(mMsg);
+        self->endMessageProcessing(mMsg, mReceivedTime);
     }
 }
 
@@ -278,6 +310,16 @@ Peer::getFlowControlJsonInfo(bool compact) const
             (Json::UInt64)mCapacity.mTotalCapacity;
         res["local_capacity"]["flood"] = (Json::UInt64)mCapacity.mFloodCapacity;
         res["peer_capacity"] = (Json::UInt64)mOutboundCapacity;
+        if (mApp.getConfig().FLOW_CONTROL_AUTOTUNE)
+        {
+            auto& at = res["autotune"];
+            at["window"] = (Json::UInt64)mAutotune.mWindow;
+            at["batch_size"] = (Json::UInt64)mAutotune.mBatchSize;
+            at["debt"] = (Json::UInt64)mAutotune.mDebt;
+            at["delivery_rate"] = mAutotune.mDeliveryRate;
+            at["processing_latency"] =
+                (Json::UInt64)mAutotune.mProcessingLatency.count();
+        }
     }
 
     if (!compact)
@@ -313,6 +355,9 @@ Peer::getJsonInfo(bool compact) const
     res["olver"] = (int)getRemoteOverlayVersion();
     res["flow_control"] = getFlowControlJsonInfo(compact);
     res["pull_mode"] = isPullModeEnabled();
+    res["compact_adverts"] = isCompactAdvertsEnabled();
+    res["compression"] = isCompressionEnabled();
+    res["blake2_mac"] = isBlake2MacEnabled();
     if (!compact)
     {
         res["message_read"] =
@@ -355,9 +400,31 @@ Peer::sendAuth()
     ZoneScoped;
     HcnetMessage msg;
     msg.type(AUTH);
-    if (mApp.getConfig().ENABLE_PULL_MODE)
+    auto const& cfg = mApp.getConfig();
+    if (cfg.ENABLE_PULL_MODE)
+    {
+        // Older peers only recognize AUTH_MSG_FLAG_PULL_MODE_REQUESTED.
+        bool compact = cfg.ENABLE_COMPACT_ADVERTS &&
+                       cfg.OVERLAY_PROTOCOL_VERSION >=
+                           Peer::FIRST_VERSION_SUPPORTING_COMPACT_ADVERTS &&
+                       mRemoteOverlayVersion >=
+                           Peer::FIRST_VERSION_SUPPORTING_COMPACT_ADVERTS;
+        msg.auth().flags = compact ? AUTH_MSG_FLAG_COMPACT_ADVERTS_REQUESTED
+                                   : AUTH_MSG_FLAG_PULL_MODE_REQUESTED;
+    }
+    if (OVERLAY_COMPRESSION_AVAILABLE && cfg.ENABLE_OVERLAY_COMPRESSION &&
+        cfg.OVERLAY_PROTOCOL_VERSION >=
+            Peer::FIRST_VERSION_SUPPORTING_COMPRESSION &&
+        mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_COMPRESSION)
+    {
+        msg.auth().flags |= AUTH_MSG_FLAG_COMPRESSION_REQUESTED;
+    }
+    if (cfg.ENABLE_OVERLAY_BLAKE2_MAC &&
+        cfg.OVERLAY_PROTOCOL_VERSION >=
+            Peer::FIRST_VERSION_SUPPORTING_BLAKE2_MAC &&
+        mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_BLAKE2_MAC)
     {
-        msg.auth().flags = AUTH_MSG_FLAG_PULL_MODE_REQUESTED;
+        msg.auth().flags |= AUTH_MSG_FLAG_BLAKE2_MAC_REQUESTED;
     }
     auto msgPtr = std::make_shared<HcnetMessage const>(msg);
     sendMessage(msgPtr);
@@ -584,12 +651,27 @@ Peer::msgSummary(HcnetMessage const& msg)
         return "FLODADVERT";
     case FLOOD_DEMAND:
         return "FLOODDEMAND";
+    case FLOOD_ADVERT_SHORT:
+        return "FLOODADVERTSHORT";
+    case FLOOD_EXPAND:
+        return "FLOODEXPAND";
+    case FLOOD_DEMAND_SHORT:
+        return "FLOODDEMANDSHORT";
+    case COMPRESSED_MESSAGE:
+        return "COMPRESSED";
     }
     return "UNKNOWN";
 }
 
 void
 Peer::sendMessage(std::shared_ptr<HcnetMessage const> msg, bool log)
+{
+    sendMessage(std::move(msg), nullptr, log);
+}
+
+void
+Peer::sendMessage(std::shared_ptr<HcnetMessage const> msg,
+                  EncodedMessage encoded, bool log)
 {
     ZoneScoped;
     CLOG_TRACE(Overlay, "send: {} to : {}", msgSummary(*msg),
@@ -668,6 +750,18 @@ Peer::sendMessage(std::shared_ptr<HcnetMessage const> msg, bool log)
     case FLOOD_DEMAND:
         getOverlayMetrics().mSendFloodDemandMeter.Mark();
         break;
+    case FLOOD_ADVERT_SHORT:
+        getOverlayMetrics().mSendFloodAdvertShortMeter.Mark();
+        break;
+    case FLOOD_EXPAND:
+        getOverlayMetrics().mSendFloodExpandMeter.Mark();
+        break;
+    case FLOOD_DEMAND_SHORT:
+        getOverlayMetrics().mSendFloodDemandShortMeter.Mark();
+        break;
+    case COMPRESSED_MESSAGE:
+        // Only built by sendAuthenticatedMessage, and counted there.
+        break;
     };
 
     if (mApp.getOverlayManager().isFloodMessage(*msg))
@@ -680,34 +774,89 @@ Peer::sendMessage(std::shared_ptr<HcnetMessage const> msg, bool log)
         }
         else if (flowControl == Peer::FlowControlState::ENABLED)
         {
-            addMsgAndMaybeTrimQueue(msg);
+            addMsgAndMaybeTrimQueue(msg, std::move(encoded));
             maybeSendNextBatch();
             return;
         }
     }
 
-    sendAuthenticatedMessage(*msg);
+    sendAuthenticatedMessage(*msg, encoded);
+}
+
+xdr::msg_ptr
+Peer::authenticatedMessageBytes(HmacSha256Key const& macKey, uint64_t sequence,
+                                xdr::opaque_vec<> const& encoded,
+                                bool blake2MacEnabled)
+{
+    ZoneScoped;
+    // AuthenticatedMessage v0 is the union discriminant, the sequence, the
+    // message and the MAC; the MAC covers the sequence and the message, which
+    // are contiguous in the output.
+    size_t const macOffset = 4;
+    size_t const macInputSize = 8 + encoded.size();
+    auto xdrBytes =
+        xdr::message_t::alloc(macOffset + macInputSize + sizeof(HmacSha256Mac));
+    xdr::xdr_put put(xdrBytes);
+    put(uint32_t(0));
+    put(sequence);
+    put.check(encoded.size());
+    put.put_bytes(put.p_, encoded.data(), encoded.size());
+    ByteSlice macInput(xdrBytes->data() + macOffset, macInputSize);
+    auto mac = blake2MacEnabled && sequence > 0
+                   ? blake2Mac(macKey, macInput)
+                   : hmacSha256(macKey, macInput);
+    put(mac);
+    releaseAssert(put.p_ == put.e_);
+    return xdrBytes;
 }
 
 void
-Peer::sendAuthenticatedMessage(HcnetMessage const& msg)
+Peer::sendAuthenticatedMessage(HcnetMessage const& msg,
+                               EncodedMessage const& encoded)
 {
-    AuthenticatedMessage amsg;
-    amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
+    if (msg.type() == HELLO || msg.type() == ERROR_MSG)
     {
-        ZoneNamedN(hmacZone, "message HMAC", true);
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
-        ++mSendMacSeq;
+        AuthenticatedMessage amsg;
+        amsg.v0().message = msg;
+        xdr::msg_ptr xdrBytes;
+        {
+            ZoneNamedN(xdrZone, "XDR serialize", true);
+            xdrBytes = xdr::xdr_to_msg(amsg);
+        }
+        this->sendMessage(std::move(xdrBytes), msg.type());
     }
-    xdr::msg_ptr xdrBytes;
+    else if (encoded)
     {
-        ZoneNamedN(xdrZone, "XDR serialize", true);
-        xdrBytes = xdr::xdr_to_msg(amsg);
+        sendAuthenticatedBody(encoded, msg.type());
     }
-    this->sendMessage(std::move(xdrBytes));
+    else
+    {
+        xdr::opaque_vec<> body;
+        {
+            ZoneNamedN(xdrZone, "XDR serialize", true);
+            body = xdr::xdr_to_opaque(msg);
+        }
+        maybeCompress(msg.type(), body);
+        sendAuthenticatedBody(
+            std::make_shared<xdr::opaque_vec<> const>(std::move(body)),
+            msg.type());
+    }
+}
+
+void
+Peer::sendAuthenticatedBody(EncodedMessage body, MessageType type)
+{
+    this->sendMessage(authenticateBody(*body), type);
+}
+
+xdr::msg_ptr
+Peer::authenticateBody(xdr::opaque_vec<> const& body)
+{
+    auto timer = getOverlayMetrics().mMacSignTimer.TimeScope();
+    auto xdrBytes = authenticatedMessageBytes(mSendMacKey, mSendMacSeq, body,
+                                              mBlake2MacEnabled);
+    ++mSendMacSeq;
+    return xdrBytes;
 }
 
 void
@@ -764,8 +913,18 @@ Peer::shouldAbort() const
     return (mState == CLOSING) || mApp.getOverlayManager().isShuttingDown();
 }
 
+bool
+Peer::verifyMac(AuthenticatedMessage const& msg, HmacSha256Key const& macKey,
+                bool blake2MacEnabled)
+{
+    auto macInput = xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message);
+    return blake2MacEnabled && msg.v0().sequence > 0
+               ? blake2MacVerify(msg.v0().mac, macKey, macInput)
+               : hmacSha256Verify(msg.v0().mac, macKey, macInput);
+}
+
 void
-Peer::recvMessage(AuthenticatedMessage const& msg)
+Peer::recvMessage(AuthenticatedMessage const& msg, std::optional<bool> macValid)
 {
     ZoneScoped;
     if (shouldAbort())
@@ -783,9 +942,12 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
             return;
         }
 
-        if (!hmacSha256Verify(
-                msg.v0().mac, mRecvMacKey,
-                xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+        if (!macValid)
+        {
+            auto timer = getOverlayMetrics().mMacVerifyTimer.TimeScope();
+            macValid = verifyMac(msg, mRecvMacKey, mBlake2MacEnabled);
+        }
+        if (!*macValid)
         {
             ++mRecvMacSeq;
             sendErrorAndDrop(ERR_AUTH, "unexpected MAC",
@@ -817,6 +979,11 @@ Peer::recvMessage(HcnetMessage const& hcnetMsg)
     case AUTH:
         Peer::recvRawMessage(hcnetMsg);
         return;
+    // unwrapped here, so the message is scheduled and flow controlled by the
+    // type it carries
+    case COMPRESSED_MESSAGE:
+        recvCompressedMessage(hcnetMsg);
+        return;
     case SEND_MORE:
     {
         if (mRemoteOverlayVersion < Peer::FIRST_VERSION_SUPPORTING_FLOW_CONTROL)
@@ -881,6 +1048,9 @@ Peer::recvMessage(HcnetMessage const& hcnetMsg)
     case TRANSACTION:
     case FLOOD_ADVERT:
     case FLOOD_DEMAND:
+    case FLOOD_ADVERT_SHORT:
+    case FLOOD_EXPAND:
+    case FLOOD_DEMAND_SHORT:
     {
         if (!mPullModeEnabled &&
             (msgType == FLOOD_ADVERT || msgType == FLOOD_DEMAND))
@@ -891,6 +1061,16 @@ Peer::recvMessage(HcnetMessage const& hcnetMsg)
                  Peer::DropMode::IGNORE_WRITE_QUEUE);
             return;
         }
+        if (!mCompactAdvertsEnabled &&
+            (msgType == FLOOD_ADVERT_SHORT || msgType == FLOOD_EXPAND ||
+             msgType == FLOOD_DEMAND_SHORT))
+        {
+            drop(fmt::format("Peer sent {}, but compact adverts are disabled",
+                             xdr::xdr_traits<MessageType>::enum_name(msgType)),
+                 Peer::DropDirection::WE_DROPPED_REMOTE,
+                 Peer::DropMode::IGNORE_WRITE_QUEUE);
+            return;
+        }
 
         cat = "TX";
         type = Scheduler::ActionType::DROPPABLE_ACTION;
@@ -943,7 +1123,7 @@ Peer::recvMessage(HcnetMessage const& hcnetMsg)
 
             try
             {
-                self->recvRawMessage(msgTracker->getMessage());
+                self->recvRawMessage(msgTracker->getMessage(), msgTracker);
             }
             catch (CryptoError const& e)
             {
@@ -997,7 +1177,7 @@ bool
 Peer::hasReadingCapacity() const
 {
     return flowControlEnabled() != Peer::FlowControlState::ENABLED ||
-           mCapacity.mTotalCapacity > 0;
+           mCapacity.mTotalCapacity > mMessagesBeingDecoded;
 }
 
 Peer::FlowControlState
@@ -1016,7 +1196,8 @@ Peer::flowControlEnabled() const
 }
 
 void
-Peer::addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg)
+Peer::addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg,
+                              EncodedMessage encoded)
 {
     ZoneScoped;
 
@@ -1036,17 +1217,18 @@ Peer::addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg)
     }
     break;
     case FLOOD_DEMAND:
+    case FLOOD_EXPAND:
+    case FLOOD_DEMAND_SHORT:
     {
         msgQInd = 2;
-        size_t s = msg->floodDemand().txHashes.size();
-        mDemandQueueTxHashCount += s;
+        mDemandQueueTxHashCount += demandTxHashCount(*msg);
     }
     break;
     case FLOOD_ADVERT:
+    case FLOOD_ADVERT_SHORT:
     {
         msgQInd = 3;
-        size_t s = msg->floodAdvert().txHashes.size();
-        mAdvertQueueTxHashCount += s;
+        mAdvertQueueTxHashCount += advertTxHashCount(*msg);
     }
     break;
     default:
@@ -1054,7 +1236,8 @@ Peer::addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg)
     }
     auto& queue = mOutboundQueues[msgQInd];
 
-    queue.emplace_back(QueuedOutboundMessage{msg, mApp.getClock().now()});
+    queue.emplace_back(
+        QueuedOutboundMessage{msg, mApp.getClock().now(), std::move(encoded)});
 
     size_t dropped = 0;
 
@@ -1103,24 +1286,25 @@ Peer::addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg)
         }
         getOverlayMetrics().mOutboundQueueDropSCP.Mark(dropped);
     }
-    else if (type == FLOOD_ADVERT)
+    else if (type == FLOOD_ADVERT || type == FLOOD_ADVERT_SHORT)
     {
         while (mAdvertQueueTxHashCount > limit)
         {
             dropped++;
-            size_t s = queue.front().mMessage->floodAdvert().txHashes.size();
+            size_t s = advertTxHashCount(*queue.front().mMessage);
             releaseAssert(mAdvertQueueTxHashCount >= s);
             mAdvertQueueTxHashCount -= s;
             queue.pop_front();
         }
         getOverlayMetrics().mOutboundQueueDropAdvert.Mark(dropped);
     }
-    else if (type == FLOOD_DEMAND)
+    else if (type == FLOOD_DEMAND || type == FLOOD_EXPAND ||
+             type == FLOOD_DEMAND_SHORT)
     {
         while (mDemandQueueTxHashCount > limit)
         {
             dropped++;
-            size_t s = queue.front().mMessage->floodDemand().txHashes.size();
+            size_t s = demandTxHashCount(*queue.front().mMessage);
             releaseAssert(mDemandQueueTxHashCount >= s);
             mDemandQueueTxHashCount -= s;
             queue.pop_front();
@@ -1150,7 +1334,7 @@ Peer::maybeSendNextBatch()
         while (!queue.empty() && mOutboundCapacity > 0)
         {
             auto& front = queue.front();
-            sendAuthenticatedMessage(*(front.mMessage));
+            sendAuthenticatedMessage(*(front.mMessage), front.mEncoded);
             auto& om = mApp.getOverlayManager().getOverlayMetrics();
 
             auto const& diff = mApp.getClock().now() - front.mTimeEmplaced;
@@ -1170,19 +1354,22 @@ Peer::maybeSendNextBatch()
             }
             break;
             case FLOOD_DEMAND:
+            case FLOOD_EXPAND:
+            case FLOOD_DEMAND_SHORT:
             {
                 om.mOutboundQueueDelayDemand.Update(diff);
                 mPeerMetrics.mOutboundQueueDelayDemand.Update(diff);
-                size_t s = front.mMessage->floodDemand().txHashes.size();
+                size_t s = demandTxHashCount(*front.mMessage);
                 releaseAssert(mDemandQueueTxHashCount >= s);
                 mDemandQueueTxHashCount -= s;
             }
             break;
             case FLOOD_ADVERT:
+            case FLOOD_ADVERT_SHORT:
             {
                 om.mOutboundQueueDelayAdvert.Update(diff);
                 mPeerMetrics.mOutboundQueueDelayAdvert.Update(diff);
-                size_t s = front.mMessage->floodAdvert().txHashes.size();
+                size_t s = advertTxHashCount(*front.mMessage);
                 releaseAssert(mAdvertQueueTxHashCount >= s);
                 mAdvertQueueTxHashCount -= s;
             }
@@ -1207,36 +1394,143 @@ Peer::maybeSendNextBatch()
                (oldOutboundCapacity - mOutboundCapacity));
 }
 
+uint64_t
+Peer::getSendMoreBatchSize() const
+{
+    return mApp.getConfig().FLOW_CONTROL_AUTOTUNE
+               ? mAutotune.mBatchSize
+               : mApp.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+}
+
 void
-Peer::endMessageProcessing(HcnetMessage const& msg)
+Peer::maybeAutotuneFlowControl(std::chrono::nanoseconds latency)
 {
-    if (shouldAbort() ||
-        flowControlEnabled() != Peer::FlowControlState::ENABLED)
+    auto& at = mAutotune;
+    at.mIntervalMsgs++;
+    at.mIntervalLatency += latency;
+
+    // Until the first ping completes, getPing() reports a placeholder and
+    // there is no RTT to size the window by
+    auto rtt = getPing();
+    auto now = mApp.getClock().now();
+    auto elapsed = now - at.mIntervalStart;
+    if (rtt >= std::chrono::hours(24) ||
+        elapsed < std::max<VirtualClock::duration>(
+                      rtt, FLOW_CONTROL_AUTOTUNE_MIN_INTERVAL))
+    {
+        return;
+    }
+
+    auto const& cfg = mApp.getConfig();
+    double secs = std::chrono::duration<double>(elapsed).count();
+    at.mDeliveryRate = at.mIntervalMsgs / secs;
+    at.mProcessingLatency =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            at.mIntervalLatency / at.mIntervalMsgs);
+    double bdp =
+        at.mDeliveryRate *
+        std::chrono::duration<double>(rtt + at.mProcessingLatency).count();
+    at.mIntervalStart = now;
+    at.mIntervalMsgs = 0;
+    at.mIntervalLatency = std::chrono::nanoseconds(0);
+
+    uint64_t const minWindow = cfg.FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+    uint64_t const maxWindow =
+        cfg.PEER_FLOOD_READING_CAPACITY * FLOW_CONTROL_AUTOTUNE_MAX_GROWTH;
+    // Shrinking the window repeatedly can leave more debt than window
+    uint64_t const available =
+        at.mDebt >= at.mWindow ? 0 : at.mWindow - at.mDebt;
+    uint64_t newWindow = at.mWindow;
+    if (at.mProcessingLatency > FLOW_CONTROL_AUTOTUNE_MAX_PROCESSING_LATENCY)
+    {
+        // Messages queue up locally faster than they are processed
+        newWindow = std::max(minWindow, at.mWindow / 2);
+    }
+    else if (bdp >= 0.5 * available)
+    {
+        // The peer keeps much of its window in flight, so the window rather
+        // than the peer limits throughput
+        newWindow = std::min(maxWindow, at.mWindow * 2);
+    }
+    if (newWindow == at.mWindow)
     {
         return;
     }
 
-    mCapacity.mTotalCapacity++;
-    if (mApp.getOverlayManager().isFloodMessage(msg))
+    CLOG_DEBUG(Overlay,
+               "Flow control window for peer {}: {} -> {} (rate {:.1f}/s, "
+               "rtt {}ms, processing {}ms)",
+               cfg.toShortString(getPeerID()), at.mWindow, newWindow,
+               at.mDeliveryRate, rtt.count(), at.mProcessingLatency.count());
+    if (newWindow > at.mWindow)
     {
-        if (mCapacity.mFloodCapacity == 0)
+        auto delta = newWindow - at.mWindow;
+        // Cancel outstanding debt first, then grant the rest right away
+        auto paid = std::min(delta, at.mDebt);
+        at.mDebt -= paid;
+        delta -= paid;
+        if (delta > 0)
         {
-            CLOG_DEBUG(Overlay, "Got flood capacity for peer {}",
-                       mApp.getConfig().toShortString(getPeerID()));
+            mCapacity.mFloodCapacity += delta;
+            mCapacity.mTotalCapacity += delta;
+            sendSendMore(static_cast<uint32_t>(delta));
         }
-        mCapacity.mFloodCapacity++;
-        mFloodMsgsProcessed++;
+    }
+    else
+    {
+        at.mDebt += at.mWindow - newWindow;
+    }
+    at.mWindow = newWindow;
+    at.mBatchSize = std::max<uint64_t>(
+        1, newWindow * cfg.FLOW_CONTROL_SEND_MORE_BATCH_SIZE /
+               cfg.PEER_FLOOD_READING_CAPACITY);
+}
+
+void
+Peer::endMessageProcessing(HcnetMessage const& msg,
+                           VirtualClock::time_point receivedTime)
+{
+    if (shouldAbort() ||
+        flowControlEnabled() != Peer::FlowControlState::ENABLED)
+    {
+        return;
+    }
 
-        if (mFloodMsgsProcessed ==
-            mApp.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE)
+    bool const isFlood = mApp.getOverlayManager().isFloodMessage(msg);
+    bool const autotune = mApp.getConfig().FLOW_CONTROL_AUTOTUNE;
+    if (isFlood && autotune && mAutotune.mDebt > 0)
+    {
+        // The window shrank: keep this slot rather than hand it back
+        mAutotune.mDebt--;
+    }
+    else
+    {
+        mCapacity.mTotalCapacity++;
+        if (isFlood)
         {
-            sendSendMore(mApp.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE);
-            mFloodMsgsProcessed = 0;
+            if (mCapacity.mFloodCapacity == 0)
+            {
+                CLOG_DEBUG(Overlay, "Got flood capacity for peer {}",
+                           mApp.getConfig().toShortString(getPeerID()));
+            }
+            mCapacity.mFloodCapacity++;
+            mFloodMsgsProcessed++;
+
+            if (mFloodMsgsProcessed >= getSendMoreBatchSize())
+            {
+                sendSendMore(static_cast<uint32_t>(mFloodMsgsProcessed));
+                mFloodMsgsProcessed = 0;
+            }
         }
     }
 
+    if (isFlood && autotune)
+    {
+        maybeAutotuneFlowControl(mApp.getClock().now() - receivedTime);
+    }
+
     // Got some capacity back, can schedule more reads now
-    if (mIsPeerThrottled)
+    if (mIsPeerThrottled && hasReadingCapacity())
     {
         CLOG_DEBUG(Overlay, "Stop throttling reading from peer {}",
                    mApp.getConfig().toShortString(getPeerID()));
@@ -1246,7 +1540,8 @@ Peer::endMessageProcessing(HcnetMessage const& msg)
 }
 
 void
-Peer::recvRawMessage(HcnetMessage const& hcnetMsg)
+Peer::recvRawMessage(HcnetMessage const& hcnetMsg,
+                     std::shared_ptr<MsgCapacityTracker> msgTracker)
 {
     ZoneScoped;
     auto peerStr = toString();
@@ -1354,7 +1649,7 @@ Peer::recvRawMessage(HcnetMessage const& hcnetMsg)
     case TRANSACTION:
     {
         auto t = getOverlayMetrics().mRecvTransactionTimer.TimeScope();
-        recvTransaction(hcnetMsg);
+        recvTransaction(hcnetMsg, msgTracker);
     }
     break;
 
@@ -1404,6 +1699,32 @@ Peer::recvRawMessage(HcnetMessage const& hcnetMsg)
         auto t = getOverlayMetrics().mRecvFloodDemandTimer.TimeScope();
         recvFloodDemand(hcnetMsg);
     }
+    break;
+
+    case FLOOD_ADVERT_SHORT:
+    {
+        auto t = getOverlayMetrics().mRecvFloodAdvertShortTimer.TimeScope();
+        recvFloodAdvertShort(hcnetMsg);
+    }
+    break;
+
+    case FLOOD_EXPAND:
+    {
+        auto t = getOverlayMetrics().mRecvFloodExpandTimer.TimeScope();
+        recvFloodExpand(hcnetMsg);
+    }
+    break;
+
+    case FLOOD_DEMAND_SHORT:
+    {
+        auto t = getOverlayMetrics().mRecvFloodDemandShortTimer.TimeScope();
+        recvFloodDemandShort(hcnetMsg);
+    }
+    break;
+
+    case COMPRESSED_MESSAGE:
+        // Unwrapped by recvMessage before getting here.
+        releaseAssert(false);
     }
 }
 
@@ -1480,6 +1801,8 @@ Peer::recvTxSet(HcnetMessage const& msg)
 {
     ZoneScoped;
     auto frame = TxSetFrame::makeFromWire(mApp.getNetworkID(), msg.txSet());
+    mApp.getHerder().peerReplied(TX_SET, frame->getContentsHash(),
+                                 shared_from_this());
     mApp.getHerder().recvTxSet(frame->getContentsHash(), frame);
 }
 
@@ -1489,11 +1812,14 @@ Peer::recvGeneralizedTxSet(HcnetMessage const& msg)
     ZoneScoped;
     auto frame =
         TxSetFrame::makeFromWire(mApp.getNetworkID(), msg.generalizedTxSet());
+    mApp.getHerder().peerReplied(GENERALIZED_TX_SET, frame->getContentsHash(),
+                                 shared_from_this());
     mApp.getHerder().recvTxSet(frame->getContentsHash(), frame);
 }
 
 void
-Peer::recvTransaction(HcnetMessage const& msg)
+Peer::recvTransaction(HcnetMessage const& msg,
+                      std::shared_ptr<MsgCapacityTracker> msgTracker)
 {
     ZoneScoped;
     auto transaction = TransactionFrameBase::makeTransactionFromWire(
@@ -1516,14 +1842,22 @@ Peer::recvTransaction(HcnetMessage const& msg)
         }
 
         // add it to our current set
-        // and make sure it is valid
-        auto recvRes = mApp.getHerder().recvTransaction(transaction, false);
-
-        if (!(recvRes == TransactionQueue::AddResult::ADD_STATUS_PENDING ||
-              recvRes == TransactionQueue::AddResult::ADD_STATUS_DUPLICATE))
-        {
-            mApp.getOverlayManager().forgetFloodedMsg(msgID);
-        }
+        // and make sure it is valid. The result may come after this peer is
+        // gone, so the callback must not refer to it. It holds on to
+        // `msgTracker` instead, so that the peer doesn't get to send more
+        // transactions until this one is admitted.
+        auto& app = mApp;
+        mApp.getHerder().recvTransactionAsync(
+            transaction, false,
+            [&app, msgID, msgTracker](TransactionQueue::AddResult recvRes) {
+                if (!(recvRes ==
+                          TransactionQueue::AddResult::ADD_STATUS_PENDING ||
+                      recvRes ==
+                          TransactionQueue::AddResult::ADD_STATUS_DUPLICATE))
+                {
+                    app.getOverlayManager().forgetFloodedMsg(msgID);
+                }
+            });
     }
 }
 
@@ -1597,6 +1931,7 @@ Peer::recvSCPQuorumSet(HcnetMessage const& msg)
     ZoneScoped;
     Hash hash = xdrSha256(msg.qSet());
     maybeProcessPingResponse(hash);
+    mApp.getHerder().peerReplied(SCP_QUORUMSET, hash, shared_from_this());
     mApp.getHerder().recvSCPQuorumSet(hash, msg.qSet());
 }
 
@@ -1897,6 +2232,17 @@ Peer::recvAuth(HcnetMessage const& msg)
 
     mState = GOT_AUTH;
 
+    // Decided before anything else is sent: every message after AUTH is
+    // MACed with the negotiated algorithm.
+    if (mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_BLAKE2_MAC &&
+        mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+            Peer::FIRST_VERSION_SUPPORTING_BLAKE2_MAC &&
+        (msg.auth().flags & AUTH_MSG_FLAG_BLAKE2_MAC_REQUESTED) != 0 &&
+        mApp.getConfig().ENABLE_OVERLAY_BLAKE2_MAC)
+    {
+        mBlake2MacEnabled = true;
+    }
+
     if (mRole == REMOTE_CALLED_US)
     {
         sendAuth();
@@ -1920,17 +2266,56 @@ Peer::recvAuth(HcnetMessage const& msg)
             Peer::FIRST_VERSION_SUPPORTING_FLOW_CONTROL)
     {
         sendSendMore(mApp.getConfig().PEER_FLOOD_READING_CAPACITY);
+        mAutotune.mIntervalStart = mApp.getClock().now();
+    }
+
+    // The compression and MAC flags are separate bits; the rest of the flags
+    // select the flooding mode.
+    auto const flags = msg.auth().flags & ~AUTH_MSG_FLAG_COMPRESSION_REQUESTED &
+                       ~AUTH_MSG_FLAG_BLAKE2_MAC_REQUESTED;
+    if (mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_COMPRESSION &&
+        mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+            Peer::FIRST_VERSION_SUPPORTING_COMPRESSION &&
+        (msg.auth().flags & AUTH_MSG_FLAG_COMPRESSION_REQUESTED) != 0 &&
+        OVERLAY_COMPRESSION_AVAILABLE &&
+        mApp.getConfig().ENABLE_OVERLAY_COMPRESSION)
+    {
+        mCompressionEnabled = true;
     }
 
     if (mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_PULL_MODE &&
         mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
             Peer::FIRST_VERSION_SUPPORTING_PULL_MODE &&
-        msg.auth().flags == AUTH_MSG_FLAG_PULL_MODE_REQUESTED &&
+        (flags == AUTH_MSG_FLAG_PULL_MODE_REQUESTED ||
+         flags == AUTH_MSG_FLAG_COMPACT_ADVERTS_REQUESTED) &&
         mApp.getConfig().ENABLE_PULL_MODE)
     {
         mPullModeEnabled = true;
     }
 
+    // Both sides request compact adverts only if both support them, see
+    // sendAuth.
+    if (mPullModeEnabled && flags == AUTH_MSG_FLAG_COMPACT_ADVERTS_REQUESTED &&
+        mApp.getConfig().ENABLE_COMPACT_ADVERTS &&
+        mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+            Peer::FIRST_VERSION_SUPPORTING_COMPACT_ADVERTS &&
+        mRemoteOverlayVersion >= Peer::FIRST_VERSION_SUPPORTING_COMPACT_ADVERTS)
+    {
+        // Key the short ids with both nonces in a fixed order, so both sides
+        // derive the same key.
+        auto const& initiatorNonce =
+            mRole == WE_CALLED_REMOTE ? mSendNonce : mRecvNonce;
+        auto const& acceptorNonce =
+            mRole == WE_CALLED_REMOTE ? mRecvNonce : mSendNonce;
+        SHA256 hasher;
+        hasher.add(initiatorNonce);
+        hasher.add(acceptorNonce);
+        auto seed = hasher.finish();
+        std::copy(seed.begin(), seed.begin() + mShortIdKey.size(),
+                  mShortIdKey.begin());
+        mCompactAdvertsEnabled = true;
+    }
+
     // Ask for SCP data _after_ the flow control message
     auto low = mApp.getHerder().getMinLedgerSeqToAskPeers();
     sendGetScpState(low);
@@ -2009,7 +2394,13 @@ Peer::recvSurveyResponseMessage(HcnetMessage const& msg)
 void
 Peer::recvFloodAdvert(HcnetMessage const& msg)
 {
-    mTxAdvertQueue.queueAndMaybeTrim(msg.floodAdvert().txHashes);
+    auto const& hashes = msg.floodAdvert().txHashes;
+    // Lets short adverts of the same transactions by other peers be matched.
+    for (auto const& h : hashes)
+    {
+        mApp.getOverlayManager().rememberTxHash(h);
+    }
+    mTxAdvertQueue.queueAndMaybeTrim(hashes);
 }
 
 void
@@ -2018,6 +2409,135 @@ Peer::recvFloodDemand(HcnetMessage const& msg)
     fulfillDemand(msg.floodDemand());
 }
 
+void
+Peer::recvFloodAdvertShort(HcnetMessage const& msg)
+{
+    // Ids of transactions this node knows of are queued as full hashes, so
+    // the usual demand bookkeeping across peers applies. Ids of unknown
+    // transactions are demanded by short id (see demandTxShortIds). Ids of
+    // several known transactions are sent back to be expanded.
+    TxAdvertVector known;
+    FloodExpand expand;
+    auto now = mApp.getClock().now();
+    for (auto id : msg.floodAdvertShort().txShortIds)
+    {
+        auto hash = mShortIds.maybeGet(id);
+        if (!hash)
+        {
+            mTxShortIdsToDemand.emplace_back(id, now);
+        }
+        else if (*hash)
+        {
+            known.emplace_back(**hash);
+        }
+        else
+        {
+            expand.txShortIds.emplace_back(id);
+        }
+    }
+    if (!known.empty())
+    {
+        mTxAdvertQueue.queueAndMaybeTrim(known);
+    }
+    size_t const limit = mApp.getLedgerManager().getLastMaxTxSetSizeOps();
+    while (mTxShortIdsToDemand.size() > limit)
+    {
+        mTxShortIdsToDemand.pop_front();
+    }
+    if (!expand.txShortIds.empty())
+    {
+        auto m = std::make_shared<HcnetMessage>();
+        m->type(FLOOD_EXPAND);
+        m->floodExpand() = std::move(expand);
+        sendMessageFromMainThread(m, "recvFloodAdvertShort");
+    }
+}
+
+void
+Peer::recvCompressedMessage(HcnetMessage const& msg)
+{
+    ZoneScoped;
+    if (!mCompressionEnabled)
+    {
+        drop("Peer sent COMPRESSED_MESSAGE, but compression is disabled",
+             Peer::DropDirection::WE_DROPPED_REMOTE,
+             Peer::DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+
+    auto const& compressed = msg.compressedMessage();
+    HcnetMessage inner;
+    try
+    {
+        auto raw = decompressMessage(compressed);
+        xdr::xdr_from_opaque(raw, inner);
+    }
+    catch (std::runtime_error& e)
+    {
+        CLOG_ERROR(Overlay, "received corrupt compressed message {}",
+                   e.what());
+        drop("received corrupted message",
+             Peer::DropDirection::WE_DROPPED_REMOTE,
+             Peer::DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+    if (!isCompressibleMessage(inner.type()))
+    {
+        drop(fmt::format("Peer sent compressed {}",
+                         xdr::xdr_traits<MessageType>::enum_name(inner.type())),
+             Peer::DropDirection::WE_DROPPED_REMOTE,
+             Peer::DropMode::IGNORE_WRITE_QUEUE);
+        return;
+    }
+
+    auto& om = getOverlayMetrics();
+    om.mCompressionRecvRawBytes.Mark(compressed.uncompressedSize);
+    om.mCompressionRecvWireBytes.Mark(xdr::xdr_size(msg));
+    recvMessage(inner);
+}
+
+void
+Peer::recvFloodDemandShort(HcnetMessage const& msg)
+{
+    FloodDemand demand;
+    for (auto id : msg.floodDemandShort().txShortIds)
+    {
+        auto hash = mShortIds.maybeGet(id);
+        if (hash && *hash)
+        {
+            demand.txHashes.emplace_back(**hash);
+        }
+        else
+        {
+            // Not advertised by this node, or forgotten since
+            getOverlayMetrics().mUnknownMessageUnfulfilledMeter.Mark();
+            mPeerMetrics.mUnknownMessageUnfulfilled++;
+        }
+    }
+    fulfillDemand(demand);
+}
+
+void
+Peer::recvFloodExpand(HcnetMessage const& msg)
+{
+    auto m = std::make_shared<HcnetMessage>();
+    m->type(FLOOD_ADVERT);
+    auto& hashes = m->floodAdvert().txHashes;
+    for (auto id : msg.floodExpand().txShortIds)
+    {
+        auto hash = mShortIds.maybeGet(id);
+        if (hash && *hash)
+        {
+            hashes.emplace_back(**hash);
+        }
+    }
+    getOverlayMetrics().mTxShortIdsExpanded.Mark(hashes.size());
+    if (!hashes.empty())
+    {
+        sendMessageFromMainThread(m, "recvFloodExpand");
+    }
+}
+
 Peer::PeerMetrics::PeerMetrics(VirtualClock::time_point connectedTime)
     : mMessageRead(0)
     , mMessageWrite(0)
@@ -2066,6 +2586,137 @@ Peer::isPullModeEnabled() const
     return mPullModeEnabled;
 }
 
+bool
+Peer::isCompactAdvertsEnabled() const
+{
+    return mCompactAdvertsEnabled;
+}
+
+bool
+Peer::isCompressionEnabled() const
+{
+    return mCompressionEnabled;
+}
+
+bool
+Peer::isBlake2MacEnabled() const
+{
+    return mBlake2MacEnabled;
+}
+
+void
+Peer::maybeCompress(MessageType type, xdr::opaque_vec<>& body)
+{
+    if (!mCompressionEnabled || !isCompressibleMessage(type) ||
+        body.size() < mApp.getConfig().OVERLAY_COMPRESSION_MIN_BYTES)
+    {
+        return;
+    }
+    auto compressed = compressMessage(body);
+    if (!compressed)
+    {
+        return;
+    }
+    HcnetMessage wrapped;
+    wrapped.type(COMPRESSED_MESSAGE);
+    wrapped.compressedMessage() = std::move(*compressed);
+    auto& om = getOverlayMetrics();
+    om.mCompressionSendRawBytes.Mark(body.size());
+    body = xdr::xdr_to_opaque(wrapped);
+    om.mCompressionSendWireBytes.Mark(body.size());
+}
+
+uint64_t
+Peer::shortTxId(Hash const& txHash) const
+{
+    SipHash24 hasher(mShortIdKey.data());
+    hasher.update(txHash.data(), txHash.size());
+    return hasher.digest();
+}
+
+std::optional<uint64_t>
+Peer::rememberTxHash(Hash const& txHash)
+{
+    auto id = shortTxId(txHash);
+    auto known = mShortIds.maybeGet(id);
+    if (!known)
+    {
+        mShortIds.put(id, txHash);
+        return id;
+    }
+    if (*known && **known == txHash)
+    {
+        return id;
+    }
+    // Neither side can tell which transaction such an id refers to.
+    *known = std::nullopt;
+    return std::nullopt;
+}
+
+bool
+Peer::demandTxShortIds(VirtualClock::time_point receivedBy, size_t maxSize)
+{
+    if (mTxShortIdsToDemand.empty())
+    {
+        return false;
+    }
+
+    TxAdvertVector known;
+    auto msg = std::make_shared<HcnetMessage>();
+    msg->type(FLOOD_DEMAND_SHORT);
+    auto& ids = msg->floodDemandShort().txShortIds;
+    std::deque<std::pair<uint64_t, VirtualClock::time_point>> waiting;
+    for (auto const& pending : mTxShortIdsToDemand)
+    {
+        auto hash = mShortIds.maybeGet(pending.first);
+        if (hash && *hash)
+        {
+            known.emplace_back(**hash);
+        }
+        else if (pending.second <= receivedBy && ids.size() < maxSize)
+        {
+            ids.emplace_back(pending.first);
+        }
+        else
+        {
+            waiting.emplace_back(pending);
+        }
+    }
+    mTxShortIdsToDemand = std::move(waiting);
+
+    if (!known.empty())
+    {
+        mTxAdvertQueue.queueAndMaybeTrim(known);
+    }
+    if (ids.empty())
+    {
+        return false;
+    }
+    CLOG_TRACE(Overlay,
+               "Peer::demandTxShortIds -- demanding {} txns from {}",
+               ids.size(), mApp.getConfig().toShortString(getPeerID()));
+    getOverlayMetrics().mMessagesDemanded.Mark(ids.size());
+    ++mPeerMetrics.mTxDemandSent;
+    sendMessageFromMainThread(msg, "demandTxShortIds");
+    return true;
+}
+
+void
+Peer::sendMessageFromMainThread(std::shared_ptr<HcnetMessage const> msg,
+                                char const* jobName)
+{
+    std::weak_ptr<Peer> weak(static_pointer_cast<Peer>(shared_from_this()));
+    mApp.postOnMainThread(
+        [weak, msg = std::move(msg)]() {
+            auto strong = weak.lock();
+            if (strong)
+            {
+                strong->sendMessage(msg);
+            }
+        },
+        jobName);
+}
+
 void
 Peer::queueTxHashToAdvertise(Hash const& txHash)
 {
@@ -2141,25 +2792,48 @@ Peer::flushAdvert()
 {
     if (mTxHashesToAdvertise.size() > 0)
     {
-        HcnetMessage adv;
-        adv.type(FLOOD_ADVERT);
-
-        adv.floodAdvert().txHashes = std::move(mTxHashesToAdvertise);
-        mTxHashesToAdvertise.clear();
-        auto msg = std::make_shared<HcnetMessage>(adv);
-        std::weak_ptr<Peer> weak(static_pointer_cast<Peer>(shared_from_this()));
+        auto msg = std::make_shared<HcnetMessage>();
         CLOG_TRACE(Overlay, "Peer::flushAdvert -- flushing {} tx hashes to {}",
-                   msg->floodAdvert().txHashes.size(),
+                   mTxHashesToAdvertise.size(),
                    mApp.getConfig().toShortString(getPeerID()));
-        mApp.postOnMainThread(
-            [weak, msg = std::move(msg)]() {
-                auto strong = weak.lock();
-                if (strong)
+        if (mCompactAdvertsEnabled)
+        {
+            // Transactions whose id is shared by another known one are
+            // advertised by hash.
+            auto full = std::make_shared<HcnetMessage>();
+            full->type(FLOOD_ADVERT);
+            msg->type(FLOOD_ADVERT_SHORT);
+            auto& ids = msg->floodAdvertShort().txShortIds;
+            ids.reserve(mTxHashesToAdvertise.size());
+            for (auto const& h : mTxHashesToAdvertise)
+            {
+                auto id = rememberTxHash(h);
+                if (id)
                 {
-                    strong->sendMessage(msg);
+                    ids.emplace_back(*id);
                 }
-            },
-            "flushAdvert");
+                else
+                {
+                    full->floodAdvert().txHashes.emplace_back(h);
+                }
+            }
+            if (!full->floodAdvert().txHashes.empty())
+            {
+                sendMessageFromMainThread(full, "flushAdvert");
+            }
+            if (ids.empty())
+            {
+                mTxHashesToAdvertise.clear();
+                return;
+            }
+        }
+        else
+        {
+            msg->type(FLOOD_ADVERT);
+            msg->floodAdvert().txHashes = std::move(mTxHashesToAdvertise);
+        }
+        mTxHashesToAdvertise.clear();
+        sendMessageFromMainThread(msg, "flushAdvert");
     }
 }
 
@@ -12,8 +12,10 @@
 #include "overlay/HcnetXDR.h"
 #include "overlay/TxAdvertQueue.h"
 #include "util/NonCopyable.h"
+#include "util/RandomEvictionCache.h"
 #include "util/Timer.h"
 #include "xdrpp/message.h"
+#include <optional>
 
 namespace medida
 {
@@ -65,6 +67,39 @@ class Peer : public std::enable_shared_from_this<Peer>,
     static constexpr std::chrono::nanoseconds PEER_METRICS_RATE_UNIT =
         std::chrono::seconds(1);
     static constexpr uint32_t FIRST_VERSION_SUPPORTING_PULL_MODE = 24;
+    static constexpr uint32_t FIRST_VERSION_SUPPORTING_COMPACT_ADVERTS = 25;
+    static constexpr uint32_t FIRST_VERSION_SUPPORTING_COMPRESSION = 26;
+    static constexpr uint32_t FIRST_VERSION_SUPPORTING_BLAKE2_MAC = 27;
+    // Short ids of known transactions remembered per compact-advert
+    // connection, so they can be matched when the peer refers to them.
+    static constexpr size_t COMPACT_ADVERT_SHORT_ID_CACHE_SIZE = 10000;
+    // With FLOW_CONTROL_AUTOTUNE, the flood capacity granted to a peer may
+    // grow up to this multiple of PEER_FLOOD_READING_CAPACITY.
+    static constexpr uint64_t FLOW_CONTROL_AUTOTUNE_MAX_GROWTH = 16;
+    // Shortest interval the autotuner measures a peer over, so that peers
+    // with a tiny RTT are not retuned on every batch.
+    static constexpr std::chrono::milliseconds
+        FLOW_CONTROL_AUTOTUNE_MIN_INTERVAL = std::chrono::milliseconds(100);
+    // Average time a flood message may wait to be processed before the
+    // autotuner shrinks the capacity granted to its sender.
+    static constexpr std::chrono::milliseconds
+        FLOW_CONTROL_AUTOTUNE_MAX_PROCESSING_LATENCY =
+            std::chrono::milliseconds(200);
+
+    // XDR encoding of an HcnetMessage. A flooded message is encoded once and
+    // the encoding is shared by every peer it is sent to.
+    typedef std::shared_ptr<xdr::opaque_vec<> const> EncodedMessage;
+
+    // Builds the wire form of an AuthenticatedMessage holding the message
+    // encoded as `encoded`, MACed with `macKey` at `sequence`. Produces the
+    // same bytes as serializing the AuthenticatedMessage.
+    // `blake2MacEnabled` tells whether the connection negotiated BLAKE2 MACs;
+    // they are used from sequence 1 on, AUTH (sequence 0) is always MACed
+    // with HMAC-SHA256.
+    static xdr::msg_ptr
+    authenticatedMessageBytes(HmacSha256Key const& macKey, uint64_t sequence,
+                              xdr::opaque_vec<> const& encoded,
+                              bool blake2MacEnabled = false);
 
     // The reporting will be based on the previous
     // PEER_METRICS_WINDOW_SIZE-second time window.
@@ -152,6 +187,7 @@ class Peer : public std::enable_shared_from_this<Peer>,
     {
         std::shared_ptr<HcnetMessage const> mMessage;
         VirtualClock::time_point mTimeEmplaced;
+        EncodedMessage mEncoded;
     };
 
     // Does this peer want flow control enabled
@@ -180,6 +216,7 @@ class Peer : public std::enable_shared_from_this<Peer>,
     {
         std::weak_ptr<Peer> mWeakPeer;
         HcnetMessage mMsg;
+        VirtualClock::time_point mReceivedTime;
 
       public:
         MsgCapacityTracker(std::weak_ptr<Peer> peer, HcnetMessage const& msg);
@@ -194,6 +231,30 @@ class Peer : public std::enable_shared_from_this<Peer>,
         uint64_t mTotalCapacity;
     };
 
+    // State of FLOW_CONTROL_AUTOTUNE for this peer. The window is the flood
+    // capacity granted to the peer, PEER_FLOOD_READING_CAPACITY when flow
+    // control starts. Every interval of at least one RTT the autotuner
+    // estimates the bandwidth-delay product from the flood messages processed
+    // in that interval: if the peer used most of its window, the window
+    // doubles; if messages waited too long to be processed, it halves.
+    // Growing grants the extra capacity with a SEND_MORE right away;
+    // shrinking withholds capacity from the next messages processed, tracked
+    // by mDebt.
+    struct FlowControlAutotune
+    {
+        uint64_t mWindow;
+        uint64_t mBatchSize;
+        uint64_t mDebt{0};
+
+        VirtualClock::time_point mIntervalStart;
+        uint64_t mIntervalMsgs{0};
+        std::chrono::nanoseconds mIntervalLatency{0};
+
+        // Last measurements, for reporting
+        double mDeliveryRate{0};
+        std::chrono::milliseconds mProcessingLatency{0};
+    };
+
     // Outbound queues indexes by priority
     // Priority 0 - SCP messages
     // Priority 1 - transactions
@@ -202,18 +263,28 @@ class Peer : public std::enable_shared_from_this<Peer>,
     std::array<std::deque<QueuedOutboundMessage>, 4> mOutboundQueues;
 
     // This methods drops obsolete load from the outbound queue
-    void addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg);
+    void addMsgAndMaybeTrimQueue(std::shared_ptr<HcnetMessage const> msg,
+                                 EncodedMessage encoded = nullptr);
 
     // How many flood messages have we received and processed since sending
     // SEND_MORE to this peer
     uint64_t mFloodMsgsProcessed{0};
 
+    FlowControlAutotune mAutotune;
+    uint64_t getSendMoreBatchSize() const;
+    void maybeAutotuneFlowControl(std::chrono::nanoseconds latency);
+
     // How many flood messages can we send to this peer
     uint64_t mOutboundCapacity{0};
 
     // Is this peer currently throttled due to lack of capacity
     bool mIsPeerThrottled{false};
 
+    // Messages read from this peer that are still being decoded on the
+    // overlay thread. They count against the reading capacity until they are
+    // handed back to the main thread.
+    size_t mMessagesBeingDecoded{0};
+
     // Does local node have capacity to read from this peer
     bool hasReadingCapacity() const;
 
@@ -248,9 +319,18 @@ class Peer : public std::enable_shared_from_this<Peer>,
     OverlayMetrics& getOverlayMetrics();
 
     bool shouldAbort() const;
-    void recvRawMessage(HcnetMessage const& msg);
+    // `msgTracker`, if set, holds the reading capacity taken by `msg`.
+    void
+    recvRawMessage(HcnetMessage const& msg,
+                   std::shared_ptr<MsgCapacityTracker> msgTracker = nullptr);
     void recvMessage(HcnetMessage const& msg);
-    void recvMessage(AuthenticatedMessage const& msg);
+    // `macValid`, if set, is the result of verifying the MAC of `msg` ahead
+    // of time with verifyMac.
+    void recvMessage(AuthenticatedMessage const& msg,
+                     std::optional<bool> macValid = std::nullopt);
+    // `blake2MacEnabled` as in authenticatedMessageBytes.
+    static bool verifyMac(AuthenticatedMessage const& msg,
+                          HmacSha256Key const& macKey, bool blake2MacEnabled);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
 
     virtual void recvError(HcnetMessage const& msg);
@@ -268,13 +348,18 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvGetTxSet(HcnetMessage const& msg);
     void recvTxSet(HcnetMessage const& msg);
     void recvGeneralizedTxSet(HcnetMessage const& msg);
-    void recvTransaction(HcnetMessage const& msg);
+    void recvTransaction(HcnetMessage const& msg,
+                         std::shared_ptr<MsgCapacityTracker> msgTracker);
     void recvGetSCPQuorumSet(HcnetMessage const& msg);
     void recvSCPQuorumSet(HcnetMessage const& msg);
     void recvSCPMessage(HcnetMessage const& msg);
     void recvGetSCPState(HcnetMessage const& msg);
     void recvFloodAdvert(HcnetMessage const& msg);
     void recvFloodDemand(HcnetMessage const& msg);
+    void recvFloodAdvertShort(HcnetMessage const& msg);
+    void recvFloodDemandShort(HcnetMessage const& msg);
+    void recvFloodExpand(HcnetMessage const& msg);
+    void recvCompressedMessage(HcnetMessage const& msg);
 
     void sendHello();
     void sendAuth();
@@ -291,7 +376,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // put in a reused/non-owned buffer without having to buffer/queue
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
-    virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+    // `type` is the type of the HcnetMessage held in `xdrBytes`.
+    virtual void sendMessage(xdr::msg_ptr&& xdrBytes, MessageType type) = 0;
     virtual void scheduleRead() = 0;
     virtual void
     connected()
@@ -312,16 +398,50 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // helper method to acknownledge that some bytes were received
     void receivedBytes(size_t byteCount, bool gotFullMessage);
 
-    void sendAuthenticatedMessage(HcnetMessage const& msg);
+    // `encoded`, if given, must be the XDR encoding of `msg`.
+    void sendAuthenticatedMessage(HcnetMessage const& msg,
+                                  EncodedMessage const& encoded = nullptr);
+
+    // Sends the message of type `type` encoded as `body`, MACed with the
+    // next send sequence number. Peers that reorder their writes override
+    // this to MAC messages in the order they are written, using
+    // authenticateBody.
+    virtual void sendAuthenticatedBody(EncodedMessage body, MessageType type);
+    xdr::msg_ptr authenticateBody(xdr::opaque_vec<> const& body);
 
     void beginMesssageProcessing(HcnetMessage const& msg);
-    void endMessageProcessing(HcnetMessage const& msg);
+    void endMessageProcessing(HcnetMessage const& msg,
+                              VirtualClock::time_point receivedTime);
 
     void maybeSendNextBatch();
 
     bool mPullModeEnabled{false};
     TxAdvertQueue mTxAdvertQueue;
 
+    // With compact adverts, tx hashes are advertised as SipHash-2-4 short ids
+    // keyed by mShortIdKey, which both sides derive from the HELLO nonces.
+    // mShortIds maps the ids of transactions known to this node, whichever
+    // peer they came from, back to their hashes; an id shared by several of
+    // them maps to nullopt. Advertised ids matching none of them wait in
+    // mTxShortIdsToDemand, with the time they were received.
+    bool mCompactAdvertsEnabled{false};
+    std::array<uint8_t, 16> mShortIdKey{};
+    RandomEvictionCache<uint64_t, std::optional<Hash>> mShortIds;
+    std::deque<std::pair<uint64_t, VirtualClock::time_point>>
+        mTxShortIdsToDemand;
+    uint64_t shortTxId(Hash const& txHash) const;
+    void sendMessageFromMainThread(std::shared_ptr<HcnetMessage const> msg,
+                                   char const* jobName);
+
+    // Both sides offered compression in AUTH; see OverlayCompression.h.
+    bool mCompressionEnabled{false};
+
+    // Both sides offered BLAKE2 MACs in AUTH.
+    bool mBlake2MacEnabled{false};
+    // Replaces `body`, the encoding of a message of type `type`, with the
+    // encoding of a COMPRESSED_MESSAGE if that is worthwhile.
+    void maybeCompress(MessageType type, xdr::opaque_vec<>& body);
+
     // How many _hashes_ in total are queued?
     // NB: Each advert & demand contains a _vector_ of tx hashes.
     size_t mAdvertQueueTxHashCount{0};
@@ -360,6 +480,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
 
     void sendMessage(std::shared_ptr<HcnetMessage const> msg,
                      bool log = true);
+    // Same as above for a message already encoded as `encoded`, which is
+    // used instead of serializing `msg` again.
+    void sendMessage(std::shared_ptr<HcnetMessage const> msg,
+                     EncodedMessage encoded, bool log = true);
 
     PeerRole
     getRole() const
@@ -457,9 +581,22 @@ class Peer : public std::enable_shared_from_this<Peer>,
     }
 
     bool isPullModeEnabled() const;
+    bool isCompactAdvertsEnabled() const;
+    bool isCompressionEnabled() const;
+    bool isBlake2MacEnabled() const;
     void sendTxDemand(TxDemandVector&& demands);
     void fulfillDemand(FloodDemand const& dmd);
     void queueTxHashToAdvertise(Hash const& hash);
+
+    // With compact adverts, lets the peer's short ids be matched to `txHash`,
+    // a transaction this node has or was told about. Returns the short id, or
+    // nullopt if another known transaction has the same one.
+    std::optional<uint64_t> rememberTxHash(Hash const& txHash);
+    // Demands the advertised short ids still matching no known transaction
+    // that were received by `receivedBy`, up to `maxSize` of them, and
+    // returns true if it demanded any. Ids matching a transaction known by
+    // now are queued as hashes instead.
+    bool demandTxShortIds(VirtualClock::time_point receivedBy, size_t maxSize);
     void queueTxHashAndMaybeTrim(Hash const& hash);
     TxAdvertQueue&
     getTxAdvertQueue()
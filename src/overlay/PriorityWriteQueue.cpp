@@ -0,0 +1,131 @@
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/PriorityWriteQueue.h"
+#include "medida/counter.h"
+#include "overlay/OverlayMetrics.h"
+#include "util/GlobalChecks.h"
+
+namespace hcnet
+{
+
+WriteQueueClass
+writeQueueClass(MessageType type)
+{
+    switch (type)
+    {
+    case GET_TX_SET:
+    case TX_SET:
+    case GENERALIZED_TX_SET:
+    case GET_SCP_QUORUMSET:
+    case SCP_QUORUMSET:
+        return WriteQueueClass::FETCH;
+    case FLOOD_DEMAND:
+    case FLOOD_EXPAND:
+    case FLOOD_DEMAND_SHORT:
+        return WriteQueueClass::DEMAND;
+    case TRANSACTION:
+    case FLOOD_ADVERT:
+    case FLOOD_ADVERT_SHORT:
+        return WriteQueueClass::FLOOD;
+    default:
+        return WriteQueueClass::SCP;
+    }
+}
+
+size_t
+QueuedWrite::wireSize() const
+{
+    if (mTimed.mMessage)
+    {
+        return mTimed.mMessage->raw_size();
+    }
+    // Record mark, union discriminant, sequence, body and MAC
+    return 4 + 4 + 8 + mBody->size() + sizeof(HmacSha256Mac);
+}
+
+PriorityWriteQueue::PriorityWriteQueue(OverlayMetrics& metrics)
+    : mDepth(metrics.mWriteQueueDepth)
+{
+}
+
+void
+PriorityWriteQueue::push(WriteQueueClass cls, QueuedWrite&& msg)
+{
+    releaseAssert(msg.mTimed.mMessage || msg.mBody);
+    auto i = static_cast<size_t>(cls);
+    mQueues[i].emplace_back(std::move(msg));
+    mDepth[i]->inc();
+    ++mSize;
+}
+
+void
+PriorityWriteQueue::popBatch(std::vector<QueuedWrite>& batch,
+                             size_t maxCount, size_t maxBytes)
+{
+    size_t bytes = 0;
+    auto full = [&]() { return batch.size() >= maxCount || bytes >= maxBytes; };
+    while (mSize != 0 && !full())
+    {
+        for (size_t i = 0; i < WRITE_QUEUE_CLASS_COUNT; ++i)
+        {
+            auto& queue = mQueues[i];
+            for (size_t n = 0; n < WRITE_QUEUE_CLASS_WEIGHTS[i] &&
+                               !queue.empty() && !full();
+                 ++n)
+            {
+                bytes += queue.front().wireSize();
+                batch.emplace_back(std::move(queue.front()));
+                queue.pop_front();
+                mDepth[i]->dec();
+                --mSize;
+            }
+        }
+    }
+}
+
+size_t
+PriorityWriteQueue::size() const
+{
+    return mSize;
+}
+
+size_t
+PriorityWriteQueue::size(WriteQueueClass cls) const
+{
+    return mQueues[static_cast<size_t>(cls)].size();
+}
+
+bool
+PriorityWriteQueue::empty() const
+{
+    return mSize == 0;
+}
+
+std::optional<VirtualClock::time_point>
+PriorityWriteQueue::oldestEnqueuedTime() const
+{
+    std::optional<VirtualClock::time_point> res;
+    for (auto const& queue : mQueues)
+    {
+        if (!queue.empty() &&
+            (!res || queue.front().mTimed.mEnqueuedTime < *res))
+        {
+            res = queue.front().mTimed.mEnqueuedTime;
+        }
+    }
+    return res;
+}
+
+void
+PriorityWriteQueue::clear()
+{
+    for (size_t i = 0; i < WRITE_QUEUE_CLASS_COUNT; ++i)
+    {
+        mDepth[i]->dec(mQueues[i].size());
+        mQueues[i].clear();
+    }
+    mSize = 0;
+}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/Peer.h"
+#include <array>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+}
+
+namespace hcnet
+{
+
+struct OverlayMetrics;
+
+// Classes of outbound traffic, in decreasing priority. SCP also carries the
+// small control messages (handshake, SEND_MORE, errors, peers, surveys).
+enum class WriteQueueClass
+{
+    SCP = 0,
+    FETCH = 1,
+    DEMAND = 2,
+    FLOOD = 3
+};
+
+static constexpr size_t WRITE_QUEUE_CLASS_COUNT = 4;
+
+// Messages a write batch takes from each class per round, indexed by
+// WriteQueueClass.
+static constexpr std::array<size_t, WRITE_QUEUE_CLASS_COUNT>
+    WRITE_QUEUE_CLASS_WEIGHTS = {8, 4, 2, 1};
+
+WriteQueueClass writeQueueClass(MessageType type);
+
+// A message waiting to be written to a peer. Authenticated messages wait as
+// their XDR body and only get a MAC sequence number once they are written:
+// the queue reorders messages, but the receiver checks sequence numbers in
+// order. mTimed.mMessage holds the wire bytes, set from the start for
+// messages sent unauthenticated (HELLO, ERROR_MSG).
+struct QueuedWrite
+{
+    Peer::TimestampedMessage mTimed;
+    Peer::EncodedMessage mBody;
+
+    // Size of the message on the wire
+    size_t wireSize() const;
+};
+
+// Write queue of a peer connection, one FIFO per WriteQueueClass. Batches are
+// drained by weighted round robin, highest priority first, so that an SCP
+// message queued behind a backlog of flooded transactions goes out with the
+// next write, while lower classes still get a share of every batch. Queue
+// depths are reported in the overlay.write-queue.<class> counters. Owners
+// clear() the queue once done with it, since it may outlive the metrics.
+class PriorityWriteQueue : private NonMovableOrCopyable
+{
+    std::array<std::deque<QueuedWrite>, WRITE_QUEUE_CLASS_COUNT> mQueues;
+    std::array<medida::Counter*, WRITE_QUEUE_CLASS_COUNT> mDepth;
+    size_t mSize{0};
+
+  public:
+    explicit PriorityWriteQueue(OverlayMetrics& metrics);
+
+    void push(WriteQueueClass cls, QueuedWrite&& msg);
+
+    // Moves queued messages to `batch` until it holds `maxCount` messages or
+    // `maxBytes` bytes were added; the message crossing `maxBytes` is
+    // included.
+    void popBatch(std::vector<QueuedWrite>& batch, size_t maxCount,
+                  size_t maxBytes);
+
+    size_t size() const;
+    size_t size(WriteQueueClass cls) const;
+    bool empty() const;
+
+    // Enqueue time of the message that has been waiting the longest
+    std::optional<VirtualClock::time_point> oldestEnqueuedTime() const;
+
+    void clear();
+};
+}
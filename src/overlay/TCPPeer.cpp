@@ -34,7 +34,11 @@ using namespace std;
 
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+    : Peer(app, role)
+    , mSocket(socket)
+    , mDecodedMessages(std::make_shared<DecodedMessageQueue>())
+    , mWriteQueue(app.getOverlayManager().getOverlayMetrics())
+    , mWriteDelayTimer(app)
 {
 }
 
@@ -134,7 +138,24 @@ TCPPeer::getIP() const
 }
 
 void
-TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
+TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes, MessageType type)
+{
+    QueuedWrite msg;
+    msg.mTimed.mMessage = std::move(xdrBytes);
+    enqueueWrite(std::move(msg), type);
+}
+
+void
+TCPPeer::sendAuthenticatedBody(EncodedMessage body, MessageType type)
+{
+    // Authenticated in messageSender, once the write order is known
+    QueuedWrite msg;
+    msg.mBody = std::move(body);
+    enqueueWrite(std::move(msg), type);
+}
+
+void
+TCPPeer::enqueueWrite(QueuedWrite&& msg, MessageType type)
 {
     if (shouldAbort())
     {
@@ -143,16 +164,68 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
 
     assertThreadIsMain();
 
-    TimestampedMessage msg;
-    msg.mEnqueuedTime = mApp.getClock().now();
-    msg.mMessage = std::move(xdrBytes);
-    mWriteQueue.emplace_back(std::move(msg));
+    size_t size = msg.wireSize();
+    msg.mTimed.mEnqueuedTime = mApp.getClock().now();
+    mWriteQueue.push(writeQueueClass(type), std::move(msg));
+
+    if (mWriting)
+    {
+        return;
+    }
 
-    if (!mWriting)
+    if (canHoldBack(type, size))
     {
-        mWriting = true;
-        messageSender();
+        // The first message held back sets the deadline for all of them.
+        if (mHeldBackBytes == 0)
+        {
+            std::weak_ptr<TCPPeer> weak =
+                static_pointer_cast<TCPPeer>(shared_from_this());
+            mWriteDelayTimer.expires_from_now(std::chrono::milliseconds(
+                mApp.getConfig().MAX_BATCH_WRITE_DELAY_MS));
+            mWriteDelayTimer.async_wait(
+                [weak]() {
+                    auto self = weak.lock();
+                    if (self && !self->mWriting && !self->shouldAbort())
+                    {
+                        self->startWriting();
+                    }
+                },
+                &VirtualTimer::onFailureNoop);
+        }
+        mHeldBackBytes += size;
+        return;
     }
+
+    startWriting();
+}
+
+bool
+TCPPeer::canHoldBack(MessageType type, size_t size) const
+{
+    auto const& cfg = mApp.getConfig();
+    if (cfg.MAX_BATCH_WRITE_DELAY_MS == 0 ||
+        (type != TRANSACTION && type != FLOOD_ADVERT && type != FLOOD_DEMAND &&
+         type != FLOOD_ADVERT_SHORT && type != FLOOD_EXPAND &&
+         type != FLOOD_DEMAND_SHORT))
+    {
+        return false;
+    }
+    // Stop waiting once a full batch is queued up.
+    auto maxCount = static_cast<size_t>(cfg.MAX_BATCH_WRITE_COUNT);
+    auto maxBytes = static_cast<size_t>(cfg.MAX_BATCH_WRITE_BYTES);
+    return mWriteQueue.size() < maxCount && mHeldBackBytes + size < maxBytes;
+}
+
+void
+TCPPeer::startWriting()
+{
+    if (mHeldBackBytes != 0)
+    {
+        mWriteDelayTimer.cancel();
+        mHeldBackBytes = 0;
+    }
+    mWriting = true;
+    messageSender();
 }
 
 void
@@ -168,6 +241,9 @@ TCPPeer::shutdown()
 
     mRecurringTimer.cancel();
     mShutdownScheduled = true;
+    // Nothing is queued past this point, and this peer may outlive the
+    // application: release the write queue depths while the metrics exist.
+    mWriteQueue.clear();
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
     // To shutdown, we first queue up our desire to shutdown in the strand,
@@ -238,35 +314,41 @@ TCPPeer::messageSender()
         return;
     }
 
-    // Take a snapshot of the contents of mWriteQueue into mWriteBuffers, in
-    // terms of asio::const_buffers pointing into the elements of mWriteQueue,
-    // and then issue a single multi-buffer ("scatter-gather") async_write that
-    // covers the whole snapshot. We'll get called back when the batch is
-    // completed, at which point we'll clear mWriteBuffers and remove the entire
-    // snapshot worth of corresponding messages from mWriteQueue (though it may
-    // have grown a bit in the meantime -- we remove only a prefix).
+    // Move the next batch out of mWriteQueue into mWriteBatch, by priority,
+    // authenticating messages in the order they will be written. Then issue a
+    // single multi-buffer ("scatter-gather") async_write that covers the whole
+    // batch, with mWriteBuffers pointing into the elements of mWriteBatch.
+    // We'll get called back when the batch is completed, at which point we'll
+    // clear mWriteBuffers and mWriteBatch.
     releaseAssert(mWriteBuffers.empty());
+    releaseAssert(mWriteBatch.empty());
     auto now = mApp.getClock().now();
     size_t expected_length = 0;
-    size_t maxQueueSize = mApp.getConfig().MAX_BATCH_WRITE_COUNT;
+    size_t const maxQueueSize = mApp.getConfig().MAX_BATCH_WRITE_COUNT;
     releaseAssert(maxQueueSize > 0);
     size_t const maxTotalBytes = mApp.getConfig().MAX_BATCH_WRITE_BYTES;
-    for (auto& tsm : mWriteQueue)
+    mWriteQueue.popBatch(mWriteBatch, maxQueueSize, maxTotalBytes);
+    for (auto& qw : mWriteBatch)
     {
+        auto& tsm = qw.mTimed;
+        if (!tsm.mMessage)
+        {
+            tsm.mMessage = authenticateBody(*qw.mBody);
+            qw.mBody.reset();
+        }
         tsm.mIssuedTime = now;
         size_t sz = tsm.mMessage->raw_size();
         mWriteBuffers.emplace_back(tsm.mMessage->raw_data(), sz);
         expected_length += sz;
-        mEnqueueTimeOfLastWrite = tsm.mEnqueuedTime;
-        // check if we reached any limit
-        if (expected_length >= maxTotalBytes)
-            break;
-        if (--maxQueueSize == 0)
-            break;
+        if (tsm.mEnqueuedTime > mEnqueueTimeOfLastWrite)
+        {
+            mEnqueueTimeOfLastWrite = tsm.mEnqueuedTime;
+        }
     }
 
     CLOG_DEBUG(Overlay, "messageSender {} - b:{} n:{}/{}", toString(),
-               expected_length, mWriteBuffers.size(), mWriteQueue.size());
+               expected_length, mWriteBuffers.size(),
+               mWriteBuffers.size() + mWriteQueue.size());
     getOverlayMetrics().mAsyncWrite.Mark();
     mPeerMetrics.mAsyncWrite++;
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
@@ -283,26 +365,18 @@ TCPPeer::messageSender()
                           self->writeHandler(ec, length,
                                              self->mWriteBuffers.size());
 
-                          // Walk through a _prefix_ of the write queue
-                          // _corresponding_ to the write buffers we just sent.
-                          // While walking, record the sent-time in metrics, but
-                          // also advance iterator 'i' so we wind up with an
-                          // iterator range to erase from the front of the write
-                          // queue.
+                          // Record the sent-time of the batch we just sent
+                          // in metrics, then forget about it.
                           auto now = self->mApp.getClock().now();
-                          auto i = self->mWriteQueue.begin();
-                          while (!self->mWriteBuffers.empty())
+                          for (auto& qw : self->mWriteBatch)
                           {
-                              i->mCompletedTime = now;
-                              i->recordWriteTiming(self->getOverlayMetrics(),
-                                                   self->mPeerMetrics);
-                              ++i;
-                              self->mWriteBuffers.pop_back();
+                              qw.mTimed.mCompletedTime = now;
+                              qw.mTimed.recordWriteTiming(
+                                  self->getOverlayMetrics(),
+                                  self->mPeerMetrics);
                           }
-
-                          // Erase the messages from the write queue that we
-                          // just forgot about the buffers for.
-                          self->mWriteQueue.erase(self->mWriteQueue.begin(), i);
+                          self->mWriteBuffers.clear();
+                          self->mWriteBatch.clear();
 
                           // continue processing the queue
                           if (!ec)
@@ -588,9 +662,9 @@ TCPPeer::connected()
 bool
 TCPPeer::sendQueueIsOverloaded() const
 {
-    auto now = mApp.getClock().now();
-    return (!mWriteQueue.empty() && (now - mWriteQueue.front().mEnqueuedTime) >
-                                        SCHEDULER_LATENCY_WINDOW);
+    auto oldest = mWriteQueue.oldestEnqueuedTime();
+    return oldest &&
+           (mApp.getClock().now() - *oldest) > SCHEDULER_LATENCY_WINDOW;
 }
 
 void
@@ -669,6 +743,15 @@ TCPPeer::recvMessage()
     assertThreadIsMain();
     releaseAssert(hasReadingCapacity());
 
+    // Only authenticated peers, whose receiving MAC key is fixed, go through
+    // the overlay thread; the handshake is processed in line.
+    if (mApp.getConfig().EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING &&
+        isAuthenticated())
+    {
+        decodeOnOverlayThread();
+        return;
+    }
+
     try
     {
         xdr::xdr_get g(mIncomingBody.data(),
@@ -692,6 +775,112 @@ TCPPeer::recvMessage()
     }
 }
 
+void
+TCPPeer::decodeOnOverlayThread()
+{
+    ZoneScoped;
+    // The overlay thread decodes the message and checks its MAC against a
+    // copy of the key; the MAC sequence number is still checked on the main
+    // thread, in the order messages were read.
+    ++mMessagesBeingDecoded;
+    std::weak_ptr<TCPPeer> weak =
+        static_pointer_cast<TCPPeer>(shared_from_this());
+    mApp.postOnOverlayThread(
+        [&app = mApp, weak, queue = mDecodedMessages, macKey = mRecvMacKey,
+         blake2Mac = mBlake2MacEnabled,
+         &verifyTimer = getOverlayMetrics().mMacVerifyTimer,
+         body = std::move(mIncomingBody)]() {
+            ZoneNamedN(decodeZone, "decode message", true);
+            DecodedMessage decoded;
+            try
+            {
+                xdr::xdr_get g(body.data(), body.data() + body.size());
+                decoded.mMessage.emplace();
+                xdr::xdr_argpack_archive(g, *decoded.mMessage);
+                if (decoded.mMessage->v0().message.type() != ERROR_MSG)
+                {
+                    auto timer = verifyTimer.TimeScope();
+                    decoded.mMacValid =
+                        verifyMac(*decoded.mMessage, macKey, blake2Mac);
+                }
+            }
+            catch (xdr::xdr_runtime_error& e)
+            {
+                decoded.mMessage.reset();
+                decoded.mError = e.what();
+            }
+
+            bool wasEmpty = false;
+            {
+                std::lock_guard<std::mutex> lock(queue->mMutex);
+                wasEmpty = queue->mMessages.empty();
+                queue->mMessages.emplace_back(std::move(decoded));
+            }
+            // A delivery is already pending if the queue was not empty.
+            if (wasEmpty)
+            {
+                app.postOnMainThread(
+                    [weak]() {
+                        auto self = weak.lock();
+                        if (self)
+                        {
+                            self->deliverDecodedMessages();
+                        }
+                    },
+                    "TCPPeer::deliverDecodedMessages");
+            }
+        },
+        "TCPPeer::decodeOnOverlayThread");
+}
+
+void
+TCPPeer::deliverDecodedMessages()
+{
+    ZoneScoped;
+    assertThreadIsMain();
+    std::deque<DecodedMessage> messages;
+    {
+        std::lock_guard<std::mutex> lock(mDecodedMessages->mMutex);
+        messages.swap(mDecodedMessages->mMessages);
+    }
+
+    for (auto& decoded : messages)
+    {
+        releaseAssert(mMessagesBeingDecoded > 0);
+        --mMessagesBeingDecoded;
+        if (shouldAbort())
+        {
+            continue;
+        }
+        if (!decoded.mMessage)
+        {
+            CLOG_ERROR(Overlay, "recvMessage got a corrupt xdr: {}",
+                       decoded.mError);
+            sendErrorAndDrop(ERR_DATA, "received corrupt XDR",
+                             Peer::DropMode::IGNORE_WRITE_QUEUE);
+            continue;
+        }
+        try
+        {
+            Peer::recvMessage(*decoded.mMessage, decoded.mMacValid);
+        }
+        catch (CryptoError const& e)
+        {
+            CLOG_ERROR(Overlay, "Crypto error: {}", e.what());
+            sendErrorAndDrop(ERR_DATA, "crypto error",
+                             Peer::DropMode::IGNORE_WRITE_QUEUE);
+        }
+    }
+
+    // Reading may have stopped only because of messages that were being
+    // decoded, and that never took up any capacity once delivered.
+    if (mIsPeerThrottled && !shouldAbort() && hasReadingCapacity())
+    {
+        mIsPeerThrottled = false;
+        scheduleRead();
+    }
+}
+
 void
 TCPPeer::drop(std::string const& reason, DropDirection dropDirection,
               DropMode dropMode)
@@ -725,6 +914,12 @@ TCPPeer::drop(std::string const& reason, DropDirection dropDirection,
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
     getApp().getOverlayManager().removePeer(this);
 
+    if (dropMode == Peer::DropMode::FLUSH_WRITE_QUEUE && !mWriting &&
+        mHeldBackBytes != 0)
+    {
+        startWriting();
+    }
+
     // if write queue is not empty, messageSender will take care of shutdown
     if ((dropMode == Peer::DropMode::IGNORE_WRITE_QUEUE) || !mWriting)
     {
@@ -5,8 +5,11 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/Peer.h"
+#include "overlay/PriorityWriteQueue.h"
 #include "util/Timer.h"
 #include <deque>
+#include <mutex>
+#include <optional>
 
 namespace medida
 {
@@ -31,15 +34,48 @@ class TCPPeer : public Peer
     std::vector<uint8_t> mIncomingHeader;
     std::vector<uint8_t> mIncomingBody;
 
+    // A message decoded on the overlay thread. mMessage is empty if the
+    // message was not valid XDR, in which case mError says why.
+    struct DecodedMessage
+    {
+        std::optional<AuthenticatedMessage> mMessage;
+        std::optional<bool> mMacValid;
+        std::string mError;
+    };
+
+    // Messages handed back by the overlay thread, in the order they were
+    // read. Shared with the overlay thread, which never touches the peer.
+    struct DecodedMessageQueue
+    {
+        std::mutex mMutex;
+        std::deque<DecodedMessage> mMessages;
+    };
+    std::shared_ptr<DecodedMessageQueue> mDecodedMessages;
+
+    // Messages waiting to be written, and the batch being written, which
+    // mWriteBuffers point into.
+    PriorityWriteQueue mWriteQueue;
+    std::vector<QueuedWrite> mWriteBatch;
     std::vector<asio::const_buffer> mWriteBuffers;
-    std::deque<TimestampedMessage> mWriteQueue;
     bool mWriting{false};
+
+    // While no write is in flight, small flood messages wait in mWriteQueue
+    // for up to MAX_BATCH_WRITE_DELAY_MS so that they go out together.
+    // mHeldBackBytes is the size of what is waiting.
+    VirtualTimer mWriteDelayTimer;
+    size_t mHeldBackBytes{0};
     bool mDelayedShutdown{false};
     bool mShutdownScheduled{false};
 
     void recvMessage();
-    void sendMessage(xdr::msg_ptr&& xdrBytes) override;
-
+    void decodeOnOverlayThread();
+    void deliverDecodedMessages();
+    void sendMessage(xdr::msg_ptr&& xdrBytes, MessageType type) override;
+    void sendAuthenticatedBody(EncodedMessage body, MessageType type) override;
+    void enqueueWrite(QueuedWrite&& msg, MessageType type);
+
+    bool canHoldBack(MessageType type, size_t size) const;
+    void startWriting();
     void messageSender();
 
     size_t getIncomingMsgLength();
@@ -17,6 +17,7 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <algorithm>
 
 namespace hcnet
 {
@@ -24,14 +25,56 @@ namespace hcnet
 static std::chrono::milliseconds const MS_TO_WAIT_FOR_FETCH_REPLY{1500};
 static int const MAX_REBUILD_FETCH_LIST = 10;
 
-Tracker::Tracker(Application& app, Hash const& hash, AskPeer& askPeer)
+// The fetch timeout is FETCH_TIMEOUT_FACTOR times the
+// FETCH_TIMEOUT_PERCENTILE of the last FETCH_REPLY_SAMPLES reply times,
+// within [MIN_FETCH_TIMEOUT, MS_TO_WAIT_FOR_FETCH_REPLY]. Until
+// MIN_FETCH_REPLY_SAMPLES replies were seen, MS_TO_WAIT_FOR_FETCH_REPLY is
+// used.
+static std::chrono::milliseconds const MIN_FETCH_TIMEOUT{200};
+static size_t const FETCH_REPLY_SAMPLES = 64;
+static size_t const MIN_FETCH_REPLY_SAMPLES = 16;
+static double const FETCH_TIMEOUT_PERCENTILE = 0.95;
+static int const FETCH_TIMEOUT_FACTOR = 2;
+
+void
+FetchReplyTimes::add(std::chrono::milliseconds replyTime)
+{
+    mSamples.emplace_back(replyTime);
+    if (mSamples.size() > FETCH_REPLY_SAMPLES)
+    {
+        mSamples.pop_front();
+    }
+}
+
+std::chrono::milliseconds
+FetchReplyTimes::getTimeout() const
+{
+    if (mSamples.size() < MIN_FETCH_REPLY_SAMPLES)
+    {
+        return MS_TO_WAIT_FOR_FETCH_REPLY;
+    }
+    std::vector<std::chrono::milliseconds> sorted(mSamples.begin(),
+                                                  mSamples.end());
+    auto nth = sorted.begin() + static_cast<size_t>(FETCH_TIMEOUT_PERCENTILE *
+                                                    (sorted.size() - 1));
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return std::clamp(*nth * FETCH_TIMEOUT_FACTOR, MIN_FETCH_TIMEOUT,
+                      MS_TO_WAIT_FOR_FETCH_REPLY);
+}
+
+Tracker::Tracker(Application& app, Hash const& hash, AskPeer& askPeer,
+                 FetchReplyTimes& replyTimes)
     : mAskPeer(askPeer)
     , mApp(app)
+    , mReplyTimes(replyTimes)
     , mNumListRebuild(0)
     , mTimer(app)
     , mItemHash(hash)
     , mTryNextPeer(
           app.getOverlayManager().getOverlayMetrics().mItemFetcherNextPeer)
+    , mHedge(app.getOverlayManager().getOverlayMetrics().mItemFetcherHedge)
+    , mReplyTimer(
+          app.getOverlayManager().getOverlayMetrics().mItemFetcherReplyTimer)
     , mFetchTime("fetch-" + hexAbbrev(hash), LogSlowExecution::Mode::MANUAL)
 {
     releaseAssert(mAskPeer);
@@ -74,6 +117,8 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
 
     mTimer.cancel();
     mLastAskedPeer = nullptr;
+    mPendingPeers.clear();
+    mAskTimes.clear();
 
     return false;
 }
@@ -81,10 +126,14 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
 void
 Tracker::doesntHave(Peer::pointer peer)
 {
-    if (mLastAskedPeer == peer)
+    if (mPendingPeers.erase(peer) != 0)
     {
-        CLOG_TRACE(Overlay, "Does not have {}", hexAbbrev(mItemHash));
-        tryNextPeer();
+        CLOG_TRACE(Overlay, "{} does not have {}", peer->toString(),
+                   hexAbbrev(mItemHash));
+        if (mPendingPeers.empty())
+        {
+            tryNextPeer();
+        }
     }
 }
 
@@ -102,6 +151,7 @@ Tracker::tryNextPeer()
         mTryNextPeer.Mark();
         mLastAskedPeer.reset();
     }
+    mPendingPeers.clear();
 
     auto canAskPeer = [&](Peer::pointer const& p, bool peerHas) {
         auto it = mPeersAsked.find(p);
@@ -199,11 +249,52 @@ Tracker::tryNextPeer()
     }
     else
     {
-        mPeersAsked[mLastAskedPeer] = peerWithEnvelopeSelected;
-        CLOG_TRACE(Overlay, "Asking for {} to {}", hexAbbrev(mItemHash),
-                   mLastAskedPeer->toString());
-        mAskPeer(mLastAskedPeer, mItemHash);
-        nextTry = MS_TO_WAIT_FOR_FETCH_REPLY;
+        auto ask = [&](Peer::pointer const& p, bool peerHas) {
+            mPeersAsked[p] = peerHas;
+            mPendingPeers.emplace(p);
+            mAskTimes.emplace(p, mApp.getClock().now());
+            CLOG_TRACE(Overlay, "Asking for {} to {}", hexAbbrev(mItemHash),
+                       p->toString());
+            mAskPeer(p, mItemHash);
+        };
+        ask(mLastAskedPeer, peerWithEnvelopeSelected);
+
+        // hedge with the nearest other peers we can ask, whether they
+        // advertised the envelope or not
+        auto hedgeCount = mApp.getConfig().ITEM_FETCH_HEDGE_PEERS;
+        if (hedgeCount != 0)
+        {
+            std::vector<std::pair<Peer::pointer, bool>> hedges;
+            auto addHedges =
+                [&](std::map<NodeID, Peer::pointer> const& peerMap) {
+                    for (auto const& mp : peerMap)
+                    {
+                        auto const& p = mp.second;
+                        bool peerHas =
+                            newPeersWithEnvelope.count(mp.first) != 0;
+                        if (p != mLastAskedPeer && canAskPeer(p, peerHas))
+                        {
+                            hedges.emplace_back(p, peerHas);
+                        }
+                    }
+                };
+            addHedges(mApp.getOverlayManager().getInboundAuthenticatedPeers());
+            addHedges(
+                mApp.getOverlayManager().getOutboundAuthenticatedPeers());
+
+            hedgeCount = std::min<size_t>(hedgeCount, hedges.size());
+            std::partial_sort(hedges.begin(), hedges.begin() + hedgeCount,
+                              hedges.end(), [](auto const& a, auto const& b) {
+                                  return a.first->getPing() <
+                                         b.first->getPing();
+                              });
+            for (size_t i = 0; i < hedgeCount; ++i)
+            {
+                ask(hedges[i].first, hedges[i].second);
+            }
+            mHedge.Mark(hedgeCount);
+        }
+        nextTry = mReplyTimes.getTimeout();
     }
 
     mTimer.expires_from_now(nextTry);
@@ -263,6 +354,29 @@ Tracker::cancel()
     mLastSeenSlotIndex = 0;
 }
 
+void
+Tracker::replied(Peer::pointer peer)
+{
+    auto it = mAskTimes.find(peer);
+    if (it != mAskTimes.end())
+    {
+        auto replyTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            mApp.getClock().now() - it->second);
+        mReplyTimes.add(replyTime);
+        mReplyTimer.Update(replyTime);
+        mAskTimes.erase(it);
+    }
+}
+
+void
+Tracker::received()
+{
+    // there is no way to withdraw the requests, but late DONT_HAVE replies
+    // must not start a new round
+    mLastAskedPeer.reset();
+    mPendingPeers.clear();
+}
+
 std::chrono::milliseconds
 Tracker::getDuration()
 {
@@ -12,6 +12,12 @@
  * with new set of peers (possibly overlapping, as peers may learned about
  * this data set in meantime).
  *
+ * With ITEM_FETCH_HEDGE_PEERS set, each round also asks that many other
+ * peers, those with the lowest round-trip time, so the data arrives from
+ * whichever answers first. A round ends when all asked peers said they do not
+ * have the data, or when the fetch timeout expires. The timeout adapts to how
+ * long peers recently took to reply, see FetchReplyTimes.
+ *
  * For asking a AskPeer delegate is used.
  *
  * Tracker keeps list of envelopes that requires given data set to be
@@ -25,8 +31,10 @@
 #include "util/Timer.h"
 #include "xdr/Hcnet-types.h"
 
+#include <deque>
 #include <functional>
 #include <map>
+#include <set>
 #include <utility>
 #include <vector>
 
@@ -37,12 +45,36 @@ class Application;
 
 using AskPeer = std::function<void(Peer::pointer, Hash)>;
 
+/**
+ * Times peers recently took from being asked to sending the data, shared
+ * by the trackers of an ItemFetcher. Fetches are abandoned for the next
+ * round after a multiple of a high percentile of these times, so that an
+ * unresponsive peer costs little more than a typical reply.
+ */
+class FetchReplyTimes
+{
+    std::deque<std::chrono::milliseconds> mSamples;
+
+  public:
+    void add(std::chrono::milliseconds replyTime);
+
+    /**
+     * Return how long to wait for a reply before asking other peers.
+     */
+    std::chrono::milliseconds getTimeout() const;
+};
+
 class Tracker
 {
   private:
     AskPeer mAskPeer;
     Application& mApp;
+    FetchReplyTimes& mReplyTimes;
     Peer::pointer mLastAskedPeer;
+    // peers asked in the current round that did not reply yet
+    std::set<Peer::pointer> mPendingPeers;
+    // when each peer was first asked during this fetch, until it replies
+    std::map<Peer::pointer, VirtualClock::time_point> mAskTimes;
     int mNumListRebuild;
     // keep track of which peer we asked, and if we thought if it had the data
     // or not at the time
@@ -51,15 +83,19 @@ class Tracker
     std::vector<std::pair<Hash, SCPEnvelope>> mWaitingEnvelopes;
     Hash mItemHash;
     medida::Meter& mTryNextPeer;
+    medida::Meter& mHedge;
+    medida::Timer& mReplyTimer;
     uint64 mLastSeenSlotIndex{0};
     LogSlowExecution mFetchTime;
 
   public:
     /**
      * Create Tracker that tracks data identified by @p hash. @p askPeer
-     * delegate is used to fetch the data.
+     * delegate is used to fetch the data, and @p replyTimes to set the fetch
+     * timeout.
      */
-    explicit Tracker(Application& app, Hash const& hash, AskPeer& askPeer);
+    explicit Tracker(Application& app, Hash const& hash, AskPeer& askPeer,
+                     FetchReplyTimes& replyTimes);
     virtual ~Tracker();
 
     /**
@@ -123,9 +159,22 @@ class Tracker
      */
     void cancel();
 
+    /**
+     * Called when the data was received. Ignores further DONT_HAVE replies
+     * from the peers that were asked.
+     */
+    void received();
+
+    /**
+     * Called when given @p peer sent the data. Records how long it took to
+     * reply, from when it was first asked, even if the data arrived from
+     * another peer first or the round it was asked in timed out.
+     */
+    void replied(Peer::pointer peer);
+
     /**
      * Called when given @p peer informs that it does not have given data.
-     * Next peer will be tried if available.
+     * Next peers will be tried if no other peer asked may still have it.
      */
     void doesntHave(Peer::pointer peer);
 
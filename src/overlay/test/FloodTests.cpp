@@ -10,6 +10,8 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/meter.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayMetrics.h"
 #include "overlay/PeerDoor.h"
@@ -197,6 +199,35 @@ TEST_CASE("Flooding", "[flood][overlay][acceptance]")
                                               networkID, cfgGen2);
                 test(injectTransaction, ackedTransactions, true);
             }
+            SECTION("tcp with background overlay processing")
+            {
+                auto cfgGenBackground = [cfgGen2](int n) {
+                    auto cfg = cfgGen2(n);
+                    cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = true;
+                    return cfg;
+                };
+                simulation = Topologies::core(4, .666f, Simulation::OVER_TCP,
+                                              networkID, cfgGenBackground);
+                test(injectTransaction, ackedTransactions, true);
+                for (auto const& node : nodes)
+                {
+                    REQUIRE(node->getMetrics()
+                                .NewTimer({"app", "post-on-overlay-thread",
+                                           "delay"})
+                                .count() > 0);
+                }
+            }
+            SECTION("tcp with delayed batch writes")
+            {
+                auto cfgGenDelayed = [cfgGen2](int n) {
+                    auto cfg = cfgGen2(n);
+                    cfg.MAX_BATCH_WRITE_DELAY_MS = 20;
+                    return cfg;
+                };
+                simulation = Topologies::core(4, .666f, Simulation::OVER_TCP,
+                                              networkID, cfgGenDelayed);
+                test(injectTransaction, ackedTransactions, true);
+            }
             auto cfgGenPullMode = [&](int n) {
                 auto cfg = getTestConfig(n);
                 // adjust delayed tx flooding
@@ -11,6 +11,7 @@
 #include "medida/metrics_registry.h"
 #include "overlay/ItemFetcher.h"
 #include "overlay/OverlayManager.h"
+#include "overlay/OverlayMetrics.h"
 #include "overlay/Tracker.h"
 #include "overlay/test/LoopbackPeer.h"
 #include "simulation/Simulation.h"
@@ -375,4 +376,87 @@ TEST_CASE("next peer strategy", "[overlay][ItemFetcher]")
         }
     }
 }
+
+TEST_CASE("hedged fetch", "[overlay][ItemFetcher]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto sim =
+        std::make_shared<Simulation>(Simulation::OVER_LOOPBACK, networkID);
+
+    auto cfgMain = getTestConfig(1);
+    cfgMain.ITEM_FETCH_HEDGE_PEERS = 1;
+    auto cfg1 = getTestConfig(2);
+    auto cfg2 = getTestConfig(3);
+
+    SIMULATION_CREATE_NODE(Main);
+    SIMULATION_CREATE_NODE(Node1);
+    SIMULATION_CREATE_NODE(Node2);
+    sim->addNode(vMainSecretKey, cfgMain.QUORUM_SET, &cfgMain);
+    sim->addNode(vNode1SecretKey, cfg1.QUORUM_SET, &cfg1);
+    sim->addNode(vNode2SecretKey, cfg2.QUORUM_SET, &cfg2);
+    sim->addPendingConnection(vMainNodeID, vNode1NodeID);
+    sim->addPendingConnection(vMainNodeID, vNode2NodeID);
+    sim->startAllNodes();
+    auto peer1 =
+        sim->getLoopbackConnection(vMainNodeID, vNode1NodeID)->getInitiator();
+    auto peer2 =
+        sim->getLoopbackConnection(vMainNodeID, vNode2NodeID)->getInitiator();
+    sim->crankUntil(
+        [&]() { return peer1->isAuthenticated() && peer2->isAuthenticated(); },
+        std::chrono::seconds{3}, false);
+
+    auto app = sim->getNode(vMainNodeID);
+    auto& metrics = app->getOverlayManager().getOverlayMetrics();
+    auto hedgeCount = metrics.mItemFetcherHedge.count();
+    auto replyCount = metrics.mItemFetcherReplyTimer.count();
+
+    std::vector<Peer::pointer> asked;
+    ItemFetcher itemFetcher(
+        *app, [&](Peer::pointer peer, Hash) { asked.emplace_back(peer); });
+
+    // both peers are asked at once
+    auto hundredEnvelope = makeEnvelope(100);
+    auto hundred = sha256(ByteSlice("100"));
+    itemFetcher.fetch(hundred, hundredEnvelope);
+    REQUIRE(asked.size() == 2);
+    REQUIRE(std::count(asked.begin(), asked.end(), peer1) == 1);
+    REQUIRE(std::count(asked.begin(), asked.end(), peer2) == 1);
+    REQUIRE(metrics.mItemFetcherHedge.count() == hedgeCount + 1);
+    auto tracker = itemFetcher.getTracker(hundred);
+    REQUIRE(tracker);
+
+    SECTION("round ends when no peer has it")
+    {
+        itemFetcher.doesntHave(hundred, asked[0]);
+        REQUIRE(tracker->getLastAskedPeer());
+        itemFetcher.doesntHave(hundred, asked[1]);
+        // ran out of peers
+        REQUIRE(!tracker->getLastAskedPeer());
+        REQUIRE(asked.size() == 2);
+    }
+    SECTION("first reply ends the fetch")
+    {
+        sim->crankForAtLeast(std::chrono::milliseconds(100), false);
+        auto& timer = app->getMetrics().NewTimer({"overlay", "fetch", "test"});
+        itemFetcher.replied(hundred, asked[0]);
+        itemFetcher.recv(hundred, timer);
+        REQUIRE(metrics.mItemFetcherReplyTimer.count() == replyCount + 1);
+
+        // a peer's reply is timed once, from when it was asked, even after
+        // the data arrived from another peer
+        sim->crankForAtLeast(std::chrono::milliseconds(500), false);
+        itemFetcher.replied(hundred, asked[0]);
+        REQUIRE(metrics.mItemFetcherReplyTimer.count() == replyCount + 1);
+        itemFetcher.replied(hundred, asked[1]);
+        REQUIRE(metrics.mItemFetcherReplyTimer.count() == replyCount + 2);
+        REQUIRE(metrics.mItemFetcherReplyTimer.max() >= 600);
+
+        // late replies do not start a new round
+        itemFetcher.doesntHave(hundred, asked[0]);
+        itemFetcher.doesntHave(hundred, asked[1]);
+        REQUIRE(!tracker->getLastAskedPeer());
+        sim->crankForAtLeast(std::chrono::seconds(5), false);
+        REQUIRE(asked.size() == 2);
+    }
+}
 }
@@ -23,7 +23,8 @@ using namespace std;
 // LoopbackPeer
 ///////////////////////////////////////////////////////////////////////
 
-LoopbackPeer::LoopbackPeer(Application& app, PeerRole role) : Peer(app, role)
+LoopbackPeer::LoopbackPeer(Application& app, PeerRole role)
+    : Peer(app, role), mLatencyTimer(app)
 {
 }
 
@@ -51,7 +52,7 @@ LoopbackPeer::scheduleRead()
 }
 
 void
-LoopbackPeer::sendMessage(xdr::msg_ptr&& msg)
+LoopbackPeer::sendMessage(xdr::msg_ptr&& msg, MessageType type)
 {
     if (mRemote.expired())
     {
@@ -243,23 +244,18 @@ LoopbackPeer::deliverOne()
 
         mEnqueueTimeOfLastWrite = msg.mEnqueuedTime;
 
-        // Pass ownership of a serialized XDR message buffer to a recvMesage
-        // callback event against the remote Peer, posted on the remote
-        // Peer's io_context.
-        auto remote = mRemote.lock();
-        if (remote)
+        if (mLatency.count() > 0)
+        {
+            mInFlight.emplace_back(mApp.getClock().now() + mLatency,
+                                   std::move(msg.mMessage));
+            if (mInFlight.size() == 1)
+            {
+                armLatencyTimer();
+            }
+        }
+        else
         {
-            // move msg to remote's in queue
-            remote->mInQueue.emplace(std::move(msg.mMessage));
-            remote->getApp().postOnMainThread(
-                [remW = mRemote]() {
-                    auto remS = remW.lock();
-                    if (remS)
-                    {
-                        remS->processInQueue();
-                    }
-                },
-                "LoopbackPeer: processInQueue in deliverOne");
+            pushToRemote(std::move(msg.mMessage));
         }
         mLastWrite = mApp.getClock().now();
         getOverlayMetrics().mMessageWrite.Mark();
@@ -269,6 +265,57 @@ LoopbackPeer::deliverOne()
     }
 }
 
+void
+LoopbackPeer::pushToRemote(xdr::msg_ptr&& msg)
+{
+    // Pass ownership of a serialized XDR message buffer to a recvMesage
+    // callback event against the remote Peer, posted on the remote
+    // Peer's io_context.
+    auto remote = mRemote.lock();
+    if (remote)
+    {
+        // move msg to remote's in queue
+        remote->mInQueue.emplace(std::move(msg));
+        remote->getApp().postOnMainThread(
+            [remW = mRemote]() {
+                auto remS = remW.lock();
+                if (remS)
+                {
+                    remS->processInQueue();
+                }
+            },
+            "LoopbackPeer: processInQueue in deliverOne");
+    }
+}
+
+void
+LoopbackPeer::armLatencyTimer()
+{
+    auto weak = std::weak_ptr<LoopbackPeer>(
+        static_pointer_cast<LoopbackPeer>(shared_from_this()));
+    mLatencyTimer.expires_at(mInFlight.front().first);
+    mLatencyTimer.async_wait(
+        [weak]() {
+            auto self = weak.lock();
+            if (!self)
+            {
+                return;
+            }
+            auto now = self->mApp.getClock().now();
+            while (!self->mInFlight.empty() &&
+                   self->mInFlight.front().first <= now)
+            {
+                self->pushToRemote(std::move(self->mInFlight.front().second));
+                self->mInFlight.pop_front();
+            }
+            if (!self->mInFlight.empty())
+            {
+                self->armLatencyTimer();
+            }
+        },
+        &VirtualTimer::onFailureNoop);
+}
+
 void
 LoopbackPeer::deliverAll()
 {
@@ -319,10 +366,23 @@ LoopbackPeer::setCorked(bool c)
     mCorked = c;
 }
 
+std::chrono::milliseconds
+LoopbackPeer::getLatency() const
+{
+    return mLatency;
+}
+
+void
+LoopbackPeer::setLatency(std::chrono::milliseconds latency)
+{
+    mLatency = latency;
+}
+
 void
 LoopbackPeer::clearInAndOutQueues()
 {
     mOutQueue.clear();
+    mInFlight.clear();
     mInQueue = std::queue<xdr::msg_ptr>();
 }
 
@@ -28,6 +28,11 @@ class LoopbackPeer : public Peer
     std::deque<TimestampedMessage> mOutQueue; // sending queue
     std::queue<xdr::msg_ptr> mInQueue;        // receiving queue
 
+    // Messages delivered but still travelling to the remote for mLatency
+    std::deque<std::pair<VirtualClock::time_point, xdr::msg_ptr>> mInFlight;
+    std::chrono::milliseconds mLatency{0};
+    VirtualTimer mLatencyTimer;
+
     bool mCorked{false};
     bool mStraggling{false};
     size_t mMaxQueueDepth{0};
@@ -52,10 +57,12 @@ class LoopbackPeer : public Peer
 
     Stats mStats;
 
-    void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void sendMessage(xdr::msg_ptr&& xdrBytes, MessageType type) override;
     AuthCert getAuthCert() override;
 
     void processInQueue();
+    void pushToRemote(xdr::msg_ptr&& msg);
+    void armLatencyTimer();
 
     std::string mDropReason;
 
@@ -104,6 +111,10 @@ class LoopbackPeer : public Peer
     double getReorderProbability() const;
     void setReorderProbability(double d);
 
+    // One-way delay added to every message delivered to the remote
+    std::chrono::milliseconds getLatency() const;
+    void setLatency(std::chrono::milliseconds latency);
+
     void clearInAndOutQueues();
 
     std::string
@@ -134,6 +145,7 @@ class LoopbackPeer : public Peer
     using Peer::sendAuthenticatedMessage;
     using Peer::sendMessage;
     using Peer::sendSendMore;
+    using Peer::verifyMac;
 
     friend class LoopbackPeerConnection;
 };
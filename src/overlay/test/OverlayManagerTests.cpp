@@ -7,6 +7,8 @@
 #include "main/Config.h"
 
 #include "database/Database.h"
+#include "herder/Herder.h"
+#include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayManagerImpl.h"
@@ -52,7 +54,7 @@ class PeerStub : public Peer
     {
     }
     virtual void
-    sendMessage(xdr::msg_ptr&& xdrBytes) override
+    sendMessage(xdr::msg_ptr&& xdrBytes, MessageType type) override
     {
         sent++;
     }
@@ -293,6 +295,46 @@ class OverlayManagerTests
         crank(10);
         REQUIRE(sentCounts(pm) == expectedFinal);
     }
+
+    void
+    testFloodRecordExpiry()
+    {
+        OverlayManagerStub& pm = app->getOverlayManager();
+
+        pm.storePeerList(pm.resolvePeers(fourPeers).first, false, true);
+        pm.tick();
+        REQUIRE(pm.mOutboundPeers.mAuthenticated.size() == 4);
+        auto a = TestAccount{*app, getAccount("a")};
+        auto b = TestAccount{*app, getAccount("b")};
+        HcnetMessage AtoB = a.tx({payment(b, 10)})->toHcnetMessage();
+
+        auto peer = pm.mOutboundPeers.mAuthenticated.begin()->second;
+        Hash id;
+        REQUIRE(pm.recvFloodedMsgID(AtoB, peer, id));
+        REQUIRE(!pm.recvFloodedMsgID(AtoB, peer, id));
+        REQUIRE(pm.getPeersKnows(id) == std::set<Peer::pointer>{peer});
+
+        pm.broadcastMessage(AtoB, false, xdrSha256(AtoB.transaction()));
+        crank(10);
+        REQUIRE(sentCounts(pm) == std::vector<int>{0, 1, 1, 1});
+        REQUIRE(pm.getPeersKnows(id).size() == 4);
+
+        // Records are kept up to and including the ledger they were created
+        // for.
+        auto ledger = app->getHerder().trackingConsensusLedgerIndex();
+        auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+        pm.clearLedgersBelow(ledger, lcl);
+        REQUIRE(pm.getPeersKnows(id).size() == 4);
+        pm.clearLedgersBelow(ledger + 1, lcl);
+        REQUIRE(pm.getPeersKnows(id).empty());
+
+        // The message is new again, and goes to every peer.
+        REQUIRE(pm.recvFloodedMsgID(AtoB, peer, id));
+        pm.forgetFloodedMsg(id);
+        pm.broadcastMessage(AtoB, false, xdrSha256(AtoB.transaction()));
+        crank(10);
+        REQUIRE(sentCounts(pm) == std::vector<int>{1, 2, 2, 2});
+    }
 };
 
 TEST_CASE_METHOD(OverlayManagerTests, "storeConfigPeers() adds", "[overlay]")
@@ -316,4 +358,10 @@ TEST_CASE_METHOD(OverlayManagerTests, "broadcast() broadcasts", "[overlay]")
 {
     testBroadcast();
 }
+
+TEST_CASE_METHOD(OverlayManagerTests, "flood records expire by ledger",
+                 "[overlay][flood]")
+{
+    testFloodRecordExpiry();
+}
 }
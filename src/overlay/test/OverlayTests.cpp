@@ -2,12 +2,17 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/BLAKE2.h"
+#include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/Random.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "overlay/BanManager.h"
+#include "overlay/OverlayCompression.h"
 #include "overlay/OverlayManagerImpl.h"
 #include "overlay/PeerManager.h"
 #include "overlay/TCPPeer.h"
@@ -24,6 +29,7 @@
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
+#include <cstring>
 #include <fmt/format.h>
 #include <numeric>
 
@@ -129,6 +135,42 @@ TEST_CASE("loopback peer send auth before hello", "[overlay][connections]")
     testutil::shutdownWorkScheduler(*app1);
 }
 
+TEST_CASE("authenticated message bytes match AuthenticatedMessage",
+          "[overlay]")
+{
+    HmacSha256Key macKey = hkdfExtract(std::string("mac key"));
+    uint64_t sequence = 0x0102030405060708;
+
+    HcnetMessage msg;
+    SECTION("small message")
+    {
+        msg.type(GET_SCP_STATE);
+        msg.getSCPLedgerSeq() = 42;
+    }
+    SECTION("variable-length message")
+    {
+        msg.type(SCP_QUORUMSET);
+        msg.qSet().threshold = 2;
+        for (int i = 0; i < 3; ++i)
+        {
+            msg.qSet().validators.emplace_back(
+                SecretKey::pseudoRandomForTesting().getPublicKey());
+        }
+    }
+
+    AuthenticatedMessage amsg;
+    amsg.v0().message = msg;
+    amsg.v0().sequence = sequence;
+    amsg.v0().mac = hmacSha256(macKey, xdr::xdr_to_opaque(sequence, msg));
+    auto expected = xdr::xdr_to_msg(amsg);
+
+    auto actual = Peer::authenticatedMessageBytes(macKey, sequence,
+                                                  xdr::xdr_to_opaque(msg));
+    REQUIRE(actual->raw_size() == expected->raw_size());
+    REQUIRE(std::memcmp(actual->raw_data(), expected->raw_data(),
+                        expected->raw_size()) == 0);
+}
+
 TEST_CASE("loopback peer flow control activation", "[overlay][flowcontrol]")
 {
     VirtualClock clock;
@@ -256,6 +298,81 @@ TEST_CASE("drop peers that dont respect capacity", "[overlay][flowcontrol]")
     testutil::shutdownWorkScheduler(*app1);
 }
 
+TEST_CASE("flow control autotune", "[overlay][flowcontrol]")
+{
+    // Small static capacities, so that a 400ms round trip limits throughput
+    auto const latency = std::chrono::milliseconds(200);
+    uint32_t const capacity = 20;
+
+    // Returns how many transactions the initiator processes while the
+    // acceptor always has more queued for it
+    auto runTest = [&](bool autotune, Json::Value& fcInfo) {
+        VirtualClock clock;
+        Config cfg1 = getTestConfig(0);
+        Config cfg2 = getTestConfig(1);
+        for (auto cfg : {&cfg1, &cfg2})
+        {
+            cfg->PEER_FLOOD_READING_CAPACITY = capacity;
+            cfg->FLOW_CONTROL_SEND_MORE_BATCH_SIZE = capacity / 4;
+            cfg->FLOW_CONTROL_AUTOTUNE = autotune;
+        }
+
+        auto app1 = createTestApplication(clock, cfg1);
+        auto app2 = createTestApplication(clock, cfg2);
+
+        LoopbackPeerConnection conn(*app1, *app2);
+        conn.getInitiator()->setLatency(latency);
+        conn.getAcceptor()->setLatency(latency);
+        // Let the peers authenticate and measure their RTT
+        testutil::crankFor(clock, std::chrono::seconds(6));
+        REQUIRE(conn.getInitiator()->isAuthenticated());
+        REQUIRE(conn.getAcceptor()->isAuthenticated());
+        REQUIRE(conn.getInitiator()->getPing() >= 2 * latency);
+
+        // tx is invalid, but it doesn't matter
+        auto msg = std::make_shared<HcnetMessage>();
+        msg->type(TRANSACTION);
+        auto& recvTxs = app1->getMetrics().NewTimer(
+            {"overlay", "recv", "transaction"});
+        auto before = recvTxs.count();
+        auto end = clock.now() + std::chrono::seconds(20);
+        while (clock.now() < end)
+        {
+            while (conn.getAcceptor()->getQueues()[1].size() < capacity)
+            {
+                conn.getAcceptor()->sendMessage(msg);
+            }
+            clock.crank(false);
+        }
+        REQUIRE(conn.getInitiator()->isConnected());
+
+        fcInfo = conn.getInitiator()->getFlowControlJsonInfo(false);
+        auto received = recvTxs.count() - before;
+        testutil::shutdownWorkScheduler(*app2);
+        testutil::shutdownWorkScheduler(*app1);
+        return received;
+    };
+
+    Json::Value staticInfo;
+    auto staticReceived = runTest(false, staticInfo);
+    REQUIRE(!staticInfo.isMember("autotune"));
+    // Bounded by one window per round trip
+    REQUIRE(staticReceived <=
+            capacity + capacity * 20 * 1000 / (2 * latency.count()));
+
+    Json::Value autotuneInfo;
+    auto autotuneReceived = runTest(true, autotuneInfo);
+    auto const& at = autotuneInfo["autotune"];
+    REQUIRE(at["window"].asUInt64() > capacity);
+    REQUIRE(at["window"].asUInt64() <=
+            capacity * Peer::FLOW_CONTROL_AUTOTUNE_MAX_GROWTH);
+    REQUIRE(at["batch_size"].asUInt64() == at["window"].asUInt64() / 4);
+    REQUIRE(at["processing_latency"].asUInt64() <
+            static_cast<Json::UInt64>(
+                Peer::FLOW_CONTROL_AUTOTUNE_MAX_PROCESSING_LATENCY.count()));
+    REQUIRE(autotuneReceived > 2 * staticReceived);
+}
+
 TEST_CASE("drop idle flow-controlled peers", "[overlay][flowcontrol]")
 {
     VirtualClock clock;
@@ -2163,6 +2280,292 @@ TEST_CASE("pull mode enable only if both request", "[overlay][pullmode]")
     }
 }
 
+TEST_CASE("compact adverts enable only if both request", "[overlay][pullmode]")
+{
+    VirtualClock clock;
+    auto test = [&](bool node1, bool node2) {
+        Config cfg1 = getTestConfig(1);
+        cfg1.ENABLE_PULL_MODE = true;
+        cfg1.ENABLE_COMPACT_ADVERTS = node1;
+        auto app1 = createTestApplication(clock, cfg1);
+        Config cfg2 = getTestConfig(2);
+        cfg2.ENABLE_PULL_MODE = true;
+        cfg2.ENABLE_COMPACT_ADVERTS = node2;
+        auto app2 = createTestApplication(clock, cfg2);
+
+        auto conn = std::make_shared<LoopbackPeerConnection>(*app1, *app2);
+        testutil::crankSome(clock);
+
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        REQUIRE(conn->getAcceptor()->isAuthenticated());
+        REQUIRE(conn->getInitiator()->isPullModeEnabled());
+        REQUIRE(conn->getAcceptor()->isPullModeEnabled());
+        REQUIRE(conn->getInitiator()->isCompactAdvertsEnabled() ==
+                (node1 && node2));
+        REQUIRE(conn->getAcceptor()->isCompactAdvertsEnabled() ==
+                (node1 && node2));
+    };
+    SECTION("both enabled compact adverts")
+    {
+        test(true, true);
+    }
+    SECTION("acceptor disabled compact adverts")
+    {
+        test(true, false);
+    }
+    SECTION("initiator disabled compact adverts")
+    {
+        test(false, true);
+    }
+}
+
+TEST_CASE("compact adverts resolve short ids on request",
+          "[overlay][pullmode]")
+{
+    VirtualClock clock;
+    Config cfg1 = getTestConfig(1);
+    cfg1.ENABLE_PULL_MODE = true;
+    cfg1.ENABLE_COMPACT_ADVERTS = true;
+    auto app1 = createTestApplication(clock, cfg1);
+    Config cfg2 = getTestConfig(2);
+    cfg2.ENABLE_PULL_MODE = true;
+    cfg2.ENABLE_COMPACT_ADVERTS = true;
+    auto app2 = createTestApplication(clock, cfg2);
+
+    auto conn = std::make_shared<LoopbackPeerConnection>(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn->getInitiator()->isCompactAdvertsEnabled());
+
+    // Both ends of a connection derive the same short id.
+    Hash txHash = sha256("tx");
+    auto id = conn->getAcceptor()->rememberTxHash(txHash);
+    REQUIRE(id);
+    REQUIRE(conn->getInitiator()->rememberTxHash(txHash) == id);
+
+    auto sendFromInitiator = [&](HcnetMessage const& msg) {
+        conn->getInitiator()->sendMessage(
+            std::make_shared<HcnetMessage const>(msg));
+        testutil::crankSome(clock);
+    };
+    auto meterCount = [](Application::pointer app, std::string const& a,
+                         std::string const& b, std::string const& unit) {
+        return app->getMetrics().NewMeter({"overlay", a, b}, unit).count();
+    };
+
+    SECTION("expand")
+    {
+        HcnetMessage msg;
+        msg.type(FLOOD_EXPAND);
+        msg.floodExpand().txShortIds.emplace_back(*id);
+        msg.floodExpand().txShortIds.emplace_back(*id + 1);
+        sendFromInitiator(msg);
+
+        // Only the id known to app2 is answered, with its full hash.
+        REQUIRE(meterCount(app2, "flood", "expanded", "transaction") == 1);
+        REQUIRE(meterCount(app2, "send", "flood-advert", "message") == 1);
+    }
+    SECTION("demand")
+    {
+        HcnetMessage msg;
+        msg.type(FLOOD_DEMAND_SHORT);
+        msg.floodDemandShort().txShortIds.emplace_back(*id);
+        msg.floodDemandShort().txShortIds.emplace_back(*id + 1);
+        sendFromInitiator(msg);
+
+        // The known id is looked up as its hash, the other matches nothing;
+        // neither transaction is in app2's queue.
+        REQUIRE(numUnknownDemand(app2) == 2);
+        REQUIRE(meterCount(app2, "flood", "expanded", "transaction") == 0);
+    }
+}
+
+#ifdef USE_ZLIB
+TEST_CASE("overlay message compression", "[overlay][compression]")
+{
+    // Repetitive enough to compress well, and above the default
+    // OVERLAY_COMPRESSION_MIN_BYTES.
+    HcnetMessage msg;
+    msg.type(SCP_QUORUMSET);
+    msg.qSet().threshold = 1;
+    msg.qSet().validators.resize(200);
+    auto raw = xdr::xdr_to_opaque(msg);
+    REQUIRE(raw.size() > getTestConfig().OVERLAY_COMPRESSION_MIN_BYTES);
+
+    SECTION("dictionary")
+    {
+        // Peers must agree on every byte of it
+        REQUIRE(overlayCompressionDictionary().size() == 824);
+        REQUIRE(binToHex(sha256(overlayCompressionDictionary())) ==
+                "25e8704cbb8eb821cff373761ea9264591808488dfb0098006e9a9660938"
+                "d656");
+    }
+    SECTION("round trip")
+    {
+        auto compressed = compressMessage(raw);
+        REQUIRE(compressed);
+        REQUIRE(compressed->data.size() < raw.size() / 10);
+        REQUIRE(decompressMessage(*compressed) == raw);
+
+        auto corrupt = *compressed;
+        corrupt.uncompressedSize++;
+        REQUIRE_THROWS_AS(decompressMessage(corrupt), std::runtime_error);
+        corrupt = *compressed;
+        corrupt.data.resize(corrupt.data.size() / 2);
+        REQUIRE_THROWS_AS(decompressMessage(corrupt), std::runtime_error);
+        corrupt = *compressed;
+        corrupt.uncompressedSize = MAX_UNCOMPRESSED_MESSAGE_SIZE + 1;
+        REQUIRE_THROWS_AS(decompressMessage(corrupt), std::runtime_error);
+        corrupt = *compressed;
+        corrupt.data.resize(4);
+        corrupt.uncompressedSize = 4 * 1032 + 1;
+        REQUIRE_THROWS_AS(decompressMessage(corrupt), std::runtime_error);
+
+        // The densest possible payload is still accepted
+        xdr::opaque_vec<> zeros(MAX_UNCOMPRESSED_MESSAGE_SIZE);
+        auto dense = compressMessage(zeros);
+        REQUIRE(dense);
+        REQUIRE(decompressMessage(*dense) == zeros);
+
+        REQUIRE(!compressMessage(randomBytes(64)));
+    }
+
+    auto test = [&](bool node1, bool node2) {
+        VirtualClock clock;
+        Config cfg1 = getTestConfig(1);
+        cfg1.ENABLE_OVERLAY_COMPRESSION = node1;
+        auto app1 = createTestApplication(clock, cfg1);
+        Config cfg2 = getTestConfig(2);
+        cfg2.ENABLE_OVERLAY_COMPRESSION = node2;
+        auto app2 = createTestApplication(clock, cfg2);
+
+        auto conn = std::make_shared<LoopbackPeerConnection>(*app1, *app2);
+        testutil::crankSome(clock);
+
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        REQUIRE(conn->getAcceptor()->isAuthenticated());
+        bool enabled = node1 && node2;
+        REQUIRE(conn->getInitiator()->isCompressionEnabled() == enabled);
+        REQUIRE(conn->getAcceptor()->isCompressionEnabled() == enabled);
+
+        conn->getInitiator()->sendMessage(std::make_shared<HcnetMessage>(msg));
+        testutil::crankSome(clock);
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        REQUIRE(conn->getAcceptor()->isAuthenticated());
+
+        auto bytes = [](Application::pointer app, std::string const& name) {
+            return app->getMetrics()
+                .NewMeter({"overlay", "compression", name}, "byte")
+                .count();
+        };
+        if (enabled)
+        {
+            REQUIRE(bytes(app1, "send-raw") == raw.size());
+            REQUIRE(bytes(app1, "send-wire") < raw.size() / 10);
+            REQUIRE(bytes(app2, "recv-raw") == raw.size());
+            REQUIRE(bytes(app2, "recv-wire") == bytes(app1, "send-wire"));
+        }
+        else
+        {
+            REQUIRE(bytes(app1, "send-raw") == 0);
+            REQUIRE(bytes(app2, "recv-raw") == 0);
+        }
+    };
+    SECTION("both enabled compression")
+    {
+        test(true, true);
+    }
+    SECTION("acceptor disabled compression")
+    {
+        test(true, false);
+    }
+    SECTION("initiator disabled compression")
+    {
+        test(false, true);
+    }
+}
+#endif
+
+TEST_CASE("overlay blake2 mac", "[overlay][mac]")
+{
+    SECTION("message encoding")
+    {
+        HmacSha256Key macKey;
+        macKey.key[0] = 1;
+        HcnetMessage msg;
+        msg.type(GET_PEERS);
+        auto body = xdr::xdr_to_opaque(msg);
+
+        auto decode = [](xdr::msg_ptr const& bytes) {
+            AuthenticatedMessage amsg;
+            xdr::xdr_from_msg(bytes, amsg);
+            return amsg;
+        };
+        // AUTH, at sequence 0, is always MACed with HMAC-SHA256
+        auto first = decode(
+            Peer::authenticatedMessageBytes(macKey, 0, body, true));
+        REQUIRE(LoopbackPeer::verifyMac(first, macKey, true));
+        REQUIRE(LoopbackPeer::verifyMac(first, macKey, false));
+
+        auto next = decode(
+            Peer::authenticatedMessageBytes(macKey, 1, body, true));
+        REQUIRE(LoopbackPeer::verifyMac(next, macKey, true));
+        REQUIRE(!LoopbackPeer::verifyMac(next, macKey, false));
+        REQUIRE(next.v0().mac ==
+                blake2Mac(macKey, xdr::xdr_to_opaque(uint64_t(1), msg)));
+        macKey.key[0] = 2;
+        REQUIRE(!LoopbackPeer::verifyMac(next, macKey, true));
+    }
+
+    auto test = [&](bool node1, bool node2) {
+        VirtualClock clock;
+        Config cfg1 = getTestConfig(1);
+        cfg1.ENABLE_OVERLAY_BLAKE2_MAC = node1;
+        auto app1 = createTestApplication(clock, cfg1);
+        Config cfg2 = getTestConfig(2);
+        cfg2.ENABLE_OVERLAY_BLAKE2_MAC = node2;
+        auto app2 = createTestApplication(clock, cfg2);
+
+        auto conn = std::make_shared<LoopbackPeerConnection>(*app1, *app2);
+        testutil::crankSome(clock);
+
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        REQUIRE(conn->getAcceptor()->isAuthenticated());
+        bool enabled = node1 && node2;
+        REQUIRE(conn->getInitiator()->isBlake2MacEnabled() == enabled);
+        REQUIRE(conn->getAcceptor()->isBlake2MacEnabled() == enabled);
+
+        // Messages keep flowing both ways after the handshake
+        HcnetMessage msg;
+        msg.type(GET_PEERS);
+        conn->getInitiator()->sendMessage(std::make_shared<HcnetMessage>(msg));
+        conn->getAcceptor()->sendMessage(std::make_shared<HcnetMessage>(msg));
+        testutil::crankSome(clock);
+        REQUIRE(conn->getInitiator()->isAuthenticated());
+        REQUIRE(conn->getAcceptor()->isAuthenticated());
+
+        for (auto app : {app1, app2})
+        {
+            auto& sign = app->getMetrics().NewTimer({"overlay", "mac", "sign"});
+            auto& verify =
+                app->getMetrics().NewTimer({"overlay", "mac", "verify"});
+            REQUIRE(sign.count() > 1);
+            REQUIRE(verify.count() > 1);
+        }
+    };
+    SECTION("both enabled blake2 mac")
+    {
+        test(true, true);
+    }
+    SECTION("acceptor disabled blake2 mac")
+    {
+        test(true, false);
+    }
+    SECTION("initiator disabled blake2 mac")
+    {
+        test(false, true);
+    }
+}
+
 TEST_CASE("overlay pull mode loadgen", "[overlay][pullmode][acceptance]")
 {
     auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
@@ -2225,6 +2628,68 @@ TEST_CASE("overlay pull mode loadgen", "[overlay][pullmode][acceptance]")
     REQUIRE(numUnknownDemand(node2) == 0);
 }
 
+TEST_CASE("overlay compact adverts loadgen", "[overlay][pullmode][acceptance]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    SIMULATION_CREATE_NODE(Node1);
+    SIMULATION_CREATE_NODE(Node2);
+
+    SCPQuorumSet qSet;
+    qSet.threshold = 2;
+    qSet.validators.push_back(vNode1NodeID);
+    qSet.validators.push_back(vNode2NodeID);
+
+    auto configs = std::vector<Config>{};
+    for (auto i = 0; i < 2; i++)
+    {
+        auto cfg = getTestConfig(i + 1);
+        cfg.ENABLE_PULL_MODE = true;
+        cfg.ENABLE_COMPACT_ADVERTS = true;
+        configs.push_back(cfg);
+    }
+
+    Application::pointer node1 =
+        simulation->addNode(vNode1SecretKey, qSet, &configs[0]);
+    Application::pointer node2 =
+        simulation->addNode(vNode2SecretKey, qSet, &configs[1]);
+
+    simulation->addPendingConnection(vNode1NodeID, vNode2NodeID);
+    simulation->startAllNodes();
+
+    simulation->crankUntil(
+        [&] { return simulation->haveAllExternalized(2, 1); },
+        3 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto& loadGen = node1->getLoadGenerator();
+    auto const numAccounts = 5;
+    loadGen.generateLoad(LoadGenMode::CREATE, numAccounts, 0, 0,
+                         /*txRate*/ 1000,
+                         /*batchSize*/ 1, std::chrono::seconds(0), 0);
+
+    simulation->crankUntil(
+        [&] { return simulation->haveAllExternalized(5, 1); },
+        10 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto meterCount = [](Application::pointer app, std::string const& a,
+                         std::string const& b, std::string const& unit) {
+        return app->getMetrics().NewMeter({"overlay", a, b}, unit).count();
+    };
+
+    // Node 1 advertised by short id only. Node 2 had never seen any of the
+    // transactions, so it demanded them by short id without expanding any.
+    REQUIRE(numTxHashesAdvertised(node1) == numAccounts);
+    REQUIRE(meterCount(node1, "send", "flood-advert-short", "message") > 0);
+    REQUIRE(meterCount(node1, "send", "flood-advert", "message") == 0);
+    REQUIRE(meterCount(node2, "send", "flood-demand-short", "message") > 0);
+    REQUIRE(meterCount(node2, "send", "flood-expand", "message") == 0);
+    REQUIRE(meterCount(node1, "flood", "expanded", "transaction") == 0);
+    REQUIRE(numUnknownDemand(node1) == 0);
+    REQUIRE(numUnknownDemand(node2) == 0);
+}
+
 TEST_CASE("overlay pull mode with many peers",
           "[overlay][pullmode][acceptance]")
 {
@@ -0,0 +1,156 @@
+// Copyright 2023 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "medida/counter.h"
+#include "overlay/OverlayManager.h"
+#include "overlay/OverlayMetrics.h"
+#include "overlay/PriorityWriteQueue.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+
+namespace hcnet
+{
+
+TEST_CASE("priority write queue", "[overlay][writequeue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& metrics = app->getOverlayManager().getOverlayMetrics();
+    auto depth = [&](WriteQueueClass cls) {
+        return metrics.mWriteQueueDepth[static_cast<size_t>(cls)]->count();
+    };
+
+    // Messages are told apart by the size of their body
+    auto makeWrite = [&](size_t id) {
+        QueuedWrite qw;
+        qw.mTimed.mEnqueuedTime = clock.now();
+        qw.mBody = std::make_shared<xdr::opaque_vec<> const>(id);
+        return qw;
+    };
+    auto ids = [](std::vector<QueuedWrite> const& batch) {
+        std::vector<size_t> res;
+        for (auto const& qw : batch)
+        {
+            res.emplace_back(qw.mBody->size());
+        }
+        return res;
+    };
+
+    SECTION("message classes")
+    {
+        REQUIRE(writeQueueClass(SCP_MESSAGE) == WriteQueueClass::SCP);
+        REQUIRE(writeQueueClass(SEND_MORE) == WriteQueueClass::SCP);
+        REQUIRE(writeQueueClass(GET_TX_SET) == WriteQueueClass::FETCH);
+        REQUIRE(writeQueueClass(GENERALIZED_TX_SET) == WriteQueueClass::FETCH);
+        REQUIRE(writeQueueClass(SCP_QUORUMSET) == WriteQueueClass::FETCH);
+        REQUIRE(writeQueueClass(FLOOD_DEMAND) == WriteQueueClass::DEMAND);
+        REQUIRE(writeQueueClass(TRANSACTION) == WriteQueueClass::FLOOD);
+        REQUIRE(writeQueueClass(FLOOD_ADVERT) == WriteQueueClass::FLOOD);
+    }
+
+    SECTION("scp does not wait behind floods")
+    {
+        PriorityWriteQueue queue(metrics);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            queue.push(WriteQueueClass::FLOOD, makeWrite(1000 + i));
+        }
+        queue.push(WriteQueueClass::SCP, makeWrite(1));
+        REQUIRE(queue.size() == 1001);
+        REQUIRE(depth(WriteQueueClass::FLOOD) == 1000);
+        REQUIRE(depth(WriteQueueClass::SCP) == 1);
+
+        std::vector<QueuedWrite> batch;
+        queue.popBatch(batch, 10, SIZE_MAX);
+        auto res = ids(batch);
+        REQUIRE(res.size() == 10);
+        REQUIRE(res[0] == 1);
+        for (size_t i = 1; i < res.size(); ++i)
+        {
+            REQUIRE(res[i] == 1000 + i - 1);
+        }
+        REQUIRE(queue.size() == 991);
+        REQUIRE(depth(WriteQueueClass::FLOOD) == 991);
+        REQUIRE(depth(WriteQueueClass::SCP) == 0);
+    }
+
+    SECTION("weighted draining")
+    {
+        PriorityWriteQueue queue(metrics);
+        for (size_t c = 0; c < WRITE_QUEUE_CLASS_COUNT; ++c)
+        {
+            for (size_t i = 0; i < 100; ++i)
+            {
+                queue.push(static_cast<WriteQueueClass>(c),
+                           makeWrite(1000 * (c + 1) + i));
+            }
+        }
+
+        // One round takes each class in priority order, by weight
+        std::vector<QueuedWrite> batch;
+        queue.popBatch(batch, 15, SIZE_MAX);
+        std::vector<size_t> expected;
+        for (size_t c = 0; c < WRITE_QUEUE_CLASS_COUNT; ++c)
+        {
+            for (size_t i = 0; i < WRITE_QUEUE_CLASS_WEIGHTS[c]; ++i)
+            {
+                expected.emplace_back(1000 * (c + 1) + i);
+            }
+        }
+        REQUIRE(ids(batch) == expected);
+
+        // Lower classes keep their share while higher ones are busy
+        batch.clear();
+        queue.popBatch(batch, 150, SIZE_MAX);
+        REQUIRE(batch.size() == 150);
+        REQUIRE(queue.size(WriteQueueClass::SCP) == 100 - 8 * 11);
+        REQUIRE(queue.size(WriteQueueClass::FETCH) == 100 - 4 * 11);
+        REQUIRE(queue.size(WriteQueueClass::DEMAND) == 100 - 2 * 11);
+        REQUIRE(queue.size(WriteQueueClass::FLOOD) == 100 - 11);
+    }
+
+    SECTION("byte limit")
+    {
+        PriorityWriteQueue queue(metrics);
+        for (size_t i = 0; i < 10; ++i)
+        {
+            queue.push(WriteQueueClass::FLOOD, makeWrite(100));
+        }
+        size_t const wireSize = makeWrite(100).wireSize();
+        REQUIRE(wireSize > 100);
+
+        // The message reaching the limit is still included
+        std::vector<QueuedWrite> batch;
+        queue.popBatch(batch, 10, 2 * wireSize + 1);
+        REQUIRE(batch.size() == 3);
+        REQUIRE(queue.size() == 7);
+    }
+
+    SECTION("oldest message")
+    {
+        PriorityWriteQueue queue(metrics);
+        REQUIRE(!queue.oldestEnqueuedTime());
+        auto first = clock.now();
+        queue.push(WriteQueueClass::FLOOD, makeWrite(1));
+        testutil::crankFor(clock, std::chrono::seconds(1));
+        queue.push(WriteQueueClass::SCP, makeWrite(2));
+        REQUIRE(queue.oldestEnqueuedTime() == first);
+    }
+
+    SECTION("depth released on clear")
+    {
+        PriorityWriteQueue queue(metrics);
+        queue.push(WriteQueueClass::DEMAND, makeWrite(1));
+        queue.push(WriteQueueClass::FETCH, makeWrite(2));
+        REQUIRE(depth(WriteQueueClass::DEMAND) == 1);
+        REQUIRE(depth(WriteQueueClass::FETCH) == 1);
+        queue.clear();
+        REQUIRE(queue.empty());
+        REQUIRE(depth(WriteQueueClass::DEMAND) == 0);
+        REQUIRE(depth(WriteQueueClass::FETCH) == 0);
+    }
+}
+}
@@ -10,6 +10,7 @@
 #include "overlay/PeerDoor.h"
 #include "overlay/TCPPeer.h"
 #include "simulation/Simulation.h"
+#include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
@@ -53,4 +54,81 @@ TEST_CASE("TCPPeer can communicate", "[overlay][acceptance]")
     REQUIRE(p1->isAuthenticated());
     s->stopAllNodes();
 }
+
+TEST_CASE("TCPPeer holds back flood messages to batch writes", "[overlay]")
+{
+    VirtualClock clock(VirtualClock::REAL_TIME);
+    auto crankUntil = [&](std::function<bool()> const& pred) {
+        auto deadline = clock.now() + std::chrono::seconds(10);
+        while (!pred() && clock.now() < deadline)
+        {
+            clock.crank(false);
+        }
+        REQUIRE(pred());
+    };
+
+    auto test = [&](int delayMs) {
+        auto makeConfig = [&](int n) {
+            // Test configs close ledgers manually and so never emit SCP
+            // messages, which would flush the write queue. Listening for
+            // peers is all they need.
+            auto cfg = getTestConfig(n);
+            cfg.RUN_STANDALONE = false;
+            cfg.MAX_BATCH_WRITE_DELAY_MS = delayMs;
+            return cfg;
+        };
+        auto app1 = createTestApplication(clock, makeConfig(1));
+        auto app2 = createTestApplication(clock, makeConfig(2));
+
+        PeerBareAddress addr2{"127.0.0.1", app2->getConfig().PEER_PORT};
+        app1->getOverlayManager().connectTo(addr2);
+        Peer::pointer peer;
+        crankUntil([&]() {
+            peer = app1->getOverlayManager().getConnectedPeer(addr2);
+            return peer && peer->isAuthenticated();
+        });
+        // Let the writes of the handshake complete
+        testutil::crankFor(clock, std::chrono::milliseconds(200));
+
+        auto const& metrics = peer->getPeerMetrics();
+        auto writes = metrics.mAsyncWrite;
+        auto messages = metrics.mMessageWrite;
+        size_t const count = 10;
+        for (size_t i = 0; i < count; ++i)
+        {
+            HcnetMessage msg;
+            msg.type(TRANSACTION);
+            msg.transaction().v0().tx.seqNum = i + 1;
+            peer->sendMessage(std::make_shared<HcnetMessage const>(msg));
+        }
+
+        if (delayMs == 0)
+        {
+            // The first message starts a write of its own
+            REQUIRE(metrics.mAsyncWrite == writes + 1);
+        }
+        else
+        {
+            // Nothing is written until the delay is up, then all messages
+            // go out in a single write
+            REQUIRE(metrics.mAsyncWrite == writes);
+            crankUntil([&]() {
+                return metrics.mMessageWrite == messages + count;
+            });
+            REQUIRE(metrics.mAsyncWrite == writes + 1);
+        }
+
+        testutil::shutdownWorkScheduler(*app2);
+        testutil::shutdownWorkScheduler(*app1);
+    };
+
+    SECTION("without delay")
+    {
+        test(0);
+    }
+    SECTION("with delay")
+    {
+        test(100);
+    }
+}
 }
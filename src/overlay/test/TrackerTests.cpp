@@ -35,10 +35,11 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
 
     auto hash = sha256(ByteSlice{"hash"});
     auto nullAskPeer = AskPeer{[](Peer::pointer, Hash) {}};
+    FetchReplyTimes replyTimes;
 
     SECTION("empty tracker")
     {
-        Tracker t{*app, hash, nullAskPeer};
+        Tracker t{*app, hash, nullAskPeer, replyTimes};
         REQUIRE(t.size() == 0);
         REQUIRE(t.empty());
         REQUIRE(t.getLastSeenSlotIndex() == 0);
@@ -46,7 +47,7 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
 
     SECTION("can listen on envelope")
     {
-        Tracker t{*app, hash, nullAskPeer};
+        Tracker t{*app, hash, nullAskPeer, replyTimes};
         auto env1 = makeEnvelope(1);
         t.listen(env1);
 
@@ -63,7 +64,7 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
 
     SECTION("listen twice on the same envelope")
     {
-        Tracker t{*app, hash, nullAskPeer};
+        Tracker t{*app, hash, nullAskPeer, replyTimes};
         auto env1 = makeEnvelope(1);
         t.listen(env1);
         // this should no-op (idempotent)
@@ -76,7 +77,7 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
 
     SECTION("can listen on different envelopes")
     {
-        Tracker t{*app, hash, nullAskPeer};
+        Tracker t{*app, hash, nullAskPeer, replyTimes};
         auto env1 = makeEnvelope(1);
         auto env2 = makeEnvelope(2);
         t.listen(env1);
@@ -90,7 +91,7 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
 
     SECTION("properly removes old envelopes")
     {
-        Tracker t{*app, hash, nullAskPeer};
+        Tracker t{*app, hash, nullAskPeer, replyTimes};
         auto env1 = makeEnvelope(1);
         auto env2 = makeEnvelope(2);
         auto env3 = makeEnvelope(3);
@@ -120,4 +121,34 @@ TEST_CASE("Tracker works", "[overlay][Tracker]")
         }
     }
 }
+
+TEST_CASE("fetch timeout adapts to reply times", "[overlay][Tracker]")
+{
+    using namespace std::chrono_literals;
+    FetchReplyTimes replyTimes;
+    REQUIRE(replyTimes.getTimeout() == 1500ms);
+
+    // a handful of replies is not enough to go by
+    for (int i = 0; i < 15; ++i)
+    {
+        replyTimes.add(50ms);
+    }
+    REQUIRE(replyTimes.getTimeout() == 1500ms);
+
+    replyTimes.add(50ms);
+    REQUIRE(replyTimes.getTimeout() == 200ms);
+
+    for (int i = 0; i < 64; ++i)
+    {
+        replyTimes.add(std::chrono::milliseconds(10 * (i + 1)));
+    }
+    // older samples are forgotten, the 95th percentile is 600ms
+    REQUIRE(replyTimes.getTimeout() == 1200ms);
+
+    for (int i = 0; i < 64; ++i)
+    {
+        replyTimes.add(5s);
+    }
+    REQUIRE(replyTimes.getTimeout() == 1500ms);
+}
 }
@@ -38,4 +38,48 @@ case 0:
 case 1:
 	PersistedSCPStateV1 v1;
 };
+
+// Bucket indexes map LedgerKeys to offsets in their bucket's XDR file. Small
+// buckets index every key individually, large buckets index fixed-size pages
+// of the file by the range of keys they contain.
+struct BucketIndexIndividualEntry
+{
+	LedgerKey key;
+	uint64 offset;
+};
+
+struct BucketIndexRangeEntry
+{
+	LedgerKey lowerBound;
+	LedgerKey upperBound;
+	uint64 offset;
+};
+
+union BucketIndexEntries switch (int v)
+{
+case 0:
+	BucketIndexIndividualEntry individualEntries<>;
+case 1:
+	BucketIndexRangeEntry rangeEntries<>;
+};
+
+// Bloom filter over every key in a bucket, letting lookups for absent keys
+// skip the bucket without touching its file.
+struct BucketIndexBloomFilter
+{
+	// SipHash-2-4 key from which the filter's hash functions are derived.
+	opaque seed[16];
+	uint32 numHashFunctions;
+	uint64 bits<>;
+};
+
+struct PersistedBucketIndex
+{
+	uint32 formatVersion;
+	Hash bucketHash;
+	// Page size in bytes, 0 for individual indexes.
+	uint64 pageSize;
+	BucketIndexEntries entries;
+	BucketIndexBloomFilter filter;
+};
 }
\ No newline at end of file
@@ -57,6 +57,14 @@ struct Hello
 // `unused`) in `Auth`.
 // 100 is just a number that is not 0.
 const AUTH_MSG_FLAG_PULL_MODE_REQUESTED = 100;
+// Requests pull mode with compact adverts (see FloodAdvertShort); implies
+// AUTH_MSG_FLAG_PULL_MODE_REQUESTED.
+const AUTH_MSG_FLAG_COMPACT_ADVERTS_REQUESTED = 200;
+// Set on top of the values above to offer COMPRESSED_MESSAGE.
+const AUTH_MSG_FLAG_COMPRESSION_REQUESTED = 0x10000;
+// Set on top of the values above to offer keyed BLAKE2b instead of
+// HMAC-SHA256 as the MAC of messages after AUTH.
+const AUTH_MSG_FLAG_BLAKE2_MAC_REQUESTED = 0x20000;
 
 struct Auth
 {
@@ -113,7 +121,12 @@ enum MessageType
 
     SEND_MORE = 16,
     FLOOD_ADVERT = 18,
-    FLOOD_DEMAND = 19
+    FLOOD_DEMAND = 19,
+    FLOOD_ADVERT_SHORT = 20,
+    FLOOD_EXPAND = 21,
+
+    COMPRESSED_MESSAGE = 22,
+    FLOOD_DEMAND_SHORT = 23
 };
 
 struct DontHave
@@ -212,6 +225,37 @@ struct FloodDemand
     TxDemandVector txHashes;
 };
 
+// Short transaction ids are SipHash-2-4 of the transaction hash, keyed with a
+// per-connection key derived from both peers' HELLO nonces.
+typedef uint64 TxShortIdVector<TX_ADVERT_VECTOR_MAX_SIZE>;
+
+struct FloodAdvertShort
+{
+    TxShortIdVector txShortIds;
+};
+
+// Demands the transactions behind short ids the peer advertised that match
+// no transaction known to the demanding node.
+struct FloodDemandShort
+{
+    TxShortIdVector txShortIds;
+};
+
+// Asks for the full hashes of short ids the peer advertised that match more
+// than one transaction known to the asking node; answered with a FloodAdvert.
+struct FloodExpand
+{
+    TxShortIdVector txShortIds;
+};
+
+// An HcnetMessage, XDR-encoded and then compressed as a zlib stream that uses
+// the preset dictionary of the overlay version.
+struct CompressedMessage
+{
+    uint32 uncompressedSize;
+    opaque data<>;
+};
+
 union HcnetMessage switch (MessageType type)
 {
 case ERROR_MSG:
@@ -260,6 +304,14 @@ case FLOOD_ADVERT:
      FloodAdvert floodAdvert;
 case FLOOD_DEMAND:
      FloodDemand floodDemand;
+case FLOOD_ADVERT_SHORT:
+     FloodAdvertShort floodAdvertShort;
+case FLOOD_EXPAND:
+     FloodExpand floodExpand;
+case COMPRESSED_MESSAGE:
+     CompressedMessage compressedMessage;
+case FLOOD_DEMAND_SHORT:
+     FloodDemandShort floodDemandShort;
 };
 
 union AuthenticatedMessage switch (uint32 v)
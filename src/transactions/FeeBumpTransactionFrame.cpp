@@ -175,26 +175,27 @@ FeeBumpTransactionFrame::checkValid(AbstractLedgerTxn& ltxOuter,
 }
 
 bool
-FeeBumpTransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx)
+FeeBumpTransactionFrame::checkValidStateless(LedgerHeader const& header)
 {
-    // this function does validations that are independent of the account state
-    //    (stay true regardless of other side effects)
+    resetResults(header, header.baseFee, false);
+    return commonValidStateless(header);
+}
 
-    auto header = ltx.loadHeader();
-    if (protocolVersionIsBefore(header.current().ledgerVersion,
-                                ProtocolVersion::V_13))
+bool
+FeeBumpTransactionFrame::commonValidStateless(LedgerHeader const& lh)
+{
+    if (protocolVersionIsBefore(lh.ledgerVersion, ProtocolVersion::V_13))
     {
         getResult().result.code(txNOT_SUPPORTED);
         return false;
     }
 
-    if (getFeeBid() < getMinFee(*this, header.current()))
+    if (getFeeBid() < getMinFee(*this, lh))
     {
         getResult().result.code(txINSUFFICIENT_FEE);
         return false;
     }
 
-    auto const& lh = header.current();
     uint128_t v1 = bigMultiply(getFeeBid(), getMinFee(*mInnerTx, lh));
     uint128_t v2 = bigMultiply(mInnerTx->getFeeBid(), getMinFee(*this, lh));
     if (v1 < v2)
@@ -208,6 +209,20 @@ FeeBumpTransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx)
         return false;
     }
 
+    return true;
+}
+
+bool
+FeeBumpTransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx)
+{
+    // this function does validations that are independent of the account state
+    //    (stay true regardless of other side effects)
+
+    if (!commonValidStateless(ltx.loadHeader().current()))
+    {
+        return false;
+    }
+
     if (!hcnet::loadAccount(ltx, getFeeSourceID()))
     {
         getResult().result.code(txNO_ACCOUNT);
@@ -390,6 +405,18 @@ FeeBumpTransactionFrame::insertKeysForTxApply(
     mInnerTx->insertKeysForTxApply(keys);
 }
 
+void
+FeeBumpTransactionFrame::insertSignatureChecks(
+    AbstractLedgerTxn& ltx,
+    std::vector<PubKeyUtils::SignatureCheck>& checks) const
+{
+    std::vector<SignerKey> signers;
+    insertAccountSignerKeys(ltx, getFeeSourceID(), signers);
+    SignatureUtils::insertSignatureChecks(mEnvelope.feeBump().signatures,
+                                          getContentsHash(), signers, checks);
+    mInnerTx->insertSignatureChecks(ltx, checks);
+}
+
 void
 FeeBumpTransactionFrame::processFeeSeqNum(AbstractLedgerTxn& ltx,
                                           std::optional<int64_t> baseFee)
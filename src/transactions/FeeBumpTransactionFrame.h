@@ -26,6 +26,7 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
     bool checkSignature(SignatureChecker& signatureChecker,
                         LedgerTxnEntry const& account, int32_t neededWeight);
 
+    bool commonValidStateless(LedgerHeader const& lh);
     bool commonValidPreSeqNum(AbstractLedgerTxn& ltx);
 
     enum ValidationType
@@ -62,6 +63,7 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
     bool checkValid(AbstractLedgerTxn& ltxOuter, SequenceNumber current,
                     uint64_t lowerBoundCloseTimeOffset,
                     uint64_t upperBoundCloseTimeOffset) override;
+    bool checkValidStateless(LedgerHeader const& header) override;
 
     TransactionEnvelope const& getEnvelope() const override;
 
@@ -89,6 +91,9 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
     void
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const override;
     void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const override;
+    void insertSignatureChecks(
+        AbstractLedgerTxn& ltx,
+        std::vector<PubKeyUtils::SignatureCheck>& checks) const override;
 
     void processFeeSeqNum(AbstractLedgerTxn& ltx,
                           std::optional<int64_t> baseFee) override;
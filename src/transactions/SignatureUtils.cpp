@@ -60,6 +60,40 @@ verifyEd25519SignedPayload(DecoratedSignature const& sig,
     return PubKeyUtils::verifySig(pubKey, sig.signature, signedPayload.payload);
 }
 
+void
+insertSignatureChecks(xdr::xvector<DecoratedSignature, 20> const& signatures,
+                      Hash const& contentsHash,
+                      std::vector<SignerKey> const& signers,
+                      std::vector<PubKeyUtils::SignatureCheck>& checks)
+{
+    for (auto const& signer : signers)
+    {
+        for (auto const& sig : signatures)
+        {
+            if (signer.type() == SIGNER_KEY_TYPE_ED25519 &&
+                doesHintMatch(signer.ed25519(), sig.hint))
+            {
+                auto& check = checks.emplace_back();
+                check.key = KeyUtils::convertKey<PublicKey>(signer);
+                check.signature = sig.signature;
+                check.message.assign(contentsHash.begin(), contentsHash.end());
+            }
+            else if (signer.type() == SIGNER_KEY_TYPE_ED25519_SIGNED_PAYLOAD &&
+                     doesHintMatch(getSignedPayloadHint(
+                                       signer.ed25519SignedPayload()),
+                                   sig.hint))
+            {
+                auto const& signedPayload = signer.ed25519SignedPayload();
+                auto& check = checks.emplace_back();
+                check.key.ed25519() = signedPayload.ed25519;
+                check.signature = sig.signature;
+                check.message.assign(signedPayload.payload.begin(),
+                                     signedPayload.payload.end());
+            }
+        }
+    }
+}
+
 DecoratedSignature
 signHashX(const ByteSlice& x)
 {
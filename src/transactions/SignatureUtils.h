@@ -4,7 +4,11 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/SecretKey.h"
 #include "xdr/Hcnet-ledger-entries.h"
+#include "xdr/Hcnet-transaction.h"
+
+#include <vector>
 
 namespace hcnet
 {
@@ -32,5 +36,13 @@ SignatureHint
 getSignedPayloadHint(SignerKey::_ed25519SignedPayload_t const& signedPayload);
 SignatureHint getHint(ByteSlice const& bs);
 bool doesHintMatch(ByteSlice const& bs, SignatureHint const& hint);
+
+// Appends a check for every signature in `signatures` whose hint matches one
+// of the ed25519 or signed payload keys in `signers`. These are the
+// verifications SignatureChecker would make for the same signers.
+void insertSignatureChecks(
+    xdr::xvector<DecoratedSignature, 20> const& signatures,
+    Hash const& contentsHash, std::vector<SignerKey> const& signers,
+    std::vector<PubKeyUtils::SignatureCheck>& checks);
 }
 }
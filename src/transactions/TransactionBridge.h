@@ -18,6 +18,8 @@ namespace txbridge
 TransactionEnvelope convertForV13(TransactionEnvelope const& input);
 
 xdr::xvector<DecoratedSignature, 20>& getSignatures(TransactionEnvelope& env);
+xdr::xvector<DecoratedSignature, 20> const&
+getSignatures(TransactionEnvelope const& env);
 xdr::xvector<DecoratedSignature, 20>&
 getSignaturesInner(TransactionEnvelope& env);
 xdr::xvector<Operation, MAX_OPS_PER_TX>&
@@ -541,15 +541,8 @@ TransactionFrame::isTooEarlyForAccount(LedgerTxnHeader const& header,
 }
 
 bool
-TransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx, bool chargeFee,
-                                       uint64_t lowerBoundCloseTimeOffset,
-                                       uint64_t upperBoundCloseTimeOffset)
+TransactionFrame::commonValidStateless(uint32_t ledgerVersion)
 {
-    ZoneScoped;
-    // this function does validations that are independent of the account state
-    //    (stay true regardless of other side effects)
-    auto header = ltx.loadHeader();
-    uint32_t ledgerVersion = header.current().ledgerVersion;
     if ((protocolVersionIsBefore(ledgerVersion, ProtocolVersion::V_13) &&
          (mEnvelope.type() == ENVELOPE_TYPE_TX ||
           hasMuxedAccount(mEnvelope))) ||
@@ -596,6 +589,23 @@ TransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx, bool chargeFee,
         return false;
     }
 
+    return true;
+}
+
+bool
+TransactionFrame::commonValidPreSeqNum(AbstractLedgerTxn& ltx, bool chargeFee,
+                                       uint64_t lowerBoundCloseTimeOffset,
+                                       uint64_t upperBoundCloseTimeOffset)
+{
+    ZoneScoped;
+    // this function does validations that are independent of the account state
+    //    (stay true regardless of other side effects)
+    auto header = ltx.loadHeader();
+    if (!commonValidStateless(header.current().ledgerVersion))
+    {
+        return false;
+    }
+
     if (isTooEarly(header, lowerBoundCloseTimeOffset))
     {
         getResult().result.code(txTOO_EARLY);
@@ -966,6 +976,14 @@ TransactionFrame::checkValid(AbstractLedgerTxn& ltxOuter,
                                               upperBoundCloseTimeOffset);
 }
 
+bool
+TransactionFrame::checkValidStateless(LedgerHeader const& header)
+{
+    ZoneScoped;
+    resetResults(header, header.baseFee, false);
+    return commonValidStateless(header.ledgerVersion);
+}
+
 void
 TransactionFrame::insertKeysForFeeProcessing(
     UnorderedSet<LedgerKey>& keys) const
@@ -986,6 +1004,32 @@ TransactionFrame::insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const
     }
 }
 
+void
+TransactionFrame::insertSignatureChecks(
+    AbstractLedgerTxn& ltx,
+    std::vector<PubKeyUtils::SignatureCheck>& checks) const
+{
+    ZoneScoped;
+    std::vector<SignerKey> signers;
+    insertAccountSignerKeys(ltx, getSourceID(), signers);
+    UnorderedSet<AccountID> opSources;
+    for (auto const& op : mOperations)
+    {
+        auto opSource = op->getSourceID();
+        if (!(opSource == getSourceID()) && opSources.emplace(opSource).second)
+        {
+            insertAccountSignerKeys(ltx, opSource, signers);
+        }
+    }
+    if (extraSignersExist())
+    {
+        auto const& extraSigners = mEnvelope.v1().tx.cond.v2().extraSigners;
+        signers.insert(signers.end(), extraSigners.begin(), extraSigners.end());
+    }
+    SignatureUtils::insertSignatureChecks(getSignatures(mEnvelope),
+                                          getContentsHash(), signers, checks);
+}
+
 void
 TransactionFrame::markResultFailed()
 {
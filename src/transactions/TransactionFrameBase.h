@@ -6,6 +6,7 @@
 
 #include <optional>
 
+#include "crypto/SecretKey.h"
 #include "ledger/LedgerHashUtils.h"
 #include "overlay/HcnetXDR.h"
 #include "util/UnorderedSet.h"
@@ -37,6 +38,11 @@ class TransactionFrameBase
                             uint64_t lowerBoundCloseTimeOffset,
                             uint64_t upperBoundCloseTimeOffset) = 0;
 
+    // Runs the checks checkValid starts with that only depend on `header`,
+    // so that they can be made off the main thread. Sets the result
+    // checkValid would set when one of them fails.
+    virtual bool checkValidStateless(LedgerHeader const& header) = 0;
+
     virtual TransactionEnvelope const& getEnvelope() const = 0;
 
     virtual int64_t getFeeBid() const = 0;
@@ -64,6 +70,13 @@ class TransactionFrameBase
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const = 0;
     virtual void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const = 0;
 
+    // Appends the ed25519 signature checks that checkValid is expected to
+    // make against the accounts as they currently are in `ltx`, so that they
+    // can be verified ahead of time.
+    virtual void insertSignatureChecks(
+        AbstractLedgerTxn& ltx,
+        std::vector<PubKeyUtils::SignatureCheck>& checks) const = 0;
+
     virtual void processFeeSeqNum(AbstractLedgerTxn& ltx,
                                   std::optional<int64_t> baseFee) = 0;
 
@@ -3,8 +3,10 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "transactions/TransactionUtils.h"
+#include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
 #include "ledger/InternalLedgerEntry.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -323,6 +325,21 @@ loadAccountWithoutRecord(AbstractLedgerTxn& ltx, AccountID const& accountID)
     return ltx.loadWithoutRecord(accountKey(accountID));
 }
 
+void
+insertAccountSignerKeys(AbstractLedgerTxn& ltx, AccountID const& accountID,
+                        std::vector<SignerKey>& signers)
+{
+    signers.emplace_back(KeyUtils::convertKey<SignerKey>(accountID));
+    auto account = loadAccountWithoutRecord(ltx, accountID);
+    if (account)
+    {
+        for (auto const& signer : account.current().data.account().signers)
+        {
+            signers.emplace_back(signer.key);
+        }
+    }
+}
+
 LedgerTxnEntry
 loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
          std::string const& dataName)
@@ -103,6 +103,11 @@ LedgerTxnEntry loadAccount(AbstractLedgerTxn& ltx, AccountID const& accountID);
 ConstLedgerTxnEntry loadAccountWithoutRecord(AbstractLedgerTxn& ltx,
                                              AccountID const& accountID);
 
+// Appends the keys that may sign for `accountID`: its master key and, if the
+// account exists, its other signers.
+void insertAccountSignerKeys(AbstractLedgerTxn& ltx, AccountID const& accountID,
+                             std::vector<SignerKey>& signers);
+
 LedgerTxnEntry loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
                         std::string const& dataName);
 
@@ -0,0 +1,477 @@
+#pragma once
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Math.h"
+#include "util/NonCopyable.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hcnet
+{
+
+enum class CacheEvictionPolicy
+{
+    // Least-recent-out-of-2-random-choices, as in RandomEvictionCache.
+    RANDOM,
+    // Second-chance: a hand sweeps the entries and evicts the first one that
+    // has not been accessed since the hand last passed it.
+    CLOCK,
+    // S3-FIFO (Yang et al., SOSP'23): new entries go to a small FIFO queue
+    // and are only promoted to the main queue if accessed again before they
+    // reach its end. Recently evicted keys are remembered in a "ghost" queue
+    // so they go straight to the main queue when they come back. This keeps
+    // one-off scans from flushing frequently used entries.
+    S3FIFO
+};
+
+inline CacheEvictionPolicy
+parseCacheEvictionPolicy(std::string const& name)
+{
+    if (name == "RANDOM")
+    {
+        return CacheEvictionPolicy::RANDOM;
+    }
+    if (name == "CLOCK")
+    {
+        return CacheEvictionPolicy::CLOCK;
+    }
+    if (name == "S3FIFO")
+    {
+        return CacheEvictionPolicy::S3FIFO;
+    }
+    throw std::invalid_argument("unknown cache eviction policy: " + name);
+}
+
+// Fixed-size cache with a choice of eviction policy and the same interface
+// and counters as RandomEvictionCache.
+//
+// Entries live in a slab of at most maxSize nodes that is allocated once and
+// reused on eviction. They are found through an open-addressed table of
+// (hash tag, node index) slots with linear probing, laid out in 64-byte lines
+// of 8 slots and kept at most half full, so most lookups touch a single cache
+// line before comparing the full key. The cache is not thread-safe.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class EvictionCache : public NonMovableOrCopyable
+{
+  public:
+    struct Counters
+    {
+        uint64_t mHits{0};
+        uint64_t mMisses{0};
+        uint64_t mInserts{0};
+        uint64_t mUpdates{0};
+        uint64_t mEvicts{0};
+    };
+
+  private:
+    static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t SLOTS_PER_LINE = 8;
+    // S3-FIFO access frequencies saturate at this value.
+    static constexpr uint8_t MAX_FREQ = 3;
+
+    struct Node
+    {
+        K mKey;
+        V mValue;
+        uint64_t mHash;
+        uint64_t mLastAccess;
+        uint8_t mFreq;
+        bool mVisited;
+    };
+
+    struct alignas(64) Line
+    {
+        uint32_t mTags[SLOTS_PER_LINE];
+        uint32_t mNodes[SLOTS_PER_LINE];
+    };
+
+    size_t const mMaxSize;
+    CacheEvictionPolicy const mPolicy;
+    Hash mHasher;
+
+    std::vector<Node> mNodes;
+    std::vector<Line> mLines;
+    size_t mSlotMask;
+    int mSlotShift;
+
+    uint64_t mGeneration{0};
+    Counters mCounters;
+
+    // CLOCK state.
+    size_t mHand{0};
+
+    // S3-FIFO state. Both queues hold node indices; the ghost queue holds
+    // hashes of keys evicted from the small queue, and mGhostCounts counts
+    // the occurrences of each hash in it.
+    std::deque<uint32_t> mSmall;
+    std::deque<uint32_t> mMain;
+    std::deque<uint64_t> mGhost;
+    std::unordered_map<uint64_t, uint32_t> mGhostCounts;
+
+    static uint32_t
+    tagOf(uint64_t h)
+    {
+        return static_cast<uint32_t>(h);
+    }
+
+    size_t
+    homeSlot(uint64_t h) const
+    {
+        // Fibonacci hashing spreads poorly-mixed hashes over the table.
+        return static_cast<size_t>((h * 0x9E3779B97F4A7C15ULL) >> mSlotShift);
+    }
+
+    uint32_t&
+    slotTag(size_t i)
+    {
+        return mLines[i / SLOTS_PER_LINE].mTags[i % SLOTS_PER_LINE];
+    }
+
+    uint32_t&
+    slotNode(size_t i)
+    {
+        return mLines[i / SLOTS_PER_LINE].mNodes[i % SLOTS_PER_LINE];
+    }
+
+    uint32_t
+    slotNode(size_t i) const
+    {
+        return mLines[i / SLOTS_PER_LINE].mNodes[i % SLOTS_PER_LINE];
+    }
+
+    uint32_t
+    slotTag(size_t i) const
+    {
+        return mLines[i / SLOTS_PER_LINE].mTags[i % SLOTS_PER_LINE];
+    }
+
+    // Returns the slot holding `k`, or the empty slot where it would go.
+    size_t
+    findSlot(K const& k, uint64_t h) const
+    {
+        auto tag = tagOf(h);
+        for (size_t i = homeSlot(h);; i = (i + 1) & mSlotMask)
+        {
+            auto n = slotNode(i);
+            if (n == NO_NODE ||
+                (slotTag(i) == tag && mNodes[n].mHash == h &&
+                 mNodes[n].mKey == k))
+            {
+                return i;
+            }
+        }
+    }
+
+    Node*
+    find(K const& k)
+    {
+        auto n = slotNode(findSlot(k, mHasher(k)));
+        return n == NO_NODE ? nullptr : &mNodes[n];
+    }
+
+    // Removes node `n` from the table, shifting later entries of its probe
+    // run back so that no tombstones are needed.
+    void
+    unlink(uint32_t n)
+    {
+        auto i = findSlot(mNodes[n].mKey, mNodes[n].mHash);
+        for (size_t j = (i + 1) & mSlotMask; slotNode(j) != NO_NODE;
+             j = (j + 1) & mSlotMask)
+        {
+            auto home = homeSlot(mNodes[slotNode(j)].mHash);
+            // The entry at j may move to i only if its home slot is not
+            // cyclically within (i, j].
+            bool homeInRange =
+                i <= j ? (i < home && home <= j) : (i < home || home <= j);
+            if (!homeInRange)
+            {
+                slotTag(i) = slotTag(j);
+                slotNode(i) = slotNode(j);
+                i = j;
+            }
+        }
+        slotNode(i) = NO_NODE;
+    }
+
+    void
+    touch(Node& node)
+    {
+        node.mLastAccess = ++mGeneration;
+        node.mVisited = true;
+        node.mFreq = std::min<uint8_t>(node.mFreq + 1, MAX_FREQ);
+    }
+
+    uint32_t
+    pickRandomVictim()
+    {
+        auto sz = mNodes.size();
+        auto n1 = rand_uniform<size_t>(0, sz - 1);
+        auto n2 = rand_uniform<size_t>(0, sz - 1);
+        return static_cast<uint32_t>(
+            mNodes[n1].mLastAccess < mNodes[n2].mLastAccess ? n1 : n2);
+    }
+
+    uint32_t
+    pickClockVictim()
+    {
+        while (mNodes[mHand].mVisited)
+        {
+            mNodes[mHand].mVisited = false;
+            mHand = (mHand + 1) % mNodes.size();
+        }
+        auto victim = static_cast<uint32_t>(mHand);
+        mHand = (mHand + 1) % mNodes.size();
+        return victim;
+    }
+
+    void
+    rememberGhost(uint64_t h)
+    {
+        mGhost.push_back(h);
+        ++mGhostCounts[h];
+        // Remember about as many evicted keys as the main queue can hold.
+        while (mGhost.size() > mMaxSize)
+        {
+            auto it = mGhostCounts.find(mGhost.front());
+            if (--it->second == 0)
+            {
+                mGhostCounts.erase(it);
+            }
+            mGhost.pop_front();
+        }
+    }
+
+    // Ghost entries are matched by hash alone; a collision only affects which
+    // queue a new entry starts in.
+    bool
+    isGhost(uint64_t h) const
+    {
+        return mGhostCounts.find(h) != mGhostCounts.end();
+    }
+
+    // Picks the S3-FIFO victim and removes it from its queue.
+    uint32_t
+    pickS3FifoVictim()
+    {
+        // Evict from the small queue while it holds more than its 10% share.
+        size_t smallTarget = std::max<size_t>(mMaxSize / 10, 1);
+        while (true)
+        {
+            if (!mSmall.empty() &&
+                (mSmall.size() >= smallTarget || mMain.empty()))
+            {
+                auto n = mSmall.front();
+                mSmall.pop_front();
+                if (mNodes[n].mFreq > 1)
+                {
+                    mNodes[n].mFreq = 0;
+                    mMain.push_back(n);
+                    continue;
+                }
+                rememberGhost(mNodes[n].mHash);
+                return n;
+            }
+            auto n = mMain.front();
+            mMain.pop_front();
+            if (mNodes[n].mFreq > 0)
+            {
+                --mNodes[n].mFreq;
+                mMain.push_back(n);
+                continue;
+            }
+            return n;
+        }
+    }
+
+    uint32_t
+    pickVictim()
+    {
+        switch (mPolicy)
+        {
+        case CacheEvictionPolicy::RANDOM:
+            return pickRandomVictim();
+        case CacheEvictionPolicy::CLOCK:
+            return pickClockVictim();
+        default:
+            return pickS3FifoVictim();
+        }
+    }
+
+  public:
+    EvictionCache(size_t maxSize, CacheEvictionPolicy policy)
+        : mMaxSize(maxSize), mPolicy(policy)
+    {
+        if (maxSize >= NO_NODE)
+        {
+            throw std::invalid_argument("EvictionCache size too large");
+        }
+        size_t slots = SLOTS_PER_LINE;
+        mSlotShift = 64 - 3;
+        while (slots < 2 * maxSize)
+        {
+            slots *= 2;
+            --mSlotShift;
+        }
+        mSlotMask = slots - 1;
+        mLines.resize(slots / SLOTS_PER_LINE);
+        mNodes.reserve(maxSize);
+        clear();
+    }
+
+    size_t
+    maxSize() const
+    {
+        return mMaxSize;
+    }
+
+    size_t
+    size() const
+    {
+        return mNodes.size();
+    }
+
+    CacheEvictionPolicy
+    policy() const
+    {
+        return mPolicy;
+    }
+
+    Counters const&
+    getCounters() const
+    {
+        return mCounters;
+    }
+
+    // `put` does not offer exception safety. If it throws an exception,
+    // cache may be in an inconsistent state. It is, therefore,
+    // client's responsibility to handle failures correctly.
+    void
+    put(K const& k, V const& v)
+    {
+        if (mMaxSize == 0)
+        {
+            return;
+        }
+        auto h = mHasher(k);
+        auto slot = findSlot(k, h);
+        auto existing = slotNode(slot);
+        if (existing != NO_NODE)
+        {
+            auto& node = mNodes[existing];
+            node.mValue = v;
+            touch(node);
+            ++mCounters.mUpdates;
+            return;
+        }
+
+        uint32_t n;
+        if (mNodes.size() < mMaxSize)
+        {
+            n = static_cast<uint32_t>(mNodes.size());
+            mNodes.push_back(Node{k, v, h, 0, 0, false});
+        }
+        else
+        {
+            n = pickVictim();
+            unlink(n);
+            ++mCounters.mEvicts;
+            mNodes[n].mKey = k;
+            mNodes[n].mValue = v;
+            mNodes[n].mHash = h;
+            // The victim may have occupied a slot in k's probe run.
+            slot = findSlot(k, h);
+        }
+        auto& node = mNodes[n];
+        node.mLastAccess = ++mGeneration;
+        node.mFreq = 0;
+        // New entries start unvisited so a CLOCK scan evicts them first.
+        node.mVisited = false;
+        slotTag(slot) = tagOf(h);
+        slotNode(slot) = n;
+        if (mPolicy == CacheEvictionPolicy::S3FIFO)
+        {
+            (isGhost(h) ? mMain : mSmall).push_back(n);
+        }
+        ++mCounters.mInserts;
+    }
+
+    // `exists` offers strong exception safety guarantee. As with
+    // RandomEvictionCache, hits are not counted here and misses are counted
+    // unless `countMisses` is false.
+    bool
+    exists(K const& k, bool countMisses = true)
+    {
+        bool miss = find(k) == nullptr;
+        if (miss && countMisses)
+        {
+            ++mCounters.mMisses;
+        }
+        return !miss;
+    }
+
+    // Returns a pointer to the value if the key exists without counting a
+    // hit or miss or recording an access, so that maintenance such as
+    // refreshing cached values does not look like use.
+    V*
+    peek(K const& k)
+    {
+        auto node = find(k);
+        return node ? &node->mValue : nullptr;
+    }
+
+    // `clear` does not throw
+    void
+    clear()
+    {
+        for (auto& line : mLines)
+        {
+            std::fill(std::begin(line.mNodes), std::end(line.mNodes),
+                      NO_NODE);
+        }
+        mNodes.clear();
+        mHand = 0;
+        mSmall.clear();
+        mMain.clear();
+        mGhost.clear();
+        mGhostCounts.clear();
+    }
+
+    // `maybeGet` offers basic exception safety guarantee.
+    // Returns a pointer to the value if the key exists,
+    // and returns a nullptr otherwise.
+    V*
+    maybeGet(K const& k)
+    {
+        auto node = find(k);
+        if (node)
+        {
+            ++mCounters.mHits;
+            touch(*node);
+            return &node->mValue;
+        }
+        ++mCounters.mMisses;
+        return nullptr;
+    }
+
+    // `get` offers basic exception safety guarantee.
+    V&
+    get(K const& k)
+    {
+        V* result = maybeGet(k);
+        if (result == nullptr)
+        {
+            throw std::range_error("There is no such key in cache");
+        }
+        return *result;
+    }
+};
+}
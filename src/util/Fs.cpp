@@ -11,6 +11,7 @@
 #include <filesystem>
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <map>
 #include <regex>
 #include <sstream>
@@ -31,6 +32,7 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #endif
@@ -160,6 +162,73 @@ durableRename(std::string const& src, std::string const& dst,
     return true;
 }
 
+MappedFile::MappedFile(std::string const& path)
+{
+    ZoneScoped;
+    mFile = ::CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        FileSystemException::failWithGetLastError(
+            std::string("fs::MappedFile failed on CreateFile(\"") + path +
+            std::string("\"): "));
+    }
+    LARGE_INTEGER sz;
+    if (GetFileSizeEx(mFile, &sz) == FALSE)
+    {
+        ::CloseHandle(mFile);
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile failed on GetFileSizeEx(): ");
+    }
+    mSize = static_cast<size_t>(sz.QuadPart);
+    if (mSize == 0)
+    {
+        return;
+    }
+    mMapping = ::CreateFileMapping(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL)
+    {
+        ::CloseHandle(mFile);
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile failed on CreateFileMapping(): ");
+    }
+    mData = static_cast<char const*>(
+        ::MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr)
+    {
+        ::CloseHandle(mMapping);
+        ::CloseHandle(mFile);
+        FileSystemException::failWithGetLastError(
+            "fs::MappedFile failed on MapViewOfFile(): ");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        ::UnmapViewOfFile(mData);
+    }
+    if (mMapping)
+    {
+        ::CloseHandle(mMapping);
+    }
+    ::CloseHandle(mFile);
+}
+
+void
+MappedFile::adviseSequential()
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN was passed at open.
+}
+
+void
+MappedFile::adviseWillNeed(size_t offset, size_t len)
+{
+    // Windows pages mapped views in on demand; PrefetchVirtualMemory would
+    // be the equivalent but is not available on all supported versions.
+}
+
 #else
 #include <cerrno>
 #include <fcntl.h>
@@ -290,6 +359,73 @@ durableRename(std::string const& src, std::string const& dst,
     }
     return true;
 }
+
+MappedFile::MappedFile(std::string const& path)
+{
+    ZoneScoped;
+    int fd;
+    while ((fd = ::open(path.c_str(), O_RDONLY)) == -1)
+    {
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        FileSystemException::failWithErrno(
+            std::string("fs::MappedFile failed on open(\"") + path +
+            "\"): ");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        FileSystemException::failWithErrno(
+            "fs::MappedFile failed on fstat(): ");
+    }
+    mSize = static_cast<size_t>(st.st_size);
+    if (mSize != 0)
+    {
+        void* p = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            FileSystemException::failWithErrno(
+                "fs::MappedFile failed on mmap(): ");
+        }
+        mData = static_cast<char const*>(p);
+    }
+    // The mapping keeps the file referenced; the descriptor is not needed.
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+    {
+        ::munmap(const_cast<char*>(mData), mSize);
+    }
+}
+
+void
+MappedFile::adviseSequential()
+{
+    if (mData)
+    {
+        ::madvise(const_cast<char*>(mData), mSize, MADV_SEQUENTIAL);
+    }
+}
+
+void
+MappedFile::adviseWillNeed(size_t offset, size_t len)
+{
+    if (!mData || offset >= mSize)
+    {
+        return;
+    }
+    static size_t const pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = offset - offset % pageSize;
+    auto end = std::min(mSize, offset + len);
+    ::madvise(const_cast<char*>(mData) + begin, end - begin, MADV_WILLNEED);
+}
 #endif
 
 namespace stdfs = std::filesystem;
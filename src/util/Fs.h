@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/NonCopyable.h"
 #include "util/asio.h"
 
 #include <filesystem>
@@ -83,6 +84,43 @@ size_t size(std::ifstream& ifs);
 
 size_t size(std::string const& path);
 
+// Read-only memory mapping of an entire file. An empty file is not mapped and
+// has data() == nullptr. The advice methods are hints to the OS paging policy
+// and are no-ops where unsupported; offsets passed to them are rounded to page
+// boundaries and lengths clamped to the file.
+class MappedFile : NonMovableOrCopyable
+{
+    char const* mData{nullptr};
+    size_t mSize{0};
+#ifdef _WIN32
+    native_handle_t mFile;
+    native_handle_t mMapping{nullptr};
+#endif
+
+  public:
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    char const*
+    data() const
+    {
+        return mData;
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+
+    // The file will be read front to back: read ahead aggressively and
+    // reclaim pages soon after they are used.
+    void adviseSequential();
+
+    // Start paging in [offset, offset + len) ahead of use.
+    void adviseWillNeed(size_t offset, size_t len);
+};
+
 ////
 // Utility functions for constructing path names
 ////
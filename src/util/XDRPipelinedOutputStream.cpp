@@ -0,0 +1,190 @@
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+// ASIO is somewhat particular about when it gets included -- it wants to be the
+// first to include <windows.h> -- so we try to include it before everything
+// else.
+#include "util/asio.h"
+#include "util/XDRPipelinedOutputStream.h"
+#include "util/GlobalChecks.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace hcnet
+{
+
+XDRPipelinedOutputFileStream::XDRPipelinedOutputFileStream(
+    asio::io_context& ctx, bool fsyncOnClose, bool computeHash)
+    : mOut(ctx, fsyncOnClose), mComputeHash(computeHash), mBuffers(NUM_BUFFERS)
+{
+    mBuffers[0].mData.resize(BUFFER_SIZE);
+}
+
+XDRPipelinedOutputFileStream::~XDRPipelinedOutputFileStream()
+{
+    // Only reached with the pipeline running if the caller gave up on the
+    // output, e.g. because of an exception; the file is discarded anyway.
+    stopPipeline();
+}
+
+void
+XDRPipelinedOutputFileStream::open(std::string const& filename)
+{
+    mOut.open(filename);
+}
+
+XDRPipelinedOutputFileStream::Buffer&
+XDRPipelinedOutputFileStream::current()
+{
+    return mBuffers[mFilled % NUM_BUFFERS];
+}
+
+void
+XDRPipelinedOutputFileStream::startPipeline()
+{
+    mHashThread = std::thread([this]() { runStage(mHashed, true); });
+    mWriteThread = std::thread([this]() { runStage(mWritten, false); });
+}
+
+void
+XDRPipelinedOutputFileStream::runStage(size_t& done, bool hashing)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCond.wait(lock, [&]() { return done < mFilled || mClosing; });
+        if (done == mFilled || mError)
+        {
+            return;
+        }
+        Buffer const& buf = mBuffers[done % NUM_BUFFERS];
+        lock.unlock();
+        try
+        {
+            ZoneScoped;
+            if (!hashing)
+            {
+                mOut.writeBytes(buf.mData.data(), buf.mSize);
+            }
+            else if (mComputeHash)
+            {
+                mHasher.add(ByteSlice(buf.mData.data(), buf.mSize));
+            }
+        }
+        catch (...)
+        {
+            lock.lock();
+            mError = std::current_exception();
+            mCond.notify_all();
+            return;
+        }
+        lock.lock();
+        ++done;
+        mCond.notify_all();
+    }
+}
+
+void
+XDRPipelinedOutputFileStream::submitCurrent()
+{
+    ZoneScoped;
+    if (!mHashThread.joinable())
+    {
+        startPipeline();
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    ++mFilled;
+    mCond.notify_all();
+
+    // Wait until both stages are done with the buffer that is about to be
+    // reused.
+    mCond.wait(lock, [&]() {
+        return mError || mFilled - std::min(mHashed, mWritten) < NUM_BUFFERS;
+    });
+    rethrowIfFailed();
+    lock.unlock();
+
+    auto& buf = current();
+    buf.mSize = 0;
+    if (buf.mData.size() < BUFFER_SIZE)
+    {
+        buf.mData.resize(BUFFER_SIZE);
+    }
+}
+
+void
+XDRPipelinedOutputFileStream::stopPipeline()
+{
+    if (!mHashThread.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosing = true;
+        mCond.notify_all();
+    }
+    mHashThread.join();
+    mWriteThread.join();
+}
+
+void
+XDRPipelinedOutputFileStream::rethrowIfFailed()
+{
+    if (mError)
+    {
+        std::rethrow_exception(mError);
+    }
+}
+
+void
+XDRPipelinedOutputFileStream::writeBytes(char const* data, size_t size,
+                                         size_t* bytesPut)
+{
+    if (bytesPut)
+    {
+        *bytesPut += size;
+    }
+    while (size != 0)
+    {
+        auto* buf = &current();
+        if (buf->mSize >= BUFFER_SIZE)
+        {
+            submitCurrent();
+            buf = &current();
+        }
+        auto n = std::min(size, BUFFER_SIZE - buf->mSize);
+        std::memcpy(buf->mData.data() + buf->mSize, data, n);
+        buf->mSize += n;
+        data += n;
+        size -= n;
+    }
+}
+
+uint256
+XDRPipelinedOutputFileStream::close()
+{
+    ZoneScoped;
+    // Drain the pipeline; the stages finish every submitted buffer before
+    // exiting.
+    stopPipeline();
+    rethrowIfFailed();
+
+    auto& buf = current();
+    if (buf.mSize != 0)
+    {
+        mOut.writeBytes(buf.mData.data(), buf.mSize);
+        if (mComputeHash)
+        {
+            mHasher.add(ByteSlice(buf.mData.data(), buf.mSize));
+        }
+        buf.mSize = 0;
+    }
+    mOut.close();
+    return mComputeHash ? mHasher.finish() : uint256{};
+}
+}
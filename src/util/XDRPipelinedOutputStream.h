@@ -0,0 +1,127 @@
+#pragma once
+
+// Copyright 2022 Hcnet Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA.h"
+#include "util/NonCopyable.h"
+#include "util/XDRStream.h"
+#include "xdr/Hcnet-types.h"
+#include "xdrpp/marshal.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hcnet
+{
+
+/**
+ * Output stream for long runs of XDR records that are both written to a file
+ * and hashed, such as bucket files. Records are serialized on the calling
+ * thread into large buffers; full buffers are hashed on one thread and written
+ * on another, so the three jobs overlap instead of all running on the caller.
+ *
+ * Buffers are handed over through a small fixed ring, so the caller blocks
+ * once it gets NUM_BUFFERS buffers ahead of the slower stage. Output that never
+ * fills a buffer is hashed and written inline at close(), and no threads are
+ * started for it.
+ *
+ * The file contents and hash are the same as writing each record with
+ * XDROutputFileStream::writeOne and a SHA256 hasher.
+ */
+class XDRPipelinedOutputFileStream : NonMovableOrCopyable
+{
+  public:
+    static constexpr size_t BUFFER_SIZE = 1024 * 1024;
+    static constexpr size_t NUM_BUFFERS = 4;
+
+  private:
+    struct Buffer
+    {
+        std::vector<char> mData;
+        size_t mSize{0};
+    };
+
+    XDROutputFileStream mOut;
+    bool const mComputeHash;
+    SHA256 mHasher;
+
+    // Ring of buffers; buffer number n lives in mBuffers[n % NUM_BUFFERS].
+    // mFilled buffers have been handed over so far, and the hash and write
+    // stages have finished with mHashed and mWritten of them respectively.
+    std::vector<Buffer> mBuffers;
+    size_t mFilled{0};
+    size_t mHashed{0};
+    size_t mWritten{0};
+    bool mClosing{false};
+    std::exception_ptr mError;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::thread mHashThread;
+    std::thread mWriteThread;
+
+    Buffer& current();
+    void startPipeline();
+    void submitCurrent();
+    void runStage(size_t& done, bool hashing);
+    void stopPipeline();
+    void rethrowIfFailed();
+
+  public:
+    // If `computeHash` is false, close() returns an all-zero hash and no
+    // hashing is done.
+    XDRPipelinedOutputFileStream(asio::io_context& ctx, bool fsyncOnClose,
+                                 bool computeHash = true);
+    ~XDRPipelinedOutputFileStream();
+
+    void open(std::string const& filename);
+
+    // Flushes everything written so far, closes the file and returns the
+    // SHA-256 of its contents.
+    uint256 close();
+
+    template <typename T>
+    void
+    writeOne(T const& t, size_t* bytesPut = nullptr)
+    {
+        uint32_t sz = (uint32_t)xdr::xdr_size(t);
+        releaseAssertOrThrow(sz < 0x80000000);
+
+        auto* buf = &current();
+        if (buf->mSize != 0 && buf->mSize + sz + 4 > BUFFER_SIZE)
+        {
+            submitCurrent();
+            buf = &current();
+        }
+        if (buf->mData.size() < buf->mSize + sz + 4)
+        {
+            // Only records larger than BUFFER_SIZE get here.
+            buf->mData.resize(buf->mSize + sz + 4);
+        }
+
+        // Write 4 bytes of size, big-endian, with XDR 'continuation' bit set on
+        // high bit of high byte.
+        char* p = buf->mData.data() + buf->mSize;
+        p[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
+        p[1] = static_cast<char>((sz >> 16) & 0xFF);
+        p[2] = static_cast<char>((sz >> 8) & 0xFF);
+        p[3] = static_cast<char>(sz & 0xFF);
+        xdr::xdr_put put(p + 4, p + 4 + sz);
+        xdr_argpack_archive(put, t);
+        buf->mSize += sz + 4;
+
+        if (bytesPut)
+        {
+            *bytesPut += (sz + 4);
+        }
+    }
+
+    // Writes already-framed XDR records.
+    void writeBytes(char const* data, size_t size, size_t* bytesPut = nullptr);
+};
+}
@@ -14,6 +14,7 @@
 #include <Tracy.hpp>
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #ifdef _WIN32
@@ -84,6 +85,16 @@ class XDRInputFileStream
         return mIn.tellg();
     }
 
+    void
+    seek(size_t pos)
+    {
+        ZoneScoped;
+        // Clear any EOF state left over from a previous read before seeking.
+        mIn.clear();
+        mIn.seekg(pos);
+        releaseAssertOrThrow(!mIn.fail());
+    }
+
     template <typename T>
     bool
     readOne(T& out)
@@ -124,6 +135,149 @@ class XDRInputFileStream
     }
 };
 
+/**
+ * Memory-mapped counterpart of XDRInputFileStream for sequential scans of
+ * large files such as buckets. Records are decoded directly from the mapping
+ * instead of being copied into an intermediate buffer first, and the OS is
+ * asked to page the file in a window ahead of the read position.
+ */
+class XDRInputMappedFileStream
+{
+    std::unique_ptr<fs::MappedFile> mFile;
+    size_t mPos{0};
+    size_t mReadAheadEnd{0};
+    size_t mSizeLimit;
+
+    void
+    maybeReadAhead()
+    {
+        // Issue the next window's advice once the reader is halfway through
+        // the current one, so paging overlaps with decoding.
+        if (mPos + READ_AHEAD_WINDOW / 2 >= mReadAheadEnd &&
+            mReadAheadEnd < mFile->size())
+        {
+            mFile->adviseWillNeed(mReadAheadEnd, READ_AHEAD_WINDOW);
+            mReadAheadEnd += READ_AHEAD_WINDOW;
+        }
+    }
+
+  public:
+    static constexpr size_t READ_AHEAD_WINDOW = 4 * 1024 * 1024;
+
+    XDRInputMappedFileStream(unsigned int sizeLimit = 0)
+        : mSizeLimit{sizeLimit}
+    {
+    }
+
+    void
+    close()
+    {
+        ZoneScoped;
+        mFile.reset();
+        mPos = 0;
+        mReadAheadEnd = 0;
+    }
+
+    void
+    open(std::string const& filename)
+    {
+        ZoneScoped;
+        mFile = std::make_unique<fs::MappedFile>(filename);
+        mFile->adviseSequential();
+        mPos = 0;
+        mReadAheadEnd = 0;
+        maybeReadAhead();
+    }
+
+    operator bool() const
+    {
+        return mFile && mPos < mFile->size();
+    }
+
+    size_t
+    size() const
+    {
+        return mFile ? mFile->size() : 0;
+    }
+
+    size_t
+    pos() const
+    {
+        return mPos;
+    }
+
+    void
+    seek(size_t pos)
+    {
+        releaseAssertOrThrow(mFile && pos <= mFile->size());
+        mPos = pos;
+        mReadAheadEnd = pos;
+        maybeReadAhead();
+    }
+
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        ZoneScoped;
+        if (!mFile || mFile->size() - mPos < 4)
+        {
+            return false;
+        }
+
+        // Read 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
+        // (high bit of high byte).
+        auto p = reinterpret_cast<uint8_t const*>(mFile->data() + mPos);
+        uint32_t sz = 0;
+        sz |= static_cast<uint8_t>(p[0] & 0x7f);
+        sz <<= 8;
+        sz |= p[1];
+        sz <<= 8;
+        sz |= p[2];
+        sz <<= 8;
+        sz |= p[3];
+
+        if (mSizeLimit != 0 && sz > mSizeLimit)
+        {
+            return false;
+        }
+        if (mFile->size() - mPos - 4 < sz)
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        // Records are multiples of 4 bytes and the mapping is page aligned,
+        // so the payload is suitably aligned for xdr_get.
+        auto begin = mFile->data() + mPos + 4;
+        xdr::xdr_get g(begin, begin + sz);
+        xdr::xdr_argpack_archive(g, out);
+        mPos += 4 + sz;
+        maybeReadAhead();
+        return true;
+    }
+
+    // Advances past the next record without decoding it. Returns false at the
+    // end of the file.
+    bool
+    skipOne()
+    {
+        if (!mFile || mFile->size() - mPos < 4)
+        {
+            return false;
+        }
+        auto p = reinterpret_cast<uint8_t const*>(mFile->data() + mPos);
+        uint32_t sz = (static_cast<uint32_t>(p[0] & 0x7f) << 24) |
+                      (static_cast<uint32_t>(p[1]) << 16) |
+                      (static_cast<uint32_t>(p[2]) << 8) | p[3];
+        if (mFile->size() - mPos - 4 < sz)
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        mPos += 4 + sz;
+        maybeReadAhead();
+        return true;
+    }
+};
+
 // XDROutputFileStream needs access to a file descriptor to do fsync, so we use
 // asio's synchronous stream types here rather than fstreams.
 class XDROutputFileStream
@@ -305,21 +459,37 @@ class XDROutputFileStream
         xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
         xdr_argpack_archive(p, t);
 
-        size_t const to_write = sz + 4;
+        writeBytes(mBuf.data(), sz + 4, hasher, bytesPut);
+    }
+
+    // Writes already-framed XDR records, such as the contents of another
+    // file written by an XDROutputFileStream.
+    void
+    writeBytes(char const* data, size_t size, SHA256* hasher = nullptr,
+               size_t* bytesPut = nullptr)
+    {
+        ZoneScoped;
+        if (!isOpen())
+        {
+            FileSystemException::failWith(
+                "XDROutputFileStream::writeBytes() on non-open stream");
+        }
+
+        size_t const to_write = size;
         size_t written = 0;
         while (written < to_write)
         {
 #ifdef WIN32
-            auto w = fwrite(mBuf.data() + written, 1, to_write - written, mOut);
+            auto w = fwrite(data + written, 1, to_write - written, mOut);
             if (w == 0)
             {
                 FileSystemException::failWith(
-                    std::string("XDROutputFileStream::writeOne() failed"));
+                    std::string("XDROutputFileStream::writeBytes() failed"));
             }
             written += w;
 #else
             asio::error_code ec;
-            auto buf = asio::buffer(mBuf.data() + written, to_write - written);
+            auto buf = asio::buffer(data + written, to_write - written);
             written += asio::write(mBufferedWriteStream, buf, ec);
             if (ec)
             {
@@ -331,7 +501,7 @@ class XDROutputFileStream
                 {
                     FileSystemException::failWith(
                         std::string(
-                            "XDROutputFileStream::writeOne() failed: ") +
+                            "XDROutputFileStream::writeBytes() failed: ") +
                         ec.message());
                 }
             }
@@ -339,11 +509,11 @@ class XDROutputFileStream
         }
         if (hasher)
         {
-            hasher->add(ByteSlice(mBuf.data(), sz + 4));
+            hasher->add(ByteSlice(data, size));
         }
         if (bytesPut)
         {
-            *bytesPut += (sz + 4);
+            *bytesPut += size;
         }
     }
 };
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "lib/catch.hpp"
+#include "util/EvictionCache.h"
 #include "util/RandomEvictionCache.h"
 #include <ctime>
 #include <map>
@@ -153,7 +154,20 @@ TEST_CASE("RandomEvictionCache does not thrash",
 
 using RandCache = RandomEvictionCache<int, int>;
 
-TEMPLATE_TEST_CASE("cache empty", "[cache][template]", RandCache)
+template <CacheEvictionPolicy P>
+class PolicyCache : public EvictionCache<int, int>
+{
+  public:
+    explicit PolicyCache(size_t maxSize) : EvictionCache(maxSize, P)
+    {
+    }
+};
+using RandomPolicyCache = PolicyCache<CacheEvictionPolicy::RANDOM>;
+using ClockCache = PolicyCache<CacheEvictionPolicy::CLOCK>;
+using S3FifoCache = PolicyCache<CacheEvictionPolicy::S3FIFO>;
+
+TEMPLATE_TEST_CASE("cache empty", "[cache][template]", RandCache,
+                   RandomPolicyCache, ClockCache, S3FifoCache)
 {
     TestType c{5};
 
@@ -161,7 +175,7 @@ TEMPLATE_TEST_CASE("cache empty", "[cache][template]", RandCache)
 }
 
 TEMPLATE_TEST_CASE("cache keeps most added items", "[cache][template]",
-                   RandCache)
+                   RandCache, RandomPolicyCache, ClockCache, S3FifoCache)
 {
     TestType c{5};
     c.put(0, 0);
@@ -189,7 +203,7 @@ TEMPLATE_TEST_CASE("cache keeps most added items", "[cache][template]",
 }
 
 TEMPLATE_TEST_CASE("cache keeps last read items", "[cache][template]",
-                   RandCache)
+                   RandCache, RandomPolicyCache, ClockCache, S3FifoCache)
 {
     TestType c{5};
     c.put(0, 0);
@@ -213,7 +227,8 @@ TEMPLATE_TEST_CASE("cache keeps last read items", "[cache][template]",
 }
 
 TEMPLATE_TEST_CASE("cache keeps last read items with maybeGet",
-                   "[cache][template]", RandCache)
+                   "[cache][template]", RandCache, RandomPolicyCache,
+                   ClockCache, S3FifoCache)
 {
     TestType c{5};
     c.put(0, 0);
@@ -236,7 +251,8 @@ TEMPLATE_TEST_CASE("cache keeps last read items with maybeGet",
     REQUIRE(existing == 5);
 }
 
-TEMPLATE_TEST_CASE("cache replace element", "[cache][template]", RandCache)
+TEMPLATE_TEST_CASE("cache replace element", "[cache][template]", RandCache,
+                   RandomPolicyCache, ClockCache, S3FifoCache)
 {
     TestType c{5};
     c.put(0, 0);
@@ -319,3 +335,123 @@ TEMPLATE_TEST_CASE("cache erase_if removes all nodes", "[cache][template]",
     REQUIRE(!c.exists(3));
     REQUIRE(!c.exists(4));
 }
+
+TEST_CASE("EvictionCache matches a map under churn", "[cache]")
+{
+    // Small key space over a small cache exercises eviction and the
+    // backward-shift deletion in the hash table on every other put.
+    for (auto policy :
+         {CacheEvictionPolicy::RANDOM, CacheEvictionPolicy::CLOCK,
+          CacheEvictionPolicy::S3FIFO})
+    {
+        size_t sz = 100;
+        EvictionCache<int, int> cache(sz, policy);
+        std::map<int, int> latest;
+        for (int i = 0; i < 20000; ++i)
+        {
+            int k = rand_uniform<int>(0, 300);
+            if (rand_flip())
+            {
+                cache.put(k, i);
+                latest[k] = i;
+            }
+            else if (auto p = cache.maybeGet(k))
+            {
+                REQUIRE(*p == latest.at(k));
+            }
+            REQUIRE(cache.size() <= sz);
+        }
+        auto const& ctrs = cache.getCounters();
+        REQUIRE(cache.size() == sz);
+        REQUIRE(ctrs.mInserts - ctrs.mEvicts == sz);
+        size_t found = 0;
+        for (int k = 0; k <= 300; ++k)
+        {
+            if (auto p = cache.peek(k))
+            {
+                REQUIRE(*p == latest.at(k));
+                ++found;
+            }
+        }
+        REQUIRE(found == sz);
+    }
+}
+
+TEST_CASE("EvictionCache peek does not count", "[cache]")
+{
+    EvictionCache<int, int> cache(5, CacheEvictionPolicy::S3FIFO);
+    auto const& ctrs = cache.getCounters();
+    cache.put(0, 0);
+    REQUIRE(cache.peek(0) != nullptr);
+    REQUIRE(cache.peek(1) == nullptr);
+    *cache.peek(0) = 7;
+    REQUIRE(ctrs.mHits == 0);
+    REQUIRE(ctrs.mMisses == 0);
+    REQUIRE(cache.get(0) == 7);
+    REQUIRE(ctrs.mHits == 1);
+}
+
+TEST_CASE("EvictionCache of size zero stores nothing", "[cache]")
+{
+    EvictionCache<int, int> cache(0, CacheEvictionPolicy::CLOCK);
+    cache.put(0, 0);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.exists(0));
+}
+
+TEST_CASE("CLOCK cache gives accessed entries a second chance", "[cache]")
+{
+    size_t sz = 10;
+    EvictionCache<int, int> cache(sz, CacheEvictionPolicy::CLOCK);
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.put(i, i);
+    }
+    for (int i = 0; i < 10; i += 2)
+    {
+        cache.get(i);
+    }
+    // The hand skips the accessed even keys, so the odd ones go first.
+    for (int i = 10; i < 15; ++i)
+    {
+        cache.put(i, i);
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        REQUIRE(cache.exists(i, false) == (i % 2 == 0));
+    }
+}
+
+TEST_CASE("S3-FIFO cache keeps hot entries through a scan", "[cache]")
+{
+    size_t sz = 1000;
+    int hot = 100;
+    EvictionCache<int, int> s3fifo(sz, CacheEvictionPolicy::S3FIFO);
+    RandomEvictionCache<int, int> random(sz);
+    auto run = [&](auto& cache) {
+        for (int round = 0; round < 3; ++round)
+        {
+            for (int k = 0; k < hot; ++k)
+            {
+                if (!cache.maybeGet(k))
+                {
+                    cache.put(k, k);
+                }
+            }
+        }
+        // A one-off scan over ten times the cache size.
+        for (int k = hot; k < hot + 10 * static_cast<int>(sz); ++k)
+        {
+            cache.put(k, k);
+        }
+        size_t kept = 0;
+        for (int k = 0; k < hot; ++k)
+        {
+            kept += cache.exists(k, false) ? 1 : 0;
+        }
+        return kept;
+    };
+    REQUIRE(run(s3fifo) == static_cast<size_t>(hot));
+    // Without scan resistance the scan flushes most of the hot set.
+    REQUIRE(run(random) < static_cast<size_t>(hot) / 2);
+}
@@ -7,6 +7,7 @@
 #include "lib/catch.hpp"
 #include "test/test.h"
 #include "util/Logging.h"
+#include "util/XDRPipelinedOutputStream.h"
 #include "util/XDRStream.h"
 #include <fmt/format.h>
 
@@ -93,3 +94,154 @@ TEST_CASE("XDROutputFileStream fsync bench", "[!hide][xdrstream][bench]")
                   elapsed.count());
     }
 }
+
+TEST_CASE("XDRInputMappedFileStream reads like XDRInputFileStream",
+          "[xdrstream]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig(0);
+    fs::mkpath(cfg.BUCKET_DIR_PATH);
+    auto filename = fmt::format("{}/mapped.xdr", cfg.BUCKET_DIR_PATH);
+
+    auto ledgerEntries = LedgerTestUtils::generateValidLedgerEntries(1000);
+    auto bucketEntries =
+        Bucket::convertToBucketEntry(false, {}, ledgerEntries, {});
+    std::vector<size_t> offsets;
+    {
+        XDROutputFileStream out(clock.getIOContext(), /*doFsync=*/false);
+        out.open(filename);
+        size_t bytes = 0;
+        for (auto const& e : bucketEntries)
+        {
+            offsets.emplace_back(bytes);
+            out.writeOne(e, nullptr, &bytes);
+        }
+    }
+
+    XDRInputMappedFileStream in;
+    in.open(filename);
+    REQUIRE(in.size() == fs::size(filename));
+
+    SECTION("sequential read")
+    {
+        BucketEntry be;
+        for (size_t i = 0; i < bucketEntries.size(); ++i)
+        {
+            REQUIRE(in);
+            REQUIRE(in.pos() == offsets[i]);
+            REQUIRE(in.readOne(be));
+            REQUIRE(be == bucketEntries[i]);
+        }
+        REQUIRE(!in);
+        REQUIRE(!in.readOne(be));
+    }
+
+    SECTION("seek")
+    {
+        BucketEntry be;
+        in.seek(offsets[500]);
+        REQUIRE(in.readOne(be));
+        REQUIRE(be == bucketEntries[500]);
+        in.seek(offsets[10]);
+        REQUIRE(in.readOne(be));
+        REQUIRE(be == bucketEntries[10]);
+    }
+
+    SECTION("truncated file")
+    {
+        in.close();
+        std::filesystem::resize_file(filename, offsets.back() + 8);
+        in.open(filename);
+        in.seek(offsets.back());
+        BucketEntry be;
+        REQUIRE_THROWS_AS(in.readOne(be), xdr::xdr_runtime_error);
+    }
+
+    SECTION("empty file")
+    {
+        in.close();
+        std::filesystem::resize_file(filename, 0);
+        in.open(filename);
+        BucketEntry be;
+        REQUIRE(!in);
+        REQUIRE(!in.readOne(be));
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("XDRPipelinedOutputFileStream matches XDROutputFileStream",
+          "[xdrstream]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig(0);
+    fs::mkpath(cfg.BUCKET_DIR_PATH);
+    auto plainName = fmt::format("{}/plain.xdr", cfg.BUCKET_DIR_PATH);
+    auto pipelinedName = fmt::format("{}/pipelined.xdr", cfg.BUCKET_DIR_PATH);
+
+    auto check = [&](std::vector<BucketEntry> const& entries) {
+        SHA256 hasher;
+        size_t plainBytes = 0;
+        {
+            XDROutputFileStream out(clock.getIOContext(), /*doFsync=*/false);
+            out.open(plainName);
+            for (auto const& e : entries)
+            {
+                out.writeOne(e, &hasher, &plainBytes);
+            }
+            out.close();
+        }
+
+        size_t pipelinedBytes = 0;
+        XDRPipelinedOutputFileStream out(clock.getIOContext(),
+                                         /*fsyncOnClose=*/false);
+        out.open(pipelinedName);
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            // Mix in raw appends of pre-framed records.
+            if (i % 7 == 0)
+            {
+                auto bytes = xdr::xdr_to_opaque(entries[i]);
+                uint32_t sz = static_cast<uint32_t>(bytes.size());
+                char header[4] = {
+                    static_cast<char>(((sz >> 24) & 0xFF) | 0x80),
+                    static_cast<char>((sz >> 16) & 0xFF),
+                    static_cast<char>((sz >> 8) & 0xFF),
+                    static_cast<char>(sz & 0xFF)};
+                out.writeBytes(header, 4, &pipelinedBytes);
+                out.writeBytes(reinterpret_cast<char const*>(bytes.data()),
+                               bytes.size(), &pipelinedBytes);
+            }
+            else
+            {
+                out.writeOne(entries[i], &pipelinedBytes);
+            }
+        }
+        REQUIRE(out.close() == hasher.finish());
+        REQUIRE(pipelinedBytes == plainBytes);
+
+        std::ifstream a(plainName, std::ios::binary);
+        std::ifstream b(pipelinedName, std::ios::binary);
+        std::string plain((std::istreambuf_iterator<char>(a)),
+                          std::istreambuf_iterator<char>());
+        std::string pipelined((std::istreambuf_iterator<char>(b)),
+                              std::istreambuf_iterator<char>());
+        REQUIRE(plain == pipelined);
+    };
+
+    SECTION("output smaller than one buffer")
+    {
+        auto entries = Bucket::convertToBucketEntry(
+            false, {}, LedgerTestUtils::generateValidLedgerEntries(10), {});
+        check(entries);
+    }
+
+    SECTION("output spanning many buffers")
+    {
+        auto entries = Bucket::convertToBucketEntry(
+            false, {}, LedgerTestUtils::generateValidLedgerEntries(50000), {});
+        check(entries);
+    }
+
+    std::remove(plainName.c_str());
+    std::remove(pipelinedName.c_str());
+}
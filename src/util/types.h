@@ -16,6 +16,10 @@ typedef std::vector<unsigned char> Blob;
 
 LedgerKey LedgerEntryKey(LedgerEntry const& e);
 
+// Returns the LedgerKey of a LIVEENTRY, INITENTRY or DEADENTRY. Throws on
+// METAENTRY, which has no key.
+LedgerKey getBucketLedgerKey(BucketEntry const& be);
+
 bool isZero(uint256 const& b);
 
 Hash& operator^=(Hash& l, Hash const& r);